@@ -0,0 +1,1103 @@
+/*
+ * Пропускная способность API разбора на детерминированном синтетическом
+ * корпусе: все поддерживаемые типы предложений плюс ошибочные строки
+ * (неверная контрольная сумма, обрезанные, мусор, слишком длинные,
+ * неизвестные типы).
+ *
+ * nmea_bench [--json] [--seed N] [--count N] [--rounds N]
+ * NMEA_KERNEL=scalar|sse2|avx2 - выбор реализации разметки, nmea_coord и nmea_geo
+ *
+ * Вывод --json стабилен по составу и порядку полей и предназначен
+ * для сравнения версий между собой.
+ */
+#include "nmea.h"
+#include "nmea_layout.h"
+#include "nmea_batch.h"
+#include "nmea_log.h"
+#include "nmea_write.h"
+#include "nmea_ubx.h"
+#include "nmea_coord.h"
+#include "nmea_geo.h"
+#include "nmea_fixed.h"
+#include "nmea_thin.h"
+#ifndef _WIN32
+#include "nmea_replay.h"
+#include <unistd.h>
+#endif
+
+
+
+//------------------- DEFINES -----------------------------
+#define BENCH_SEED					20240601u
+#define BENCH_COUNT					8192		// предложений в корпусе
+#define BENCH_ROUNDS				50			// проходов по корпусу на замер
+#define BENCH_REPLAY_SIZE			(64 << 20)
+#define BENCH_LINE					(NMEA_MAX_LENGTH + 64)
+
+
+//------------------- VARIABLES ---------------------------
+enum bench_kind {
+	BENCH_VALID = 0,
+	BENCH_BAD_CHECKSUM,
+	BENCH_TRUNCATED,
+	BENCH_JUNK,
+	BENCH_OVERLONG,
+	BENCH_UNKNOWN,
+	BENCH_KINDS
+};
+
+static const char *kind_names[BENCH_KINDS] = {
+	"valid", "bad_checksum", "truncated", "junk", "overlong", "unknown"
+};
+
+struct corpus {
+	char **lines;				// строки без "\r\n", завершенные '\0'
+	size_t *lens;
+	enum nmea_sentence_id *ids;	// тип корректной строки, NMEA_INVALID для ошибочных
+	enum bench_kind *kinds;
+	size_t count;
+	char *text;					// все строки подряд через "\r\n"
+	size_t len;
+};
+
+struct result {
+	const char *name;
+	size_t sentences;			// за один проход
+	double ns;					// на предложение
+	double mbps;
+	long ok;					// успешно разобрано за один проход
+};
+
+static struct result results[64];
+static size_t nresults;
+static uint32_t lcg_state;
+static int rounds = BENCH_ROUNDS;
+static volatile long sink;
+static size_t log_text, log_size;	// текст трека и его журнал nmea_log, байт
+static double replay_gbps[8];		// nmea_replay на 1, 2, 4... потоках, ГБ/с
+static size_t nreplay;
+
+
+//------------------- FUNCTIONS ---------------------------
+static uint32_t lcg(void)
+{
+	lcg_state = lcg_state * 1664525u + 1013904223u;
+	return lcg_state >> 8;
+}
+
+static int rnd(int n)
+{
+	return (int) (lcg() % (uint32_t) n);
+}
+
+static double now_ns(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static const char *talker(void)
+{
+	static const char *talkers[] = {"GP", "GN", "GL", "GA", "BD"};
+	return talkers[rnd(5)];
+}
+
+static int gen_time(char *p)
+{
+	return sprintf(p, "%02d%02d%02d.%02d", rnd(24), rnd(60), rnd(60), rnd(100));
+}
+
+static int gen_coord(char *p, int degrees)
+{
+	return sprintf(p, degrees == 2 ? "%02d%02d.%04d,%c" : "%03d%02d.%04d,%c",
+	               rnd(degrees == 2 ? 90 : 180), rnd(60), rnd(10000),
+	               degrees == 2 ? "NS"[rnd(2)] : "EW"[rnd(2)]);
+}
+
+static int gen_float(char *p, int whole)
+{
+	return sprintf(p, "%d.%d", rnd(whole), rnd(10));
+}
+
+// Тело предложения без '$' и контрольной суммы
+static int gen_body(char *p, enum nmea_sentence_id id)
+{
+	char *s = p;
+
+	switch (id) {
+		case NMEA_SENTENCE_RMC:
+			p += sprintf(p, "%sRMC,", talker());
+			p += gen_time(p);
+			p += sprintf(p, ",%c,", "AV"[rnd(8) == 0]);
+			p += gen_coord(p, 2);
+			*p++ = ',';
+			p += gen_coord(p, 3);
+			*p++ = ',';
+			p += gen_float(p, 200);
+			*p++ = ',';
+			p += gen_float(p, 360);
+			p += sprintf(p, ",%02d%02d%02d,", 1 + rnd(28), 1 + rnd(12), rnd(100));
+			p += gen_float(p, 30);
+			p += sprintf(p, ",%c", "EW"[rnd(2)]);
+			break;
+		case NMEA_SENTENCE_GGA:
+			p += sprintf(p, "%sGGA,", talker());
+			p += gen_time(p);
+			*p++ = ',';
+			p += gen_coord(p, 2);
+			*p++ = ',';
+			p += gen_coord(p, 3);
+			p += sprintf(p, ",%d,%02d,", rnd(6), rnd(24));
+			p += gen_float(p, 5);
+			*p++ = ',';
+			p += gen_float(p, 3000);
+			p += sprintf(p, ",M,");
+			p += gen_float(p, 60);
+			p += sprintf(p, rnd(4) ? ",M,," : ",M,1.2,0031");
+			break;
+		case NMEA_SENTENCE_GSA:
+			p += sprintf(p, "%sGSA,%c,%d", talker(), "AM"[rnd(4) == 0], 1 + rnd(3));
+			for (int i = 0; i < 12; i++)
+				p += rnd(3) ? sprintf(p, ",%02d", 1 + rnd(32)) : sprintf(p, ",");
+			for (int i = 0; i < 3; i++) {
+				*p++ = ',';
+				p += gen_float(p, 10);
+			}
+			break;
+		case NMEA_SENTENCE_GLL:
+			p += sprintf(p, "%sGLL,", talker());
+			p += gen_coord(p, 2);
+			*p++ = ',';
+			p += gen_coord(p, 3);
+			*p++ = ',';
+			p += gen_time(p);
+			p += sprintf(p, ",%c,%c", "AV"[rnd(8) == 0], "ADN"[rnd(3)]);
+			break;
+		case NMEA_SENTENCE_GST:
+			p += sprintf(p, "%sGST,", talker());
+			p += gen_time(p);
+			for (int i = 0; i < 7; i++) {
+				*p++ = ',';
+				p += gen_float(p, i == 3 ? 180 : 50);
+			}
+			break;
+		case NMEA_SENTENCE_GSV: {
+			int total = 1 + rnd(16);
+			int msgs = (total + 3) / 4;
+			int nr = 1 + rnd(msgs);
+			int sats = nr < msgs ? 4 : total - 4 * (msgs - 1);
+			p += sprintf(p, "%sGSV,%d,%d,%02d", talker(), msgs, nr, total);
+			for (int i = 0; i < sats; i++)
+				p += sprintf(p, ",%02d,%02d,%03d,%02d", 1 + rnd(32), rnd(90), rnd(360), rnd(55));
+			break;
+		}
+		case NMEA_SENTENCE_VTG:
+			p += sprintf(p, "%sVTG,", talker());
+			p += gen_float(p, 360);
+			p += sprintf(p, ",T,");
+			p += gen_float(p, 360);
+			p += sprintf(p, ",M,");
+			p += gen_float(p, 100);
+			p += sprintf(p, ",N,");
+			p += gen_float(p, 200);
+			p += sprintf(p, ",K,%c", "ADE"[rnd(3)]);
+			break;
+		case NMEA_SENTENCE_ZDA:
+			p += sprintf(p, "%sZDA,", talker());
+			p += gen_time(p);
+			p += sprintf(p, ",%02d,%02d,%04d,00,00", 1 + rnd(28), 1 + rnd(12), 1990 + rnd(40));
+			break;
+		default:
+			p += sprintf(p, "%sXYZ,%d,%d,%d", talker(), rnd(1000), rnd(1000), rnd(1000));
+			break;
+	}
+
+	return (int) (p - s);
+}
+
+static int gen_checksum(char *line, int n)
+{
+	uint8_t sum = 0;
+	for (int i = 1; i < n; i++)
+		sum ^= (uint8_t) line[i];
+	return n + sprintf(line + n, "*%02X", sum);
+}
+
+static const enum nmea_sentence_id types[] = {
+	NMEA_SENTENCE_RMC, NMEA_SENTENCE_GGA, NMEA_SENTENCE_GSA, NMEA_SENTENCE_GLL,
+	NMEA_SENTENCE_GST, NMEA_SENTENCE_GSV, NMEA_SENTENCE_VTG, NMEA_SENTENCE_ZDA,
+};
+#define TYPES_COUNT					(sizeof(types) / sizeof(types[0]))
+
+// Одна строка корпуса; примерно 1/8 строк - ошибочные
+static int gen_line(char *line, enum nmea_sentence_id *id, enum bench_kind *kind)
+{
+	int n;
+
+	*id = types[rnd(TYPES_COUNT)];
+	*kind = rnd(8) ? BENCH_VALID : (enum bench_kind) (1 + rnd(BENCH_KINDS - 1));
+
+	line[0] = '$';
+	switch (*kind) {
+		case BENCH_VALID:
+			n = gen_checksum(line, 1 + gen_body(line + 1, *id));
+			break;
+		case BENCH_BAD_CHECKSUM:
+			n = gen_checksum(line, 1 + gen_body(line + 1, *id));
+			line[n - 1] = line[n - 1] == '0' ? '1' : '0';
+			break;
+		case BENCH_TRUNCATED:
+			n = gen_checksum(line, 1 + gen_body(line + 1, *id));
+			n = 7 + rnd(n - 8);
+			line[n] = '\0';
+			break;
+		case BENCH_JUNK:
+			n = 1 + rnd(60);
+			for (int i = 1; i < n; i++)
+				line[i] = (char) (0x21 + rnd(0x5e));
+			line[n] = '\0';
+			break;
+		case BENCH_OVERLONG:
+			n = 1 + gen_body(line + 1, NMEA_SENTENCE_GSA);
+			while (n < NMEA_MAX_LENGTH + 8)
+				n += sprintf(line + n, ",%02d", rnd(100));
+			n = gen_checksum(line, n);
+			break;
+		default:
+			n = gen_checksum(line, 1 + gen_body(line + 1, NMEA_UNKNOWN));
+			break;
+	}
+
+	if (*kind != BENCH_VALID)
+		*id = NMEA_INVALID;
+	return n;
+}
+
+static bool corpus_init(struct corpus *c, size_t count, uint32_t seed)
+{
+	char line[BENCH_LINE];
+
+	memset(c, 0, sizeof(*c));
+	c->lines = calloc(count, sizeof(*c->lines));
+	c->lens = calloc(count, sizeof(*c->lens));
+	c->ids = calloc(count, sizeof(*c->ids));
+	c->kinds = calloc(count, sizeof(*c->kinds));
+	c->text = malloc(count * (BENCH_LINE + 2));
+	if (!c->lines || !c->lens || !c->ids || !c->kinds || !c->text)
+		return false;
+
+	lcg_state = seed;
+	for (size_t i = 0; i < count; i++) {
+		int n = gen_line(line, &c->ids[i], &c->kinds[i]);
+		c->lines[i] = malloc((size_t) n + 1);
+		if (!c->lines[i])
+			return false;
+		memcpy(c->lines[i], line, (size_t) n + 1);
+		c->lens[i] = (size_t) n;
+		memcpy(c->text + c->len, line, (size_t) n);
+		memcpy(c->text + c->len + n, "\r\n", 2);
+		c->len += (size_t) n + 2;
+		c->count++;
+	}
+
+	return true;
+}
+
+static void corpus_free(struct corpus *c)
+{
+	for (size_t i = 0; i < c->count; i++)
+		free(c->lines[i]);
+	free(c->lines);
+	free(c->lens);
+	free(c->ids);
+	free(c->kinds);
+	free(c->text);
+}
+
+static void record(const char *name, size_t sentences, size_t bytes, double ns, long ok)
+{
+	struct result *r = &results[nresults++];
+
+	r->name = name;
+	r->sentences = sentences;
+	r->ns = sentences ? ns / sentences : 0.0;
+	r->mbps = ns > 0 ? bytes / ns * 1e3 : 0.0;
+	r->ok = ok;
+}
+
+// Замер функции по строкам корпуса; id != NMEA_INVALID - только строки этого типа
+static void run(const struct corpus *c, const char *name, enum nmea_sentence_id id, bool (*parse)(const char *))
+{
+	size_t sentences = 0, bytes = 0;
+	long ok = 0;
+
+	for (size_t i = 0; i < c->count; i++) {
+		if (id != NMEA_INVALID && c->ids[i] != id)
+			continue;
+		sentences++;
+		bytes += c->lens[i];
+		ok += parse(c->lines[i]);
+	}
+
+	double start = now_ns();
+	for (int r = 0; r < rounds; r++)
+		for (size_t i = 0; i < c->count; i++)
+			if (id == NMEA_INVALID || c->ids[i] == id)
+				sink += parse(c->lines[i]);
+	record(name, sentences, bytes, (now_ns() - start) / rounds, ok);
+}
+
+static bool check(const char *sentence)
+{
+	return nmea_check(sentence, false);
+}
+
+static bool check_strict(const char *sentence)
+{
+	return nmea_check(sentence, true);
+}
+
+static bool sentence_id(const char *sentence)
+{
+	return nmea_sentence_id(sentence, false) > NMEA_UNKNOWN;
+}
+
+static bool parse_any(const char *sentence)
+{
+	struct nmea_sentence frame;
+	return nmea_parse_any(&frame, sentence, false) > NMEA_UNKNOWN;
+}
+
+static bool parse_legacy(const char *sentence)
+{
+	struct nmea_sentence frame;
+
+	switch (nmea_sentence_id(sentence, false)) {
+		case NMEA_SENTENCE_RMC: return nmea_parse_rmc(&frame.data.rmc, sentence);
+		case NMEA_SENTENCE_GGA: return nmea_parse_gga(&frame.data.gga, sentence);
+		case NMEA_SENTENCE_GSA: return nmea_parse_gsa(&frame.data.gsa, sentence);
+		case NMEA_SENTENCE_GLL: return nmea_parse_gll(&frame.data.gll, sentence);
+		case NMEA_SENTENCE_GST: return nmea_parse_gst(&frame.data.gst, sentence);
+		case NMEA_SENTENCE_GSV: return nmea_parse_gsv(&frame.data.gsv, sentence);
+		case NMEA_SENTENCE_VTG: return nmea_parse_vtg(&frame.data.vtg, sentence);
+		case NMEA_SENTENCE_ZDA: return nmea_parse_zda(&frame.data.zda, sentence);
+		default: return false;
+	}
+}
+
+#define BENCH_PARSER(type) \
+	static bool parse_##type(const char *sentence) \
+	{ \
+		struct nmea_sentence_##type frame; \
+		return nmea_parse_##type(&frame, sentence); \
+	}
+BENCH_PARSER(rmc)
+BENCH_PARSER(gga)
+BENCH_PARSER(gsa)
+BENCH_PARSER(gll)
+BENCH_PARSER(gst)
+BENCH_PARSER(gsv)
+BENCH_PARSER(vtg)
+BENCH_PARSER(zda)
+
+// Выборочный разбор: только координаты / только время
+#define BENCH_FIELDS(type, name, mask) \
+	static bool parse_##type##_##name(const char *sentence) \
+	{ \
+		struct nmea_sentence_##type frame; \
+		return nmea_parse_##type##_fields(&frame, sentence, mask); \
+	}
+BENCH_FIELDS(rmc, position, NMEA_FIELD_POSITION)
+BENCH_FIELDS(rmc, time, NMEA_FIELD_TIME)
+BENCH_FIELDS(gga, position, NMEA_FIELD_POSITION)
+BENCH_FIELDS(gga, time, NMEA_FIELD_TIME)
+BENCH_FIELDS(gsa, status, NMEA_FIELD_STATUS)
+
+static bool parse_fields_position(const char *sentence)
+{
+	struct nmea_sentence frame;
+	return nmea_parse_fields(&frame, sentence, false, NMEA_FIELD_TIME | NMEA_FIELD_POSITION) > NMEA_UNKNOWN;
+}
+
+// nmea_gettime по дате и времени из корректных RMC
+static void run_gettime(const struct corpus *c)
+{
+	struct nmea_sentence_rmc *frames = calloc(c->count, sizeof(*frames));
+	size_t n = 0, bytes = 0;
+	long ok = 0;
+	struct timespec ts;
+
+	if (!frames)
+		return;
+	for (size_t i = 0; i < c->count; i++) {
+		if (c->ids[i] == NMEA_SENTENCE_RMC && nmea_parse_rmc(&frames[n], c->lines[i])) {
+			bytes += c->lens[i];
+			n++;
+		}
+	}
+	for (size_t i = 0; i < n; i++)
+		ok += nmea_gettime(&ts, &frames[i].date, &frames[i].time) == 0;
+
+	double start = now_ns();
+	for (int r = 0; r < rounds; r++)
+		for (size_t i = 0; i < n; i++)
+			sink += nmea_gettime(&ts, &frames[i].date, &frames[i].time) + (long) ts.tv_sec;
+	record("nmea_gettime", n, bytes, (now_ns() - start) / rounds, ok);
+	free(frames);
+}
+
+// Разбор прямо из буфера приема (c->text): с копированием строки ради '\0'
+// и по длине без копирования
+static void run_text(const struct corpus *c)
+{
+	struct nmea_sentence frame;
+	char line[NMEA_MAX_LENGTH * 4];
+	long ok = 0, ok_n = 0;
+
+	for (int copy = 1; copy >= 0; copy--) {
+		double start = now_ns();
+		for (int r = 0; r < rounds; r++) {
+			const char *p = c->text;
+			for (size_t i = 0; i < c->count; i++) {
+				size_t n = c->lens[i] + 2;
+				if (copy) {
+					size_t m = n < sizeof(line) ? n : sizeof(line) - 1;
+					memcpy(line, p, m);
+					line[m] = '\0';
+					ok += nmea_parse_any(&frame, line, false) > NMEA_UNKNOWN;
+				} else {
+					ok_n += nmea_parse_any_n(&frame, p, n, false) > NMEA_UNKNOWN;
+				}
+				p += n;
+			}
+		}
+		record(copy ? "copy+nmea_parse_any" : "nmea_parse_any_n", c->count, c->len,
+		       (now_ns() - start) / rounds, (copy ? ok : ok_n) / rounds);
+	}
+}
+
+// Журнал nmea_log против повторного разбора текста: плавный трек 1 Гц,
+// RMC + GGA на эпоху
+static void run_log(const struct corpus *c)
+{
+	size_t epochs = c->count / 2;
+	char *text = malloc(epochs * 2 * (BENCH_LINE + 2));
+	size_t *offsets = malloc(epochs * 2 * sizeof(*offsets));
+	struct nmea_log_record *records = malloc(NMEA_LOG_BLOCK * sizeof(*records));
+	struct nmea_log_writer *writer = NULL;
+	uint64_t *data = NULL;
+	FILE *file = tmpfile();
+	long ok = 0;
+
+	if (!text || !offsets || !records || !file || !(writer = nmea_log_writer_create(file)))
+		goto out;
+
+	int latitude = 4807 * 10000, longitude = 1131 * 10000, altitude = 5454;
+	size_t len = 0;
+	for (size_t i = 0; i < epochs; i++) {
+		int t = (int) (43200 + i % 43200);
+		char line[BENCH_LINE];
+		int n;
+
+		latitude += rnd(21) - 8;
+		longitude += rnd(21) - 10;
+		altitude += rnd(3) - 1;
+		line[0] = '$';
+		n = 1 + sprintf(line + 1, "GPRMC,%02d%02d%02d.00,A,%04d.%04d,N,%05d.%04d,E,%d.%d,%d.%d,150624,,",
+		                t / 3600, t / 60 % 60, t % 60, latitude / 10000, latitude % 10000,
+		                longitude / 10000, longitude % 10000, 20 + rnd(5), rnd(10), 45 + rnd(3), rnd(10));
+		n = gen_checksum(line, n);
+		offsets[2 * i] = len;
+		// '\0' на месте '\r': строка для nmea_parse_*, размер как у текста
+		memcpy(text + len, line, (size_t) n + 1);
+		len += (size_t) n + 2;
+		text[len - 1] = '\n';
+
+		n = 1 + sprintf(line + 1, "GPGGA,%02d%02d%02d.00,%04d.%04d,N,%05d.%04d,E,1,%02d,0.9,%d.%d,M,46.9,M,,",
+		                t / 3600, t / 60 % 60, t % 60, latitude / 10000, latitude % 10000,
+		                longitude / 10000, longitude % 10000, 8 + rnd(2), altitude / 10, altitude % 10);
+		n = gen_checksum(line, n);
+		offsets[2 * i + 1] = len;
+		memcpy(text + len, line, (size_t) n + 1);
+		len += (size_t) n + 2;
+		text[len - 1] = '\n';
+	}
+
+	// Повторный разбор текста в записи
+	double start = now_ns();
+	for (int r = 0; r < rounds; r++) {
+		ok = 0;
+		for (size_t i = 0; i < epochs; i++) {
+			struct nmea_sentence_rmc rmc;
+			struct nmea_sentence_gga gga;
+			struct nmea_log_record *record = &records[i % NMEA_LOG_BLOCK];
+			struct timespec ts;
+
+			if (!nmea_parse_rmc(&rmc, text + offsets[2 * i]) || !nmea_parse_gga(&gga, text + offsets[2 * i + 1]) ||
+			    nmea_gettime(&ts, &rmc.date, &rmc.time))
+				continue;
+			record->time = (int64_t) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+			record->latitude = gga.latitude;
+			record->longitude = gga.longitude;
+			record->altitude = gga.altitude;
+			record->speed = rmc.speed;
+			record->course = rmc.course;
+			record->hdop = gga.hdop;
+			record->fix_quality = gga.fix_quality;
+			record->satellites = gga.satellites_tracked;
+			record->valid = rmc.valid;
+			if (r == 0 && nmea_log_append(writer, record))
+				goto out;
+			ok++;
+		}
+	}
+	record("track parse rmc+gga", epochs, len, (now_ns() - start) / rounds, ok);
+
+	if (nmea_log_writer_close(writer))
+		goto out;
+	writer = NULL;
+	log_text = len;
+	log_size = (size_t) ftell(file);
+	data = malloc(log_size);
+	rewind(file);
+	if (!data || fread(data, 1, log_size, file) != log_size)
+		goto out;
+
+	start = now_ns();
+	for (int r = 0; r < rounds; r++) {
+		struct nmea_log_reader reader;
+		const struct nmea_log_block *block;
+
+		ok = 0;
+		nmea_log_reader_init(&reader, data, log_size);
+		while ((block = nmea_log_next(&reader)))
+			ok += nmea_log_decode(block, records);
+		sink += records[0].latitude.value;
+	}
+	record("nmea_log_decode", epochs, log_size, (now_ns() - start) / rounds, ok);
+
+out:
+	if (writer)
+		nmea_log_writer_close(writer);
+	if (file)
+		fclose(file);
+	free(data);
+	free(records);
+	free(offsets);
+	free(text);
+}
+
+// Формирование предложений из разобранных структур корпуса;
+// ok - совпадение повторного разбора с исходной структурой
+static void run_write(const struct corpus *c)
+{
+	struct nmea_sentence *frames = calloc(c->count, sizeof(*frames));
+	char buf[NMEA_WRITE_MAX];
+	size_t count = 0, bytes = 0;
+	long ok = 0;
+
+	if (!frames)
+		return;
+	// Слот обнуляется перед каждым разбором: неудачный разбор оставляет
+	// поля и выравнивание, а сравнение ниже побайтовое
+	for (size_t i = 0; i < c->count; i++) {
+		memset(&frames[count], 0, sizeof(frames[count]));
+		if (nmea_parse_any(&frames[count], c->lines[i], false) > NMEA_UNKNOWN)
+			count++;
+	}
+
+	for (size_t i = 0; i < count; i++) {
+		struct nmea_sentence again;
+		memset(&again, 0, sizeof(again));
+		bytes += nmea_write_sentence(buf, &frames[i]);
+		ok += nmea_parse_any(&again, buf, true) == frames[i].id &&
+		      !memcmp(&again.data, &frames[i].data, sizeof(again.data));
+	}
+
+	double start = now_ns();
+	for (int r = 0; r < rounds; r++)
+		for (size_t i = 0; i < count; i++)
+			sink += (long) nmea_write_sentence(buf, &frames[i]);
+	record("nmea_write_sentence", count, bytes, (now_ns() - start) / rounds, ok);
+
+	free(frames);
+}
+
+static void put_le(uint8_t *p, uint32_t v, int n)
+{
+	for (int i = 0; i < n; i++)
+		p[i] = (uint8_t) (v >> (8 * i));
+}
+
+// Эпоха 1 Гц: RMC + GGA + GSA + 3 GSV текстом против одного NAV-PVT
+// в том же смешанном потоке; ok - эпох с разобранными координатами
+static void run_ubx(const struct corpus *c)
+{
+	static const char *const lines[] = {
+		"$GPRMC,081836.00,A,3751.65000,S,14507.36000,E,0.012,360.0,130998,011.3,E,A",
+		"$GPGGA,081836.00,3751.65000,S,14507.36000,E,1,09,0.9,15.2,M,-21.4,M,,",
+		"$GPGSA,A,3,04,05,09,12,24,25,29,31,32,,,,1.8,0.9,1.5",
+		"$GPGSV,3,1,11,04,35,211,42,05,63,107,45,09,11,323,38,12,52,034,44",
+		"$GPGSV,3,2,11,24,18,075,40,25,41,263,43,29,27,142,41,31,08,298,35",
+		"$GPGSV,3,3,11,32,13,190,37,02,02,045,,10,05,350,",
+	};
+	size_t epochs = c->count / 6;
+	char text[6 * (BENCH_LINE + 2)];
+	uint8_t frame[NMEA_UBX_NAV_PVT_LEN + NMEA_UBX_OVERHEAD] = {NMEA_UBX_SYNC1, NMEA_UBX_SYNC2,
+	                                                          NMEA_UBX_CLASS_NAV, NMEA_UBX_NAV_PVT,
+	                                                          NMEA_UBX_NAV_PVT_LEN, 0};
+	uint8_t *pvt = frame + NMEA_UBX_HEADER;
+	struct nmea_ubx_stream *stream = malloc(sizeof(*stream));
+	struct nmea_ubx_item item;
+	struct nmea_sentence sentence;
+	struct nmea_fix fix;
+	size_t len = 0;
+	long ok = 0;
+
+	if (!stream)
+		return;
+	for (size_t i = 0; i < sizeof(lines) / sizeof(lines[0]); i++) {
+		int n = sprintf(text + len, "%s", lines[i]);
+		n = gen_checksum(text + len, n);
+		text[len + n] = '\r';
+		text[len + n + 1] = '\n';
+		len += (size_t) n + 2;
+	}
+
+	put_le(pvt + 4, 1998, 2);
+	pvt[6] = 9, pvt[7] = 13, pvt[8] = 8, pvt[9] = 18, pvt[10] = 36;
+	pvt[11] = 0x07;
+	pvt[20] = 3, pvt[21] = 0x01, pvt[23] = 9;
+	put_le(pvt + 24, 1451226000, 4);
+	put_le(pvt + 28, (uint32_t) -378608333, 4);
+	put_le(pvt + 32, (uint32_t) -6200, 4);
+	put_le(pvt + 36, 15200, 4);
+	put_le(pvt + 76, 180, 2);
+	uint16_t ck = nmea_ubx_checksum(frame + 2, NMEA_UBX_NAV_PVT_LEN + 4);
+	put_le(frame + NMEA_UBX_HEADER + NMEA_UBX_NAV_PVT_LEN, ck, 2);
+
+	for (int ubx = 0; ubx < 2; ubx++) {
+		nmea_ubx_init(stream);
+		ok = 0;
+		double start = now_ns();
+		for (int r = 0; r < rounds; r++) {
+			for (size_t e = 0; e < epochs; e++) {
+				bool position = false;
+				if (ubx)
+					nmea_ubx_push(stream, frame, sizeof(frame));
+				else
+					nmea_ubx_push(stream, text, len);
+				while (nmea_ubx_next(stream, &item)) {
+					if (item.kind == NMEA_UBX_PACKET) {
+						nmea_ubx_fix_init(&fix);
+						position |= nmea_ubx_nav_pvt(&fix, &item.data.packet);
+					} else {
+						position |= nmea_parse_any(&sentence, item.data.sentence.data, false) == NMEA_SENTENCE_GGA;
+					}
+				}
+				ok += position;
+			}
+		}
+		record(ubx ? "epoch_ubx_nav_pvt" : "epoch_nmea_text", epochs, epochs * (ubx ? sizeof(frame) : len),
+		       (now_ns() - start) / rounds, ok / rounds);
+	}
+
+	free(stream);
+}
+
+// Координаты корректных RMC: nmea_tocoord по одной против пакетного перевода
+static void run_coord(const struct corpus *c)
+{
+	struct nmea_float *coords = calloc(2 * c->count, sizeof(*coords));
+	double *deg = calloc(2 * c->count, sizeof(*deg));
+	int32_t *e7 = calloc(2 * c->count, sizeof(*e7));
+	struct nmea_sentence_rmc frame;
+	size_t n = 0, bytes = 0;
+	long ok = 0;
+
+	if (!coords || !deg || !e7)
+		goto out;
+	for (size_t i = 0; i < c->count; i++) {
+		if (c->ids[i] == NMEA_SENTENCE_RMC && nmea_parse_rmc(&frame, c->lines[i])) {
+			coords[n++] = frame.latitude;
+			coords[n++] = frame.longitude;
+			bytes += 2 * sizeof(*coords);
+		}
+	}
+
+	double start = now_ns();
+	for (int r = 0; r < rounds; r++)
+		for (size_t i = 0; i < n; i++)
+			deg[i] = nmea_tocoord(&coords[i]);
+	for (size_t i = 0; i < n; i++)
+		ok += deg[i] == deg[i];
+	record("nmea_tocoord", n, bytes, (now_ns() - start) / rounds, ok);
+
+	ok = 0;
+	start = now_ns();
+	for (int r = 0; r < rounds; r++)
+		nmea_coord_degrees(deg, coords, n);
+	for (size_t i = 0; i < n; i++)
+		ok += deg[i] == deg[i];
+	record("nmea_coord_degrees", n, bytes, (now_ns() - start) / rounds, ok);
+
+	ok = 0;
+	start = now_ns();
+	for (int r = 0; r < rounds; r++)
+		nmea_coord_e7(e7, coords, n);
+	for (size_t i = 0; i < n; i++)
+		ok += e7[i] != NMEA_COORD_NONE;
+	record("nmea_coord_e7", n, bytes, (now_ns() - start) / rounds, ok);
+
+out:
+	free(coords);
+	free(deg);
+	free(e7);
+}
+
+// Точки корректных GGA в ECEF: libm по одной точке против пакета, ENU и UTM
+static void run_geo(const struct corpus *c)
+{
+	struct nmea_sentence_gga *gga = calloc(c->count, sizeof(*gga));
+	double *col = calloc(6 * c->count, sizeof(*col));
+	int8_t *zone = calloc(c->count, sizeof(*zone));
+	struct nmea_geo_origin origin;
+	size_t n = 0, bytes = 0;
+
+	if (!gga || !col || !zone)
+		goto out;
+	for (size_t i = 0; i < c->count; i++) {
+		if (c->ids[i] == NMEA_SENTENCE_GGA && nmea_parse_gga(&gga[n], c->lines[i])) {
+			bytes += c->lens[i];
+			n++;
+		}
+	}
+
+	double *lat = col, *lon = col + n, *h = col + 2 * n, *x = col + 3 * n, *y = col + 4 * n, *z = col + 5 * n;
+	long ok = (long) nmea_geo_from_gga(lat, lon, h, gga, n);
+
+	double start = now_ns();
+	for (int r = 0; r < rounds; r++) {
+		for (size_t i = 0; i < n; i++) {
+			const double a = NMEA_GEO_A, e2 = NMEA_GEO_F * (2.0 - NMEA_GEO_F);
+			double sp = sin(lat[i] * M_PI / 180), cp = cos(lat[i] * M_PI / 180);
+			double nn = a / sqrt(1.0 - e2 * sp * sp);
+			x[i] = (nn + h[i]) * cp * cos(lon[i] * M_PI / 180);
+			y[i] = (nn + h[i]) * cp * sin(lon[i] * M_PI / 180);
+			z[i] = (nn * (1.0 - e2) + h[i]) * sp;
+		}
+	}
+	record("ecef libm", n, bytes, (now_ns() - start) / rounds, ok);
+
+	start = now_ns();
+	for (int r = 0; r < rounds; r++)
+		nmea_geo_ecef(x, y, z, lat, lon, h, n);
+	record("nmea_geo_ecef", n, bytes, (now_ns() - start) / rounds, ok);
+
+	nmea_geo_origin(&origin, lat[0], lon[0], h[0]);
+	start = now_ns();
+	for (int r = 0; r < rounds; r++)
+		nmea_geo_enu(&origin, x, y, z, lat, lon, h, n);
+	record("nmea_geo_enu", n, bytes, (now_ns() - start) / rounds, ok);
+
+	start = now_ns();
+	for (int r = 0; r < rounds; r++)
+		nmea_geo_utm(x, y, zone, lat, lon, n, 0);
+	ok = 0;
+	for (size_t i = 0; i < n; i++)
+		ok += zone[i] != 0;
+	record("nmea_geo_utm", n, bytes, (now_ns() - start) / rounds, ok);
+
+out:
+	free(gga);
+	free(col);
+	free(zone);
+}
+
+static void run_fixed(const struct corpus *c)
+{
+	static const struct nmea_fixed_units units = NMEA_FIXED_UNITS_INIT;
+	struct nmea_sentence frame;
+	struct nmea_fixed fixed;
+	struct nmea_float coord[2];
+	int32_t e7[2];
+	size_t bytes = 0;
+	long ok = 0;
+
+	for (size_t i = 0; i < c->count; i++)
+		bytes += c->lens[i];
+
+	// Разбор в nmea_float и перевод в те же единицы, что и NMEA_FIXED_UNITS_INIT
+	double start = now_ns();
+	for (int r = 0; r < rounds; r++) {
+		for (size_t i = 0; i < c->count; i++) {
+			switch (nmea_parse_any(&frame, c->lines[i], false)) {
+				case NMEA_SENTENCE_RMC:
+					coord[0] = frame.data.rmc.latitude;
+					coord[1] = frame.data.rmc.longitude;
+					nmea_coord_e7(e7, coord, 2);
+					sink += (long) e7[0] + e7[1] + nmea_rescale(&frame.data.rmc.speed, 1000) * 463 / 900 +
+					        nmea_rescale(&frame.data.rmc.course, 100);
+					ok += r == 0;
+					break;
+				case NMEA_SENTENCE_GGA:
+					coord[0] = frame.data.gga.latitude;
+					coord[1] = frame.data.gga.longitude;
+					nmea_coord_e7(e7, coord, 2);
+					sink += (long) e7[0] + e7[1] + nmea_rescale(&frame.data.gga.hdop, 100) +
+					        nmea_rescale(&frame.data.gga.altitude, 1000);
+					ok += r == 0;
+					break;
+				default:
+					break;
+			}
+		}
+	}
+	record("nmea_parse_any+rescale", c->count, bytes, (now_ns() - start) / rounds, ok);
+
+	ok = 0;
+	start = now_ns();
+	for (int r = 0; r < rounds; r++) {
+		for (size_t i = 0; i < c->count; i++) {
+			switch (nmea_parse_fixed(&fixed, c->lines[i], false, &units)) {
+				case NMEA_SENTENCE_RMC:
+					sink += (long) ((uint64_t) fixed.data.rmc.latitude + (uint64_t) fixed.data.rmc.longitude +
+					               (uint64_t) fixed.data.rmc.speed + (uint64_t) fixed.data.rmc.course);
+					ok += r == 0;
+					break;
+				case NMEA_SENTENCE_GGA:
+					sink += (long) ((uint64_t) fixed.data.gga.latitude + (uint64_t) fixed.data.gga.longitude +
+					               (uint64_t) fixed.data.gga.hdop + (uint64_t) fixed.data.gga.altitude);
+					ok += r == 0;
+					break;
+				default:
+					break;
+			}
+		}
+	}
+	record("nmea_parse_fixed", c->count, bytes, (now_ns() - start) / rounds, ok);
+}
+
+// RMC 20 Гц в 1 Гц: разбор всех предложений против фильтра nmea_thin_wanted()
+static void run_thin(const struct corpus *c)
+{
+	static const struct nmea_thin_options options = {1000, 2.0, 30.0, 30000, 1.0, 0};
+	size_t count = c->count;
+	char *text = malloc(count * BENCH_LINE);
+	struct nmea_thin_point out[NMEA_THIN_WINDOW];
+	struct nmea_sentence frame;
+	struct nmea_thin thin;
+	size_t bytes = 0;
+	long ok = 0;
+
+	if (!text)
+		return;
+	int latitude = 4807 * 10000, longitude = 1131 * 10000;
+	for (size_t i = 0; i < count; i++) {
+		int cs = (int) (4320000 + i * 5 % 4320000);
+		char *line = text + i * BENCH_LINE;
+		int n;
+
+		latitude += rnd(5) - 1;
+		longitude += rnd(5) - 2;
+		line[0] = '$';
+		n = 1 + sprintf(line + 1, "GPRMC,%02d%02d%02d.%02d,A,%04d.%04d,N,%05d.%04d,E,%d.%d,%d.%d,150624,,",
+		                cs / 360000, cs / 6000 % 60, cs / 100 % 60, cs % 100, latitude / 10000, latitude % 10000,
+		                longitude / 10000, longitude % 10000, 20 + rnd(5), rnd(10), 45 + rnd(3), rnd(10));
+		bytes += (size_t) gen_checksum(line, n);
+	}
+
+	double start = now_ns();
+	for (int r = 0; r < rounds; r++) {
+		ok = 0;
+		nmea_thin_init(&thin, &options);
+		for (size_t i = 0; i < count; i++)
+			if (nmea_parse_any(&frame, text + i * BENCH_LINE, false) != NMEA_INVALID)
+				ok += nmea_thin_push(&thin, &frame, out);
+		ok += nmea_thin_flush(&thin, out);
+	}
+	record("nmea_parse_any+nmea_thin", count, bytes, (now_ns() - start) / rounds, ok);
+
+	start = now_ns();
+	for (int r = 0; r < rounds; r++) {
+		ok = 0;
+		nmea_thin_init(&thin, &options);
+		for (size_t i = 0; i < count; i++) {
+			const char *line = text + i * BENCH_LINE;
+			if (nmea_thin_wanted(&thin, line) && nmea_parse_any(&frame, line, false) != NMEA_INVALID)
+				ok += nmea_thin_push(&thin, &frame, out);
+		}
+		ok += nmea_thin_flush(&thin, out);
+	}
+	record("nmea_thin_wanted+parse", count, bytes, (now_ns() - start) / rounds, ok);
+	free(text);
+}
+
+static void run_batch(const struct corpus *c)
+{
+	int8_t *type = malloc(c->count);
+	uint8_t *valid = malloc(c->count / 8 + 1);
+	int32_t *columns = malloc(c->count * 4 * sizeof(int32_t));
+	int16_t *hdop = malloc(c->count * sizeof(int16_t));
+	int8_t *satellites = malloc(c->count);
+
+	if (type && valid && columns && hdop && satellites) {
+		struct nmea_batch batch = {c->count, 0, 0, false, 0, type, valid,
+		                           columns, columns + c->count, columns + 2 * c->count, columns + 3 * c->count,
+		                           hdop, satellites};
+		double start = now_ns();
+		for (int r = 0; r < rounds; r++) {
+			nmea_batch_reset(&batch);
+			nmea_parse_batch(&batch, c->text, c->len);
+		}
+		record("nmea_parse_batch", c->count, c->len, (now_ns() - start) / rounds, (long) batch.count);
+	}
+
+	free(type);
+	free(valid);
+	free(columns);
+	free(hdop);
+	free(satellites);
+}
+
+#ifndef _WIN32
+static void run_replay(const struct corpus *c)
+{
+	static char names[8][32];
+	char *buf = malloc(BENCH_REPLAY_SIZE);
+	size_t len = 0, copies = 0;
+
+	if (!buf)
+		return;
+	while (len + c->len <= BENCH_REPLAY_SIZE) {
+		memcpy(buf + len, c->text, c->len);
+		len += c->len;
+		copies++;
+	}
+
+	long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+	for (long threads = 1, k = 0; threads <= cpus && k < 8; threads *= 2, k++) {
+		struct nmea_replay_options options = {(int) threads, 0, false};
+		struct nmea_replay_stats stats;
+		if (nmea_replay_buffer(buf, len, &options, NULL, NULL, &stats) == 0) {
+			snprintf(names[k], sizeof(names[k]), "nmea_replay_%ldt", threads);
+			// Буфер - copies копий корпуса, результат в пересчете на одну
+			record(names[k], c->count, c->len, stats.seconds * 1e9 / copies, (long) (stats.sentences / copies));
+			replay_gbps[nreplay++] = stats.seconds > 0 ? (double) stats.bytes / stats.seconds / 1e9 : 0.0;
+		}
+	}
+	free(buf);
+}
+#endif
+
+static void print_text(const struct corpus *c, uint32_t seed)
+{
+	size_t kinds[BENCH_KINDS] = {0};
+
+	for (size_t i = 0; i < c->count; i++)
+		kinds[c->kinds[i]]++;
+
+	printf("kernel: %s  seed: %u  sentences: %zu  bytes: %zu  rounds: %d\n",
+	       nmea_layout_kernel(), seed, c->count, c->len, rounds);
+	for (int k = 0; k < BENCH_KINDS; k++)
+		printf("%s%s %zu", k ? ", " : "corpus: ", kind_names[k], kinds[k]);
+	printf("\n\n%-24s %10s %10s %12s %10s\n", "api", "sentences", "ok", "ns/sentence", "MB/s");
+	for (size_t i = 0; i < nresults; i++)
+		printf("%-24s %10zu %10ld %12.1f %10.1f\n", results[i].name, results[i].sentences,
+		       results[i].ok, results[i].ns, results[i].mbps);
+	if (log_size)
+		printf("\nnmea_log: %zu text bytes -> %zu bytes (%.1fx)\n", log_text, log_size, (double) log_text / log_size);
+	for (size_t k = 0; k < nreplay; k++)
+		printf("%s%zut %.2f GB/s", k ? ", " : "\nnmea_replay: ", (size_t) 1 << k, replay_gbps[k]);
+	if (nreplay)
+		printf("\n");
+}
+
+static void print_json(const struct corpus *c, uint32_t seed)
+{
+	printf("{\n  \"kernel\": \"%s\",\n  \"seed\": %u,\n  \"sentences\": %zu,\n  \"bytes\": %zu,\n  \"rounds\": %d,\n",
+	       nmea_layout_kernel(), seed, c->count, c->len, rounds);
+	printf("  \"results\": [\n");
+	for (size_t i = 0; i < nresults; i++)
+		printf("    {\"api\": \"%s\", \"sentences\": %zu, \"ok\": %ld, \"ns_per_sentence\": %.2f, \"mb_per_s\": %.2f}%s\n",
+		       results[i].name, results[i].sentences, results[i].ok, results[i].ns, results[i].mbps,
+		       i + 1 < nresults ? "," : "");
+	printf("  ],\n  \"log_ratio\": %.2f,\n  \"replay_gb_per_s\": [", log_size ? (double) log_text / log_size : 0.0);
+	for (size_t k = 0; k < nreplay; k++)
+		printf("%s%.3f", k ? ", " : "", replay_gbps[k]);
+	printf("]\n}\n");
+}
+
+int main(int argc, char *argv[])
+{
+	struct corpus c;
+	uint32_t seed = BENCH_SEED;
+	size_t count = BENCH_COUNT;
+	bool json = false;
+
+	for (int i = 1; i < argc; i++) {
+		if (!strcmp(argv[i], "--json"))
+			json = true;
+		else if (!strcmp(argv[i], "--seed") && i + 1 < argc)
+			seed = (uint32_t) strtoul(argv[++i], NULL, 0);
+		else if (!strcmp(argv[i], "--count") && i + 1 < argc)
+			count = strtoul(argv[++i], NULL, 0);
+		else if (!strcmp(argv[i], "--rounds") && i + 1 < argc)
+			rounds = atoi(argv[++i]);
+		else {
+			fprintf(stderr, "usage: %s [--json] [--seed N] [--count N] [--rounds N]\n", argv[0]);
+			return 2;
+		}
+	}
+	if (!count || rounds < 1) {
+		fprintf(stderr, "count and rounds must be positive\n");
+		return 2;
+	}
+
+	if (!corpus_init(&c, count, seed)) {
+		fprintf(stderr, "out of memory\n");
+		return 1;
+	}
+
+	run(&c, "nmea_check", NMEA_INVALID, check);
+	run(&c, "nmea_check_strict", NMEA_INVALID, check_strict);
+	run(&c, "nmea_sentence_id", NMEA_INVALID, sentence_id);
+	run(&c, "nmea_parse_rmc", NMEA_SENTENCE_RMC, parse_rmc);
+	run(&c, "nmea_parse_gga", NMEA_SENTENCE_GGA, parse_gga);
+	run(&c, "nmea_parse_gsa", NMEA_SENTENCE_GSA, parse_gsa);
+	run(&c, "nmea_parse_gll", NMEA_SENTENCE_GLL, parse_gll);
+	run(&c, "nmea_parse_gst", NMEA_SENTENCE_GST, parse_gst);
+	run(&c, "nmea_parse_gsv", NMEA_SENTENCE_GSV, parse_gsv);
+	run(&c, "nmea_parse_vtg", NMEA_SENTENCE_VTG, parse_vtg);
+	run(&c, "nmea_parse_zda", NMEA_SENTENCE_ZDA, parse_zda);
+	run(&c, "parse_rmc position", NMEA_SENTENCE_RMC, parse_rmc_position);
+	run(&c, "parse_rmc time", NMEA_SENTENCE_RMC, parse_rmc_time);
+	run(&c, "parse_gga position", NMEA_SENTENCE_GGA, parse_gga_position);
+	run(&c, "parse_gga time", NMEA_SENTENCE_GGA, parse_gga_time);
+	run(&c, "parse_gsa status", NMEA_SENTENCE_GSA, parse_gsa_status);
+	run_gettime(&c);
+	run(&c, "sentence_id+parse_*", NMEA_INVALID, parse_legacy);
+	run(&c, "nmea_parse_any", NMEA_INVALID, parse_any);
+	run(&c, "parse_fields time+pos", NMEA_INVALID, parse_fields_position);
+	run_text(&c);
+	run_batch(&c);
+	run_log(&c);
+	run_write(&c);
+	run_ubx(&c);
+	run_coord(&c);
+	run_geo(&c);
+	run_fixed(&c);
+	run_thin(&c);
+#ifndef _WIN32
+	run_replay(&c);
+#endif
+
+	if (json)
+		print_json(&c, seed);
+	else
+		print_text(&c, seed);
+
+	corpus_free(&c);
+	return 0;
+}
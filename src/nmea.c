@@ -1,4 +1,8 @@
 #include "nmea.h"
+#include "nmea_layout.h"
+#include "nmea_number.h"
+#include "nmea_ubx.h"
+#include "nmea_stats.h"
 
 
 
@@ -9,8 +13,6 @@
 #include <stdarg.h>
 #include <time.h>
 
-#define timegm _mkgmtime
-
 /*		Example
 
 char buff[NMEA_MAX_LENGTH];
@@ -45,289 +47,33 @@ switch (nmea_sentence_id(buff, false)) {
 
 //------------------- VARIABLES ------------------------
 
-// <<---------------------------------------------------------------------------//CFG-MSG packets:
-	// <<---------------------------------------------------------------------------//off packets
-	uint8_t turn_Off_GPGGA[NMEA_LEN] = {//---------------------------------------------//GPGGA off
-	  0xB5, // Header char 1
-	  0x62, // Header char 2
-	  0x06, // class
-	  0x01, // id
-	  0x08, // length char 1
-	  0x00, // length char 2
-	  0xF0, // payload (NMEA sentence ID char 1)
-	  0x00, // payload (NMEA sentence ID char 2)
-	  0x00, // payload I/O Target 0 - DDC       - (1 - enable sentence, 0 - disable)
-	  0x00, // payload I/O Target 1 - Serial Port 1 - (1 - enable sentence, 0 - disable)
-	  0x00, // payload I/O Target 2 - Serial Port 2 - (1 - enable sentence, 0 - disable)
-	  0x00, // payload I/O Target 3 - USB       - (1 - enable sentence, 0 - disable)
-	  0x00, // payload I/O Target 4 - SPI       - (1 - enable sentence, 0 - disable)
-	  0x00, // payload I/O Target 5 - Reserved    - (1 - enable sentence, 0 - disable)
-	  0xFF, // CK_A
-	  0x23  // CK_B
-	};
-
-	uint8_t turn_Off_GPGLL[NMEA_LEN] = {//---------------------------------------------//GPGLL off
-	  0xB5, // Header char 1
-	  0x62, // Header char 2
-	  0x06, // class
-	  0x01, // id
-	  0x08, // length char 1
-	  0x00, // length char 2
-	  0xF0, // payload (NMEA sentence ID char 1)
-	  0x01, // payload (NMEA sentence ID char 2)
-	  0x00, // payload I/O Target 0 - DDC       - (1 - enable sentence, 0 - disable)
-	  0x00, // payload I/O Target 1 - Serial Port 1 - (1 - enable sentence, 0 - disable)
-	  0x00, // payload I/O Target 2 - Serial Port 2 - (1 - enable sentence, 0 - disable)
-	  0x00, // payload I/O Target 3 - USB       - (1 - enable sentence, 0 - disable)
-	  0x00, // payload I/O Target 4 - SPI       - (1 - enable sentence, 0 - disable)
-	  0x00, // payload I/O Target 5 - Reserved    - (1 - enable sentence, 0 - disable)
-	  0x00, // CK_A
-	  0x2A  // CK_B
-	};
-
-	uint8_t turn_Off_GPGSA[NMEA_LEN] = {//---------------------------------------------//GPGSA off
-	  0xB5, // Header char 1
-	  0x62, // Header char 2
-	  0x06, // class
-	  0x01, // id
-	  0x08, // length char 1
-	  0x00, // length char 2
-	  0xF0, // payload (NMEA sentence ID char 1)
-	  0x02, // payload (NMEA sentence ID char 2)
-	  0x00, // payload I/O Target 0 - DDC			- (1 - enable sentence, 0 - disable)
-	  0x00, // payload I/O Target 1 - Serial Port 1 - (1 - enable sentence, 0 - disable)
-	  0x00, // payload I/O Target 2 - Serial Port 2 - (1 - enable sentence, 0 - disable)
-	  0x00, // payload I/O Target 3 - USB			- (1 - enable sentence, 0 - disable)
-	  0x00, // payload I/O Target 4 - SPI			- (1 - enable sentence, 0 - disable)
-	  0x00, // payload I/O Target 5 - Reserved		- (1 - enable sentence, 0 - disable)
-	  0x01, // CK_A
-	  0x31  // CK_B
-	};
-
-	uint8_t turn_Off_GPGLV[NMEA_LEN] = {//---------------------------------------------//GPGSV off
-	  0xB5, // Header char 1
-	  0x62, // Header char 2
-	  0x06, // class
-	  0x01, // id
-	  0x08, // length char 1
-	  0x00, // length char 2
-	  0xF0, // payload (NMEA sentence ID char 1)
-	  0x03, // payload (NMEA sentence ID char 2)
-	  0x00, // payload I/O Target 0 - DDC			- (1 - enable sentence, 0 - disable)
-	  0x00, // payload I/O Target 1 - Serial Port 1 - (1 - enable sentence, 0 - disable)
-	  0x00, // payload I/O Target 2 - Serial Port 2 - (1 - enable sentence, 0 - disable)
-	  0x00, // payload I/O Target 3 - USB			- (1 - enable sentence, 0 - disable)
-	  0x00, // payload I/O Target 4 - SPI			- (1 - enable sentence, 0 - disable)
-	  0x00, // payload I/O Target 5 - Reserved		- (1 - enable sentence, 0 - disable)
-	  0x02, // CK_A
-	  0x38  // CK_B
-	};
-
-	uint8_t turn_Off_GPRMC[NMEA_LEN] = {//---------------------------------------------//GPRMC off
-	  0xB5, // Header char 1
-	  0x62, // Header char 2
-	  0x06, // class
-	  0x01, // id
-	  0x08, // length char 1
-	  0x00, // length char 2
-	  0xF0, // payload (NMEA sentence ID char 1)
-	  0x04, // payload (NMEA sentence ID char 2)
-	  0x00, // payload I/O Target 0 - DDC			- (1 - enable sentence, 0 - disable)
-	  0x00, // payload I/O Target 1 - Serial Port 1 - (1 - enable sentence, 0 - disable)
-	  0x00, // payload I/O Target 2 - Serial Port 2 - (1 - enable sentence, 0 - disable)
-	  0x00, // payload I/O Target 3 - USB			- (1 - enable sentence, 0 - disable)
-	  0x00, // payload I/O Target 4 - SPI			- (1 - enable sentence, 0 - disable)
-	  0x00, // payload I/O Target 5 - Reserved		- (1 - enable sentence, 0 - disable)
-	  0x03, // CK_A
-	  0x3F  // CK_B
-	};
-
-	uint8_t turn_Off_GPVTG[NMEA_LEN] = {//---------------------------------------------//GPVTG off
-	  0xB5, // Header char 1
-	  0x62, // Header char 2
-	  0x06, // class
-	  0x01, // id
-	  0x08, // length char 1
-	  0x00, // length char 2
-	  0xF0, // payload (NMEA sentence ID char 1)
-	  0x05, // payload (NMEA sentence ID char 2)
-	  0x00, // payload I/O Target 0 - DDC			- (1 - enable sentence, 0 - disable)
-	  0x00, // payload I/O Target 1 - Serial Port 1 - (1 - enable sentence, 0 - disable)
-	  0x00, // payload I/O Target 2 - Serial Port 2 - (1 - enable sentence, 0 - disable)
-	  0x00, // payload I/O Target 3 - USB			- (1 - enable sentence, 0 - disable)
-	  0x00, // payload I/O Target 4 - SPI			- (1 - enable sentence, 0 - disable)
-	  0x00, // payload I/O Target 5 - Reserved		- (1 - enable sentence, 0 - disable)
-	  0x04, // CK_A
-	  0x46  // CK_B
-	};
-
-	// <<---------------------------------------------------------------------------//on packets
-	uint8_t turn_On_GPGGA[NMEA_LEN] = {//---------------------------------------------//GPGGA on
-	  0xB5, // Header char 1
-	  0x62, // Header char 2
-	  0x06, // class
-	  0x01, // id
-	  0x08, // length char 1
-	  0x00, // length char 2
-	  0xF0, // payload (NMEA sentence ID char 1)
-	  0x00, // payload (NMEA sentence ID char 2)
-	  0x01, // payload I/O Target 0 - DDC			- (1 - enable sentence, 0 - disable)
-	  0x01, // payload I/O Target 1 - Serial Port 1 - (1 - enable sentence, 0 - disable)
-	  0x01, // payload I/O Target 2 - Serial Port 2 - (1 - enable sentence, 0 - disable)
-	  0x01, // payload I/O Target 3 - USB			- (1 - enable sentence, 0 - disable)
-	  0x01, // payload I/O Target 4 - SPI			- (1 - enable sentence, 0 - disable)
-	  0x01, // payload I/O Target 5 - Reserved		- (1 - enable sentence, 0 - disable)
-	  0x05, // CK_A
-	  0x38  // CK_B
-	};
-
-	uint8_t turn_On_GPGLL[NMEA_LEN] = {//---------------------------------------------//GPGLL on
-	  0xB5, // Header char 1
-	  0x62, // Header char 2
-	  0x06, // class
-	  0x01, // id
-	  0x08, // length char 1
-	  0x00, // length char 2
-	  0xF0, // payload (NMEA sentence ID char 1)
-	  0x01, // payload (NMEA sentence ID char 2)
-	  0x01, // payload I/O Target 0 - DDC			- (1 - enable sentence, 0 - disable)
-	  0x01, // payload I/O Target 1 - Serial Port 1 - (1 - enable sentence, 0 - disable)
-	  0x01, // payload I/O Target 2 - Serial Port 2 - (1 - enable sentence, 0 - disable)
-	  0x01, // payload I/O Target 3 - USB			- (1 - enable sentence, 0 - disable)
-	  0x01, // payload I/O Target 4 - SPI			- (1 - enable sentence, 0 - disable)
-	  0x01, // payload I/O Target 5 - Reserved		- (1 - enable sentence, 0 - disable)
-	  0x06, // CK_A
-	  0x3F  // CK_B
-	};
-
-	uint8_t turn_On_GPGSA[NMEA_LEN] = {//---------------------------------------------//GPGSA on
-	  0xB5, // Header char 1
-	  0x62, // Header char 2
-	  0x06, // class
-	  0x01, // id
-	  0x08, // length char 1
-	  0x00, // length char 2
-	  0xF0, // payload (NMEA sentence ID char 1)
-	  0x02, // payload (NMEA sentence ID char 2)
-	  0x01, // payload I/O Target 0 - DDC			- (1 - enable sentence, 0 - disable)
-	  0x01, // payload I/O Target 1 - Serial Port 1 - (1 - enable sentence, 0 - disable)
-	  0x01, // payload I/O Target 2 - Serial Port 2 - (1 - enable sentence, 0 - disable)
-	  0x01, // payload I/O Target 3 - USB			- (1 - enable sentence, 0 - disable)
-	  0x01, // payload I/O Target 4 - SPI			- (1 - enable sentence, 0 - disable)
-	  0x01, // payload I/O Target 5 - Reserved		- (1 - enable sentence, 0 - disable)
-	  0x07, // CK_A
-	  0x46  // CK_B
-	};
-
-	uint8_t turn_On_GPGLV[NMEA_LEN] = {//---------------------------------------------//GPGSV on
-	  0xB5, // Header char 1
-	  0x62, // Header char 2
-	  0x06, // class
-	  0x01, // id
-	  0x08, // length char 1
-	  0x00, // length char 2
-	  0xF0, // payload (NMEA sentence ID char 1)
-	  0x03, // payload (NMEA sentence ID char 2)
-	  0x01, // payload I/O Target 0 - DDC			- (1 - enable sentence, 0 - disable)
-	  0x01, // payload I/O Target 1 - Serial Port 1 - (1 - enable sentence, 0 - disable)
-	  0x01, // payload I/O Target 2 - Serial Port 2 - (1 - enable sentence, 0 - disable)
-	  0x01, // payload I/O Target 3 - USB			- (1 - enable sentence, 0 - disable)
-	  0x01, // payload I/O Target 4 - SPI			- (1 - enable sentence, 0 - disable)
-	  0x01, // payload I/O Target 5 - Reserved		- (1 - enable sentence, 0 - disable)
-	  0x08, // CK_A
-	  0x4D  // CK_B
-	};
-
-	uint8_t turn_On_GPRMC[NMEA_LEN] = {//---------------------------------------------//GPRMC on
-	  0xB5, // Header char 1
-	  0x62, // Header char 2
-	  0x06, // class
-	  0x01, // id
-	  0x08, // length char 1
-	  0x00, // length char 2
-	  0xF0, // payload (NMEA sentence ID char 1)
-	  0x04, // payload (NMEA sentence ID char 2)
-	  0x01, // payload I/O Target 0 - DDC			- (1 - enable sentence, 0 - disable)
-	  0x01, // payload I/O Target 1 - Serial Port 1 - (1 - enable sentence, 0 - disable)
-	  0x01, // payload I/O Target 2 - Serial Port 2 - (1 - enable sentence, 0 - disable)
-	  0x01, // payload I/O Target 3 - USB			- (1 - enable sentence, 0 - disable)
-	  0x01, // payload I/O Target 4 - SPI			- (1 - enable sentence, 0 - disable)
-	  0x01, // payload I/O Target 5 - Reserved		- (1 - enable sentence, 0 - disable)
-	  0x09, // CK_A
-	  0x54  // CK_B
-	};
-
-	uint8_t turn_On_GPVTG[NMEA_LEN] = {//---------------------------------------------//GPVTG on
-	  0xB5, // Header char 1
-	  0x62, // Header char 2
-	  0x06, // class
-	  0x01, // id
-	  0x08, // length char 1
-	  0x00, // length char 2
-	  0xF0, // payload (NMEA sentence ID char 1)
-	  0x05, // payload (NMEA sentence ID char 2)
-	  0x01, // payload I/O Target 0 - DDC			- (1 - enable sentence, 0 - disable)
-	  0x01, // payload I/O Target 1 - Serial Port 1 - (1 - enable sentence, 0 - disable)
-	  0x01, // payload I/O Target 2 - Serial Port 2 - (1 - enable sentence, 0 - disable)
-	  0x01, // payload I/O Target 3 - USB			- (1 - enable sentence, 0 - disable)
-	  0x01, // payload I/O Target 4 - SPI			- (1 - enable sentence, 0 - disable)
-	  0x01, // payload I/O Target 5 - Reserved		- (1 - enable sentence, 0 - disable)
-	  0x0A, // CK_A
-	  0x5B  // CK_B
-	};
-	// <<---------------------------------------------------------------------------//CFG-MSG packets
-
-	// <<---------------------------------------------------------------------------//CFG-RATE packets:
-	uint8_t updateFreq[FREQ_LEN] = {
-	  0xB5, // sync char 1
-	  0x62, // sync char 2
-	  0x06, // class
-	  0x08, // id
-	  0x06, // length
-	  0x00, // length
-	  0x64, // payload
-	  0x00, // payload
-	  0x01, // payload
-	  0x00, // payload
-	  0x01, // payload
-	  0x00, // payload
-	  0x7A, // CK_A
-	  0x12, // CK_B
-	};
-	// <<---------------------------------------------------------------------------//CFG-RATE packets
-
-	// <<---------------------------------------------------------------------------//CFG-PRT packets:
-	uint8_t changeBaud[BAUD_LEN] = {
-	  0xB5, // sync char 1
-	  0x62, // sync char 2
-	  0x06, // class
-	  0x00, // id
-	  0x14, // length
-	  0x00, // length
-	  0x01, // payload
-	  0x00, // payload
-	  0x00, // payload
-	  0x00, // payload
-	  0xD0, // payload
-	  0x08, // payload
-	  0x00, // payload
-	  0x00, // payload
-	  0x00, // payload
-	  0xC2, // payload
-	  0x01, // payload
-	  0x00, // payload
-	  0x07, // payload
-	  0x00, // payload
-	  0x03, // payload
-	  0x00, // payload
-	  0x00, // payload
-	  0x00, // payload
-	  0x00, // payload
-	  0x00, // payload
-	  0xC0, // CK_A
-	  0x7E, // CK_B
-	};
-	// <<---------------------------------------------------------------------------//CFG-PRT packets
+// Кадры UBX прежнего API, контрольные суммы вычисляются при компиляции.
+// Для других параметров - nmea_ubx_cfg_msg(), nmea_ubx_cfg_rate(), nmea_ubx_cfg_prt()
+#define NMEA_UBX_NMEA_OFF(msg_id)	NMEA_UBX_CFG_MSG_INIT(NMEA_UBX_CLASS_NMEA, msg_id, 0, 0, 0, 0, 0, 0)
+#define NMEA_UBX_NMEA_ON(msg_id)	NMEA_UBX_CFG_MSG_INIT(NMEA_UBX_CLASS_NMEA, msg_id, 1, 1, 1, 1, 1, 1)
+
+const uint8_t turn_Off_GPGGA[NMEA_LEN] = NMEA_UBX_NMEA_OFF(NMEA_UBX_NMEA_GGA);
+const uint8_t turn_Off_GPGLL[NMEA_LEN] = NMEA_UBX_NMEA_OFF(NMEA_UBX_NMEA_GLL);
+const uint8_t turn_Off_GPGSA[NMEA_LEN] = NMEA_UBX_NMEA_OFF(NMEA_UBX_NMEA_GSA);
+const uint8_t turn_Off_GPGLV[NMEA_LEN] = NMEA_UBX_NMEA_OFF(NMEA_UBX_NMEA_GSV);
+const uint8_t turn_Off_GPRMC[NMEA_LEN] = NMEA_UBX_NMEA_OFF(NMEA_UBX_NMEA_RMC);
+const uint8_t turn_Off_GPVTG[NMEA_LEN] = NMEA_UBX_NMEA_OFF(NMEA_UBX_NMEA_VTG);
+
+const uint8_t turn_On_GPGGA[NMEA_LEN] = NMEA_UBX_NMEA_ON(NMEA_UBX_NMEA_GGA);
+const uint8_t turn_On_GPGLL[NMEA_LEN] = NMEA_UBX_NMEA_ON(NMEA_UBX_NMEA_GLL);
+const uint8_t turn_On_GPGSA[NMEA_LEN] = NMEA_UBX_NMEA_ON(NMEA_UBX_NMEA_GSA);
+const uint8_t turn_On_GPGLV[NMEA_LEN] = NMEA_UBX_NMEA_ON(NMEA_UBX_NMEA_GSV);
+const uint8_t turn_On_GPRMC[NMEA_LEN] = NMEA_UBX_NMEA_ON(NMEA_UBX_NMEA_RMC);
+const uint8_t turn_On_GPVTG[NMEA_LEN] = NMEA_UBX_NMEA_ON(NMEA_UBX_NMEA_VTG);
+
+// 10 Гц, решение на каждое измерение, время GPS
+const uint8_t updateFreq[FREQ_LEN] = NMEA_UBX_CFG_RATE_INIT(100, 1, 1);
+
+// UART1 115200 8N1, вход UBX+NMEA+RTCM, выход UBX+NMEA
+const uint8_t changeBaud[BAUD_LEN] = NMEA_UBX_CFG_PRT_INIT(NMEA_UBX_PORT_UART1, NMEA_UBX_PRT_8N1, 115200,
+                                                           NMEA_UBX_PROTO_UBX | NMEA_UBX_PROTO_NMEA | NMEA_UBX_PROTO_RTCM,
+                                                           NMEA_UBX_PROTO_UBX | NMEA_UBX_PROTO_NMEA);
+
 
 //------------------- FUNCTIONS ------------------------
 static int hex2int(char c)
@@ -341,13 +87,85 @@ static int hex2int(char c)
     return -1;
 }
 
+// Проверка контрольной суммы "*hh" и конца строки после данных.
+// end - конец данных, checksum - XOR данных без '$'.
+// Возвращает начало следующей строки (или '\0'), NULL при ошибке
+static const char *nmea_trailer(const char *end, uint8_t checksum, bool strict)
+{
+    if (*end == '*') {
+        int upper = hex2int(end[1]);
+        int lower = upper == -1 ? -1 : hex2int(end[2]);
+        if (lower == -1 || checksum != (upper << 4 | lower)) {
+            NMEA_STATS_REJECT(NMEA_REJECT_CHECKSUM);
+            return NULL;
+        }
+        end += 3;
+    } else if (strict) {
+        NMEA_STATS_REJECT(NMEA_REJECT_CHECKSUM);
+        return NULL;
+    }
+
+    if (end[0] == '\r' && end[1] == '\n')
+        return end + 2;
+    if (end[0] == '\n')
+        return end + 1;
+
+    // Мусор после данных
+    if (*end) {
+        NMEA_STATS_REJECT(NMEA_REJECT_FORMAT);
+        return NULL;
+    }
+    return end;
+}
+
+static inline bool nmea_verify(const char *sentence, const char *end, uint8_t checksum, bool strict)
+{
+    const char *next = nmea_trailer(end, checksum, strict);
+
+    // Только одна строка и не длиннее допустимой
+    if (!next)
+        return false;
+    if (*next)
+        return nmea_reject(NMEA_REJECT_FORMAT);
+    if (next - sentence > NMEA_MAX_LENGTH + 3)
+        return nmea_reject(NMEA_REJECT_LENGTH);
+    return true;
+}
+
+// nmea_trailer() в пределах [end, limit): после данных только "*hh" и конец строки
+static bool nmea_trailer_n(const char *end, const char *limit, uint8_t checksum, bool strict)
+{
+    if (end < limit && *end == '*') {
+        if (limit - end < 3)
+            return nmea_reject(NMEA_REJECT_CHECKSUM);
+        int upper = hex2int(end[1]);
+        int lower = hex2int(end[2]);
+        if (upper == -1 || lower == -1 || checksum != (upper << 4 | lower))
+            return nmea_reject(NMEA_REJECT_CHECKSUM);
+        end += 3;
+    } else if (strict) {
+        return nmea_reject(NMEA_REJECT_CHECKSUM);
+    }
+
+    if ((limit - end == 2 && end[0] == '\r' && end[1] == '\n') ||
+        (limit - end == 1 && end[0] == '\n') || end == limit)
+        return true;
+    return nmea_reject(NMEA_REJECT_FORMAT);
+}
+
 uint8_t nmea_checksum(const char *sentence)
 {
+    struct nmea_layout layout;
+
     if (*sentence == '$')
         sentence++;
 
     uint8_t checksum = 0x00;
 
+    if (nmea_layout(&layout, sentence)) {
+        checksum = layout.checksum;
+        sentence += layout.end;
+    }
     while (*sentence && *sentence != '*')
         checksum ^= *sentence++;
 
@@ -356,44 +174,137 @@ uint8_t nmea_checksum(const char *sentence)
 
 bool nmea_check(const char *sentence, bool strict)
 {
-    uint8_t checksum = 0x00;
+    struct nmea_layout layout;
 
-    // ���� ������ ������ �������� ������
-    if (strlen(sentence) > NMEA_MAX_LENGTH + 3)
-        return false;
+    // Строка должна начинаться с "$"
+    if (*sentence != '$')
+        return nmea_reject(NMEA_REJECT_FORMAT);
 
-    // ���� ������ �� ���������� � "$".
-    if (*sentence++ != '$')
-        return false;
+    // Конец данных дальше максимальной длины
+    if (!nmea_layout(&layout, sentence))
+        return nmea_reject(NMEA_REJECT_LENGTH);
 
-    while (*sentence && *sentence != '*' && isprint((unsigned char) *sentence))
-        checksum ^= *sentence++;
+    return nmea_verify(sentence, sentence + layout.end, layout.checksum ^ '$', strict);
+}
 
-    // ���� ������������ ����������� �����
-    if (*sentence == '*') {
-        sentence++;
-        int upper = hex2int(*sentence++);
-        if (upper == -1)
-            return false;
-        int lower = hex2int(*sentence++);
-        if (lower == -1)
-            return false;
-        int expected = upper << 4 | lower;
+static inline bool nmea_isfield(char c) {
+    return isprint((unsigned char) c) && c != ',' && c != '*';
+}
 
-        if (checksum != expected)
-            return false;
-    } else if (strict) {
-        return false;
+// Декодеры отдельных полей. field == NULL - поле отсутствует.
+// При ошибке результат не записывается.
+static inline void nmea_field_char(const char *field, char *value)
+{
+    *value = (field && nmea_isfield(*field)) ? *field : '\0';
+}
+
+static inline bool nmea_field_direction(const char *field, int *value)
+{
+    int direction = 0;
+
+    if (field && nmea_isfield(*field)) {
+        switch (*field) {
+            case 'N':
+            case 'E':
+                direction = 1;
+                break;
+            case 'S':
+            case 'W':
+                direction = -1;
+                break;
+            default:
+                return nmea_reject(NMEA_REJECT_DIRECTION);
+        }
     }
 
-    if (*sentence && strcmp(sentence, "\n") && strcmp(sentence, "\r\n"))
-        return false;
+    *value = direction;
+    return true;
+}
 
+static inline bool nmea_field_float(const char *field, struct nmea_float *f)
+{
+    int64_t value = 0;
+    int64_t scale = 0;
+
+    if (field) {
+        // Пробелы допустимы только перед числом
+        while (*field == ' ')
+            field++;
+        field = nmea_number_decimal(field, -1, &value, &scale);
+        if (!field || nmea_isfield(*field))
+            return nmea_reject(NMEA_REJECT_FLOAT);
+    }
+
+    f->value = value;
+    f->scale = scale;
     return true;
 }
 
-static inline bool nmea_isfield(char c) {
-    return isprint((unsigned char) c) && c != ',' && c != '*';
+static inline bool nmea_field_int(const char *field, int *value)
+{
+    int result = 0;
+
+    if (field && nmea_isfield(*field)) {
+        while (*field == ' ')
+            field++;
+        field = nmea_number_int(field, &result);
+        if (!field || nmea_isfield(*field))
+            return nmea_reject(NMEA_REJECT_INT);
+    }
+
+    *value = result;
+    return true;
+}
+
+static inline void nmea_field_string(const char *field, char *buf)
+{
+    if (field) {
+        while (nmea_isfield(*field))
+            *buf++ = *field++;
+    }
+
+    *buf = '\0';
+}
+
+static inline bool nmea_field_type(const char *field, char type[6])
+{
+    // Поле обязательно
+    if (!field)
+        return nmea_reject(NMEA_REJECT_TYPE);
+
+    if (field[0] != '$')
+        return nmea_reject(NMEA_REJECT_TYPE);
+    for (int f=0; f<5; f++)
+        if (!nmea_isfield(field[1+f]))
+            return nmea_reject(NMEA_REJECT_TYPE);
+
+    memcpy(type, field+1, 5);
+    type[5] = '\0';
+    return true;
+}
+
+static inline bool nmea_field_date(const char *field, struct nmea_date *date)
+{
+    struct nmea_date d = {-1, -1, -1};
+
+    // Ровно 6 цифр
+    if (field && nmea_isfield(*field) && !nmea_number_date(field, &d))
+        return nmea_reject(NMEA_REJECT_DATE);
+
+    *date = d;
+    return true;
+}
+
+static inline bool nmea_field_time(const char *field, struct nmea_time *time_)
+{
+    struct nmea_time t = {-1, -1, -1, -1};
+
+    // Минимальный формат: ччммсс, дробная часть секунд до микросекунд
+    if (field && nmea_isfield(*field) && !nmea_number_time(field, &t))
+        return nmea_reject(NMEA_REJECT_TIME);
+
+    *time_ = t;
+    return true;
 }
 
 bool nmea_scan(const char *sentence, const char *format, ...)
@@ -425,203 +336,54 @@ bool nmea_scan(const char *sentence, const char *format, ...)
         }
 
         if (!field && !optional) {
+            NMEA_STATS_REJECT(NMEA_REJECT_FIELDS);
             goto parse_error;
         }
 
         switch (type) {
             case 'c': { // Single character field (char).
-                char value = '\0';
-
-                if (field && nmea_isfield(*field))
-                    value = *field;
-
-                *va_arg(ap, char *) = value;
+                nmea_field_char(field, va_arg(ap, char *));
             } break;
 
             case 'd': { // Single character direction field (int).
-                int value = 0;
-
-                if (field && nmea_isfield(*field)) {
-                    switch (*field) {
-                        case 'N':
-                        case 'E':
-                            value = 1;
-                            break;
-                        case 'S':
-                        case 'W':
-                            value = -1;
-                            break;
-                        default:
-                            goto parse_error;
-                    }
-                }
-
-                *va_arg(ap, int *) = value;
+                if (!nmea_field_direction(field, va_arg(ap, int *)))
+                    goto parse_error;
             } break;
 
             case 'f': { // Fractional value with scale (struct nmea_float).
-                int sign = 0;
-                int_least32_t value = -1;
-                int_least32_t scale = 0;
-
-                if (field) {
-                    while (nmea_isfield(*field)) {
-                        if (*field == '+' && !sign && value == -1) {
-                            sign = 1;
-                        } else if (*field == '-' && !sign && value == -1) {
-                            sign = -1;
-                        } else if (isdigit((unsigned char) *field)) {
-                            int digit = *field - '0';
-                            if (value == -1)
-                                value = 0;
-                            if (value > (INT_LEAST32_MAX-digit) / 10) {
-                                if (scale) {
-                                    break;
-                                } else {
-                                    goto parse_error;
-                                }
-                            }
-                            value = (10 * value) + digit;
-                            if (scale)
-                                scale *= 10;
-                        } else if (*field == '.' && scale == 0) {
-                            scale = 1;
-                        } else if (*field == ' ') {
-                            if (sign != 0 || value != -1 || scale != 0)
-                                goto parse_error;
-                        } else {
-                            goto parse_error;
-                        }
-                        field++;
-                    }
-                }
-
-                if ((sign || scale) && value == -1)
+                if (!nmea_field_float(field, va_arg(ap, struct nmea_float *)))
                     goto parse_error;
-
-                if (value == -1) {
-                    value = 0;
-                    scale = 0;
-                } else if (scale == 0) {
-                    scale = 1;
-                }
-                if (sign)
-                    value *= sign;
-
-				struct nmea_float test;
-				test.value = value;
-				test.scale = scale;
-                //*va_arg(ap, struct nmea_float *) = (struct nmea_float) {value, scale};
-                *va_arg(ap, struct nmea_float *) = test;
             } break;
 
             case 'i': { // Integer value, default 0 (int).
-                int value = 0;
-
-                if (field) {
-                    char *endptr;
-                    value = strtol(field, &endptr, 10);
-                    if (nmea_isfield(*endptr))
-                        goto parse_error;
-                }
-
-                *va_arg(ap, int *) = value;
+                if (!nmea_field_int(field, va_arg(ap, int *)))
+                    goto parse_error;
             } break;
 
             case 's': { // String value (char *).
-                char *buf = va_arg(ap, char *);
-
-                if (field) {
-                    while (nmea_isfield(*field))
-                        *buf++ = *field++;
-                }
-
-                *buf = '\0';
+                nmea_field_string(field, va_arg(ap, char *));
             } break;
 
             case 't': { // NMEA talker+sentence identifier (char *).
-                // ��� ���� �����������
-                if (!field)
+                if (!nmea_field_type(field, va_arg(ap, char *)))
                     goto parse_error;
-
-                if (field[0] != '$')
-                    goto parse_error;
-                for (int f=0; f<5; f++)
-                    if (!nmea_isfield(field[1+f]))
-                        goto parse_error;
-
-                char *buf = va_arg(ap, char *);
-                memcpy(buf, field+1, 5);
-                buf[5] = '\0';
             } break;
 
             case 'D': { // Date (int, int, int), -1 if empty.
-                struct nmea_date *date = va_arg(ap, struct nmea_date *);
-
-                int d = -1, m = -1, y = -1;
-
-                if (field && nmea_isfield(*field)) {
-                    // ������ 6 ����.
-                    for (int f=0; f<6; f++)
-                        if (!isdigit((unsigned char) field[f]))
-                            goto parse_error;
-
-                    char dArr[] = {field[0], field[1], '\0'};
-                    char mArr[] = {field[2], field[3], '\0'};
-                    char yArr[] = {field[4], field[5], '\0'};
-                    d = strtol(dArr, NULL, 10);
-                    m = strtol(mArr, NULL, 10);
-                    y = strtol(yArr, NULL, 10);
-                }
-
-                date->day = d;
-                date->month = m;
-                date->year = y;
+                if (!nmea_field_date(field, va_arg(ap, struct nmea_date *)))
+                    goto parse_error;
             } break;
 
             case 'T': { // Time (int, int, int, int), -1 if empty.
-                struct nmea_time *time_ = va_arg(ap, struct nmea_time *);
-
-                int h = -1, i = -1, s = -1, u = -1;
-
-                if (field && nmea_isfield(*field)) {
-                    // ����������� ����������: ����� �����
-                    for (int f=0; f<6; f++)
-                        if (!isdigit((unsigned char) field[f]))
-                            goto parse_error;
-
-                    char hArr[] = {field[0], field[1], '\0'};
-                    char iArr[] = {field[2], field[3], '\0'};
-                    char sArr[] = {field[4], field[5], '\0'};
-                    h = strtol(hArr, NULL, 10);
-                    i = strtol(iArr, NULL, 10);
-                    s = strtol(sArr, NULL, 10);
-                    field += 6;
-
-                    // ������� ����� ����������� ��� ������������
-                    if (*field++ == '.') {
-                        uint32_t value = 0;
-                        uint32_t scale = 1000000LU;
-                        while (isdigit((unsigned char) *field) && scale > 1) {
-                            value = (value * 10) + (*field++ - '0');
-                            scale /= 10;
-                        }
-                        u = value * scale;
-                    } else {
-                        u = 0;
-                    }
-                }
-
-                time_->hours = h;
-                time_->minutes = i;
-                time_->seconds = s;
-                time_->microseconds = u;
+                if (!nmea_field_time(field, va_arg(ap, struct nmea_time *)))
+                    goto parse_error;
             } break;
 
-            case '_': { // ������������� ����.
+            case '_': { // Пропускаемое поле.
             } break;
 
             default: {
+                NMEA_STATS_REJECT(NMEA_REJECT_FORMAT);
                 goto parse_error;
             }
         }
@@ -636,68 +398,116 @@ parse_error:
     return result;
 }
 
-bool nmea_talker_id(char talker[3], const char *sentence)
+// Разбивка на поля за один проход с подсчетом контрольной суммы.
+// Границы полей совпадают с next_field() из nmea_scan.
+// Возвращает количество полей (не более NMEA_MAX_FIELDS).
+static int nmea_tokenize(const char *sentence, const char *fields[NMEA_MAX_FIELDS], const char **end, uint8_t *checksum)
 {
-    char type[6];
-    if (!nmea_scan(sentence, "t", type))
-        return false;
+    struct nmea_layout layout;
+    int count = 1;
 
-    talker[0] = type[0];
-    talker[1] = type[1];
-    talker[2] = '\0';
+    fields[0] = sentence;
 
-    return true;
+    // Поля по маске запятых, без повторного прохода по строке
+    if (nmea_layout(&layout, sentence)) {
+        for (int w = 0; w < NMEA_LAYOUT_WORDS && count < NMEA_MAX_FIELDS; w++) {
+            for (uint64_t bits = layout.commas[w]; bits && count < NMEA_MAX_FIELDS; bits &= bits - 1)
+                fields[count++] = sentence + w * 64 + nmea_ctz64(bits) + 1;
+        }
+        *end = sentence + layout.end;
+        *checksum = layout.checksum;
+        return count;
+    }
+
+    uint8_t sum = 0x00;
+    for (;;) {
+        while (nmea_isfield(*sentence))
+            sum ^= *sentence++;
+        if (*sentence != ',')
+            break;
+        sum ^= *sentence++;
+        if (count < NMEA_MAX_FIELDS)
+            fields[count] = sentence;
+        count++;
+    }
+
+    *end = sentence;
+    *checksum = sum;
+    return count < NMEA_MAX_FIELDS ? count : NMEA_MAX_FIELDS;
 }
 
-enum nmea_sentence_id nmea_sentence_id(const char *sentence, bool strict)
+// То же для данных длиной len без признака конца внутри буфера: побайтно,
+// конец данных - первый непечатный символ, '*' или len
+static int nmea_tokenize_n(const char *sentence, size_t len, const char *fields[NMEA_MAX_FIELDS], const char **end, uint8_t *checksum)
 {
-    if (!nmea_check(sentence, strict))
-        return NMEA_INVALID;
+    const char *limit = sentence + len;
+    uint8_t sum = 0x00;
+    int count = 1;
+
+    fields[0] = sentence;
+    for (;;) {
+        while (sentence < limit && nmea_isfield(*sentence))
+            sum ^= *sentence++;
+        if (sentence == limit || *sentence != ',')
+            break;
+        sum ^= *sentence++;
+        if (count < NMEA_MAX_FIELDS)
+            fields[count] = sentence;
+        count++;
+    }
+
+    *end = sentence;
+    *checksum = sum;
+    return count < NMEA_MAX_FIELDS ? count : NMEA_MAX_FIELDS;
+}
+
+// Поле по номеру, NULL если отсутствует
+#define nmea_field_at(fields, count, n) ((n) < (count) ? (fields)[(n)] : NULL)
+
+// Тип предложения (3 символа после источника), упакованный в целое
+#define NMEA_TYPE_KEY(a, b, c) (((uint32_t)(a) << 16) | ((uint32_t)(b) << 8) | (uint32_t)(c))
 
+// Поля предложения заданного типа (NMEA_TYPE_KEY) без проверки контрольной суммы,
+// end - конец данных. Возвращает количество полей, 0 если тип не совпадает.
+static inline int nmea_fields(const char *sentence, const char *fields[NMEA_MAX_FIELDS], uint32_t expected,
+                              const char **end)
+{
+    uint8_t checksum;
     char type[6];
-    if (!nmea_scan(sentence, "t", type))
-        return NMEA_INVALID;
 
-    if (!strcmp(type+2, "RMC"))
-        return NMEA_SENTENCE_RMC;
-    if (!strcmp(type+2, "GGA"))
-        return NMEA_SENTENCE_GGA;
-    if (!strcmp(type+2, "GSA"))
-        return NMEA_SENTENCE_GSA;
-    if (!strcmp(type+2, "GLL"))
-        return NMEA_SENTENCE_GLL;
-    if (!strcmp(type+2, "GST"))
-        return NMEA_SENTENCE_GST;
-    if (!strcmp(type+2, "GSV"))
-        return NMEA_SENTENCE_GSV;
-    if (!strcmp(type+2, "VTG"))
-        return NMEA_SENTENCE_VTG;
-    if (!strcmp(type+2, "ZDA"))
-        return NMEA_SENTENCE_ZDA;
-
-    return NMEA_UNKNOWN;
+    int count = nmea_tokenize(sentence, fields, end, &checksum);
+    if (!nmea_field_type(fields[0], type))
+        return 0;
+    if (NMEA_TYPE_KEY(type[2], type[3], type[4]) != expected)
+        return nmea_reject(NMEA_REJECT_TYPE);
+
+    return count;
 }
 
-bool nmea_parse_rmc(struct nmea_sentence_rmc *frame, const char *sentence)
+// Поле n, если его группа запрошена в mask, иначе NULL: значение по
+// умолчанию без разбора числа
+#define nmea_field_sel(f, n, mask, group) (((mask) & (group)) ? (f)[(n)] : NULL)
+
+static bool nmea_decode_rmc(struct nmea_sentence_rmc *frame, const char **f, int count, unsigned mask)
 {
-    // $GPRMC,081836,A,3751.65,S,14507.36,E,000.0,360.0,130998,011.3,E*62
-    char type[6];
     char validity;
     int latitude_direction;
     int longitude_direction;
     int variation_direction;
-    if (!nmea_scan(sentence, "tTcfdfdffDfd",
-            type,
-            &frame->time,
-            &validity,
-            &frame->latitude, &latitude_direction,
-            &frame->longitude, &longitude_direction,
-            &frame->speed,
-            &frame->course,
-            &frame->date,
-            &frame->variation, &variation_direction))
-        return false;
-    if (strcmp(type+2, "RMC"))
+
+    if (count < 12)
+        return nmea_reject(NMEA_REJECT_FIELDS);
+    nmea_field_char(nmea_field_sel(f, 2, mask, NMEA_FIELD_STATUS), &validity);
+    if (!nmea_field_time(nmea_field_sel(f, 1, mask, NMEA_FIELD_TIME), &frame->time) ||
+        !nmea_field_float(nmea_field_sel(f, 3, mask, NMEA_FIELD_POSITION), &frame->latitude) ||
+        !nmea_field_direction(nmea_field_sel(f, 4, mask, NMEA_FIELD_POSITION), &latitude_direction) ||
+        !nmea_field_float(nmea_field_sel(f, 5, mask, NMEA_FIELD_POSITION), &frame->longitude) ||
+        !nmea_field_direction(nmea_field_sel(f, 6, mask, NMEA_FIELD_POSITION), &longitude_direction) ||
+        !nmea_field_float(nmea_field_sel(f, 7, mask, NMEA_FIELD_MOTION), &frame->speed) ||
+        !nmea_field_float(nmea_field_sel(f, 8, mask, NMEA_FIELD_MOTION), &frame->course) ||
+        !nmea_field_date(nmea_field_sel(f, 9, mask, NMEA_FIELD_TIME), &frame->date) ||
+        !nmea_field_float(nmea_field_sel(f, 10, mask, NMEA_FIELD_MOTION), &frame->variation) ||
+        !nmea_field_direction(nmea_field_sel(f, 11, mask, NMEA_FIELD_MOTION), &variation_direction))
         return false;
 
     frame->valid = (validity == 'A');
@@ -708,26 +518,28 @@ bool nmea_parse_rmc(struct nmea_sentence_rmc *frame, const char *sentence)
     return true;
 }
 
-bool nmea_parse_gga(struct nmea_sentence_gga *frame, const char *sentence)
+static bool nmea_decode_gga(struct nmea_sentence_gga *frame, const char **f, int count, unsigned mask)
 {
-    // $GPGGA,123519,4807.038,N,01131.000,E,1,08,0.9,545.4,M,46.9,M,,*47
-    char type[6];
     int latitude_direction;
     int longitude_direction;
 
-    if (!nmea_scan(sentence, "tTfdfdiiffcfcf_",
-            type,
-            &frame->time,
-            &frame->latitude, &latitude_direction,
-            &frame->longitude, &longitude_direction,
-            &frame->fix_quality,
-            &frame->satellites_tracked,
-            &frame->hdop,
-            &frame->altitude, &frame->altitude_units,
-            &frame->height, &frame->height_units,
-            &frame->dgps_age))
+    if (count < 15)
+        return nmea_reject(NMEA_REJECT_FIELDS);
+    if (!nmea_field_time(nmea_field_sel(f, 1, mask, NMEA_FIELD_TIME), &frame->time) ||
+        !nmea_field_float(nmea_field_sel(f, 2, mask, NMEA_FIELD_POSITION), &frame->latitude) ||
+        !nmea_field_direction(nmea_field_sel(f, 3, mask, NMEA_FIELD_POSITION), &latitude_direction) ||
+        !nmea_field_float(nmea_field_sel(f, 4, mask, NMEA_FIELD_POSITION), &frame->longitude) ||
+        !nmea_field_direction(nmea_field_sel(f, 5, mask, NMEA_FIELD_POSITION), &longitude_direction) ||
+        !nmea_field_int(nmea_field_sel(f, 6, mask, NMEA_FIELD_STATUS), &frame->fix_quality) ||
+        !nmea_field_int(nmea_field_sel(f, 7, mask, NMEA_FIELD_QUALITY), &frame->satellites_tracked) ||
+        !nmea_field_float(nmea_field_sel(f, 8, mask, NMEA_FIELD_QUALITY), &frame->hdop) ||
+        !nmea_field_float(nmea_field_sel(f, 9, mask, NMEA_FIELD_ALTITUDE), &frame->altitude))
+        return false;
+    nmea_field_char(nmea_field_sel(f, 10, mask, NMEA_FIELD_ALTITUDE), &frame->altitude_units);
+    if (!nmea_field_float(nmea_field_sel(f, 11, mask, NMEA_FIELD_ALTITUDE), &frame->height))
         return false;
-    if (strcmp(type+2, "GGA"))
+    nmea_field_char(nmea_field_sel(f, 12, mask, NMEA_FIELD_ALTITUDE), &frame->height_units);
+    if (!nmea_field_float(nmea_field_sel(f, 13, mask, NMEA_FIELD_QUALITY), &frame->dgps_age))
         return false;
 
     frame->latitude.value *= latitude_direction;
@@ -736,54 +548,39 @@ bool nmea_parse_gga(struct nmea_sentence_gga *frame, const char *sentence)
     return true;
 }
 
-bool nmea_parse_gsa(struct nmea_sentence_gsa *frame, const char *sentence)
+static bool nmea_decode_gsa(struct nmea_sentence_gsa *frame, const char **f, int count, unsigned mask)
 {
-    // $GPGSA,A,3,04,05,,09,12,,,24,,,,,2.5,1.3,2.1*39
-    char type[6];
-
-    if (!nmea_scan(sentence, "tciiiiiiiiiiiiifff",
-            type,
-            &frame->mode,
-            &frame->fix_type,
-            &frame->sats[0],
-            &frame->sats[1],
-            &frame->sats[2],
-            &frame->sats[3],
-            &frame->sats[4],
-            &frame->sats[5],
-            &frame->sats[6],
-            &frame->sats[7],
-            &frame->sats[8],
-            &frame->sats[9],
-            &frame->sats[10],
-            &frame->sats[11],
-            &frame->pdop,
-            &frame->hdop,
-            &frame->vdop))
+    if (count < 18)
+        return nmea_reject(NMEA_REJECT_FIELDS);
+    nmea_field_char(nmea_field_sel(f, 1, mask, NMEA_FIELD_STATUS), &frame->mode);
+    if (!nmea_field_int(nmea_field_sel(f, 2, mask, NMEA_FIELD_STATUS), &frame->fix_type))
         return false;
-    if (strcmp(type+2, "GSA"))
+    for (int i = 0; i < 12; i++)
+        if (!nmea_field_int(nmea_field_sel(f, 3+i, mask, NMEA_FIELD_SATS), &frame->sats[i]))
+            return false;
+    if (!nmea_field_float(nmea_field_sel(f, 15, mask, NMEA_FIELD_QUALITY), &frame->pdop) ||
+        !nmea_field_float(nmea_field_sel(f, 16, mask, NMEA_FIELD_QUALITY), &frame->hdop) ||
+        !nmea_field_float(nmea_field_sel(f, 17, mask, NMEA_FIELD_QUALITY), &frame->vdop))
         return false;
 
     return true;
 }
 
-bool nmea_parse_gll(struct nmea_sentence_gll *frame, const char *sentence)
+static bool nmea_decode_gll(struct nmea_sentence_gll *frame, const char **f, int count, unsigned mask)
 {
-    // $GPGLL,3723.2475,N,12158.3416,W,161229.487,A,A*41$;
-    char type[6];
     int latitude_direction;
     int longitude_direction;
 
-    if (!nmea_scan(sentence, "tfdfdTc;c",
-            type,
-            &frame->latitude, &latitude_direction,
-            &frame->longitude, &longitude_direction,
-            &frame->time,
-            &frame->status,
-            &frame->mode))
-        return false;
-    if (strcmp(type+2, "GLL"))
+    if (count < 7)
+        return nmea_reject(NMEA_REJECT_FIELDS);
+    if (!nmea_field_float(nmea_field_sel(f, 1, mask, NMEA_FIELD_POSITION), &frame->latitude) ||
+        !nmea_field_direction(nmea_field_sel(f, 2, mask, NMEA_FIELD_POSITION), &latitude_direction) ||
+        !nmea_field_float(nmea_field_sel(f, 3, mask, NMEA_FIELD_POSITION), &frame->longitude) ||
+        !nmea_field_direction(nmea_field_sel(f, 4, mask, NMEA_FIELD_POSITION), &longitude_direction) ||
+        !nmea_field_time(nmea_field_sel(f, 5, mask, NMEA_FIELD_TIME), &frame->time))
         return false;
+    nmea_field_char(nmea_field_sel(f, 6, mask, NMEA_FIELD_STATUS), &frame->status);
+    nmea_field_char((mask & NMEA_FIELD_STATUS) ? nmea_field_at(f, count, 7) : NULL, &frame->mode);
 
     frame->latitude.value *= latitude_direction;
     frame->longitude.value *= longitude_direction;
@@ -791,155 +588,649 @@ bool nmea_parse_gll(struct nmea_sentence_gll *frame, const char *sentence)
     return true;
 }
 
-bool nmea_parse_gst(struct nmea_sentence_gst *frame, const char *sentence)
+static bool nmea_decode_gst(struct nmea_sentence_gst *frame, const char **f, int count, unsigned mask)
 {
-    // $GPGST,024603.00,3.2,6.6,4.7,47.3,5.8,5.6,22.0*58
-    char type[6];
-
-    if (!nmea_scan(sentence, "tTfffffff",
-            type,
-            &frame->time,
-            &frame->rms_deviation,
-            &frame->semi_major_deviation,
-            &frame->semi_minor_deviation,
-            &frame->semi_major_orientation,
-            &frame->latitude_error_deviation,
-            &frame->longitude_error_deviation,
-            &frame->altitude_error_deviation))
-        return false;
-    if (strcmp(type+2, "GST"))
+    if (count < 9)
+        return nmea_reject(NMEA_REJECT_FIELDS);
+    if (!nmea_field_time(nmea_field_sel(f, 1, mask, NMEA_FIELD_TIME), &frame->time) ||
+        !nmea_field_float(nmea_field_sel(f, 2, mask, NMEA_FIELD_QUALITY), &frame->rms_deviation) ||
+        !nmea_field_float(nmea_field_sel(f, 3, mask, NMEA_FIELD_QUALITY), &frame->semi_major_deviation) ||
+        !nmea_field_float(nmea_field_sel(f, 4, mask, NMEA_FIELD_QUALITY), &frame->semi_minor_deviation) ||
+        !nmea_field_float(nmea_field_sel(f, 5, mask, NMEA_FIELD_QUALITY), &frame->semi_major_orientation) ||
+        !nmea_field_float(nmea_field_sel(f, 6, mask, NMEA_FIELD_QUALITY), &frame->latitude_error_deviation) ||
+        !nmea_field_float(nmea_field_sel(f, 7, mask, NMEA_FIELD_QUALITY), &frame->longitude_error_deviation) ||
+        !nmea_field_float(nmea_field_sel(f, 8, mask, NMEA_FIELD_QUALITY), &frame->altitude_error_deviation))
         return false;
 
     return true;
 }
 
-bool nmea_parse_gsv(struct nmea_sentence_gsv *frame, const char *sentence)
+static bool nmea_decode_gsv(struct nmea_sentence_gsv *frame, const char **f, int count, unsigned mask)
 {
-    // $GPGSV,3,1,11,03,03,111,00,04,15,270,00,06,01,010,00,13,06,292,00*74
-    // $GPGSV,3,3,11,22,42,067,42,24,14,311,43,27,05,244,00,,,,*4D
-    // $GPGSV,4,2,11,08,51,203,30,09,45,215,28*75
-    // $GPGSV,4,4,13,39,31,170,27*40
-    // $GPGSV,4,4,13*7B
-    char type[6];
-
-    if (!nmea_scan(sentence, "tiii;iiiiiiiiiiiiiiii",
-            type,
-            &frame->total_msgs,
-            &frame->msg_nr,
-            &frame->total_sats,
-            &frame->sats[0].nr,
-            &frame->sats[0].elevation,
-            &frame->sats[0].azimuth,
-            &frame->sats[0].snr,
-            &frame->sats[1].nr,
-            &frame->sats[1].elevation,
-            &frame->sats[1].azimuth,
-            &frame->sats[1].snr,
-            &frame->sats[2].nr,
-            &frame->sats[2].elevation,
-            &frame->sats[2].azimuth,
-            &frame->sats[2].snr,
-            &frame->sats[3].nr,
-            &frame->sats[3].elevation,
-            &frame->sats[3].azimuth,
-            &frame->sats[3].snr
-            )) {
+    // Номера частей нужны всегда: без них не собрать цикл
+    if (count < 4)
+        return nmea_reject(NMEA_REJECT_FIELDS);
+    if (!nmea_field_int(f[1], &frame->total_msgs) ||
+        !nmea_field_int(f[2], &frame->msg_nr) ||
+        !nmea_field_int(f[3], &frame->total_sats))
         return false;
+    if (!(mask & NMEA_FIELD_SATS))
+        count = 0;
+    for (int i = 0; i < 4; i++) {
+        struct nmea_sat_info *sat = &frame->sats[i];
+        if (!nmea_field_int(nmea_field_at(f, count, 4+4*i), &sat->nr) ||
+            !nmea_field_int(nmea_field_at(f, count, 5+4*i), &sat->elevation) ||
+            !nmea_field_int(nmea_field_at(f, count, 6+4*i), &sat->azimuth) ||
+            !nmea_field_int(nmea_field_at(f, count, 7+4*i), &sat->snr))
+            return false;
     }
-    if (strcmp(type+2, "GSV"))
-        return false;
 
     return true;
 }
 
-bool nmea_parse_vtg(struct nmea_sentence_vtg *frame, const char *sentence)
+static bool nmea_decode_vtg(struct nmea_sentence_vtg *frame, const char **f, int count, unsigned mask)
 {
-    // $GPVTG,054.7,T,034.4,M,005.5,N,010.2,K*48
-    // $GPVTG,156.1,T,140.9,M,0.0,N,0.0,K*41
-    // $GPVTG,096.5,T,083.5,M,0.0,N,0.0,K,D*22
-    // $GPVTG,188.36,T,,M,0.820,N,1.519,K,A*3F
-    char type[6];
     char c_true, c_magnetic, c_knots, c_kph, c_faa_mode;
 
-    if (!nmea_scan(sentence, "tfcfcfcfc;c",
-            type,
-            &frame->true_track_degrees,
-            &c_true,
-            &frame->magnetic_track_degrees,
-            &c_magnetic,
-            &frame->speed_knots,
-            &c_knots,
-            &frame->speed_kph,
-            &c_kph,
-            &c_faa_mode))
-        return false;
-    if (strcmp(type+2, "VTG"))
+    if (count < 9)
+        return nmea_reject(NMEA_REJECT_FIELDS);
+    if (!nmea_field_float(nmea_field_sel(f, 1, mask, NMEA_FIELD_MOTION), &frame->true_track_degrees) ||
+        !nmea_field_float(nmea_field_sel(f, 3, mask, NMEA_FIELD_MOTION), &frame->magnetic_track_degrees) ||
+        !nmea_field_float(nmea_field_sel(f, 5, mask, NMEA_FIELD_MOTION), &frame->speed_knots) ||
+        !nmea_field_float(nmea_field_sel(f, 7, mask, NMEA_FIELD_MOTION), &frame->speed_kph))
         return false;
-    // �������� ��������
+    nmea_field_char((mask & NMEA_FIELD_STATUS) ? nmea_field_at(f, count, 9) : NULL, &c_faa_mode);
+    frame->faa_mode = (enum nmea_faa_mode)c_faa_mode;
+    if (!(mask & NMEA_FIELD_MOTION))
+        return true;
+
+    nmea_field_char(f[2], &c_true);
+    nmea_field_char(f[4], &c_magnetic);
+    nmea_field_char(f[6], &c_knots);
+    nmea_field_char(f[8], &c_kph);
+    // Проверка единиц
     if (c_true != 'T' ||
         c_magnetic != 'M' ||
         c_knots != 'N' ||
         c_kph != 'K')
+        return nmea_reject(NMEA_REJECT_RANGE);
+
+    return true;
+}
+
+static bool nmea_decode_zda(struct nmea_sentence_zda *frame, const char **f, int count, unsigned mask)
+{
+    if (count < 7)
+        return nmea_reject(NMEA_REJECT_FIELDS);
+    if (!nmea_field_time(nmea_field_sel(f, 1, mask, NMEA_FIELD_TIME), &frame->time) ||
+        !nmea_field_int(nmea_field_sel(f, 2, mask, NMEA_FIELD_TIME), &frame->date.day) ||
+        !nmea_field_int(nmea_field_sel(f, 3, mask, NMEA_FIELD_TIME), &frame->date.month) ||
+        !nmea_field_int(nmea_field_sel(f, 4, mask, NMEA_FIELD_TIME), &frame->date.year) ||
+        !nmea_field_int(nmea_field_sel(f, 5, mask, NMEA_FIELD_TIME), &frame->hour_offset) ||
+        !nmea_field_int(nmea_field_sel(f, 6, mask, NMEA_FIELD_TIME), &frame->minute_offset))
+        return false;
+
+    // Проверка смещения
+    if (abs(frame->hour_offset) > 13 ||
+        frame->minute_offset > 59 ||
+        frame->minute_offset < 0)
+        return nmea_reject(NMEA_REJECT_RANGE);
+
+    return true;
+}
+
+bool nmea_talker_id(char talker[3], const char *sentence)
+{
+    char type[6];
+    if (!nmea_scan(sentence, "t", type))
         return false;
-    frame->faa_mode = (enum nmea_faa_mode)c_faa_mode;
+
+    talker[0] = type[0];
+    talker[1] = type[1];
+    talker[2] = '\0';
 
     return true;
 }
 
+bool nmea_parse_rmc_fields(struct nmea_sentence_rmc *frame, const char *sentence, unsigned mask)
+{
+    // $GPRMC,081836,A,3751.65,S,14507.36,E,000.0,360.0,130998,011.3,E*62
+    const char *fields[NMEA_MAX_FIELDS];
+    const char *end;
+    NMEA_STATS_BEGIN(start);
+    int count = nmea_fields(sentence, fields, NMEA_TYPE_KEY('R', 'M', 'C'), &end);
+    bool ok = count && nmea_decode_rmc(frame, fields, count, mask);
+
+    NMEA_STATS_END(start, ok ? NMEA_SENTENCE_RMC : NMEA_INVALID, (size_t) (end - sentence) + (*end == '*' ? 3 : 0));
+    return ok;
+}
+
+bool nmea_parse_rmc(struct nmea_sentence_rmc *frame, const char *sentence)
+{
+    return nmea_parse_rmc_fields(frame, sentence, NMEA_PARSE_FIELDS);
+}
+
+bool nmea_parse_gga_fields(struct nmea_sentence_gga *frame, const char *sentence, unsigned mask)
+{
+    // $GPGGA,123519,4807.038,N,01131.000,E,1,08,0.9,545.4,M,46.9,M,,*47
+    const char *fields[NMEA_MAX_FIELDS];
+    const char *end;
+    NMEA_STATS_BEGIN(start);
+    int count = nmea_fields(sentence, fields, NMEA_TYPE_KEY('G', 'G', 'A'), &end);
+    bool ok = count && nmea_decode_gga(frame, fields, count, mask);
+
+    NMEA_STATS_END(start, ok ? NMEA_SENTENCE_GGA : NMEA_INVALID, (size_t) (end - sentence) + (*end == '*' ? 3 : 0));
+    return ok;
+}
+
+bool nmea_parse_gga(struct nmea_sentence_gga *frame, const char *sentence)
+{
+    return nmea_parse_gga_fields(frame, sentence, NMEA_PARSE_FIELDS);
+}
+
+bool nmea_parse_gsa_fields(struct nmea_sentence_gsa *frame, const char *sentence, unsigned mask)
+{
+    // $GPGSA,A,3,04,05,,09,12,,,24,,,,,2.5,1.3,2.1*39
+    const char *fields[NMEA_MAX_FIELDS];
+    const char *end;
+    NMEA_STATS_BEGIN(start);
+    int count = nmea_fields(sentence, fields, NMEA_TYPE_KEY('G', 'S', 'A'), &end);
+    bool ok = count && nmea_decode_gsa(frame, fields, count, mask);
+
+    NMEA_STATS_END(start, ok ? NMEA_SENTENCE_GSA : NMEA_INVALID, (size_t) (end - sentence) + (*end == '*' ? 3 : 0));
+    return ok;
+}
+
+bool nmea_parse_gsa(struct nmea_sentence_gsa *frame, const char *sentence)
+{
+    return nmea_parse_gsa_fields(frame, sentence, NMEA_PARSE_FIELDS);
+}
+
+bool nmea_parse_gll_fields(struct nmea_sentence_gll *frame, const char *sentence, unsigned mask)
+{
+    // $GPGLL,3723.2475,N,12158.3416,W,161229.487,A,A*41$;
+    const char *fields[NMEA_MAX_FIELDS];
+    const char *end;
+    NMEA_STATS_BEGIN(start);
+    int count = nmea_fields(sentence, fields, NMEA_TYPE_KEY('G', 'L', 'L'), &end);
+    bool ok = count && nmea_decode_gll(frame, fields, count, mask);
+
+    NMEA_STATS_END(start, ok ? NMEA_SENTENCE_GLL : NMEA_INVALID, (size_t) (end - sentence) + (*end == '*' ? 3 : 0));
+    return ok;
+}
+
+bool nmea_parse_gll(struct nmea_sentence_gll *frame, const char *sentence)
+{
+    return nmea_parse_gll_fields(frame, sentence, NMEA_PARSE_FIELDS);
+}
+
+bool nmea_parse_gst_fields(struct nmea_sentence_gst *frame, const char *sentence, unsigned mask)
+{
+    // $GPGST,024603.00,3.2,6.6,4.7,47.3,5.8,5.6,22.0*58
+    const char *fields[NMEA_MAX_FIELDS];
+    const char *end;
+    NMEA_STATS_BEGIN(start);
+    int count = nmea_fields(sentence, fields, NMEA_TYPE_KEY('G', 'S', 'T'), &end);
+    bool ok = count && nmea_decode_gst(frame, fields, count, mask);
+
+    NMEA_STATS_END(start, ok ? NMEA_SENTENCE_GST : NMEA_INVALID, (size_t) (end - sentence) + (*end == '*' ? 3 : 0));
+    return ok;
+}
+
+bool nmea_parse_gst(struct nmea_sentence_gst *frame, const char *sentence)
+{
+    return nmea_parse_gst_fields(frame, sentence, NMEA_PARSE_FIELDS);
+}
+
+bool nmea_parse_gsv_fields(struct nmea_sentence_gsv *frame, const char *sentence, unsigned mask)
+{
+    // $GPGSV,3,1,11,03,03,111,00,04,15,270,00,06,01,010,00,13,06,292,00*74
+    // $GPGSV,3,3,11,22,42,067,42,24,14,311,43,27,05,244,00,,,,*4D
+    // $GPGSV,4,2,11,08,51,203,30,09,45,215,28*75
+    // $GPGSV,4,4,13,39,31,170,27*40
+    // $GPGSV,4,4,13*7B
+    const char *fields[NMEA_MAX_FIELDS];
+    const char *end;
+    NMEA_STATS_BEGIN(start);
+    int count = nmea_fields(sentence, fields, NMEA_TYPE_KEY('G', 'S', 'V'), &end);
+    bool ok = count && nmea_decode_gsv(frame, fields, count, mask);
+
+    NMEA_STATS_END(start, ok ? NMEA_SENTENCE_GSV : NMEA_INVALID, (size_t) (end - sentence) + (*end == '*' ? 3 : 0));
+    return ok;
+}
+
+bool nmea_parse_gsv(struct nmea_sentence_gsv *frame, const char *sentence)
+{
+    return nmea_parse_gsv_fields(frame, sentence, NMEA_PARSE_FIELDS);
+}
+
+bool nmea_parse_vtg_fields(struct nmea_sentence_vtg *frame, const char *sentence, unsigned mask)
+{
+    // $GPVTG,054.7,T,034.4,M,005.5,N,010.2,K*48
+    // $GPVTG,156.1,T,140.9,M,0.0,N,0.0,K*41
+    // $GPVTG,096.5,T,083.5,M,0.0,N,0.0,K,D*22
+    // $GPVTG,188.36,T,,M,0.820,N,1.519,K,A*3F
+    const char *fields[NMEA_MAX_FIELDS];
+    const char *end;
+    NMEA_STATS_BEGIN(start);
+    int count = nmea_fields(sentence, fields, NMEA_TYPE_KEY('V', 'T', 'G'), &end);
+    bool ok = count && nmea_decode_vtg(frame, fields, count, mask);
+
+    NMEA_STATS_END(start, ok ? NMEA_SENTENCE_VTG : NMEA_INVALID, (size_t) (end - sentence) + (*end == '*' ? 3 : 0));
+    return ok;
+}
+
+bool nmea_parse_vtg(struct nmea_sentence_vtg *frame, const char *sentence)
+{
+    return nmea_parse_vtg_fields(frame, sentence, NMEA_PARSE_FIELDS);
+}
+
+bool nmea_parse_zda_fields(struct nmea_sentence_zda *frame, const char *sentence, unsigned mask)
+{
+    // $GPZDA,201530.00,04,07,2002,00,00*60
+    const char *fields[NMEA_MAX_FIELDS];
+    const char *end;
+    NMEA_STATS_BEGIN(start);
+    int count = nmea_fields(sentence, fields, NMEA_TYPE_KEY('Z', 'D', 'A'), &end);
+    bool ok = count && nmea_decode_zda(frame, fields, count, mask);
+
+    NMEA_STATS_END(start, ok ? NMEA_SENTENCE_ZDA : NMEA_INVALID, (size_t) (end - sentence) + (*end == '*' ? 3 : 0));
+    return ok;
+}
+
 bool nmea_parse_zda(struct nmea_sentence_zda *frame, const char *sentence)
 {
-  // $GPZDA,201530.00,04,07,2002,00,00*60
-  char type[6];
+    return nmea_parse_zda_fields(frame, sentence, NMEA_PARSE_FIELDS);
+}
 
-  if(!nmea_scan(sentence, "tTiiiii",
-          type,
-          &frame->time,
-          &frame->date.day,
-          &frame->date.month,
-          &frame->date.year,
-          &frame->hour_offset,
-          &frame->minute_offset))
-      return false;
-  if (strcmp(type+2, "ZDA"))
-      return false;
+int nmea_split(const char *sentence, const char *fields[NMEA_MAX_FIELDS], bool strict, const char **next)
+{
+    const char *end;
+    uint8_t checksum;
 
-  // �������� ��������
-  if (abs(frame->hour_offset) > 13 ||
-      frame->minute_offset > 59 ||
-      frame->minute_offset < 0)
-      return false;
+    if (*sentence != '$')
+        return nmea_reject(NMEA_REJECT_FORMAT);
 
-  return true;
+    int count = nmea_tokenize(sentence, fields, &end, &checksum);
+    const char *line_end = nmea_trailer(end, checksum ^ '$', strict);
+    if (!line_end)
+        return 0;
+    if (line_end - sentence > NMEA_MAX_LENGTH + 3)
+        return nmea_reject(NMEA_REJECT_LENGTH);
+
+    if (next)
+        *next = line_end;
+    return count;
 }
 
-int nmea_gettime(struct timespec *ts, const struct nmea_date *date, const struct nmea_time *time_)
+int nmea_split_n(const char *data, size_t len, const char *fields[NMEA_MAX_FIELDS], bool strict, size_t *end)
 {
-    if (date->year == -1 || time_->hours == -1)
-        return -1;
+    const char *stop;
+    uint8_t checksum;
+    int count;
+
+    if (len > NMEA_MAX_LENGTH + 3)
+        return nmea_reject(NMEA_REJECT_LENGTH);
+    if (!len || *data != '$')
+        return nmea_reject(NMEA_REJECT_FORMAT);
+
+    // Признак конца данных внутри буфера - разметка не выходит за len
+    unsigned char last = (unsigned char) data[len - 1];
+    if (last == '\n' || last == '\r' || (len >= 3 && data[len - 3] == '*'))
+        count = nmea_tokenize(data, fields, &stop, &checksum);
+    else
+        count = nmea_tokenize_n(data, len, fields, &stop, &checksum);
+
+    if (!nmea_trailer_n(stop, data + len, checksum ^ '$', strict))
+        return 0;
 
-    struct tm tm;
-    memset(&tm, 0, sizeof(tm));
-    if (date->year < 80) {
-        tm.tm_year = 2000 + date->year - 1900;
-    } else if (date->year >= 1900) {
-        tm.tm_year = date->year - 1900;
-    } else {
-        tm.tm_year = date->year;
+    if (end)
+        *end = (size_t) (stop - data);
+    return count;
+}
+
+bool nmea_check_n(const char *data, size_t len, bool strict)
+{
+    const char *fields[NMEA_MAX_FIELDS];
+    return nmea_split_n(data, len, fields, strict, NULL) != 0;
+}
+
+// Таблица зарегистрированных предложений: открытая адресация, заполнение
+// не более 50%, поэтому поиск - не более пары проб независимо от размера
+#define NMEA_REGISTRY_BITS			7
+#define NMEA_REGISTRY_SIZE			(1 << NMEA_REGISTRY_BITS)
+#define NMEA_REGISTRY_MASK			(NMEA_REGISTRY_SIZE - 1)
+#define NMEA_FORMATTER_KEY			((uint64_t)1 << 63)	// ключ только по типу, любой источник
+
+struct nmea_registry_entry {
+    uint64_t key;			// 0 - свободно
+    enum nmea_sentence_id id;
+    nmea_decoder decode;
+    void *ctx;
+};
+
+static struct nmea_registry_entry nmea_registry[NMEA_REGISTRY_SIZE];
+static int nmea_registry_count;
+
+// До 8 символов адреса, упакованных в целое
+static inline uint64_t nmea_address_key(const char *address, size_t len)
+{
+    uint64_t key = 0;
+    for (size_t i = 0; i < len; i++)
+        key |= (uint64_t)(unsigned char) address[i] << (8 * i);
+    return key;
+}
+
+static inline struct nmea_registry_entry *nmea_registry_find(uint64_t key)
+{
+    size_t i = (size_t) ((key * 0x9E3779B97F4A7C15ull) >> (64 - NMEA_REGISTRY_BITS));
+
+    for (;; i = (i + 1) & NMEA_REGISTRY_MASK) {
+        if (nmea_registry[i].key == key || !nmea_registry[i].key)
+            return &nmea_registry[i];
     }
-    tm.tm_mon = date->month - 1;
-    tm.tm_mday = date->day;
-    tm.tm_hour = time_->hours;
-    tm.tm_min = time_->minutes;
-    tm.tm_sec = time_->seconds;
-
-    time_t timestamp = timegm(&tm);
-    if (timestamp != (time_t)-1) {
-        ts->tv_sec = timestamp;
-        ts->tv_nsec = time_->microseconds * 1000;
-        return 0;
+}
+
+static const struct nmea_registry_entry *nmea_registry_lookup(const char *sentence)
+{
+    if (!nmea_registry_count || *sentence != '$')
+        return NULL;
+
+    size_t len = 0;
+    while (len < 9 && nmea_isfield(sentence[1+len]))
+        len++;
+
+    const struct nmea_registry_entry *entry = NULL;
+    if (len <= 8)
+        entry = nmea_registry_find(nmea_address_key(sentence+1, len));
+    if ((!entry || !entry->key) && len >= 5)
+        entry = nmea_registry_find(nmea_address_key(sentence+3, 3) | NMEA_FORMATTER_KEY);
+
+    return entry && entry->key ? entry : NULL;
+}
+
+static enum nmea_sentence_id nmea_builtin_id(uint32_t key)
+{
+    switch (key) {
+        case NMEA_TYPE_KEY('R', 'M', 'C'): return NMEA_SENTENCE_RMC;
+        case NMEA_TYPE_KEY('G', 'G', 'A'): return NMEA_SENTENCE_GGA;
+        case NMEA_TYPE_KEY('G', 'S', 'A'): return NMEA_SENTENCE_GSA;
+        case NMEA_TYPE_KEY('G', 'L', 'L'): return NMEA_SENTENCE_GLL;
+        case NMEA_TYPE_KEY('G', 'S', 'T'): return NMEA_SENTENCE_GST;
+        case NMEA_TYPE_KEY('G', 'S', 'V'): return NMEA_SENTENCE_GSV;
+        case NMEA_TYPE_KEY('V', 'T', 'G'): return NMEA_SENTENCE_VTG;
+        case NMEA_TYPE_KEY('Z', 'D', 'A'): return NMEA_SENTENCE_ZDA;
+        default: return NMEA_UNKNOWN;
+    }
+}
+
+static enum nmea_sentence_id nmea_builtin_type(const char *sentence)
+{
+    char type[6];
+    if (!nmea_field_type(sentence, type))
+        return NMEA_INVALID;
+
+    return nmea_builtin_id(NMEA_TYPE_KEY(type[2], type[3], type[4]));
+}
+
+enum nmea_sentence_id nmea_register(const char *address, nmea_decoder decode, void *ctx)
+{
+    size_t len = strlen(address);
+    uint64_t key;
+
+    for (size_t i = 0; i < len; i++)
+        if (!nmea_isfield(address[i]))
+            return NMEA_INVALID;
+
+    // Встроенные типы не переопределяются
+    if (len == 3) {
+        if (nmea_builtin_id(NMEA_TYPE_KEY(address[0], address[1], address[2])) != NMEA_UNKNOWN)
+            return NMEA_INVALID;
+        key = nmea_address_key(address, 3) | NMEA_FORMATTER_KEY;
+    } else if (len >= 2 && len <= 8) {
+        // У собственных (P...) адресов нет источника: "PGRMC" - не RMC
+        if (len >= 5 && address[0] != 'P' &&
+            nmea_builtin_id(NMEA_TYPE_KEY(address[2], address[3], address[4])) != NMEA_UNKNOWN)
+            return NMEA_INVALID;
+        key = nmea_address_key(address, len);
     } else {
-        return -1;
+        return NMEA_INVALID;
+    }
+
+    struct nmea_registry_entry *entry = nmea_registry_find(key);
+    if (!entry->key) {
+        if (nmea_registry_count >= NMEA_REGISTRY_MAX)
+            return NMEA_INVALID;
+        entry->key = key;
+        entry->id = (enum nmea_sentence_id) (NMEA_SENTENCE_USER + nmea_registry_count++);
+    }
+    entry->decode = decode;
+    entry->ctx = ctx;
+
+    return entry->id;
+}
+
+enum nmea_sentence_id nmea_sentence_type(const char *sentence)
+{
+    const struct nmea_registry_entry *entry = nmea_registry_lookup(sentence);
+    if (entry)
+        return entry->id;
+
+    return nmea_builtin_type(sentence);
+}
+
+enum nmea_sentence_id nmea_sentence_id(const char *sentence, bool strict)
+{
+    const char *fields[NMEA_MAX_FIELDS];
+    const char *next;
+
+    if (!nmea_split(sentence, fields, strict, &next))
+        return NMEA_INVALID;
+    if (*next) {
+        NMEA_STATS_REJECT(NMEA_REJECT_FORMAT);
+        return NMEA_INVALID;
+    }
+
+    return nmea_sentence_type(sentence);
+}
+
+// Тип и декодирование по полям, уже проверенным nmea_split()
+static enum nmea_sentence_id nmea_decode(struct nmea_sentence *frame, const char *fields[NMEA_MAX_FIELDS], int count, unsigned mask)
+{
+    const char *sentence = fields[0];
+    const struct nmea_registry_entry *entry = nmea_registry_lookup(sentence);
+
+    frame->id = entry ? entry->id : nmea_builtin_type(sentence);
+    if (frame->id == NMEA_INVALID)
+        return NMEA_INVALID;
+    frame->talker[0] = sentence[1];
+    frame->talker[1] = sentence[2];
+    frame->talker[2] = '\0';
+
+    bool ok = true;
+    switch (frame->id) {
+        case NMEA_SENTENCE_RMC: ok = nmea_decode_rmc(&frame->data.rmc, fields, count, mask); break;
+        case NMEA_SENTENCE_GGA: ok = nmea_decode_gga(&frame->data.gga, fields, count, mask); break;
+        case NMEA_SENTENCE_GSA: ok = nmea_decode_gsa(&frame->data.gsa, fields, count, mask); break;
+        case NMEA_SENTENCE_GLL: ok = nmea_decode_gll(&frame->data.gll, fields, count, mask); break;
+        case NMEA_SENTENCE_GST: ok = nmea_decode_gst(&frame->data.gst, fields, count, mask); break;
+        case NMEA_SENTENCE_GSV: ok = nmea_decode_gsv(&frame->data.gsv, fields, count, mask); break;
+        case NMEA_SENTENCE_VTG: ok = nmea_decode_vtg(&frame->data.vtg, fields, count, mask); break;
+        case NMEA_SENTENCE_ZDA: ok = nmea_decode_zda(&frame->data.zda, fields, count, mask); break;
+        default:
+            if (entry && entry->decode && !entry->decode(entry->ctx, frame, sentence, fields, count))
+                ok = nmea_reject(NMEA_REJECT_DECODER);
+            break;
+    }
+
+    if (!ok)
+        frame->id = NMEA_INVALID;
+    return frame->id;
+}
+
+enum nmea_sentence_id nmea_parse_line(struct nmea_sentence *frame, const char *sentence, bool strict, const char **next)
+{
+    const char *fields[NMEA_MAX_FIELDS];
+    const char *line_end = sentence;
+    NMEA_STATS_BEGIN(start);
+
+    frame->id = NMEA_INVALID;
+    int count = nmea_split(sentence, fields, strict, &line_end);
+    if (count)
+        nmea_decode(frame, fields, count, NMEA_PARSE_FIELDS);
+    if (next && count)
+        *next = line_end;
+
+    NMEA_STATS_END(start, frame->id, (size_t) (line_end - sentence));
+    return frame->id;
+}
+
+enum nmea_sentence_id nmea_parse_any_n(struct nmea_sentence *frame, const char *data, size_t len, bool strict)
+{
+    const char *fields[NMEA_MAX_FIELDS];
+    char tail[NMEA_MAX_LENGTH + 4];
+    size_t end;
+
+    NMEA_STATS_BEGIN(start);
+
+    frame->id = NMEA_INVALID;
+    int count = nmea_split_n(data, len, fields, strict, &end);
+    if (count) {
+        // Нет "*hh" и конца строки: за последним полем в буфере нет разделителя,
+        // декодеры получают его копию с '\0'
+        if (end == len) {
+            size_t n = (size_t) (data + len - fields[count - 1]);
+            memcpy(tail, fields[count - 1], n);
+            tail[n] = '\0';
+            fields[count - 1] = tail;
+        }
+        nmea_decode(frame, fields, count, NMEA_PARSE_FIELDS);
     }
+
+    NMEA_STATS_END(start, frame->id, len);
+    return frame->id;
 }
 
+enum nmea_sentence_id nmea_parse_any(struct nmea_sentence *frame, const char *sentence, bool strict)
+{
+    return nmea_parse_fields(frame, sentence, strict, NMEA_PARSE_FIELDS);
+}
 
+enum nmea_sentence_id nmea_parse_fields(struct nmea_sentence *frame, const char *sentence, bool strict, unsigned mask)
+{
+    const char *fields[NMEA_MAX_FIELDS];
+    const char *next = sentence;
+    NMEA_STATS_BEGIN(start);
+
+    frame->id = NMEA_INVALID;
+    int count = nmea_split(sentence, fields, strict, &next);
+    // Данные после конца строки недопустимы
+    if (count && *next)
+        NMEA_STATS_REJECT(NMEA_REJECT_FORMAT);
+    else if (count)
+        nmea_decode(frame, fields, count, mask);
+
+    NMEA_STATS_END(start, frame->id, (size_t) (next - sentence));
+    return frame->id;
+}
+
+// Кэш полуночи последней даты (в каждом потоке свой)
+#ifdef NMEA_THREAD_LOCAL
+static NMEA_THREAD_LOCAL struct {
+    int day;
+    int month;
+    int year;
+    int64_t midnight;
+} nmea_midnight_cache = {-1, -1, -1, 0};
+#endif
+
+// TAI - UTC с 1972 года: момент UTC (UNIX) и новое значение
+static const struct {
+    int64_t since;
+    int offset;
+} nmea_leap_table[] = {
+    {63072000, 10}, {78796800, 11}, {94694400, 12}, {126230400, 13},
+    {157766400, 14}, {189302400, 15}, {220924800, 16}, {252460800, 17},
+    {283996800, 18}, {315532800, 19}, {362793600, 20}, {394329600, 21},
+    {425865600, 22}, {489024000, 23}, {567993600, 24}, {631152000, 25},
+    {662688000, 26}, {709948800, 27}, {741484800, 28}, {773020800, 29},
+    {820454400, 30}, {867715200, 31}, {915148800, 32}, {1136073600, 33},
+    {1230768000, 34}, {1341100800, 35}, {1435708800, 36}, {1483228800, 37},
+};
+
+int nmea_leap_seconds(int64_t utc)
+{
+    int n = (int) (sizeof(nmea_leap_table) / sizeof(nmea_leap_table[0]));
+
+    while (n > 0 && utc < nmea_leap_table[n - 1].since)
+        n--;
+    return n ? nmea_leap_table[n - 1].offset : 0;
+}
+
+// Секунды UNIX на начало суток
+static int64_t nmea_midnight(const struct nmea_date *date)
+{
+#ifdef NMEA_THREAD_LOCAL
+    if (date->day == nmea_midnight_cache.day && date->month == nmea_midnight_cache.month &&
+        date->year == nmea_midnight_cache.year)
+        return nmea_midnight_cache.midnight;
+#endif
+
+    int year = date->year;
+    if (year < 80)
+        year += 2000;
+    else if (year < 1900)
+        year += 1900;
+
+    // Месяц вне 1..12 переносится на год, как в timegm()
+    int month = date->month - 1;
+    year += month >= 0 ? month / 12 : (month - 11) / 12;
+    month -= (month >= 0 ? month / 12 : (month - 11) / 12) * 12;
+
+    int64_t midnight = nmea_days_from_civil(year, month + 1, date->day) * 86400;
+
+#ifdef NMEA_THREAD_LOCAL
+    nmea_midnight_cache.day = date->day;
+    nmea_midnight_cache.month = date->month;
+    nmea_midnight_cache.year = date->year;
+    nmea_midnight_cache.midnight = midnight;
+#endif
+    return midnight;
+}
+
+int nmea_gettime(struct timespec *ts, const struct nmea_date *date, const struct nmea_time *time_)
+{
+    return nmea_gettime_scale(ts, date, time_, NMEA_TIMESCALE_UTC);
+}
+
+int nmea_gettime_scale(struct timespec *ts, const struct nmea_date *date, const struct nmea_time *time_,
+                       enum nmea_timescale scale)
+{
+    if (date->year == -1 || time_->hours == -1)
+        return -1;
+
+    int64_t seconds = nmea_midnight(date)
+                    + (int64_t) time_->hours * 3600 + time_->minutes * 60 + time_->seconds;
+
+    switch (scale) {
+        case NMEA_TIMESCALE_UTC:
+            break;
+        case NMEA_TIMESCALE_TAI:
+            // 23:59:60 считается по значению до вставки секунды
+            seconds += nmea_leap_seconds(seconds - (time_->seconds == 60));
+            break;
+        case NMEA_TIMESCALE_GPS:
+            seconds += nmea_leap_seconds(seconds - (time_->seconds == 60)) - NMEA_GPS_TAI_OFFSET
+                     - NMEA_GPS_EPOCH;
+            break;
+        default:
+            return -1;
+    }
+
+    if ((time_t) seconds != seconds)
+        return -1;
+
+    ts->tv_sec = (time_t) seconds;
+    ts->tv_nsec = time_->microseconds * 1000;
+    return 0;
+}
@@ -17,10 +17,53 @@ extern "C" {
 #include <math.h>
 
 #define NMEA_MAX_LENGTH				256
+#define NMEA_MAX_FIELDS				32
+#define NMEA_REGISTRY_MAX			64
 #define NMEA_LEN					16
 #define FREQ_LEN					14
 #define BAUD_LEN					28
 
+// Группы полей для nmea_parse_*_fields(): поля вне mask не разбираются и
+// получают значение пустого поля
+#define NMEA_FIELD_TIME				0x01	// время, дата (RMC, ZDA)
+#define NMEA_FIELD_POSITION			0x02	// широта, долгота
+#define NMEA_FIELD_STATUS			0x04	// достоверность, тип решения, режим
+#define NMEA_FIELD_MOTION			0x08	// скорость, курс, склонение
+#define NMEA_FIELD_ALTITUDE			0x10	// высота, высота геоида (GGA)
+#define NMEA_FIELD_QUALITY			0x20	// число спутников, DOP, СКО, возраст DGPS
+#define NMEA_FIELD_SATS				0x40	// номера спутников GSA, спутники GSV
+#define NMEA_FIELD_ALL				0xFF
+
+// Набор полей nmea_parse_*() и nmea_parse_any(), при сборке можно сузить:
+// -DNMEA_PARSE_FIELDS="(NMEA_FIELD_TIME|NMEA_FIELD_POSITION)"
+#ifndef NMEA_PARSE_FIELDS
+#define NMEA_PARSE_FIELDS			NMEA_FIELD_ALL
+#endif
+
+#define NMEA_GPS_EPOCH				315964800	// 1980-01-06 00:00:00 UTC в секундах UNIX
+#define NMEA_GPS_TAI_OFFSET			19			// TAI - GPS
+
+// Переменная потока (кэши разбора, счетчики nmea_stats). Не определен -
+// компилятор без поддержки, кэши отключаются
+#if defined(_MSC_VER)
+#define NMEA_THREAD_LOCAL			__declspec(thread)
+#elif defined(__GNUC__)
+#define NMEA_THREAD_LOCAL			__thread
+#endif
+
+// Значение, которое публикует один поток и читают другие (выбранная
+// реализация SIMD, индексы очереди nmea_epoch): чтение acquire, запись release
+#if defined(__GNUC__)
+#define nmea_atomic_load(p)			__atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define nmea_atomic_store(p, v)		__atomic_store_n((p), (v), __ATOMIC_RELEASE)
+#elif defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64))
+// /volatile:ms (по умолчанию на x86/x64): volatile - acquire/release
+#define nmea_atomic_load(p)			(*(volatile __typeof__(*(p)) *) (p))
+#define nmea_atomic_store(p, v)		(*(volatile __typeof__(*(p)) *) (p) = (v))
+#else
+#error "nmea_atomic_load/store: GCC/Clang atomics or MSVC x86/x64 required"
+#endif
+
 
 //------------------- VARIABLES ---------------------------
 enum nmea_sentence_id {
@@ -34,11 +77,23 @@ enum nmea_sentence_id {
 	NMEA_SENTENCE_GSV,
 	NMEA_SENTENCE_VTG,
 	NMEA_SENTENCE_ZDA,
+	NMEA_SENTENCE_USER = 32,	// первый идентификатор nmea_register()
+};
+
+enum nmea_timescale {
+	NMEA_TIMESCALE_UTC = 0,	// секунды UNIX
+	NMEA_TIMESCALE_GPS,		// секунды от начала эпохи GPS, без високосных секунд
+	NMEA_TIMESCALE_TAI,		// секунды UNIX + (TAI - UTC), как CLOCK_TAI
 };
 
 struct nmea_float {
-	int_least32_t value;
-	int_least32_t scale;
+	int_least64_t value;
+	int_least64_t scale;	// 0 - значение отсутствует
+};
+
+struct nmea_span {
+	const char *data;
+	size_t len;
 };
 
 struct nmea_date {
@@ -160,21 +215,47 @@ struct nmea_sentence_zda {
 	int minute_offset;
 };
 
-extern uint8_t turn_Off_GPGGA[NMEA_LEN];
-extern uint8_t turn_Off_GPGLL[NMEA_LEN];
-extern uint8_t turn_Off_GPGSA[NMEA_LEN];
-extern uint8_t turn_Off_GPGLV[NMEA_LEN];
-extern uint8_t turn_Off_GPRMC[NMEA_LEN];
-extern uint8_t turn_Off_GPVTG[NMEA_LEN];
+struct nmea_sentence {
+	enum nmea_sentence_id id;
+	char talker[3];
+	union {
+		struct nmea_sentence_rmc rmc;
+		struct nmea_sentence_gga gga;
+		struct nmea_sentence_gsa gsa;
+		struct nmea_sentence_gll gll;
+		struct nmea_sentence_gst gst;
+		struct nmea_sentence_gsv gsv;
+		struct nmea_sentence_vtg vtg;
+		struct nmea_sentence_zda zda;
+		uint64_t user[8];	// данные зарегистрированных декодеров
+	} data;
+};
+
+/**
+ * Декодер зарегистрированного предложения. fields - поля после nmea_split(),
+ * результат записывается в frame->data.user. Возвращает true в случае успеха
+ */
+typedef bool (*nmea_decoder)(void *ctx, struct nmea_sentence *frame, const char *sentence,
+                             const char *fields[], int count);
+
+/**
+ * Готовые кадры UBX CFG-MSG/CFG-RATE/CFG-PRT, другие параметры - nmea_ubx.h
+ */
+extern const uint8_t turn_Off_GPGGA[NMEA_LEN];
+extern const uint8_t turn_Off_GPGLL[NMEA_LEN];
+extern const uint8_t turn_Off_GPGSA[NMEA_LEN];
+extern const uint8_t turn_Off_GPGLV[NMEA_LEN];
+extern const uint8_t turn_Off_GPRMC[NMEA_LEN];
+extern const uint8_t turn_Off_GPVTG[NMEA_LEN];
 // <<---------------------------------------------------------------------------//on packets
-extern uint8_t turn_On_GPGGA[NMEA_LEN];
-extern uint8_t turn_On_GPGLL[NMEA_LEN];
-extern uint8_t turn_On_GPGSA[NMEA_LEN];
-extern uint8_t turn_On_GPGLV[NMEA_LEN];
-extern uint8_t turn_On_GPRMC[NMEA_LEN];
-extern uint8_t turn_On_GPVTG[NMEA_LEN];
-extern uint8_t updateFreq[FREQ_LEN];
-extern uint8_t changeBaud[BAUD_LEN];
+extern const uint8_t turn_On_GPGGA[NMEA_LEN];
+extern const uint8_t turn_On_GPGLL[NMEA_LEN];
+extern const uint8_t turn_On_GPGSA[NMEA_LEN];
+extern const uint8_t turn_On_GPGLV[NMEA_LEN];
+extern const uint8_t turn_On_GPRMC[NMEA_LEN];
+extern const uint8_t turn_On_GPVTG[NMEA_LEN];
+extern const uint8_t updateFreq[FREQ_LEN];
+extern const uint8_t changeBaud[BAUD_LEN];
 
 //------------------- FUNCTIONS ---------------------------
 /**
@@ -197,11 +278,49 @@ bool nmea_talker_id(char talker[3], const char *sentence);
  */
 enum nmea_sentence_id nmea_sentence_id(const char *sentence, bool strict);
 
+/**
+ * Регистрация дополнительного предложения для nmea_sentence_type(),
+ * nmea_sentence_id() и nmea_parse_any(). address - тип из 3 символов для
+ * любого источника ("HDT") или полный адрес до 8 символов ("PUBX", "PGRMZ").
+ * decode может быть NULL (только определение типа). Встроенные типы не
+ * переопределяются. Не потокобезопасна: регистрировать до начала разбора.
+ * Возвращает идентификатор (>= NMEA_SENTENCE_USER), NMEA_INVALID при ошибке
+ */
+enum nmea_sentence_id nmea_register(const char *address, nmea_decoder decode, void *ctx);
+
+/**
+ * Определяет тип по первому полю "$ttsss" без проверки контрольной суммы
+ */
+enum nmea_sentence_id nmea_sentence_type(const char *sentence);
+
+/**
+ * Проверка и разбивка на поля за один проход.
+ * Строка завершается '\0' или концом строки ("\n", "\r\n"),
+ * в *next (если не NULL) записывается начало следующей строки.
+ * Возвращает количество полей (не более NMEA_MAX_FIELDS), 0 при ошибке
+ */
+int nmea_split(const char *sentence, const char *fields[NMEA_MAX_FIELDS], bool strict, const char **next);
+
+/**
+ * nmea_split() для предложения длиной len (без '\0'), например прямо
+ * в буфере приема. len включает "*hh" и конец строки, если они есть.
+ * В *end (если не NULL) записывается смещение конца данных.
+ * Если за данными в буфере нет ни "*hh", ни конца строки, последнее
+ * поле заканчивается на data + len, а не разделителем.
+ * Возвращает количество полей, 0 при ошибке
+ */
+int nmea_split_n(const char *data, size_t len, const char *fields[NMEA_MAX_FIELDS], bool strict, size_t *end);
+
+/**
+ * nmea_check() для предложения длиной len
+ */
+bool nmea_check_n(const char *data, size_t len, bool strict);
+
 /**
  * Сканер данных NMEA. Поддерживаемые форматы:
  * c - символ (char *)
  * d - направление, возвращает as 1/-1, дефолт 0 (int *)
- * f - дробный, возвращает значение + размер (int *, int *)
+ * f - дробный, значение + размер до 18 значащих цифр (struct nmea_float *)
  * i - десятичное, дефолт 0 (int *)
  * s - строка (char *)
  * t - идентефикатор и тип (char *)
@@ -222,15 +341,79 @@ bool nmea_parse_gsv(struct nmea_sentence_gsv *frame, const char *sentence);
 bool nmea_parse_vtg(struct nmea_sentence_vtg *frame, const char *sentence);
 bool nmea_parse_zda(struct nmea_sentence_zda *frame, const char *sentence);
 
+/*
+ * То же с разбором только групп полей mask (NMEA_FIELD_*). Поля вне mask
+ * пропускаются без преобразования чисел и не проверяются
+ */
+bool nmea_parse_rmc_fields(struct nmea_sentence_rmc *frame, const char *sentence, unsigned mask);
+bool nmea_parse_gga_fields(struct nmea_sentence_gga *frame, const char *sentence, unsigned mask);
+bool nmea_parse_gsa_fields(struct nmea_sentence_gsa *frame, const char *sentence, unsigned mask);
+bool nmea_parse_gll_fields(struct nmea_sentence_gll *frame, const char *sentence, unsigned mask);
+bool nmea_parse_gst_fields(struct nmea_sentence_gst *frame, const char *sentence, unsigned mask);
+bool nmea_parse_gsv_fields(struct nmea_sentence_gsv *frame, const char *sentence, unsigned mask);
+bool nmea_parse_vtg_fields(struct nmea_sentence_vtg *frame, const char *sentence, unsigned mask);
+bool nmea_parse_zda_fields(struct nmea_sentence_zda *frame, const char *sentence, unsigned mask);
+
+/**
+ * Проверка, определение типа и парсинг за один проход.
+ * Заполняет frame->id, frame->talker и соответствующую структуру frame->data.
+ * Возвращает тип предложения, NMEA_UNKNOWN для неизвестного типа,
+ * NMEA_INVALID при ошибке контрольной суммы или данных
+ */
+enum nmea_sentence_id nmea_parse_any(struct nmea_sentence *frame, const char *sentence, bool strict);
+
+/**
+ * nmea_parse_any() с разбором только групп полей mask (NMEA_FIELD_*)
+ */
+enum nmea_sentence_id nmea_parse_fields(struct nmea_sentence *frame, const char *sentence, bool strict, unsigned mask);
+
+/**
+ * То же, что nmea_parse_any(), для строки в буфере: предложение завершается
+ * '\0' или концом строки, в *next записывается начало следующей строки
+ */
+enum nmea_sentence_id nmea_parse_line(struct nmea_sentence *frame, const char *sentence, bool strict, const char **next);
+
+/**
+ * nmea_parse_any() для предложения длиной len без копирования строки
+ */
+enum nmea_sentence_id nmea_parse_any_n(struct nmea_sentence *frame, const char *data, size_t len, bool strict);
+
 /**
  * Конвертер GPS UTC даты/времени в UNIX timestamp.
+ * Без libc: полночь последней даты кэшируется в потоке.
+ * Двузначный год: < 80 - 20xx, иначе 19xx. Возвращает 0, -1 при ошибке
  */
 int nmea_gettime(struct timespec *ts, const struct nmea_date *date, const struct nmea_time *time_);
 
+/**
+ * То же в заданной шкале времени (по таблице високосных секунд)
+ */
+int nmea_gettime_scale(struct timespec *ts, const struct nmea_date *date, const struct nmea_time *time_,
+                       enum nmea_timescale scale);
+
+/**
+ * TAI - UTC в секундах на момент utc (секунды UNIX), 0 до 1972 года
+ */
+int nmea_leap_seconds(int64_t utc);
+
+/**
+ * Количество дней от 1970-01-01 до даты пролептического григорианского
+ * календаря (month 1..12). Только целочисленная арифметика
+ */
+static inline int64_t nmea_days_from_civil(int64_t year, int month, int day)
+{
+	year -= month <= 2;
+	int64_t era = (year >= 0 ? year : year - 399) / 400;
+	int64_t yoe = year - era * 400;
+	int64_t doy = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1;
+	int64_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+	return era * 146097 + doe - 719468;
+}
+
 /**
  * Меняет размер значения
  */
-static inline int_least32_t nmea_rescale(struct nmea_float *f, int_least32_t new_scale)
+static inline int_least64_t nmea_rescale(struct nmea_float *f, int_least64_t new_scale)
 {
 	if (f->scale == 0)
 		return 0;
@@ -254,35 +437,17 @@ static inline float nmea_tofloat(struct nmea_float *f)
 }
 
 /**
- * Конвертер чисел с фиксированной точкой в числа с плавающей
- * Возвращает NaN для "непонятных" значений.
+ * Число с фиксированной точкой в строку "[-]ddd[.ddd]" без '\0'
+ * (пусто для отсутствующего значения). Возвращает длину
+ */
+size_t nmea_write_float(char *buf, const struct nmea_float *f);
+
+/**
+ * Число с фиксированной точкой в строку с '\0'
  */
 static inline void nmea_ftoa(struct nmea_float *f, char* buff)
 {
-	uint8_t r = 0;
-	uint32_t scale = f->scale;
-	if( scale > 0 ){
-		while( scale > 10 ){
-			scale /= 10;
-			r++;
-		}
-		r++;
-	}
-
-	itoa( f->value, buff, 10 );
-
-	if( r ){
-		uint8_t len = strlen( buff );
-		for( uint8_t i = len; i > 0; i-- ){
-			buff[ i + 1 ] = buff[ i ];
-			if( r > 0 ){
-				r--;
-			}else{
-				buff[ i ] = '.';
-				break;
-			}
-		}
-	}
+	buff[nmea_write_float(buff, f)] = '\0';
 }
 
 /**
@@ -293,8 +458,8 @@ static inline float nmea_tocoord(const struct nmea_float *f)
 {
 	if (f->scale == 0)
 		return NAN;
-	int_least32_t degrees = f->value / (f->scale * 100);
-	int_least32_t minutes = f->value % (f->scale * 100);
+	int_least64_t degrees = f->value / (f->scale * 100);
+	int_least64_t minutes = f->value % (f->scale * 100);
 	return (float) degrees + (float) minutes / (60 * f->scale);
 }
 
@@ -0,0 +1,230 @@
+#include "nmea_batch.h"
+#include "nmea_number.h"
+
+
+
+//------------------- DEFINES -----------------------------
+#define NMEA_BATCH_LATITUDE			900000000LL		// 90 градусов в 1e-7
+#define NMEA_BATCH_LONGITUDE		1800000000LL	// 180 градусов
+
+
+//------------------- FUNCTIONS ------------------------
+static inline bool nmea_batch_end(char c)
+{
+    return c == ',' || c == '*' || (unsigned char) c < 0x20 || (unsigned char) c > 0x7e;
+}
+
+// Десятичное число сразу в фиксированную точку с decimals знаками,
+// лишние знаки отбрасываются. Пустое поле - *present = false
+static bool nmea_batch_decimal(const char *field, int decimals, int64_t *value, bool *present)
+{
+    *present = false;
+    if (!field || nmea_batch_end(*field))
+        return true;
+
+    field = nmea_number_fixed(field, decimals, value);
+    if (!field || !nmea_batch_end(*field))
+        return false;
+
+    *present = true;
+    return true;
+}
+
+// ччммсс[.sss] -> мс от начала суток
+static bool nmea_batch_time(const char *field, int32_t *value)
+{
+    struct nmea_time t;
+
+    *value = NMEA_BATCH_NONE;
+    if (!field || nmea_batch_end(*field))
+        return true;
+
+    field = nmea_number_time(field, &t);
+    if (!field || !nmea_batch_end(*field))
+        return false;
+
+    *value = ((t.hours * 60 + t.minutes) * 60 + t.seconds) * 1000 + t.microseconds / 1000;
+    return true;
+}
+
+// ddmm.mmmm + N/S/E/W -> 1e-7 градуса, не больше max
+static bool nmea_batch_coord(const char *field, const char *direction, int64_t max, int32_t *value)
+{
+    int64_t coord;
+
+    *value = NMEA_BATCH_NONE;
+    if (!field || nmea_batch_end(*field))
+        return true;
+
+    field = nmea_number_coord(field, 7, &coord);
+    if (!field || !nmea_batch_end(*field) || coord > max)
+        return false;
+    if (coord < 0 || !direction || nmea_batch_end(*direction))
+        return true;
+
+    switch (*direction) {
+        case 'N':
+        case 'E':
+            break;
+        case 'S':
+        case 'W':
+            coord = -coord;
+            break;
+        default:
+            return false;
+    }
+
+    *value = (int32_t) coord;
+    return true;
+}
+
+#define nmea_batch_field(f, count, n) ((n) < (count) ? (f)[(n)] : NULL)
+
+static bool nmea_batch_row(struct nmea_batch *batch, enum nmea_sentence_id id, const char **f, int count)
+{
+    size_t row = batch->count;
+    int32_t time = NMEA_BATCH_NONE;
+    int32_t latitude = NMEA_BATCH_NONE;
+    int32_t longitude = NMEA_BATCH_NONE;
+    int32_t altitude = NMEA_BATCH_NONE;
+    int64_t hdop = -1, satellites = -1, quality = 0, value;
+    bool valid = false, present;
+
+#define F(n) nmea_batch_field(f, count, n)
+    // Минимум полей - как у декодеров nmea.c
+    switch (id) {
+        case NMEA_SENTENCE_RMC:
+            // $GPRMC,081836,A,3751.65,S,14507.36,E,...
+            if (count < 12)
+                return false;
+            if ((batch->time && !nmea_batch_time(F(1), &time)) ||
+                (batch->latitude && !nmea_batch_coord(F(3), F(4), NMEA_BATCH_LATITUDE, &latitude)) ||
+                (batch->longitude && !nmea_batch_coord(F(5), F(6), NMEA_BATCH_LONGITUDE, &longitude)))
+                return false;
+            valid = F(2) && *F(2) == 'A';
+            break;
+        case NMEA_SENTENCE_GGA:
+            // $GPGGA,123519,4807.038,N,01131.000,E,1,08,0.9,545.4,M,...
+            if (count < 15)
+                return false;
+            if ((batch->time && !nmea_batch_time(F(1), &time)) ||
+                (batch->latitude && !nmea_batch_coord(F(2), F(3), NMEA_BATCH_LATITUDE, &latitude)) ||
+                (batch->longitude && !nmea_batch_coord(F(4), F(5), NMEA_BATCH_LONGITUDE, &longitude)) ||
+                !nmea_batch_decimal(F(6), 0, &quality, &present))
+                return false;
+            valid = quality > 0;
+            if (batch->satellites && !nmea_batch_decimal(F(7), 0, &satellites, &present))
+                return false;
+            if (batch->hdop && !nmea_batch_decimal(F(8), 2, &hdop, &present))
+                return false;
+            if (batch->altitude) {
+                if (!nmea_batch_decimal(F(9), 3, &value, &present))
+                    return false;
+                // Вне колонки int32_t в мм - нет значения
+                if (present && value > INT32_MIN && value <= INT32_MAX)
+                    altitude = (int32_t) value;
+            }
+            break;
+        case NMEA_SENTENCE_GLL:
+            // $GPGLL,3723.2475,N,12158.3416,W,161229.487,A,A
+            if (count < 7)
+                return false;
+            if ((batch->latitude && !nmea_batch_coord(F(1), F(2), NMEA_BATCH_LATITUDE, &latitude)) ||
+                (batch->longitude && !nmea_batch_coord(F(3), F(4), NMEA_BATCH_LONGITUDE, &longitude)) ||
+                (batch->time && !nmea_batch_time(F(5), &time)))
+                return false;
+            valid = F(6) && *F(6) == 'A';
+            break;
+        case NMEA_SENTENCE_GST:
+        case NMEA_SENTENCE_ZDA:
+            if (count < (id == NMEA_SENTENCE_GST ? 9 : 7))
+                return false;
+            if (batch->time && !nmea_batch_time(F(1), &time))
+                return false;
+            valid = time != NMEA_BATCH_NONE;
+            break;
+        default:
+            break;
+    }
+#undef F
+
+    if (batch->type)
+        batch->type[row] = (int8_t) id;
+    if (batch->valid) {
+        if (valid)
+            batch->valid[row >> 3] |= (uint8_t) (1u << (row & 7));
+        else
+            batch->valid[row >> 3] &= (uint8_t) ~(1u << (row & 7));
+    }
+    if (batch->time)
+        batch->time[row] = time;
+    if (batch->latitude)
+        batch->latitude[row] = latitude;
+    if (batch->longitude)
+        batch->longitude[row] = longitude;
+    if (batch->altitude)
+        batch->altitude[row] = altitude;
+    if (batch->hdop)
+        batch->hdop[row] = (hdop < 0 || hdop > INT16_MAX) ? -1 : (int16_t) hdop;
+    if (batch->satellites)
+        batch->satellites[row] = (satellites < 0 || satellites > INT8_MAX) ? -1 : (int8_t) satellites;
+
+    batch->count++;
+    return true;
+}
+
+// Разбор одного предложения. Возвращает начало следующей строки, NULL при ошибке
+static const char *nmea_batch_sentence(struct nmea_batch *batch, const char *sentence)
+{
+    const char *fields[NMEA_MAX_FIELDS];
+    const char *next;
+
+    int count = nmea_split(sentence, fields, batch->strict, &next);
+    if (!count)
+        return NULL;
+
+    enum nmea_sentence_id id = nmea_sentence_type(sentence);
+    if (id == NMEA_INVALID)
+        return NULL;
+    // Зарегистрированные типы пишутся как NMEA_UNKNOWN
+    if (id >= NMEA_SENTENCE_USER)
+        id = NMEA_UNKNOWN;
+    if (batch->types && !(batch->types & NMEA_BATCH_TYPE(id)))
+        return next;
+
+    return nmea_batch_row(batch, id, fields, count) ? next : NULL;
+}
+
+size_t nmea_parse_batch(struct nmea_batch *batch, const char *buf, size_t len)
+{
+    const char *p = buf;
+    const char *last = buf + len;
+
+    while (p < last && batch->count < batch->capacity) {
+        const char *eol = memchr(p, '\n', (size_t) (last - p));
+        if (!eol)
+            break;
+
+        // Пустые строки пропускаются без учета
+        if (*p != '\r' && *p != '\n') {
+            const char *next = nmea_batch_sentence(batch, p);
+            if (next != eol + 1)
+                batch->rejected++;
+        }
+        p = eol + 1;
+    }
+
+    return (size_t) (p - buf);
+}
+
+size_t nmea_parse_batch_spans(struct nmea_batch *batch, const struct nmea_span *spans, size_t n)
+{
+    size_t i;
+
+    for (i = 0; i < n && batch->count < batch->capacity; i++) {
+        if (!nmea_batch_sentence(batch, spans[i].data))
+            batch->rejected++;
+    }
+
+    return i;
+}
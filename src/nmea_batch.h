@@ -0,0 +1,70 @@
+#ifndef NMEA_BATCH_H
+#define NMEA_BATCH_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+//------------------- DEFINES -----------------------------
+#include "nmea.h"
+
+#define NMEA_BATCH_NONE				INT32_MIN	// нет значения в колонке int32_t
+#define NMEA_BATCH_TYPE(id)			(1u << (id))	// маска для nmea_batch.types
+
+
+//------------------- VARIABLES ---------------------------
+/**
+ * Колонки (struct-of-arrays) для пакетного разбора.
+ * Все колонки выделяются вызывающим на capacity строк, любая колонка
+ * может быть NULL - тогда соответствующее поле не декодируется.
+ * Строка добавляется для каждого корректного предложения из types,
+ * значения без соответствующего поля в предложении - NMEA_BATCH_NONE / -1.
+ */
+struct nmea_batch {
+	size_t capacity;		// строк в колонках
+	size_t count;			// заполнено строк
+	uint32_t types;			// маска NMEA_BATCH_TYPE(...), 0 - все типы
+	bool strict;			// контрольная сумма обязательна
+	unsigned long rejected;		// отброшено (контрольная сумма, формат)
+
+	int8_t *type;			// enum nmea_sentence_id
+	uint8_t *valid;			// бит i - строка i содержит валидное решение (A / fix > 0)
+	int32_t *time;			// мс от начала суток UTC
+	int32_t *latitude;		// 1e-7 градуса
+	int32_t *longitude;		// 1e-7 градуса
+	int32_t *altitude;		// мм
+	int16_t *hdop;			// x100, -1 если нет
+	int8_t *satellites;		// -1 если нет
+};
+
+//------------------- FUNCTIONS ---------------------------
+/**
+ * Сброс счетчиков (колонки и capacity не меняются)
+ */
+static inline void nmea_batch_reset(struct nmea_batch *batch)
+{
+	batch->count = 0;
+	batch->rejected = 0;
+}
+
+/**
+ * Разбор буфера строк, каждая завершается '\n'.
+ * Возвращает количество обработанных байт: разбор останавливается на
+ * неполной последней строке или при заполнении колонок
+ */
+size_t nmea_parse_batch(struct nmea_batch *batch, const char *buf, size_t len);
+
+/**
+ * Разбор массива предложений. Каждое должно завершаться '\0' или концом
+ * строки (как выдает nmea_stream_next()).
+ * Возвращает количество обработанных предложений
+ */
+size_t nmea_parse_batch_spans(struct nmea_batch *batch, const struct nmea_span *spans, size_t n);
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif /* NMEA_BATCH_H */
@@ -0,0 +1,239 @@
+#include "nmea_coord.h"
+
+
+
+//------------------- DEFINES -----------------------------
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define NMEA_COORD_X86
+#include <immintrin.h>
+
+#define NMEA_COORD_KERNEL(isa)		__attribute__((target(isa)))
+#endif
+
+// Целые меньше 2^52 переводятся в double и обратно без потерь
+#define NMEA_COORD_EXACT		((int_least64_t) 1 << 52)
+
+
+//------------------- VARIABLES ------------------------
+/**
+ * Обратные величины для одного scale, пересчитываются при его смене
+ */
+struct nmea_coord_scale {
+	int_least64_t scale;
+	bool exact;			// value и scale * 100 точны в double
+	double div;			// scale * 100: градус в единицах value
+	double inv_div;		// 1 / div
+	double inv_minutes;	// 1 / (60 * scale)
+	double e7_minutes;	// 1e7 / (60 * scale)
+};
+
+typedef void (*nmea_coord_fn)(double *deg, int32_t *e7, const struct nmea_float *in, size_t count);
+
+static void nmea_coord_resolve(double *deg, int32_t *e7, const struct nmea_float *in, size_t count);
+
+static nmea_coord_fn nmea_coord_impl = nmea_coord_resolve;
+static const char *nmea_coord_name = "scalar";
+
+
+//------------------- FUNCTIONS ------------------------
+static void nmea_coord_prepare(struct nmea_coord_scale *s, int_least64_t scale)
+{
+    s->scale = scale;
+    s->exact = scale < NMEA_COORD_EXACT / 100;
+    s->div = (double) scale * 100.0;
+    s->inv_div = 1.0 / s->div;
+    s->inv_minutes = 1.0 / (60.0 * (double) scale);
+    s->e7_minutes = 1e7 / (60.0 * (double) scale);
+}
+
+// |value| на целые градусы и остаток (минуты * scale). false - пустое значение
+static inline bool nmea_coord_split(const struct nmea_float *f, struct nmea_coord_scale *s,
+                                    double *deg, double *rem)
+{
+    uint_least64_t mag;
+
+    if (f->scale <= 0)
+        return false;
+    if (f->scale != s->scale)
+        nmea_coord_prepare(s, f->scale);
+
+    // Без ветвления: знаки N/S и E/W в потоке не предсказываются
+    uint_least64_t neg = 0 - (uint_least64_t) (f->value < 0);
+    mag = ((uint_least64_t) f->value ^ neg) - neg;
+    if (!s->exact || mag >= (uint_least64_t) NMEA_COORD_EXACT) {
+        // Вне точного диапазона double: обычное деление
+        uint_least64_t div = (uint_least64_t) f->scale * 100;
+        if (f->scale > INT_LEAST64_MAX / 100)
+            div = UINT_LEAST64_MAX;
+        *deg = (double) (mag / div);
+        *rem = (double) (mag % div);
+        return true;
+    }
+
+    // Частное через обратную величину, ошибка округления - не больше единицы
+    double x = (double) mag;
+    double q = (double) (int_least64_t) (x * s->inv_div);
+    double r = x - q * s->div;
+    if (r < 0) {
+        q -= 1;
+        r += s->div;
+    } else if (r >= s->div) {
+        q += 1;
+        r -= s->div;
+    }
+    *deg = q;
+    *rem = r;
+    return true;
+}
+
+static inline void nmea_coord_one(double *deg, int32_t *e7, const struct nmea_float *f,
+                                  struct nmea_coord_scale *s)
+{
+    double q, r;
+
+    if (!nmea_coord_split(f, s, &q, &r)) {
+        if (deg)
+            *deg = NAN;
+        else
+            *e7 = NMEA_COORD_NONE;
+        return;
+    }
+
+    static const double signs[2] = {1.0, -1.0};
+    double sign = signs[f->value < 0];
+    if (deg) {
+        *deg = (q + r * s->inv_minutes) * sign;
+    } else {
+        double v = q * 1e7 + (double) (int_least64_t) (r * s->e7_minutes + 0.5);
+        *e7 = v > (double) INT32_MAX ? NMEA_COORD_NONE : (int32_t) (v * sign);
+    }
+}
+
+static void nmea_coord_scalar(double *deg, int32_t *e7, const struct nmea_float *in, size_t count)
+{
+    struct nmea_coord_scale s = {0};
+
+    if (deg) {
+        for (size_t i = 0; i < count; i++)
+            nmea_coord_one(deg + i, NULL, &in[i], &s);
+    } else {
+        for (size_t i = 0; i < count; i++)
+            nmea_coord_one(NULL, e7 + i, &in[i], &s);
+    }
+}
+
+#ifdef NMEA_COORD_X86
+// Блок из 4 значений с одинаковым scale; блок с другим scale, пустым или
+// слишком большим значением - поэлементно, с пересчетом обратных величин.
+// Порядок в регистрах после распаковки пар {value, scale}: 0 2 1 3
+NMEA_COORD_KERNEL("avx2")
+static void nmea_coord_avx2(double *deg, int32_t *e7, const struct nmea_float *in, size_t count)
+{
+    struct nmea_coord_scale s = {0};
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i high = _mm256_set1_epi64x(~(NMEA_COORD_EXACT - 1));
+    const __m256i magic = _mm256_set1_epi64x(0x4330000000000000);	// 2^52
+    const __m256d two52 = _mm256_set1_pd(4503599627370496.0);
+    const __m256d one = _mm256_set1_pd(1.0);
+    const __m256d half = _mm256_set1_pd(0.5);
+    const __m256d e7_deg = _mm256_set1_pd(1e7);
+    const __m256d sign = _mm256_set1_pd(-0.0);
+    size_t i = 0;
+
+    while (i + 4 <= count) {
+        __m256i a = _mm256_loadu_si256((const __m256i *) &in[i]);
+        __m256i b = _mm256_loadu_si256((const __m256i *) &in[i + 2]);
+        __m256i value = _mm256_unpacklo_epi64(a, b);
+        __m256i scale = _mm256_unpackhi_epi64(a, b);
+
+        if (!s.exact || _mm256_movemask_epi8(_mm256_cmpeq_epi64(scale, _mm256_set1_epi64x(s.scale))) != -1) {
+            nmea_coord_one(deg ? deg + i : NULL, e7 ? e7 + i : NULL, &in[i], &s);
+            i++;
+            continue;
+        }
+
+        __m256i neg = _mm256_cmpgt_epi64(zero, value);
+        __m256i mag = _mm256_sub_epi64(_mm256_xor_si256(value, neg), neg);
+        if (!_mm256_testz_si256(mag, high)) {
+            for (int k = 0; k < 4; k++, i++)
+                nmea_coord_one(deg ? deg + i : NULL, e7 ? e7 + i : NULL, &in[i], &s);
+            continue;
+        }
+
+        __m256d div = _mm256_set1_pd(s.div);
+        __m256d zero_pd = _mm256_setzero_pd();
+        __m256d x = _mm256_sub_pd(_mm256_castsi256_pd(_mm256_or_si256(mag, magic)), two52);
+        __m256d q = _mm256_round_pd(_mm256_mul_pd(x, _mm256_set1_pd(s.inv_div)),
+                                    _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC);
+        __m256d r = _mm256_sub_pd(x, _mm256_mul_pd(q, div));
+        __m256d low = _mm256_cmp_pd(r, zero_pd, _CMP_LT_OQ);
+        q = _mm256_sub_pd(q, _mm256_and_pd(low, one));
+        r = _mm256_add_pd(r, _mm256_and_pd(low, div));
+        __m256d over = _mm256_cmp_pd(r, div, _CMP_GE_OQ);
+        q = _mm256_add_pd(q, _mm256_and_pd(over, one));
+        r = _mm256_sub_pd(r, _mm256_and_pd(over, div));
+
+        __m256d minus = _mm256_and_pd(_mm256_castsi256_pd(neg), sign);
+        __m256d v;
+        if (deg) {
+            v = _mm256_add_pd(q, _mm256_mul_pd(r, _mm256_set1_pd(s.inv_minutes)));
+            v = _mm256_permute4x64_pd(_mm256_xor_pd(v, minus), _MM_SHUFFLE(3, 1, 2, 0));
+            _mm256_storeu_pd(deg + i, v);
+        } else {
+            __m256d m = _mm256_round_pd(_mm256_add_pd(_mm256_mul_pd(r, _mm256_set1_pd(s.e7_minutes)), half),
+                                        _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC);
+            v = _mm256_add_pd(_mm256_mul_pd(q, e7_deg), m);
+            v = _mm256_permute4x64_pd(_mm256_xor_pd(v, minus), _MM_SHUFFLE(3, 1, 2, 0));
+            // Вне int32 cvtpd дает 0x80000000 = NMEA_COORD_NONE
+            _mm_storeu_si128((__m128i *) (e7 + i), _mm256_cvtpd_epi32(v));
+        }
+        i += 4;
+    }
+
+    for (; i < count; i++)
+        nmea_coord_one(deg ? deg + i : NULL, e7 ? e7 + i : NULL, &in[i], &s);
+}
+#endif
+
+// Выбор реализации, NMEA_KERNEL=scalar отключает AVX2 (sse2 - тоже скалярная)
+static void nmea_coord_select(void)
+{
+    nmea_coord_fn impl = nmea_coord_scalar;
+    const char *name = "scalar";
+
+#ifdef NMEA_COORD_X86
+    const char *force = getenv("NMEA_KERNEL");
+
+    __builtin_cpu_init();
+    if (sizeof(struct nmea_float) == 16 && __builtin_cpu_supports("avx2") && (!force || !strcmp(force, "avx2"))) {
+        impl = nmea_coord_avx2;
+        name = "avx2";
+    }
+#endif
+
+    nmea_atomic_store(&nmea_coord_name, name);
+    nmea_atomic_store(&nmea_coord_impl, impl);
+}
+
+static void nmea_coord_resolve(double *deg, int32_t *e7, const struct nmea_float *in, size_t count)
+{
+    nmea_coord_select();
+    nmea_atomic_load(&nmea_coord_impl)(deg, e7, in, count);
+}
+
+void nmea_coord_degrees(double *out, const struct nmea_float *in, size_t count)
+{
+    nmea_atomic_load(&nmea_coord_impl)(out, NULL, in, count);
+}
+
+void nmea_coord_e7(int32_t *out, const struct nmea_float *in, size_t count)
+{
+    nmea_atomic_load(&nmea_coord_impl)(NULL, out, in, count);
+}
+
+const char *nmea_coord_kernel(void)
+{
+    if (nmea_atomic_load(&nmea_coord_impl) == nmea_coord_resolve)
+        nmea_coord_select();
+    return nmea_atomic_load(&nmea_coord_name);
+}
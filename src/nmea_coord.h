@@ -0,0 +1,40 @@
+#ifndef NMEA_COORD_H
+#define NMEA_COORD_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+//------------------- DEFINES -----------------------------
+#include "nmea.h"
+
+#define NMEA_COORD_NONE				INT32_MIN	// пустое значение или вне диапазона int32
+
+
+//------------------- FUNCTIONS ---------------------------
+/**
+ * Сырые координаты NMEA ddmm.mmmm (value / scale) в градусы double.
+ * Пустые значения (scale = 0) - NaN. Без деления на элемент: обратные
+ * величины масштаба вычисляются один раз на серию одинаковых scale,
+ * блоки по 4 - AVX2 (если доступен). in и out не должны перекрываться
+ */
+void nmea_coord_degrees(double *out, const struct nmea_float *in, size_t count);
+
+/**
+ * То же в целых 1e-7 градуса с округлением к ближайшему.
+ * Пустые значения - NMEA_COORD_NONE
+ */
+void nmea_coord_e7(int32_t *out, const struct nmea_float *in, size_t count);
+
+/**
+ * Название выбранной реализации: "avx2" или "scalar" (NMEA_KERNEL как у nmea_layout)
+ */
+const char *nmea_coord_kernel(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif /* NMEA_COORD_H */
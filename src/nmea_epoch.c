@@ -0,0 +1,292 @@
+#include "nmea_epoch.h"
+
+
+
+//------------------- DEFINES -----------------------------
+#define NMEA_EPOCH_DAY				86400000
+#define NMEA_EPOCH_QUEUE_MASK		(NMEA_EPOCH_QUEUE - 1)
+
+
+//------------------- FUNCTIONS ------------------------
+// Разность моментов суток a - b с учетом перехода через полночь
+static inline int32_t nmea_epoch_diff(int32_t a, int32_t b)
+{
+    int32_t diff = a - b;
+
+    if (diff >= NMEA_EPOCH_DAY / 2)
+        diff -= NMEA_EPOCH_DAY;
+    else if (diff < -NMEA_EPOCH_DAY / 2)
+        diff += NMEA_EPOCH_DAY;
+    return diff;
+}
+
+static inline int32_t nmea_epoch_key(const struct nmea_time *time_)
+{
+    if (time_->hours < 0)
+        return -1;
+    return ((time_->hours * 60 + time_->minutes) * 60 + time_->seconds) * 1000 + time_->microseconds / 1000;
+}
+
+// Время предложения, NULL для GSA/GSV
+static const struct nmea_time *nmea_epoch_time(const struct nmea_sentence *frame)
+{
+    switch (frame->id) {
+        case NMEA_SENTENCE_RMC: return &frame->data.rmc.time;
+        case NMEA_SENTENCE_GGA: return &frame->data.gga.time;
+        case NMEA_SENTENCE_GLL: return &frame->data.gll.time;
+        case NMEA_SENTENCE_GST: return &frame->data.gst.time;
+        case NMEA_SENTENCE_ZDA: return &frame->data.zda.time;
+        default: return NULL;
+    }
+}
+
+void nmea_epoch_init(struct nmea_epoch *epoch, uint32_t required, uint32_t timeout)
+{
+    memset(epoch, 0, sizeof(*epoch));
+    epoch->required = required ? required
+                               : NMEA_EPOCH_TYPE(NMEA_SENTENCE_RMC) | NMEA_EPOCH_TYPE(NMEA_SENTENCE_GGA);
+    epoch->timeout = timeout ? timeout : NMEA_EPOCH_TIMEOUT;
+    epoch->recent = -1;
+    epoch->last_key = -1;
+    epoch->date.day = epoch->date.month = epoch->date.year = -1;
+}
+
+static void nmea_epoch_enqueue(struct nmea_epoch *epoch, struct nmea_epoch_slot *slot, bool complete)
+{
+    size_t head = epoch->head;
+
+    slot->fix.complete = complete;
+    epoch->emitted++;
+    if (!complete)
+        epoch->timeouts++;
+
+    if (head - nmea_atomic_load(&epoch->tail) >= NMEA_EPOCH_QUEUE) {
+        epoch->overflow++;
+    } else {
+        epoch->queue[head & NMEA_EPOCH_QUEUE_MASK] = slot->fix;
+        nmea_atomic_store(&epoch->head, head + 1);
+    }
+
+    epoch->last_key = slot->key;
+    slot->used = false;
+    if (epoch->recent == slot - epoch->pending)
+        epoch->recent = -1;
+}
+
+// Выдает эпоху slot, перед ней - все более старые незавершенные
+static void nmea_epoch_emit(struct nmea_epoch *epoch, struct nmea_epoch_slot *slot, bool complete)
+{
+    for (;;) {
+        struct nmea_epoch_slot *oldest = NULL;
+
+        for (int i = 0; i < NMEA_EPOCH_PENDING; i++) {
+            struct nmea_epoch_slot *s = &epoch->pending[i];
+            if (s->used && s != slot && nmea_epoch_diff(s->key, slot->key) < 0 &&
+                (!oldest || nmea_epoch_diff(s->key, oldest->key) < 0))
+                oldest = s;
+        }
+        if (!oldest)
+            break;
+        nmea_epoch_enqueue(epoch, oldest, false);
+    }
+
+    nmea_epoch_enqueue(epoch, slot, complete);
+}
+
+static struct nmea_epoch_slot *nmea_epoch_slot(struct nmea_epoch *epoch, int32_t key, uint64_t now)
+{
+    struct nmea_epoch_slot *slot = NULL;
+
+    for (int i = 0; i < NMEA_EPOCH_PENDING; i++) {
+        struct nmea_epoch_slot *s = &epoch->pending[i];
+        if (s->used && s->key == key)
+            return s;
+        if (!s->used && !slot)
+            slot = s;
+    }
+
+    // Нет свободного слота - самая старая эпоха выдается неполной
+    if (!slot) {
+        for (int i = 0; i < NMEA_EPOCH_PENDING; i++)
+            if (!slot || nmea_epoch_diff(epoch->pending[i].key, slot->key) < 0)
+                slot = &epoch->pending[i];
+        // Новая эпоха старше всех собираемых - порядок выдачи не сохранить
+        if (nmea_epoch_diff(key, slot->key) < 0)
+            return NULL;
+        nmea_epoch_emit(epoch, slot, false);
+    }
+
+    struct nmea_fix *fix = &slot->fix;
+    memset(fix, 0, sizeof(*fix));
+    fix->date = epoch->date;
+    fix->time.hours = fix->time.minutes = fix->time.seconds = fix->time.microseconds = -1;
+    fix->fix_quality = fix->satellites_tracked = fix->fix_type = fix->sats_in_view = -1;
+    slot->used = true;
+    slot->key = key;
+    slot->first = now;
+    return slot;
+}
+
+static void nmea_epoch_position(struct nmea_fix *fix, const struct nmea_float *latitude,
+                                const struct nmea_float *longitude, bool primary)
+{
+    // Координаты GGA приоритетнее RMC/GLL
+    if (primary || !(fix->types & NMEA_EPOCH_TYPE(NMEA_SENTENCE_GGA))) {
+        fix->latitude = *latitude;
+        fix->longitude = *longitude;
+    }
+}
+
+static void nmea_epoch_merge(struct nmea_epoch *epoch, struct nmea_fix *fix, const struct nmea_sentence *frame)
+{
+    const struct nmea_time *time_ = nmea_epoch_time(frame);
+
+    if (time_ && time_->hours >= 0)
+        fix->time = *time_;
+
+    switch (frame->id) {
+        case NMEA_SENTENCE_RMC: {
+            const struct nmea_sentence_rmc *rmc = &frame->data.rmc;
+            nmea_epoch_position(fix, &rmc->latitude, &rmc->longitude, false);
+            fix->valid = rmc->valid;
+            fix->speed = rmc->speed;
+            fix->course = rmc->course;
+            fix->variation = rmc->variation;
+            if (rmc->date.year >= 0)
+                fix->date = epoch->date = rmc->date;
+            break;
+        }
+        case NMEA_SENTENCE_GGA: {
+            const struct nmea_sentence_gga *gga = &frame->data.gga;
+            nmea_epoch_position(fix, &gga->latitude, &gga->longitude, true);
+            if (!(fix->types & (NMEA_EPOCH_TYPE(NMEA_SENTENCE_RMC) | NMEA_EPOCH_TYPE(NMEA_SENTENCE_GLL))))
+                fix->valid = gga->fix_quality > 0;
+            fix->fix_quality = gga->fix_quality;
+            fix->satellites_tracked = gga->satellites_tracked;
+            fix->hdop = gga->hdop;
+            fix->altitude = gga->altitude;
+            fix->height = gga->height;
+            fix->dgps_age = gga->dgps_age;
+            break;
+        }
+        case NMEA_SENTENCE_GLL: {
+            const struct nmea_sentence_gll *gll = &frame->data.gll;
+            nmea_epoch_position(fix, &gll->latitude, &gll->longitude, false);
+            if (!(fix->types & NMEA_EPOCH_TYPE(NMEA_SENTENCE_RMC)))
+                fix->valid = gll->status == NMEA_GLL_STATUS_DATA_VALID;
+            break;
+        }
+        case NMEA_SENTENCE_GSA: {
+            const struct nmea_sentence_gsa *gsa = &frame->data.gsa;
+            int n = 0;
+            // Несколько GSA (по системам) - номера спутников дописываются
+            if (fix->types & NMEA_EPOCH_TYPE(NMEA_SENTENCE_GSA))
+                while (n < 12 && fix->sats[n])
+                    n++;
+            for (int i = 0; i < 12 && n < 12; i++)
+                if (gsa->sats[i])
+                    fix->sats[n++] = gsa->sats[i];
+            fix->mode = gsa->mode;
+            fix->fix_type = gsa->fix_type;
+            fix->pdop = gsa->pdop;
+            fix->vdop = gsa->vdop;
+            if (!(fix->types & NMEA_EPOCH_TYPE(NMEA_SENTENCE_GGA)))
+                fix->hdop = gsa->hdop;
+            break;
+        }
+        case NMEA_SENTENCE_GSV: {
+            const struct nmea_sentence_gsv *gsv = &frame->data.gsv;
+            if (gsv->msg_nr == 1)
+                fix->sats_in_view = (fix->sats_in_view < 0 ? 0 : fix->sats_in_view) + gsv->total_sats;
+            // Тип считается принятым по последней части
+            if (gsv->msg_nr != gsv->total_msgs)
+                return;
+            break;
+        }
+        case NMEA_SENTENCE_GST: {
+            const struct nmea_sentence_gst *gst = &frame->data.gst;
+            fix->rms_deviation = gst->rms_deviation;
+            fix->latitude_error_deviation = gst->latitude_error_deviation;
+            fix->longitude_error_deviation = gst->longitude_error_deviation;
+            fix->altitude_error_deviation = gst->altitude_error_deviation;
+            break;
+        }
+        case NMEA_SENTENCE_ZDA:
+            if (frame->data.zda.date.year >= 0)
+                fix->date = epoch->date = frame->data.zda.date;
+            break;
+        default:
+            return;
+    }
+
+    fix->types |= NMEA_EPOCH_TYPE(frame->id);
+}
+
+bool nmea_epoch_push(struct nmea_epoch *epoch, const struct nmea_sentence *frame, uint64_t now)
+{
+    struct nmea_epoch_slot *slot;
+
+    if (frame->id <= NMEA_UNKNOWN || frame->id >= NMEA_SENTENCE_USER)
+        return false;
+
+    nmea_epoch_poll(epoch, now);
+
+    const struct nmea_time *time_ = nmea_epoch_time(frame);
+    int32_t key = time_ ? nmea_epoch_key(time_) : -1;
+
+    if (key >= 0) {
+        if (epoch->last_key >= 0 && nmea_epoch_diff(key, epoch->last_key) <= 0) {
+            epoch->late++;
+            return false;
+        }
+        slot = nmea_epoch_slot(epoch, key, now);
+        if (!slot) {
+            epoch->late++;
+            return false;
+        }
+        epoch->recent = (int) (slot - epoch->pending);
+    } else {
+        // Без времени - к последней эпохе
+        if (epoch->recent < 0) {
+            epoch->late++;
+            return false;
+        }
+        slot = &epoch->pending[epoch->recent];
+    }
+
+    nmea_epoch_merge(epoch, &slot->fix, frame);
+    if ((slot->fix.types & epoch->required) == epoch->required)
+        nmea_epoch_emit(epoch, slot, true);
+
+    return true;
+}
+
+void nmea_epoch_poll(struct nmea_epoch *epoch, uint64_t now)
+{
+    for (int i = 0; i < NMEA_EPOCH_PENDING; i++) {
+        struct nmea_epoch_slot *slot = &epoch->pending[i];
+        if (slot->used && now - slot->first >= epoch->timeout)
+            nmea_epoch_emit(epoch, slot, false);
+    }
+}
+
+void nmea_epoch_flush(struct nmea_epoch *epoch)
+{
+    for (int i = 0; i < NMEA_EPOCH_PENDING; i++) {
+        struct nmea_epoch_slot *slot = &epoch->pending[i];
+        if (slot->used)
+            nmea_epoch_emit(epoch, slot, (slot->fix.types & epoch->required) == epoch->required);
+    }
+}
+
+bool nmea_epoch_pop(struct nmea_epoch *epoch, struct nmea_fix *fix)
+{
+    size_t tail = epoch->tail;
+
+    if (tail == nmea_atomic_load(&epoch->head))
+        return false;
+
+    *fix = epoch->queue[tail & NMEA_EPOCH_QUEUE_MASK];
+    nmea_atomic_store(&epoch->tail, tail + 1);
+    return true;
+}
@@ -0,0 +1,119 @@
+#ifndef NMEA_EPOCH_H
+#define NMEA_EPOCH_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+//------------------- DEFINES -----------------------------
+#include "nmea.h"
+
+#define NMEA_EPOCH_TYPE(id)			(1u << (id))	// маска для required и nmea_fix.types
+#define NMEA_EPOCH_PENDING			4		// эпох в сборке одновременно
+#define NMEA_EPOCH_QUEUE			64		// степень двойки
+#define NMEA_EPOCH_TIMEOUT			1000	// мс по умолчанию
+
+
+//------------------- VARIABLES ---------------------------
+/**
+ * Решение за одну эпоху, собранное из RMC/GGA/GLL/GSA/GSV/GST/ZDA.
+ * Поля типов, не вошедших в types, не заполнены (scale = 0, -1)
+ */
+struct nmea_fix {
+	uint32_t types;			// NMEA_EPOCH_TYPE() принятых предложений
+	bool complete;			// приняты все обязательные типы (иначе - по таймауту)
+	struct nmea_date date;		// из RMC/ZDA эпохи или последняя известная
+	struct nmea_time time;
+	bool valid;			// RMC/GLL статус 'A' или GGA fix_quality > 0
+	struct nmea_float latitude;	// GGA, иначе RMC/GLL
+	struct nmea_float longitude;
+	struct nmea_float speed;	// RMC, узлы
+	struct nmea_float course;	// RMC
+	struct nmea_float variation;	// RMC
+	int fix_quality;		// GGA
+	int satellites_tracked;		// GGA
+	struct nmea_float hdop;		// GGA, иначе GSA
+	struct nmea_float altitude;	// GGA
+	struct nmea_float height;	// GGA
+	struct nmea_float dgps_age;	// GGA
+	char mode;			// GSA
+	int fix_type;			// GSA
+	int sats[12];			// GSA, PRN всех систем до заполнения
+	struct nmea_float pdop;		// GSA
+	struct nmea_float vdop;		// GSA
+	int sats_in_view;		// GSV, сумма по источникам
+	struct nmea_float rms_deviation;		// GST
+	struct nmea_float latitude_error_deviation;	// GST
+	struct nmea_float longitude_error_deviation;	// GST
+	struct nmea_float altitude_error_deviation;	// GST
+};
+
+struct nmea_epoch_slot {
+	bool used;
+	int32_t key;			// мс от начала суток
+	uint64_t first;			// время первого предложения, мс
+	struct nmea_fix fix;
+};
+
+/**
+ * Сборщик эпох одного приемника. Память фиксирована, выделяется вызывающим.
+ * nmea_epoch_push()/nmea_epoch_poll() вызываются в потоке приемника,
+ * nmea_epoch_pop() - в потоке потребителя (очередь SPSC без блокировок).
+ */
+struct nmea_epoch {
+	uint32_t required;		// NMEA_EPOCH_TYPE() для завершения эпохи
+	uint32_t timeout;		// мс от первого предложения эпохи
+	struct nmea_epoch_slot pending[NMEA_EPOCH_PENDING];
+	int recent;			// слот последнего предложения со временем, -1
+	int32_t last_key;		// последняя выданная эпоха, -1
+	struct nmea_date date;		// последняя известная дата
+	unsigned long emitted;		// выдано эпох
+	unsigned long timeouts;		// из них неполных
+	unsigned long late;		// отброшено предложений старше выданной эпохи
+	unsigned long overflow;		// отброшено эпох при заполненной очереди
+
+	size_t head;			// пишет только производитель
+	struct nmea_fix queue[NMEA_EPOCH_QUEUE];
+	size_t tail;			// пишет только потребитель, отделен от head очередью
+};
+
+//------------------- FUNCTIONS ---------------------------
+/**
+ * Инициализация. required - маска NMEA_EPOCH_TYPE(), 0 - RMC и GGA;
+ * timeout - мс, 0 - NMEA_EPOCH_TIMEOUT
+ */
+void nmea_epoch_init(struct nmea_epoch *epoch, uint32_t required, uint32_t timeout);
+
+/**
+ * Добавляет разобранное предложение (nmea_parse_any()). now - монотонное
+ * время в мс. GSA/GSV без времени относятся к последней еще не выданной
+ * эпохе, поэтому для их учета они должны входить в required.
+ * Эпоха выдается в очередь, как только приняты все обязательные типы;
+ * более старые незавершенные эпохи выдаются перед ней.
+ * Возвращает false если предложение отброшено
+ */
+bool nmea_epoch_push(struct nmea_epoch *epoch, const struct nmea_sentence *frame, uint64_t now);
+
+/**
+ * Выдает незавершенные эпохи с истекшим таймаутом
+ */
+void nmea_epoch_poll(struct nmea_epoch *epoch, uint64_t now);
+
+/**
+ * Выдает все эпохи в сборке (конец данных)
+ */
+void nmea_epoch_flush(struct nmea_epoch *epoch);
+
+/**
+ * Следующая эпоха из очереди (поток потребителя).
+ * Возвращает false если очередь пуста
+ */
+bool nmea_epoch_pop(struct nmea_epoch *epoch, struct nmea_fix *fix);
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif /* NMEA_EPOCH_H */
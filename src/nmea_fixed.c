@@ -0,0 +1,282 @@
+#include "nmea_fixed.h"
+#include "nmea_number.h"
+
+
+
+//------------------- FUNCTIONS ------------------------
+static inline bool nmea_fixed_end(char c)
+{
+    return c == ',' || c == '*' || (unsigned char) c < 0x20 || (unsigned char) c > 0x7e;
+}
+
+#define nmea_fixed_field(f, count, n) ((n) < (count) ? (f)[(n)] : NULL)
+
+// Пробелы допустимы только перед числом. NULL - поле пустое
+static inline const char *nmea_fixed_skip(const char *field)
+{
+    if (!field)
+        return NULL;
+    while (*field == ' ')
+        field++;
+    return nmea_fixed_end(*field) ? NULL : field;
+}
+
+// Число сразу в 10^-decimals, пустое - NMEA_FIXED_NONE
+static inline bool nmea_fixed_decimal(const char *field, int decimals, int64_t *value)
+{
+    *value = NMEA_FIXED_NONE;
+    field = nmea_fixed_skip(field);
+    if (!field)
+        return true;
+
+    field = nmea_number_fixed(field, decimals, value);
+    return field && nmea_fixed_end(*field);
+}
+
+// Знак по N/S/E/W. Значение без направления неопределенно - NMEA_FIXED_NONE
+static inline bool nmea_fixed_direction(const char *field, int64_t *value)
+{
+    if (*value == NMEA_FIXED_NONE)
+        return true;
+    if (!field || nmea_fixed_end(*field)) {
+        *value = NMEA_FIXED_NONE;
+        return true;
+    }
+
+    switch (*field) {
+        case 'N':
+        case 'E':
+            return true;
+        case 'S':
+        case 'W':
+            *value = -*value;
+            return true;
+        default:
+            return false;
+    }
+}
+
+// ddmm.mmmm + N/S/E/W -> 10^-decimals градуса
+static inline bool nmea_fixed_coord(const char *field, const char *direction, int decimals, int64_t *value)
+{
+    *value = NMEA_FIXED_NONE;
+    field = nmea_fixed_skip(field);
+    if (field) {
+        field = nmea_number_coord(field, decimals, value);
+        if (!field || !nmea_fixed_end(*field))
+            return false;
+    }
+
+    return nmea_fixed_direction(direction, value);
+}
+
+// value * num / den с округлением к ближайшему. num и den - константы,
+// деление компилятор заменяет умножением
+static inline bool nmea_fixed_ratio(int64_t *value, int64_t num, int64_t den)
+{
+    int64_t v = *value;
+
+    if (v == NMEA_FIXED_NONE)
+        return true;
+    if (v > INT64_MAX / num || v < -(INT64_MAX / num))
+        return false;
+
+    v *= num;
+    *value = (v < 0 ? v - den / 2 : v + den / 2) / den;
+    return true;
+}
+
+// Узлы (1852 / 3600 м/с) и км/ч (1000 / 3600 м/с) в тех же знаках - в м/с
+static inline bool nmea_fixed_knots(const char *field, int decimals, int64_t *value)
+{
+    return nmea_fixed_decimal(field, decimals, value) && nmea_fixed_ratio(value, 463, 900);
+}
+
+static inline bool nmea_fixed_kph(const char *field, int decimals, int64_t *value)
+{
+    return nmea_fixed_decimal(field, decimals, value) && nmea_fixed_ratio(value, 5, 18);
+}
+
+static inline bool nmea_fixed_int(const char *field, int *value)
+{
+    *value = 0;
+    field = nmea_fixed_skip(field);
+    if (!field)
+        return true;
+
+    field = nmea_number_int(field, value);
+    return field && nmea_fixed_end(*field);
+}
+
+static inline bool nmea_fixed_time(const char *field, struct nmea_time *time_)
+{
+    static const struct nmea_time none = {-1, -1, -1, -1};
+
+    *time_ = none;
+    if (!field || nmea_fixed_end(*field))
+        return true;
+    return nmea_number_time(field, time_) != NULL;
+}
+
+static inline bool nmea_fixed_date(const char *field, struct nmea_date *date)
+{
+    static const struct nmea_date none = {-1, -1, -1};
+
+    *date = none;
+    if (!field || nmea_fixed_end(*field))
+        return true;
+    return nmea_number_date(field, date) != NULL;
+}
+
+static inline char nmea_fixed_char(const char *field)
+{
+    return (field && !nmea_fixed_end(*field)) ? *field : '\0';
+}
+
+static bool nmea_fixed_rmc(struct nmea_fixed_rmc *frame, const char **f, int count, const struct nmea_fixed_units *u)
+{
+    // $GPRMC,081836,A,3751.65,S,14507.36,E,000.0,360.0,130998,011.3,E*62
+    if (count < 12)
+        return false;
+
+    frame->valid = nmea_fixed_char(f[2]) == 'A';
+    return nmea_fixed_time(f[1], &frame->time) &&
+           nmea_fixed_coord(f[3], f[4], u->coord, &frame->latitude) &&
+           nmea_fixed_coord(f[5], f[6], u->coord, &frame->longitude) &&
+           nmea_fixed_knots(f[7], u->speed, &frame->speed) &&
+           nmea_fixed_decimal(f[8], u->angle, &frame->course) &&
+           nmea_fixed_date(f[9], &frame->date) &&
+           nmea_fixed_decimal(f[10], u->angle, &frame->variation) &&
+           nmea_fixed_direction(f[11], &frame->variation);
+}
+
+static bool nmea_fixed_gga(struct nmea_fixed_gga *frame, const char **f, int count, const struct nmea_fixed_units *u)
+{
+    // $GPGGA,123519,4807.038,N,01131.000,E,1,08,0.9,545.4,M,46.9,M,,*47
+    if (count < 15)
+        return false;
+
+    return nmea_fixed_time(f[1], &frame->time) &&
+           nmea_fixed_coord(f[2], f[3], u->coord, &frame->latitude) &&
+           nmea_fixed_coord(f[4], f[5], u->coord, &frame->longitude) &&
+           nmea_fixed_int(f[6], &frame->fix_quality) &&
+           nmea_fixed_int(f[7], &frame->satellites_tracked) &&
+           nmea_fixed_decimal(f[8], u->dop, &frame->hdop) &&
+           nmea_fixed_decimal(f[9], u->length, &frame->altitude) &&
+           nmea_fixed_decimal(f[11], u->length, &frame->height) &&
+           nmea_fixed_decimal(f[13], 3, &frame->dgps_age);
+}
+
+static bool nmea_fixed_gsa(struct nmea_fixed_gsa *frame, const char **f, int count, const struct nmea_fixed_units *u)
+{
+    // $GPGSA,A,3,04,05,,09,12,,,24,,,,,2.5,1.3,2.1*39
+    if (count < 18)
+        return false;
+
+    frame->mode = nmea_fixed_char(f[1]);
+    if (!nmea_fixed_int(f[2], &frame->fix_type))
+        return false;
+    for (int i = 0; i < 12; i++)
+        if (!nmea_fixed_int(f[3 + i], &frame->sats[i]))
+            return false;
+    return nmea_fixed_decimal(f[15], u->dop, &frame->pdop) &&
+           nmea_fixed_decimal(f[16], u->dop, &frame->hdop) &&
+           nmea_fixed_decimal(f[17], u->dop, &frame->vdop);
+}
+
+static bool nmea_fixed_gll(struct nmea_fixed_gll *frame, const char **f, int count, const struct nmea_fixed_units *u)
+{
+    // $GPGLL,3723.2475,N,12158.3416,W,161229.487,A,A*41
+    if (count < 7)
+        return false;
+
+    frame->status = nmea_fixed_char(f[6]);
+    frame->mode = nmea_fixed_char(nmea_fixed_field(f, count, 7));
+    return nmea_fixed_coord(f[1], f[2], u->coord, &frame->latitude) &&
+           nmea_fixed_coord(f[3], f[4], u->coord, &frame->longitude) &&
+           nmea_fixed_time(f[5], &frame->time);
+}
+
+static bool nmea_fixed_gst(struct nmea_fixed_gst *frame, const char **f, int count, const struct nmea_fixed_units *u)
+{
+    // $GPGST,024603.00,3.2,6.6,4.7,47.3,5.8,5.6,22.0*58
+    if (count < 9)
+        return false;
+
+    return nmea_fixed_time(f[1], &frame->time) &&
+           nmea_fixed_decimal(f[2], u->length, &frame->rms_deviation) &&
+           nmea_fixed_decimal(f[3], u->length, &frame->semi_major_deviation) &&
+           nmea_fixed_decimal(f[4], u->length, &frame->semi_minor_deviation) &&
+           nmea_fixed_decimal(f[5], u->angle, &frame->semi_major_orientation) &&
+           nmea_fixed_decimal(f[6], u->length, &frame->latitude_error_deviation) &&
+           nmea_fixed_decimal(f[7], u->length, &frame->longitude_error_deviation) &&
+           nmea_fixed_decimal(f[8], u->length, &frame->altitude_error_deviation);
+}
+
+static bool nmea_fixed_vtg(struct nmea_fixed_vtg *frame, const char **f, int count, const struct nmea_fixed_units *u)
+{
+    // $GPVTG,054.7,T,034.4,M,005.5,N,010.2,K*48
+    if (count < 9)
+        return false;
+
+    // Проверка единиц
+    if (nmea_fixed_char(f[2]) != 'T' || nmea_fixed_char(f[4]) != 'M' ||
+        nmea_fixed_char(f[6]) != 'N' || nmea_fixed_char(f[8]) != 'K')
+        return false;
+
+    frame->faa_mode = (enum nmea_faa_mode) nmea_fixed_char(nmea_fixed_field(f, count, 9));
+    if (!nmea_fixed_decimal(f[1], u->angle, &frame->true_track_degrees) ||
+        !nmea_fixed_decimal(f[3], u->angle, &frame->magnetic_track_degrees) ||
+        !nmea_fixed_knots(f[5], u->speed, &frame->speed))
+        return false;
+    if (frame->speed == NMEA_FIXED_NONE)
+        return nmea_fixed_kph(f[7], u->speed, &frame->speed);
+    return true;
+}
+
+static inline bool nmea_fixed_units_valid(const struct nmea_fixed_units *u)
+{
+    return (unsigned) u->coord <= NMEA_FIXED_DECIMALS && (unsigned) u->angle <= NMEA_FIXED_DECIMALS &&
+           (unsigned) u->speed <= NMEA_FIXED_DECIMALS && (unsigned) u->length <= NMEA_FIXED_DECIMALS &&
+           (unsigned) u->dop <= NMEA_FIXED_DECIMALS;
+}
+
+enum nmea_sentence_id nmea_parse_fixed(struct nmea_fixed *frame, const char *sentence, bool strict,
+                                       const struct nmea_fixed_units *units)
+{
+    const char *fields[NMEA_MAX_FIELDS];
+    const char *next;
+    bool ok;
+
+    frame->id = NMEA_INVALID;
+    if (!nmea_fixed_units_valid(units))
+        return NMEA_INVALID;
+    int count = nmea_split(sentence, fields, strict, &next);
+    // Данные после конца строки недопустимы
+    if (!count || *next)
+        return NMEA_INVALID;
+
+    enum nmea_sentence_id id = nmea_sentence_type(sentence);
+    if (id == NMEA_INVALID)
+        return NMEA_INVALID;
+    frame->talker[0] = sentence[1];
+    frame->talker[1] = sentence[2];
+    frame->talker[2] = '\0';
+
+    switch (id) {
+        case NMEA_SENTENCE_RMC: ok = nmea_fixed_rmc(&frame->data.rmc, fields, count, units); break;
+        case NMEA_SENTENCE_GGA: ok = nmea_fixed_gga(&frame->data.gga, fields, count, units); break;
+        case NMEA_SENTENCE_GSA: ok = nmea_fixed_gsa(&frame->data.gsa, fields, count, units); break;
+        case NMEA_SENTENCE_GLL: ok = nmea_fixed_gll(&frame->data.gll, fields, count, units); break;
+        case NMEA_SENTENCE_GST: ok = nmea_fixed_gst(&frame->data.gst, fields, count, units); break;
+        case NMEA_SENTENCE_VTG: ok = nmea_fixed_vtg(&frame->data.vtg, fields, count, units); break;
+        default:
+            // Без полей с фиксированной точкой (GSV, ZDA) и зарегистрированные
+            id = NMEA_UNKNOWN;
+            ok = true;
+            break;
+    }
+
+    frame->id = ok ? id : NMEA_INVALID;
+    return frame->id;
+}
@@ -0,0 +1,118 @@
+#ifndef NMEA_FIXED_H
+#define NMEA_FIXED_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+//------------------- DEFINES -----------------------------
+#include "nmea.h"
+
+#define NMEA_FIXED_NONE				INT64_MIN	// поле пустое или отсутствует
+#define NMEA_FIXED_DECIMALS			9			// наибольшее число знаков в nmea_fixed_units
+
+// 1e-7 градуса, 0.01 градуса, мм/с, мм, x100
+#define NMEA_FIXED_UNITS_INIT		{7, 2, 3, 3, 2}
+
+
+//------------------- VARIABLES ---------------------------
+/**
+ * Единицы по классам полей: число знаков после точки 0..NMEA_FIXED_DECIMALS.
+ * Значения пишутся целыми сразу при разборе цифр, без scale и деления
+ */
+struct nmea_fixed_units {
+	int coord;			// широта/долгота: 10^-coord градуса
+	int angle;			// курс, склонение, ориентация эллипса: 10^-angle градуса
+	int speed;			// 10^-speed м/с (узлы и км/ч пересчитываются)
+	int length;			// высота, высота геоида, СКО: 10^-length м
+	int dop;			// DOP: 10^-dop
+};
+
+struct nmea_fixed_rmc {
+	struct nmea_time time;
+	bool valid;
+	int64_t latitude;		// coord, со знаком N/S
+	int64_t longitude;		// coord, со знаком E/W
+	int64_t speed;			// speed
+	int64_t course;			// angle
+	struct nmea_date date;
+	int64_t variation;		// angle, со знаком E/W
+};
+
+struct nmea_fixed_gga {
+	struct nmea_time time;
+	int64_t latitude;
+	int64_t longitude;
+	int fix_quality;
+	int satellites_tracked;
+	int64_t hdop;			// dop
+	int64_t altitude;		// length, над уровнем моря
+	int64_t height;			// length, высота геоида
+	int64_t dgps_age;		// мс
+};
+
+struct nmea_fixed_gsa {
+	char mode;
+	int fix_type;
+	int sats[12];
+	int64_t pdop;
+	int64_t hdop;
+	int64_t vdop;
+};
+
+struct nmea_fixed_gll {
+	int64_t latitude;
+	int64_t longitude;
+	struct nmea_time time;
+	char status;
+	char mode;
+};
+
+struct nmea_fixed_gst {
+	struct nmea_time time;
+	int64_t rms_deviation;				// length
+	int64_t semi_major_deviation;		// length
+	int64_t semi_minor_deviation;		// length
+	int64_t semi_major_orientation;		// angle
+	int64_t latitude_error_deviation;	// length
+	int64_t longitude_error_deviation;
+	int64_t altitude_error_deviation;
+};
+
+struct nmea_fixed_vtg {
+	int64_t true_track_degrees;			// angle
+	int64_t magnetic_track_degrees;		// angle
+	int64_t speed;						// speed: из узлов, без них - из км/ч
+	enum nmea_faa_mode faa_mode;
+};
+
+struct nmea_fixed {
+	enum nmea_sentence_id id;
+	char talker[3];
+	union {
+		struct nmea_fixed_rmc rmc;
+		struct nmea_fixed_gga gga;
+		struct nmea_fixed_gsa gsa;
+		struct nmea_fixed_gll gll;
+		struct nmea_fixed_gst gst;
+		struct nmea_fixed_vtg vtg;
+	} data;
+};
+
+//------------------- FUNCTIONS ---------------------------
+/**
+ * Разбор в единицы units. Поддерживаются RMC, GGA, GSA, GLL, GST, VTG;
+ * для остальных корректных предложений - NMEA_UNKNOWN (разбирать
+ * nmea_parse_any()). Пустые поля - NMEA_FIXED_NONE.
+ * Возвращает тип, NMEA_INVALID при ошибке или неверных units
+ */
+enum nmea_sentence_id nmea_parse_fixed(struct nmea_fixed *frame, const char *sentence, bool strict,
+                                       const struct nmea_fixed_units *units);
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif /* NMEA_FIXED_H */
@@ -0,0 +1,451 @@
+#include "nmea_geo.h"
+#include "nmea_coord.h"
+
+
+
+//------------------- DEFINES -----------------------------
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define NMEA_GEO_X86
+#include <immintrin.h>
+
+#define NMEA_GEO_KERNEL				__attribute__((target("avx2")))
+#endif
+
+// Без FMA: скалярная и векторная реализации совпадают побитно
+#define NMEA_GEO_ROUND				6755399441055744.0	// 1.5 * 2^52: x + R - R = округленное x
+#define NMEA_GEO_RAD				0.017453292519943295	// pi / 180
+#define NMEA_GEO_E2					(NMEA_GEO_F * (2.0 - NMEA_GEO_F))
+#define NMEA_GEO_EP2				(NMEA_GEO_E2 / (1.0 - NMEA_GEO_E2))
+
+// sin/cos на [-pi/4, pi/4] (коэффициенты fdlibm __kernel_sin/__kernel_cos)
+#define NMEA_GEO_S1					-1.66666666666666324348e-01
+#define NMEA_GEO_S2					8.33333333332248946124e-03
+#define NMEA_GEO_S3					-1.98412698298579493134e-04
+#define NMEA_GEO_S4					2.75573137070700676789e-06
+#define NMEA_GEO_S5					-2.50507602534068634195e-08
+#define NMEA_GEO_S6					1.58969099521155010221e-10
+#define NMEA_GEO_C1					4.16666666666666019037e-02
+#define NMEA_GEO_C2					-1.38888888888741095749e-03
+#define NMEA_GEO_C3					2.48015872894767294178e-05
+#define NMEA_GEO_C4					-2.75573143513906633035e-07
+#define NMEA_GEO_C5					2.08757232129817482790e-09
+#define NMEA_GEO_C6					-1.13596475577881948265e-11
+
+
+//------------------- VARIABLES ------------------------
+// Длина дуги меридиана: M = a (M0 phi - M2 sin 2phi + M4 sin 4phi - M6 sin 6phi)
+static const double nmea_geo_m0 = NMEA_GEO_A * (1.0 - NMEA_GEO_E2 / 4 - 3 * NMEA_GEO_E2 * NMEA_GEO_E2 / 64 -
+                                                5 * NMEA_GEO_E2 * NMEA_GEO_E2 * NMEA_GEO_E2 / 256);
+static const double nmea_geo_m2 = NMEA_GEO_A * (3 * NMEA_GEO_E2 / 8 + 3 * NMEA_GEO_E2 * NMEA_GEO_E2 / 32 +
+                                                45 * NMEA_GEO_E2 * NMEA_GEO_E2 * NMEA_GEO_E2 / 1024);
+static const double nmea_geo_m4 = NMEA_GEO_A * (15 * NMEA_GEO_E2 * NMEA_GEO_E2 / 256 +
+                                                45 * NMEA_GEO_E2 * NMEA_GEO_E2 * NMEA_GEO_E2 / 1024);
+static const double nmea_geo_m6 = NMEA_GEO_A * (35 * NMEA_GEO_E2 * NMEA_GEO_E2 * NMEA_GEO_E2 / 3072);
+
+typedef void (*nmea_geo_ecef_fn)(double *x, double *y, double *z, const double *latitude,
+                                 const double *longitude, const double *height, size_t count,
+                                 const struct nmea_geo_origin *origin);
+typedef void (*nmea_geo_utm_fn)(double *easting, double *northing, const int8_t *zone,
+                                const double *latitude, const double *longitude, size_t count);
+
+struct nmea_geo_impl {
+	const char *name;
+	nmea_geo_ecef_fn ecef;		// с origin - сразу ENU
+	nmea_geo_utm_fn utm;		// зоны уже выбраны
+};
+
+static const struct nmea_geo_impl *nmea_geo_impl;
+
+
+//------------------- FUNCTIONS ------------------------
+static inline double nmea_geo_flip(double v, uint64_t sign)
+{
+    uint64_t bits;
+
+    memcpy(&bits, &v, sizeof(bits));
+    bits ^= sign;
+    memcpy(&v, &bits, sizeof(v));
+    return v;
+}
+
+void nmea_geo_sincos(double degrees, double *sin_out, double *cos_out)
+{
+    // Четверть k = round(degrees / 90) в младших битах мантиссы t
+    double t = degrees * (1.0 / 90.0) + NMEA_GEO_ROUND;
+    double k = t - NMEA_GEO_ROUND;
+    uint64_t q;
+    memcpy(&q, &t, sizeof(q));
+
+    // degrees - 90k точно: остаток кратен ulp(degrees) и меньше degrees
+    double r = (degrees - k * 90.0) * NMEA_GEO_RAD;
+    double z = r * r;
+    double s = r + (r * z) * (NMEA_GEO_S1 + z * (NMEA_GEO_S2 + z * (NMEA_GEO_S3 + z * (NMEA_GEO_S4 +
+               z * (NMEA_GEO_S5 + z * NMEA_GEO_S6)))));
+    double hz = 0.5 * z;
+    double w = 1.0 - hz;
+    double c = w + (((1.0 - w) - hz) + (z * z) * (NMEA_GEO_C1 + z * (NMEA_GEO_C2 + z * (NMEA_GEO_C3 +
+               z * (NMEA_GEO_C4 + z * (NMEA_GEO_C5 + z * NMEA_GEO_C6))))));
+
+    // sin(r + 90k): s, c, -s, -c; cos(r + 90k): c, -s, -c, s
+    *sin_out = nmea_geo_flip((q & 1) ? c : s, (q & 2) << 62);
+    *cos_out = nmea_geo_flip((q & 1) ? s : c, ((q + 1) & 2) << 62);
+}
+
+static inline void nmea_geo_ecef_one(double *x, double *y, double *z, double latitude, double longitude,
+                                     double height, const struct nmea_geo_origin *origin)
+{
+    double sp, cp, sl, cl;
+
+    nmea_geo_sincos(latitude, &sp, &cp);
+    nmea_geo_sincos(longitude, &sl, &cl);
+
+    double n = NMEA_GEO_A / sqrt(1.0 - NMEA_GEO_E2 * (sp * sp));
+    double nc = (n + height) * cp;
+    double ex = nc * cl;
+    double ey = nc * sl;
+    double ez = (n * (1.0 - NMEA_GEO_E2) + height) * sp;
+
+    if (!origin) {
+        *x = ex;
+        *y = ey;
+        *z = ez;
+        return;
+    }
+
+    double dx = ex - origin->x;
+    double dy = ey - origin->y;
+    double dz = ez - origin->z;
+    *x = origin->east[0] * dx + origin->east[1] * dy;
+    *y = origin->north[0] * dx + origin->north[1] * dy + origin->north[2] * dz;
+    *z = origin->up[0] * dx + origin->up[1] * dy + origin->up[2] * dz;
+}
+
+static void nmea_geo_ecef_scalar(double *x, double *y, double *z, const double *latitude,
+                                 const double *longitude, const double *height, size_t count,
+                                 const struct nmea_geo_origin *origin)
+{
+    for (size_t i = 0; i < count; i++)
+        nmea_geo_ecef_one(&x[i], &y[i], &z[i], latitude[i], longitude[i], height ? height[i] : 0.0, origin);
+}
+
+static inline void nmea_geo_utm_one(double *easting, double *northing, int zone, double latitude, double longitude)
+{
+    double sp, cp;
+
+    if (!zone) {
+        *easting = NAN;
+        *northing = NAN;
+        return;
+    }
+
+    // Долгота от осевого меридиана в (-180, 180]
+    double dl = longitude - (double) ((zone < 0 ? -zone : zone) * 6 - 183);
+    dl = dl > 180.0 ? dl - 360.0 : dl;
+    dl = dl < -180.0 ? dl + 360.0 : dl;
+
+    nmea_geo_sincos(latitude, &sp, &cp);
+
+    double n = NMEA_GEO_A / sqrt(1.0 - NMEA_GEO_E2 * (sp * sp));
+    double tn = sp / cp;
+    double t = tn * tn;
+    double c = NMEA_GEO_EP2 * (cp * cp);
+    double a = (dl * NMEA_GEO_RAD) * cp;
+    double a2 = a * a;
+
+    double s2 = 2.0 * sp * cp;
+    double c2 = (cp - sp) * (cp + sp);
+    double s4 = 2.0 * s2 * c2;
+    double c4 = 1.0 - 2.0 * (s2 * s2);
+    double s6 = s4 * c2 + c4 * s2;
+    double m = nmea_geo_m0 * (latitude * NMEA_GEO_RAD) - nmea_geo_m2 * s2 + nmea_geo_m4 * s4 - nmea_geo_m6 * s6;
+
+    double x = a * (1.0 + a2 * ((1.0 - t + c) * (1.0 / 6.0) +
+               a2 * ((5.0 - 18.0 * t + t * t + 72.0 * c - 58.0 * NMEA_GEO_EP2) * (1.0 / 120.0))));
+    double y = a2 * (0.5 + a2 * ((5.0 - t + 9.0 * c + 4.0 * (c * c)) * (1.0 / 24.0) +
+               a2 * ((61.0 - 58.0 * t + t * t + 600.0 * c - 330.0 * NMEA_GEO_EP2) * (1.0 / 720.0))));
+
+    *easting = NMEA_GEO_UTM_K0 * (n * x) + 500000.0;
+    *northing = NMEA_GEO_UTM_K0 * (m + (n * tn) * y) + (zone < 0 ? 10000000.0 : 0.0);
+}
+
+static void nmea_geo_utm_scalar(double *easting, double *northing, const int8_t *zone,
+                                const double *latitude, const double *longitude, size_t count)
+{
+    for (size_t i = 0; i < count; i++)
+        nmea_geo_utm_one(&easting[i], &northing[i], zone[i], latitude[i], longitude[i]);
+}
+
+#ifdef NMEA_GEO_X86
+// Тот же порядок операций, что в скалярной реализации
+NMEA_GEO_KERNEL
+static inline void nmea_geo_sincos4(__m256d degrees, __m256d *sin_out, __m256d *cos_out)
+{
+    const __m256d round = _mm256_set1_pd(NMEA_GEO_ROUND);
+    const __m256i one = _mm256_set1_epi64x(1);
+    const __m256i two = _mm256_set1_epi64x(2);
+
+    __m256d t = _mm256_add_pd(_mm256_mul_pd(degrees, _mm256_set1_pd(1.0 / 90.0)), round);
+    __m256d k = _mm256_sub_pd(t, round);
+    __m256i q = _mm256_castpd_si256(t);
+
+    __m256d r = _mm256_mul_pd(_mm256_sub_pd(degrees, _mm256_mul_pd(k, _mm256_set1_pd(90.0))),
+                              _mm256_set1_pd(NMEA_GEO_RAD));
+    __m256d z = _mm256_mul_pd(r, r);
+    __m256d p = _mm256_add_pd(_mm256_set1_pd(NMEA_GEO_S5), _mm256_mul_pd(z, _mm256_set1_pd(NMEA_GEO_S6)));
+    p = _mm256_add_pd(_mm256_set1_pd(NMEA_GEO_S4), _mm256_mul_pd(z, p));
+    p = _mm256_add_pd(_mm256_set1_pd(NMEA_GEO_S3), _mm256_mul_pd(z, p));
+    p = _mm256_add_pd(_mm256_set1_pd(NMEA_GEO_S2), _mm256_mul_pd(z, p));
+    p = _mm256_add_pd(_mm256_set1_pd(NMEA_GEO_S1), _mm256_mul_pd(z, p));
+    __m256d s = _mm256_add_pd(r, _mm256_mul_pd(_mm256_mul_pd(r, z), p));
+
+    p = _mm256_add_pd(_mm256_set1_pd(NMEA_GEO_C5), _mm256_mul_pd(z, _mm256_set1_pd(NMEA_GEO_C6)));
+    p = _mm256_add_pd(_mm256_set1_pd(NMEA_GEO_C4), _mm256_mul_pd(z, p));
+    p = _mm256_add_pd(_mm256_set1_pd(NMEA_GEO_C3), _mm256_mul_pd(z, p));
+    p = _mm256_add_pd(_mm256_set1_pd(NMEA_GEO_C2), _mm256_mul_pd(z, p));
+    p = _mm256_add_pd(_mm256_set1_pd(NMEA_GEO_C1), _mm256_mul_pd(z, p));
+    __m256d hz = _mm256_mul_pd(_mm256_set1_pd(0.5), z);
+    __m256d w = _mm256_sub_pd(_mm256_set1_pd(1.0), hz);
+    __m256d c = _mm256_add_pd(w, _mm256_add_pd(_mm256_sub_pd(_mm256_sub_pd(_mm256_set1_pd(1.0), w), hz),
+                                               _mm256_mul_pd(_mm256_mul_pd(z, z), p)));
+
+    __m256d swap = _mm256_castsi256_pd(_mm256_cmpeq_epi64(_mm256_and_si256(q, one), one));
+    __m256i sin_sign = _mm256_slli_epi64(_mm256_and_si256(q, two), 62);
+    __m256i cos_sign = _mm256_slli_epi64(_mm256_and_si256(_mm256_add_epi64(q, one), two), 62);
+    *sin_out = _mm256_xor_pd(_mm256_blendv_pd(s, c, swap), _mm256_castsi256_pd(sin_sign));
+    *cos_out = _mm256_xor_pd(_mm256_blendv_pd(c, s, swap), _mm256_castsi256_pd(cos_sign));
+}
+
+NMEA_GEO_KERNEL
+static void nmea_geo_ecef_avx2(double *x, double *y, double *z, const double *latitude,
+                               const double *longitude, const double *height, size_t count,
+                               const struct nmea_geo_origin *origin)
+{
+    const __m256d a = _mm256_set1_pd(NMEA_GEO_A);
+    const __m256d one = _mm256_set1_pd(1.0);
+    const __m256d e2 = _mm256_set1_pd(NMEA_GEO_E2);
+    const __m256d b2 = _mm256_set1_pd(1.0 - NMEA_GEO_E2);
+    size_t i = 0;
+
+    for (; i + 4 <= count; i += 4) {
+        __m256d sp, cp, sl, cl;
+        __m256d h = height ? _mm256_loadu_pd(height + i) : _mm256_setzero_pd();
+
+        nmea_geo_sincos4(_mm256_loadu_pd(latitude + i), &sp, &cp);
+        nmea_geo_sincos4(_mm256_loadu_pd(longitude + i), &sl, &cl);
+
+        __m256d n = _mm256_div_pd(a, _mm256_sqrt_pd(_mm256_sub_pd(one, _mm256_mul_pd(e2, _mm256_mul_pd(sp, sp)))));
+        __m256d nc = _mm256_mul_pd(_mm256_add_pd(n, h), cp);
+        __m256d ex = _mm256_mul_pd(nc, cl);
+        __m256d ey = _mm256_mul_pd(nc, sl);
+        __m256d ez = _mm256_mul_pd(_mm256_add_pd(_mm256_mul_pd(n, b2), h), sp);
+
+        if (origin) {
+            __m256d dx = _mm256_sub_pd(ex, _mm256_set1_pd(origin->x));
+            __m256d dy = _mm256_sub_pd(ey, _mm256_set1_pd(origin->y));
+            __m256d dz = _mm256_sub_pd(ez, _mm256_set1_pd(origin->z));
+            ex = _mm256_add_pd(_mm256_mul_pd(_mm256_set1_pd(origin->east[0]), dx),
+                               _mm256_mul_pd(_mm256_set1_pd(origin->east[1]), dy));
+            ey = _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(_mm256_set1_pd(origin->north[0]), dx),
+                                             _mm256_mul_pd(_mm256_set1_pd(origin->north[1]), dy)),
+                               _mm256_mul_pd(_mm256_set1_pd(origin->north[2]), dz));
+            ez = _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(_mm256_set1_pd(origin->up[0]), dx),
+                                             _mm256_mul_pd(_mm256_set1_pd(origin->up[1]), dy)),
+                               _mm256_mul_pd(_mm256_set1_pd(origin->up[2]), dz));
+        }
+        _mm256_storeu_pd(x + i, ex);
+        _mm256_storeu_pd(y + i, ey);
+        _mm256_storeu_pd(z + i, ez);
+    }
+
+    nmea_geo_ecef_scalar(x + i, y + i, z + i, latitude + i, longitude + i, height ? height + i : NULL,
+                         count - i, origin);
+}
+
+NMEA_GEO_KERNEL
+static void nmea_geo_utm_avx2(double *easting, double *northing, const int8_t *zone,
+                              const double *latitude, const double *longitude, size_t count)
+{
+    const __m256d one = _mm256_set1_pd(1.0);
+    const __m256d two = _mm256_set1_pd(2.0);
+    const __m256d ep2 = _mm256_set1_pd(NMEA_GEO_EP2);
+    const __m256d lim = _mm256_set1_pd(180.0);
+    const __m256d turn = _mm256_set1_pd(360.0);
+    const __m256d nan = _mm256_set1_pd(NAN);
+    size_t i = 0;
+
+    for (; i + 4 <= count; i += 4) {
+        int32_t zones;
+        memcpy(&zones, zone + i, sizeof(zones));
+        __m256d zn = _mm256_cvtepi32_pd(_mm_cvtepi8_epi32(_mm_cvtsi32_si128(zones)));
+        __m256d za = _mm256_andnot_pd(_mm256_set1_pd(-0.0), zn);
+        __m256d invalid = _mm256_cmp_pd(zn, _mm256_setzero_pd(), _CMP_EQ_OQ);
+        __m256d south = _mm256_cmp_pd(zn, _mm256_setzero_pd(), _CMP_LT_OQ);
+        __m256d lat = _mm256_loadu_pd(latitude + i);
+        __m256d sp, cp;
+
+        __m256d dl = _mm256_sub_pd(_mm256_loadu_pd(longitude + i),
+                                   _mm256_sub_pd(_mm256_mul_pd(za, _mm256_set1_pd(6.0)), _mm256_set1_pd(183.0)));
+        dl = _mm256_blendv_pd(dl, _mm256_sub_pd(dl, turn), _mm256_cmp_pd(dl, lim, _CMP_GT_OQ));
+        dl = _mm256_blendv_pd(dl, _mm256_add_pd(dl, turn), _mm256_cmp_pd(dl, _mm256_sub_pd(_mm256_setzero_pd(), lim), _CMP_LT_OQ));
+
+        nmea_geo_sincos4(lat, &sp, &cp);
+
+        __m256d n = _mm256_div_pd(_mm256_set1_pd(NMEA_GEO_A),
+                                  _mm256_sqrt_pd(_mm256_sub_pd(one, _mm256_mul_pd(_mm256_set1_pd(NMEA_GEO_E2), _mm256_mul_pd(sp, sp)))));
+        __m256d tn = _mm256_div_pd(sp, cp);
+        __m256d t = _mm256_mul_pd(tn, tn);
+        __m256d c = _mm256_mul_pd(ep2, _mm256_mul_pd(cp, cp));
+        __m256d a = _mm256_mul_pd(_mm256_mul_pd(dl, _mm256_set1_pd(NMEA_GEO_RAD)), cp);
+        __m256d a2 = _mm256_mul_pd(a, a);
+
+        __m256d s2 = _mm256_mul_pd(_mm256_mul_pd(two, sp), cp);
+        __m256d c2 = _mm256_mul_pd(_mm256_sub_pd(cp, sp), _mm256_add_pd(cp, sp));
+        __m256d s4 = _mm256_mul_pd(_mm256_mul_pd(two, s2), c2);
+        __m256d c4 = _mm256_sub_pd(one, _mm256_mul_pd(two, _mm256_mul_pd(s2, s2)));
+        __m256d s6 = _mm256_add_pd(_mm256_mul_pd(s4, c2), _mm256_mul_pd(c4, s2));
+        __m256d m = _mm256_sub_pd(_mm256_mul_pd(_mm256_set1_pd(nmea_geo_m0), _mm256_mul_pd(lat, _mm256_set1_pd(NMEA_GEO_RAD))),
+                                  _mm256_mul_pd(_mm256_set1_pd(nmea_geo_m2), s2));
+        m = _mm256_add_pd(m, _mm256_mul_pd(_mm256_set1_pd(nmea_geo_m4), s4));
+        m = _mm256_sub_pd(m, _mm256_mul_pd(_mm256_set1_pd(nmea_geo_m6), s6));
+
+        // (5 - 18t + t^2 + 72c - 58ep2) / 120
+        __m256d p = _mm256_add_pd(_mm256_sub_pd(_mm256_set1_pd(5.0), _mm256_mul_pd(_mm256_set1_pd(18.0), t)), _mm256_mul_pd(t, t));
+        p = _mm256_sub_pd(_mm256_add_pd(p, _mm256_mul_pd(_mm256_set1_pd(72.0), c)), _mm256_mul_pd(_mm256_set1_pd(58.0), ep2));
+        p = _mm256_mul_pd(p, _mm256_set1_pd(1.0 / 120.0));
+        __m256d x = _mm256_mul_pd(_mm256_add_pd(_mm256_sub_pd(one, t), c), _mm256_set1_pd(1.0 / 6.0));
+        x = _mm256_mul_pd(a, _mm256_add_pd(one, _mm256_mul_pd(a2, _mm256_add_pd(x, _mm256_mul_pd(a2, p)))));
+
+        // (61 - 58t + t^2 + 600c - 330ep2) / 720
+        p = _mm256_add_pd(_mm256_sub_pd(_mm256_set1_pd(61.0), _mm256_mul_pd(_mm256_set1_pd(58.0), t)), _mm256_mul_pd(t, t));
+        p = _mm256_sub_pd(_mm256_add_pd(p, _mm256_mul_pd(_mm256_set1_pd(600.0), c)), _mm256_mul_pd(_mm256_set1_pd(330.0), ep2));
+        p = _mm256_mul_pd(p, _mm256_set1_pd(1.0 / 720.0));
+        // (5 - t + 9c + 4c^2) / 24
+        __m256d y = _mm256_add_pd(_mm256_add_pd(_mm256_sub_pd(_mm256_set1_pd(5.0), t), _mm256_mul_pd(_mm256_set1_pd(9.0), c)),
+                                  _mm256_mul_pd(_mm256_set1_pd(4.0), _mm256_mul_pd(c, c)));
+        y = _mm256_mul_pd(y, _mm256_set1_pd(1.0 / 24.0));
+        y = _mm256_mul_pd(a2, _mm256_add_pd(_mm256_set1_pd(0.5), _mm256_mul_pd(a2, _mm256_add_pd(y, _mm256_mul_pd(a2, p)))));
+
+        __m256d e = _mm256_add_pd(_mm256_mul_pd(_mm256_set1_pd(NMEA_GEO_UTM_K0), _mm256_mul_pd(n, x)), _mm256_set1_pd(500000.0));
+        __m256d nn = _mm256_mul_pd(_mm256_set1_pd(NMEA_GEO_UTM_K0), _mm256_add_pd(m, _mm256_mul_pd(_mm256_mul_pd(n, tn), y)));
+        nn = _mm256_add_pd(nn, _mm256_and_pd(south, _mm256_set1_pd(10000000.0)));
+        _mm256_storeu_pd(easting + i, _mm256_blendv_pd(e, nan, invalid));
+        _mm256_storeu_pd(northing + i, _mm256_blendv_pd(nn, nan, invalid));
+    }
+
+    nmea_geo_utm_scalar(easting + i, northing + i, zone + i, latitude + i, longitude + i, count - i);
+}
+#endif
+
+static const struct nmea_geo_impl nmea_geo_scalar = {"scalar", nmea_geo_ecef_scalar, nmea_geo_utm_scalar};
+#ifdef NMEA_GEO_X86
+static const struct nmea_geo_impl nmea_geo_avx2 = {"avx2", nmea_geo_ecef_avx2, nmea_geo_utm_avx2};
+#endif
+
+// Выбор реализации, NMEA_KERNEL=scalar отключает AVX2
+static const struct nmea_geo_impl *nmea_geo_select(void)
+{
+    const struct nmea_geo_impl *impl = nmea_atomic_load(&nmea_geo_impl);
+
+    if (impl)
+        return impl;
+    impl = &nmea_geo_scalar;
+#ifdef NMEA_GEO_X86
+    const char *force = getenv("NMEA_KERNEL");
+
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2") && (!force || !strcmp(force, "avx2")))
+        impl = &nmea_geo_avx2;
+#endif
+    nmea_atomic_store(&nmea_geo_impl, impl);
+    return impl;
+}
+
+static double nmea_geo_float(const struct nmea_float *f)
+{
+    return f->scale ? (double) f->value / (double) f->scale : NAN;
+}
+
+size_t nmea_geo_from_gga(double *latitude, double *longitude, double *height,
+                         const struct nmea_sentence_gga *gga, size_t count)
+{
+    size_t valid = 0;
+
+    for (size_t i = 0; i < count; i++) {
+        nmea_coord_degrees(&latitude[i], &gga[i].latitude, 1);
+        nmea_coord_degrees(&longitude[i], &gga[i].longitude, 1);
+        height[i] = nmea_geo_float(&gga[i].altitude) + (gga[i].height.scale ? nmea_geo_float(&gga[i].height) : 0.0);
+        valid += gga[i].latitude.scale && gga[i].longitude.scale;
+    }
+
+    return valid;
+}
+
+void nmea_geo_ecef(double *x, double *y, double *z, const double *latitude,
+                   const double *longitude, const double *height, size_t count)
+{
+    nmea_geo_select()->ecef(x, y, z, latitude, longitude, height, count, NULL);
+}
+
+void nmea_geo_origin(struct nmea_geo_origin *origin, double latitude, double longitude, double height)
+{
+    double sp, cp, sl, cl;
+
+    origin->latitude = latitude;
+    origin->longitude = longitude;
+    origin->height = height;
+    nmea_geo_ecef_one(&origin->x, &origin->y, &origin->z, latitude, longitude, height, NULL);
+
+    nmea_geo_sincos(latitude, &sp, &cp);
+    nmea_geo_sincos(longitude, &sl, &cl);
+    origin->east[0] = -sl;
+    origin->east[1] = cl;
+    origin->east[2] = 0.0;
+    origin->north[0] = -sp * cl;
+    origin->north[1] = -sp * sl;
+    origin->north[2] = cp;
+    origin->up[0] = cp * cl;
+    origin->up[1] = cp * sl;
+    origin->up[2] = sp;
+}
+
+void nmea_geo_enu(const struct nmea_geo_origin *origin, double *east, double *north, double *up,
+                  const double *latitude, const double *longitude, const double *height, size_t count)
+{
+    nmea_geo_select()->ecef(east, north, up, latitude, longitude, height, count, origin);
+}
+
+// Зона точки: 0 вне [-80, 84] и для NaN, отрицательная на юге
+static int nmea_geo_zone(double latitude, double longitude, int force)
+{
+    int zone;
+
+    if (!(latitude >= NMEA_GEO_UTM_MIN && latitude <= NMEA_GEO_UTM_MAX) || !(longitude >= -180.0 && longitude <= 180.0))
+        return 0;
+
+    if (force) {
+        zone = force;
+    } else {
+        zone = (int) ((longitude + 180.0) / 6.0) % 60 + 1;
+        if (latitude >= 56.0 && latitude < 64.0 && longitude >= 3.0 && longitude < 12.0)
+            zone = 32;
+        else if (latitude >= 72.0 && longitude >= 0.0 && longitude < 42.0)
+            zone = longitude < 9.0 ? 31 : longitude < 21.0 ? 33 : longitude < 33.0 ? 35 : 37;
+    }
+
+    return latitude < 0 ? -zone : zone;
+}
+
+void nmea_geo_utm(double *easting, double *northing, int8_t *zone, const double *latitude,
+                  const double *longitude, size_t count, int force)
+{
+    if (force < 0 || force > 60)
+        force = 0;
+    for (size_t i = 0; i < count; i++)
+        zone[i] = (int8_t) nmea_geo_zone(latitude[i], longitude[i], force);
+    nmea_geo_select()->utm(easting, northing, zone, latitude, longitude, count);
+}
+
+const char *nmea_geo_kernel(void)
+{
+    return nmea_geo_select()->name;
+}
@@ -0,0 +1,89 @@
+#ifndef NMEA_GEO_H
+#define NMEA_GEO_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+//------------------- DEFINES -----------------------------
+#include "nmea.h"
+
+#define NMEA_GEO_A					6378137.0				// WGS84: большая полуось, м
+#define NMEA_GEO_F					(1.0 / 298.257223563)	// WGS84: сжатие
+#define NMEA_GEO_UTM_K0				0.9996
+#define NMEA_GEO_UTM_MIN			-80.0					// UTM определена для широт [-80, 84]
+#define NMEA_GEO_UTM_MAX			84.0
+
+
+//------------------- VARIABLES ---------------------------
+/**
+ * Начало локальной системы ENU. Положение в ECEF и матрица поворота
+ * считаются один раз в nmea_geo_origin()
+ */
+struct nmea_geo_origin {
+	double latitude;		// градусы
+	double longitude;
+	double height;			// м над эллипсоидом
+	double x, y, z;			// ECEF, м
+	double east[3];			// строки матрицы ECEF -> ENU
+	double north[3];
+	double up[3];
+};
+
+//------------------- FUNCTIONS ---------------------------
+/**
+ * sin и cos угла в градусах: приведение к [-45, 45] без потерь и
+ * полиномы на [-pi/4, pi/4], абсолютная ошибка около 1.3e-16.
+ * Пакетные функции ниже дают побитно тот же результат в любой реализации
+ */
+void nmea_geo_sincos(double degrees, double *sin_out, double *cos_out);
+
+/**
+ * Колонки для преобразований из GGA: градусы и высота над эллипсоидом
+ * (altitude + height, без height - только altitude). Пустые поля - NaN.
+ * Возвращает количество точек с координатами
+ */
+size_t nmea_geo_from_gga(double *latitude, double *longitude, double *height,
+                         const struct nmea_sentence_gga *gga, size_t count);
+
+/**
+ * Геодезические координаты WGS84 в ECEF. height может быть NULL (0 м).
+ * Колонки одной длины, по 4 точки за шаг (AVX2, если доступен)
+ */
+void nmea_geo_ecef(double *x, double *y, double *z, const double *latitude,
+                   const double *longitude, const double *height, size_t count);
+
+/**
+ * Начало ENU в точке (градусы, м над эллипсоидом)
+ */
+void nmea_geo_origin(struct nmea_geo_origin *origin, double latitude, double longitude, double height);
+
+/**
+ * Геодезические координаты в ENU относительно origin, м
+ */
+void nmea_geo_enu(const struct nmea_geo_origin *origin, double *east, double *north, double *up,
+                  const double *latitude, const double *longitude, const double *height, size_t count);
+
+/**
+ * UTM: easting/northing в метрах, zone - номер зоны, отрицательный для
+ * южного полушария, 0 и NaN вне [-80, 84] широты. force = 1..60 - одна
+ * зона для всех точек (непрерывная траектория через границу зон), 0 -
+ * зона каждой точки с исключениями Норвегии и Шпицбергена.
+ * Ряд Снайдера (USGS) до A^6: отличие от ряда Крюгера меньше 1 мм
+ * в пределах стандартных зон, с force дальше от осевого меридиана растет
+ */
+void nmea_geo_utm(double *easting, double *northing, int8_t *zone, const double *latitude,
+                  const double *longitude, size_t count, int force);
+
+/**
+ * Название выбранной реализации: "avx2" или "scalar" (NMEA_KERNEL как у nmea_layout)
+ */
+const char *nmea_geo_kernel(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif /* NMEA_GEO_H */
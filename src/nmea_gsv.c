@@ -0,0 +1,142 @@
+#include "nmea_gsv.h"
+
+
+
+//------------------- FUNCTIONS ------------------------
+void nmea_gsv_init(struct nmea_gsv *gsv)
+{
+    memset(gsv, 0, sizeof(*gsv));
+}
+
+static struct nmea_gsv_talker *nmea_gsv_find(const struct nmea_gsv *gsv, const char *talker)
+{
+    for (int i = 0; i < NMEA_GSV_TALKERS; i++) {
+        const struct nmea_gsv_talker *t = &gsv->talkers[i];
+        if (t->talker[0] == talker[0] && t->talker[1] == talker[1])
+            return (struct nmea_gsv_talker *) t;
+    }
+    return NULL;
+}
+
+// Начало нового цикла: очистка индекса по заполненным позициям
+static void nmea_gsv_start(struct nmea_gsv_talker *t, int total_msgs, int total_sats)
+{
+    struct nmea_gsv_table *table = &t->tables[t->back];
+
+    for (int i = 0; i < table->count; i++) {
+        int nr = table->sats[i].nr;
+        if (nr > 0 && nr < NMEA_GSV_PRN_INDEX)
+            t->index[nr] = 0;
+    }
+    memcpy(table->talker, t->talker, sizeof(table->talker));
+    table->total_sats = total_sats;
+    table->count = 0;
+    t->total_msgs = total_msgs;
+    t->next = 1;
+}
+
+static bool nmea_gsv_add(struct nmea_gsv_talker *t, const struct nmea_sat_info *sat)
+{
+    struct nmea_gsv_table *table = &t->tables[t->back];
+    int pos = -1;
+
+    if (sat->nr > 0 && sat->nr < NMEA_GSV_PRN_INDEX) {
+        pos = t->index[sat->nr] - 1;
+    } else {
+        for (int i = 0; i < table->count; i++)
+            if (table->sats[i].nr == sat->nr)
+                pos = i;
+    }
+
+    if (pos < 0) {
+        if (table->count >= NMEA_GSV_SATS)
+            return false;
+        pos = table->count++;
+        if (sat->nr > 0 && sat->nr < NMEA_GSV_PRN_INDEX)
+            t->index[sat->nr] = (uint8_t) (pos + 1);
+    }
+
+    table->sats[pos] = *sat;
+    return true;
+}
+
+const struct nmea_gsv_table *nmea_gsv_push(struct nmea_gsv *gsv, const char *talker,
+                                           const struct nmea_sentence_gsv *frame)
+{
+    struct nmea_gsv_talker *t = nmea_gsv_find(gsv, talker);
+
+    if (!t) {
+        for (int i = 0; i < NMEA_GSV_TALKERS && !t; i++)
+            if (!gsv->talkers[i].talker[0])
+                t = &gsv->talkers[i];
+        if (!t) {
+            gsv->overflow++;
+            return NULL;
+        }
+        t->talker[0] = talker[0];
+        t->talker[1] = talker[1];
+        t->talker[2] = '\0';
+    }
+
+    if (frame->total_msgs < 1 || frame->total_msgs > NMEA_GSV_SATS / 4 ||
+        frame->msg_nr < 1 || frame->msg_nr > frame->total_msgs) {
+        if (t->next) {
+            gsv->dropped++;
+            t->next = 0;
+        }
+        return NULL;
+    }
+
+    // Первая часть начинает цикл, незавершенный предыдущий отбрасывается
+    if (frame->msg_nr == 1) {
+        if (t->next)
+            gsv->dropped++;
+        nmea_gsv_start(t, frame->total_msgs, frame->total_sats);
+    } else if (frame->msg_nr != t->next || frame->total_msgs != t->total_msgs) {
+        if (t->next)
+            gsv->dropped++;
+        t->next = 0;
+        return NULL;
+    }
+
+    for (int i = 0; i < 4; i++) {
+        if (frame->sats[i].nr && !nmea_gsv_add(t, &frame->sats[i])) {
+            gsv->overflow++;
+            break;
+        }
+    }
+
+    if (frame->msg_nr < t->total_msgs) {
+        t->next++;
+        return NULL;
+    }
+
+    // Публикация и переключение на второй буфер
+    struct nmea_gsv_table *table = &t->tables[t->back];
+    table->cycle = t->published ? t->published->cycle + 1 : 1;
+    t->published = table;
+    t->back ^= 1;
+    t->next = 0;
+    gsv->cycles++;
+
+    // Индекс строится заново для второго буфера
+    memset(t->index, 0, sizeof(t->index));
+    t->tables[t->back].count = 0;
+    return table;
+}
+
+const struct nmea_gsv_table *nmea_gsv_parse(struct nmea_gsv *gsv, const char *sentence)
+{
+    struct nmea_sentence_gsv frame;
+    char talker[3];
+
+    if (!nmea_talker_id(talker, sentence) || !nmea_parse_gsv(&frame, sentence))
+        return NULL;
+    return nmea_gsv_push(gsv, talker, &frame);
+}
+
+const struct nmea_gsv_table *nmea_gsv_table(const struct nmea_gsv *gsv, const char *talker)
+{
+    const struct nmea_gsv_talker *t = nmea_gsv_find(gsv, talker);
+    return t ? t->published : NULL;
+}
@@ -0,0 +1,81 @@
+#ifndef NMEA_GSV_H
+#define NMEA_GSV_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+//------------------- DEFINES -----------------------------
+#include "nmea.h"
+
+#define NMEA_GSV_TALKERS			8	// источников (GP, GL, GA, GB/BD, GQ, ...)
+#define NMEA_GSV_SATS				64	// спутников в таблице источника
+#define NMEA_GSV_PRN_INDEX			256	// PRN с прямым индексом, остальные - поиском
+
+
+//------------------- VARIABLES ---------------------------
+/**
+ * Полная таблица спутников одного источника за цикл GSV
+ */
+struct nmea_gsv_table {
+	char talker[3];
+	int total_sats;			// заявлено в GSV
+	int count;			// спутников в sats
+	unsigned long cycle;		// номер опубликованного цикла, с 1
+	struct nmea_sat_info sats[NMEA_GSV_SATS];
+};
+
+struct nmea_gsv_talker {
+	char talker[3];			// "" - свободен
+	int total_msgs;			// частей в текущем цикле
+	int next;			// ожидаемый номер части, 0 - ждать первую
+	int back;			// собираемая таблица
+	const struct nmea_gsv_table *published;	// последняя полная, NULL
+	struct nmea_gsv_table tables[2];
+	uint8_t index[NMEA_GSV_PRN_INDEX];	// PRN -> позиция в tables[back] + 1
+};
+
+/**
+ * Сборщик многочастных GSV. Память фиксирована, без выделений.
+ * Таблица публикуется после последней части цикла; опубликованная
+ * таблица остается неизменной, пока собирается следующий цикл, и
+ * перезаписывается только после еще одной публикации.
+ */
+struct nmea_gsv {
+	struct nmea_gsv_talker talkers[NMEA_GSV_TALKERS];
+	unsigned long cycles;		// опубликовано таблиц
+	unsigned long dropped;		// отброшено неполных циклов
+	unsigned long overflow;		// отброшено частей (нет места для источника/спутников)
+};
+
+//------------------- FUNCTIONS ---------------------------
+/**
+ * Инициализация (сброс) сборщика
+ */
+void nmea_gsv_init(struct nmea_gsv *gsv);
+
+/**
+ * Добавляет часть GSV источника talker ("GP", "GL", ...).
+ * Часть вне порядка или новая первая часть отбрасывают незавершенный цикл.
+ * Возвращает опубликованную таблицу, если часть была последней, иначе NULL
+ */
+const struct nmea_gsv_table *nmea_gsv_push(struct nmea_gsv *gsv, const char *talker,
+                                           const struct nmea_sentence_gsv *frame);
+
+/**
+ * nmea_parse_gsv() + nmea_gsv_push() для строки предложения
+ */
+const struct nmea_gsv_table *nmea_gsv_parse(struct nmea_gsv *gsv, const char *sentence);
+
+/**
+ * Последняя полная таблица источника, NULL если ее еще нет
+ */
+const struct nmea_gsv_table *nmea_gsv_table(const struct nmea_gsv *gsv, const char *talker);
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif /* NMEA_GSV_H */
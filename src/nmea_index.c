@@ -0,0 +1,190 @@
+#include "nmea_index.h"
+
+
+
+//------------------- DEFINES -----------------------------
+#define NMEA_INDEX_VERSION			1
+#define NMEA_INDEX_DAY				86400
+
+
+//------------------- VARIABLES ------------------------
+struct nmea_index_header {
+	char magic[8];
+	uint32_t version;
+	uint32_t step;
+	uint64_t scanned;
+	int64_t midnight;
+	int64_t last;
+	uint64_t count;
+};
+
+
+//------------------- FUNCTIONS ------------------------
+bool nmea_index_time(struct nmea_index_clock *clock, const struct nmea_sentence *frame, int64_t *time)
+{
+    const struct nmea_date *date = NULL;
+    const struct nmea_time *time_;
+    struct timespec ts;
+    int64_t t;
+
+    switch (frame->id) {
+        case NMEA_SENTENCE_RMC: time_ = &frame->data.rmc.time; date = &frame->data.rmc.date; break;
+        case NMEA_SENTENCE_ZDA: time_ = &frame->data.zda.time; date = &frame->data.zda.date; break;
+        case NMEA_SENTENCE_GGA: time_ = &frame->data.gga.time; break;
+        case NMEA_SENTENCE_GLL: time_ = &frame->data.gll.time; break;
+        case NMEA_SENTENCE_GST: time_ = &frame->data.gst.time; break;
+        default: return false;
+    }
+    if (time_->hours < 0)
+        return false;
+
+    int64_t day = (int64_t) time_->hours * 3600 + time_->minutes * 60 + time_->seconds;
+    if (date && !nmea_gettime(&ts, date, time_)) {
+        t = (int64_t) ts.tv_sec;
+        clock->midnight = t - day;
+    } else {
+        if (clock->midnight < 0)
+            return false;
+        t = clock->midnight + day;
+        // Время суток меньше предыдущего более чем на полсуток - новые сутки;
+        // больше - строка прошлых суток после смены даты
+        if (clock->last >= 0 && t < clock->last - NMEA_INDEX_DAY / 2) {
+            clock->midnight += NMEA_INDEX_DAY;
+            t += NMEA_INDEX_DAY;
+        } else if (clock->last >= 0 && t > clock->last + NMEA_INDEX_DAY / 2) {
+            t -= NMEA_INDEX_DAY;
+        }
+    }
+
+    clock->last = t;
+    *time = t;
+    return true;
+}
+
+static bool nmea_index_dated(const struct nmea_sentence *frame)
+{
+    return (frame->id == NMEA_SENTENCE_RMC && frame->data.rmc.date.year >= 0) ||
+           (frame->id == NMEA_SENTENCE_ZDA && frame->data.zda.date.year >= 0);
+}
+
+void nmea_index_init(struct nmea_index *index, uint32_t step)
+{
+    memset(index, 0, sizeof(*index));
+    index->step = step ? step : NMEA_INDEX_STEP;
+    index->clock.midnight = index->clock.last = -1;
+}
+
+static int nmea_index_add(struct nmea_index *index, int64_t time, uint64_t offset)
+{
+    if (index->count == index->capacity) {
+        size_t capacity = index->capacity ? index->capacity * 2 : 256;
+        struct nmea_index_entry *entries = realloc(index->entries, capacity * sizeof(*entries));
+        if (!entries)
+            return -1;
+        index->entries = entries;
+        index->capacity = capacity;
+    }
+
+    index->entries[index->count].time = time;
+    index->entries[index->count].offset = offset;
+    index->count++;
+    return 0;
+}
+
+ptrdiff_t nmea_index_update(struct nmea_index *index, const char *data, size_t len)
+{
+    const char *p = data;
+    const char *end = data + len;
+    const char *nl;
+
+    while ((nl = memchr(p, '\n', (size_t) (end - p)))) {
+        size_t n = (size_t) (nl + 1 - p);
+        struct nmea_sentence frame;
+        int64_t t;
+
+        // Записи только по строкам с датой: с них время восстанавливается
+        // без предыдущих строк
+        if (*p == '$' && nmea_parse_any_n(&frame, p, n, false) > NMEA_UNKNOWN &&
+            nmea_index_time(&index->clock, &frame, &t) && nmea_index_dated(&frame) &&
+            (!index->count || t >= index->entries[index->count - 1].time + (int64_t) index->step) &&
+            nmea_index_add(index, t, index->scanned + (uint64_t) (p - data)))
+            return -1;
+        p = nl + 1;
+    }
+
+    // Хвост без конца строки длиннее предложения - мусор
+    if (end - p > NMEA_MAX_LENGTH + 3)
+        p = end - (NMEA_MAX_LENGTH + 3);
+
+    index->scanned += (uint64_t) (p - data);
+    return p - data;
+}
+
+uint64_t nmea_index_seek(const struct nmea_index *index, int64_t time)
+{
+    size_t lo = 0, hi = index->count;
+
+    // Последняя запись раньше time: строки до нее не новее ее времени
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (index->entries[mid].time < time)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo ? index->entries[lo - 1].offset : 0;
+}
+
+int nmea_index_save(const struct nmea_index *index, FILE *file)
+{
+    struct nmea_index_header header;
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, NMEA_INDEX_MAGIC, sizeof(header.magic));
+    header.version = NMEA_INDEX_VERSION;
+    header.step = index->step;
+    header.scanned = index->scanned;
+    header.midnight = index->clock.midnight;
+    header.last = index->clock.last;
+    header.count = index->count;
+
+    if (fwrite(&header, sizeof(header), 1, file) != 1 ||
+        (index->count && fwrite(index->entries, sizeof(*index->entries), index->count, file) != index->count))
+        return -1;
+    return fflush(file) ? -1 : 0;
+}
+
+int nmea_index_load(struct nmea_index *index, FILE *file)
+{
+    struct nmea_index_header header;
+
+    if (fread(&header, sizeof(header), 1, file) != 1 || memcmp(header.magic, NMEA_INDEX_MAGIC, sizeof(header.magic)) ||
+        header.version != NMEA_INDEX_VERSION || !header.step || header.count > SIZE_MAX / sizeof(*index->entries)) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    nmea_index_init(index, header.step);
+    if (header.count) {
+        index->entries = malloc((size_t) header.count * sizeof(*index->entries));
+        if (!index->entries)
+            return -1;
+        if (fread(index->entries, sizeof(*index->entries), (size_t) header.count, file) != header.count) {
+            nmea_index_free(index);
+            errno = EINVAL;
+            return -1;
+        }
+    }
+    index->count = index->capacity = (size_t) header.count;
+    index->scanned = header.scanned;
+    index->clock.midnight = header.midnight;
+    index->clock.last = header.last;
+    return 0;
+}
+
+void nmea_index_free(struct nmea_index *index)
+{
+    free(index->entries);
+    index->entries = NULL;
+    index->count = index->capacity = 0;
+}
@@ -0,0 +1,84 @@
+#ifndef NMEA_INDEX_H
+#define NMEA_INDEX_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+//------------------- DEFINES -----------------------------
+#include "nmea.h"
+#include <stddef.h>
+
+#define NMEA_INDEX_MAGIC			"NMEAIDX1"
+#define NMEA_INDEX_STEP				10	// секунд между записями по умолчанию
+
+
+//------------------- VARIABLES ---------------------------
+/**
+ * Время строк захвата: дата берется из RMC/ZDA, предложения только со
+ * временем суток (GGA, GLL, GST, RMC без даты) отсчитываются от последней
+ * даты с переходом через полночь
+ */
+struct nmea_index_clock {
+	int64_t midnight;		// UNIX, с; -1 - дата еще неизвестна
+	int64_t last;			// последнее время, с; -1 - нет
+};
+
+struct nmea_index_entry {
+	int64_t time;			// UNIX, с
+	uint64_t offset;		// строка RMC/ZDA с датой, первая с этим временем
+};
+
+/**
+ * Индекс времени захвата (файла NMEA). Записи через step секунд,
+ * упорядочены по времени: скачки времени назад не индексируются.
+ */
+struct nmea_index {
+	uint32_t step;
+	uint64_t scanned;		// байт захвата разобрано, граница строки
+	struct nmea_index_clock clock;
+	size_t count;
+	size_t capacity;
+	struct nmea_index_entry *entries;
+};
+
+//------------------- FUNCTIONS ---------------------------
+/**
+ * Время предложения в секундах UNIX. Возвращает false, если в
+ * предложении нет времени или дата еще неизвестна
+ */
+bool nmea_index_time(struct nmea_index_clock *clock, const struct nmea_sentence *frame, int64_t *time);
+
+/**
+ * Пустой индекс, step = 0 - NMEA_INDEX_STEP
+ */
+void nmea_index_init(struct nmea_index *index, uint32_t step);
+
+/**
+ * Продолжение разбора: data - байты захвата с позиции index->scanned.
+ * Разбираются только полные строки, остаток передается в следующий раз.
+ * Возвращает количество разобранных байт, -1 при ошибке (errno)
+ */
+ptrdiff_t nmea_index_update(struct nmea_index *index, const char *data, size_t len);
+
+/**
+ * Смещение, с которого достаточно читать захват для строк со временем
+ * не раньше time (0 - с начала)
+ */
+uint64_t nmea_index_seek(const struct nmea_index *index, int64_t time);
+
+/**
+ * Запись и чтение файла индекса. Возвращают 0, -1 при ошибке (errno)
+ */
+int nmea_index_save(const struct nmea_index *index, FILE *file);
+int nmea_index_load(struct nmea_index *index, FILE *file);
+
+void nmea_index_free(struct nmea_index *index);
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif /* NMEA_INDEX_H */
@@ -0,0 +1,355 @@
+#include "nmea_ingest.h"
+#include "nmea_stream.h"
+
+
+
+//------------------- DEFINES -----------------------------
+#include <pthread.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+
+#define NMEA_INGEST_EVENTS			64	// событий за epoll_wait()
+
+
+//------------------- VARIABLES ------------------------
+struct nmea_ingest_worker;
+
+struct nmea_ingest_receiver {
+	int fd;
+	int id;
+	void *ctx;
+	struct nmea_ingest_worker *worker;
+	struct nmea_ingest_stats stats;
+	struct nmea_stream stream;
+};
+
+struct nmea_ingest_worker {
+	struct nmea_ingest *ingest;
+	pthread_t thread;
+	bool started;
+	int epfd;
+	int wake;			// eventfd остановки
+	pthread_mutex_t lock;		// обработка событий / удаление приемников
+	pthread_cond_t idle;		// обработчик вернулся
+	struct nmea_ingest_receiver *busy;	// приемник в обработчике (вызывается без lock)
+	struct nmea_sentence frames[NMEA_INGEST_BATCH];
+};
+
+struct nmea_ingest {
+	nmea_ingest_cb cb;
+	nmea_ingest_filter filter;
+	bool strict;
+
+	struct nmea_ingest_worker *workers;
+	int nworkers;
+	int next_worker;
+
+	pthread_mutex_t lock;		// таблица приемников
+	struct nmea_ingest_receiver **receivers;
+	int count;
+	int capacity;
+};
+
+
+//------------------- FUNCTIONS ------------------------
+static void nmea_ingest_close(struct nmea_ingest_receiver *r)
+{
+    epoll_ctl(r->worker->epfd, EPOLL_CTL_DEL, r->fd, NULL);
+    close(r->fd);
+    r->fd = -1;
+    r->stats.open = false;
+}
+
+// Вызов обработчика без w->lock: из него можно вызывать nmea_ingest_stats()
+// и nmea_ingest_remove(). Вызывается с w->lock, false - приемник закрыт
+static bool nmea_ingest_deliver(struct nmea_ingest_worker *w, struct nmea_ingest_receiver *r, size_t count)
+{
+    w->busy = r;
+    pthread_mutex_unlock(&w->lock);
+    w->ingest->cb(r->ctx, r->id, count ? w->frames : NULL, count);
+    pthread_mutex_lock(&w->lock);
+    w->busy = NULL;
+    pthread_cond_broadcast(&w->idle);
+    return r->fd >= 0;
+}
+
+// Чтение приемника: не более NMEA_INGEST_READS read() за пробуждение,
+// остальное дочитывается по следующему событию (level-triggered)
+static void nmea_ingest_read(struct nmea_ingest_worker *w, struct nmea_ingest_receiver *r)
+{
+    struct nmea_ingest *ingest = w->ingest;
+    struct nmea_span span;
+    size_t count = 0;
+    bool eof = false;
+
+    r->stats.wakeups++;
+    for (int i = 0; i < NMEA_INGEST_READS; i++) {
+        size_t space;
+        char *buf = nmea_stream_wbuf(&r->stream, &space);
+        ssize_t got = read(r->fd, buf, space);
+
+        if (got < 0 && errno == EINTR)
+            continue;
+        if (got < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            break;
+        // pty после закрытия второй стороны возвращает EIO
+        if (got <= 0) {
+            eof = true;
+            break;
+        }
+
+        nmea_stream_commit(&r->stream, (size_t) got);
+        r->stats.bytes += (uint64_t) got;
+
+        while (nmea_stream_next(&r->stream, &span)) {
+            if (ingest->filter && !ingest->filter(r->ctx, r->id, span.data)) {
+                r->stats.skipped++;
+                continue;
+            }
+            if (nmea_parse_any(&w->frames[count], span.data, ingest->strict) == NMEA_INVALID) {
+                r->stats.invalid++;
+                continue;
+            }
+            r->stats.sentences++;
+            if (++count == NMEA_INGEST_BATCH) {
+                count = 0;
+                // Удален из обработчика - остаток не выдается
+                if (!nmea_ingest_deliver(w, r, NMEA_INGEST_BATCH)) {
+                    r->stats.dropped = r->stream.dropped;
+                    return;
+                }
+            }
+        }
+        if ((size_t) got < space)
+            break;
+    }
+
+    r->stats.dropped = r->stream.dropped;
+    if (count && !nmea_ingest_deliver(w, r, count))
+        return;
+    if (eof) {
+        nmea_ingest_close(r);
+        nmea_ingest_deliver(w, r, 0);
+    }
+}
+
+static void *nmea_ingest_worker(void *arg)
+{
+    struct nmea_ingest_worker *w = arg;
+    struct epoll_event events[NMEA_INGEST_EVENTS];
+
+    for (;;) {
+        int n = epoll_wait(w->epfd, events, NMEA_INGEST_EVENTS, -1);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            break;
+        }
+
+        for (int i = 0; i < n; i++) {
+            struct nmea_ingest_receiver *r = events[i].data.ptr;
+            // eventfd остановки зарегистрирован с NULL
+            if (!r)
+                return NULL;
+
+            pthread_mutex_lock(&w->lock);
+            if (r->fd >= 0)
+                nmea_ingest_read(w, r);
+            pthread_mutex_unlock(&w->lock);
+        }
+    }
+
+    return NULL;
+}
+
+struct nmea_ingest *nmea_ingest_create(const struct nmea_ingest_options *options, nmea_ingest_cb cb)
+{
+    int threads = options && options->threads > 0 ? options->threads : NMEA_INGEST_THREADS;
+    struct nmea_ingest *ingest = calloc(1, sizeof(*ingest));
+
+    if (!ingest || !cb) {
+        free(ingest);
+        errno = EINVAL;
+        return NULL;
+    }
+    ingest->cb = cb;
+    ingest->strict = options && options->strict;
+    ingest->filter = options ? options->filter : NULL;
+    pthread_mutex_init(&ingest->lock, NULL);
+
+    ingest->workers = calloc((size_t) threads, sizeof(*ingest->workers));
+    if (!ingest->workers) {
+        nmea_ingest_destroy(ingest);
+        return NULL;
+    }
+
+    for (int i = 0; i < threads; i++) {
+        struct nmea_ingest_worker *w = &ingest->workers[i];
+        struct epoll_event ev = {EPOLLIN, {NULL}};
+
+        w->ingest = ingest;
+        w->epfd = epoll_create1(EPOLL_CLOEXEC);
+        w->wake = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+        pthread_mutex_init(&w->lock, NULL);
+        pthread_cond_init(&w->idle, NULL);
+        ingest->nworkers++;
+
+        if (w->epfd < 0 || w->wake < 0 || epoll_ctl(w->epfd, EPOLL_CTL_ADD, w->wake, &ev) < 0 ||
+            pthread_create(&w->thread, NULL, nmea_ingest_worker, w)) {
+            nmea_ingest_destroy(ingest);
+            return NULL;
+        }
+        w->started = true;
+    }
+
+    return ingest;
+}
+
+// Ошибка добавления: дескриптор закрывается, errno сохраняется
+static int nmea_ingest_fail(int fd, struct nmea_ingest_receiver *r)
+{
+    int error = errno;
+
+    free(r);
+    close(fd);
+    errno = error;
+    return -1;
+}
+
+int nmea_ingest_add(struct nmea_ingest *ingest, int fd, void *ctx)
+{
+    struct nmea_ingest_receiver *r;
+    int flags = fcntl(fd, F_GETFL);
+
+    if (flags < 0 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) < 0)
+        return nmea_ingest_fail(fd, NULL);
+    r = calloc(1, sizeof(*r));
+    if (!r)
+        return nmea_ingest_fail(fd, NULL);
+    r->fd = fd;
+    r->ctx = ctx;
+    r->stats.open = true;
+    nmea_stream_init(&r->stream);
+
+    pthread_mutex_lock(&ingest->lock);
+    if (ingest->count == ingest->capacity) {
+        int capacity = ingest->capacity ? ingest->capacity * 2 : 16;
+        struct nmea_ingest_receiver **receivers = realloc(ingest->receivers, (size_t) capacity * sizeof(*receivers));
+        if (!receivers) {
+            pthread_mutex_unlock(&ingest->lock);
+            return nmea_ingest_fail(fd, r);
+        }
+        ingest->receivers = receivers;
+        ingest->capacity = capacity;
+    }
+    r->id = ingest->count;
+    r->worker = &ingest->workers[ingest->next_worker];
+    ingest->next_worker = (ingest->next_worker + 1) % ingest->nworkers;
+
+    struct epoll_event ev = {EPOLLIN | EPOLLRDHUP, {r}};
+    if (epoll_ctl(r->worker->epfd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+        pthread_mutex_unlock(&ingest->lock);
+        return nmea_ingest_fail(fd, r);
+    }
+    ingest->receivers[ingest->count++] = r;
+    pthread_mutex_unlock(&ingest->lock);
+
+    return r->id;
+}
+
+static struct nmea_ingest_receiver *nmea_ingest_receiver(struct nmea_ingest *ingest, int receiver)
+{
+    struct nmea_ingest_receiver *r = NULL;
+
+    pthread_mutex_lock(&ingest->lock);
+    if (receiver >= 0 && receiver < ingest->count)
+        r = ingest->receivers[receiver];
+    pthread_mutex_unlock(&ingest->lock);
+    return r;
+}
+
+// Вызов из потока обработки (любого): массив потоков после
+// nmea_ingest_create() не меняется
+static bool nmea_ingest_inside(const struct nmea_ingest *ingest)
+{
+    for (int i = 0; i < ingest->nworkers; i++)
+        if (ingest->workers[i].started && pthread_equal(pthread_self(), ingest->workers[i].thread))
+            return true;
+    return false;
+}
+
+int nmea_ingest_remove(struct nmea_ingest *ingest, int receiver)
+{
+    struct nmea_ingest_receiver *r = nmea_ingest_receiver(ingest, receiver);
+
+    if (!r) {
+        errno = ENOENT;
+        return -1;
+    }
+
+    // Память приемника освобождается только в nmea_ingest_destroy():
+    // событие для него может быть уже получено другим потоком.
+    // Вне потоков обработки - ожидание выхода из обработчика этого приемника.
+    // Из обработчика не ждем: два обработчика, удаляющие приемники друг
+    // друга, ждали бы взаимно. Закрытие под w->lock безопасно и без
+    // ожидания - nmea_ingest_deliver() проверяет fd после возврата
+    pthread_mutex_lock(&r->worker->lock);
+    if (!nmea_ingest_inside(ingest))
+        while (r->worker->busy == r)
+            pthread_cond_wait(&r->worker->idle, &r->worker->lock);
+    if (r->fd >= 0)
+        nmea_ingest_close(r);
+    pthread_mutex_unlock(&r->worker->lock);
+    return 0;
+}
+
+int nmea_ingest_stats(struct nmea_ingest *ingest, int receiver, struct nmea_ingest_stats *stats)
+{
+    struct nmea_ingest_receiver *r = nmea_ingest_receiver(ingest, receiver);
+
+    if (!r) {
+        errno = ENOENT;
+        return -1;
+    }
+
+    pthread_mutex_lock(&r->worker->lock);
+    *stats = r->stats;
+    pthread_mutex_unlock(&r->worker->lock);
+    return 0;
+}
+
+void nmea_ingest_destroy(struct nmea_ingest *ingest)
+{
+    if (!ingest)
+        return;
+
+    for (int i = 0; i < ingest->nworkers; i++) {
+        struct nmea_ingest_worker *w = &ingest->workers[i];
+        uint64_t one = 1;
+        if (w->started && write(w->wake, &one, sizeof(one)) == sizeof(one))
+            pthread_join(w->thread, NULL);
+    }
+
+    for (int i = 0; i < ingest->count; i++) {
+        if (ingest->receivers[i]->fd >= 0)
+            close(ingest->receivers[i]->fd);
+        free(ingest->receivers[i]);
+    }
+
+    for (int i = 0; i < ingest->nworkers; i++) {
+        struct nmea_ingest_worker *w = &ingest->workers[i];
+        if (w->epfd >= 0)
+            close(w->epfd);
+        if (w->wake >= 0)
+            close(w->wake);
+        pthread_mutex_destroy(&w->lock);
+        pthread_cond_destroy(&w->idle);
+    }
+
+    pthread_mutex_destroy(&ingest->lock);
+    free(ingest->receivers);
+    free(ingest->workers);
+    free(ingest);
+}
@@ -0,0 +1,89 @@
+#ifndef NMEA_INGEST_H
+#define NMEA_INGEST_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+//------------------- DEFINES -----------------------------
+#include "nmea.h"
+
+#define NMEA_INGEST_BATCH			64	// предложений в одном вызове обработчика
+#define NMEA_INGEST_READS			8	// read() одного приемника за пробуждение
+#define NMEA_INGEST_THREADS			2	// потоков по умолчанию
+
+
+//------------------- VARIABLES ---------------------------
+struct nmea_ingest;
+
+/**
+ * Фильтр кадрового буфера: вызывается в потоке обработки приемника до
+ * разбора, sentence - предложение без конца строки. false - предложение
+ * не разбирается и не передается обработчику (например nmea_thin_wanted())
+ */
+typedef bool (*nmea_ingest_filter)(void *ctx, int receiver, const char *sentence);
+
+struct nmea_ingest_options {
+	int threads;			// 0 - NMEA_INGEST_THREADS
+	bool strict;			// контрольная сумма обязательна
+	nmea_ingest_filter filter;	// NULL - разбираются все предложения
+};
+
+struct nmea_ingest_stats {
+	uint64_t bytes;			// прочитано байт
+	uint64_t sentences;		// разобрано предложений (включая NMEA_UNKNOWN)
+	uint64_t invalid;		// предложений с ошибками
+	uint64_t dropped;		// отброшено кадровым буфером (мусор, длинные строки)
+	uint64_t skipped;		// не разобрано по фильтру
+	uint64_t wakeups;		// пробуждений с данными
+	bool open;			// источник еще читается
+};
+
+/**
+ * Предложения одного приемника, разобранные за пробуждение (в потоке
+ * обработки), frames действительны только во время вызова.
+ * ctx - значение из nmea_ingest_add(). После закрытия
+ * источника (EOF, ошибка) вызывается один раз с frames = NULL, count = 0.
+ * Вызывается без блокировок: из обработчика допустимы nmea_ingest_stats()
+ * и nmea_ingest_remove(), в том числе для своего приемника
+ */
+typedef void (*nmea_ingest_cb)(void *ctx, int receiver, const struct nmea_sentence *frames, size_t count);
+
+//------------------- FUNCTIONS ---------------------------
+/**
+ * Создает пул потоков epoll. Возвращает NULL при ошибке (errno)
+ */
+struct nmea_ingest *nmea_ingest_create(const struct nmea_ingest_options *options, nmea_ingest_cb cb);
+
+/**
+ * Добавляет источник (serial, pty, сокет). Дескриптор переводится в
+ * неблокирующий режим и закрывается библиотекой, в том числе при ошибке.
+ * Возвращает номер приемника, -1 при ошибке (errno)
+ */
+int nmea_ingest_add(struct nmea_ingest *ingest, int fd, void *ctx);
+
+/**
+ * Прекращает чтение и закрывает дескриптор приемника.
+ * Обработчик после возврата для него не вызывается. Вне обработчика
+ * дожидается завершения текущего вызова; из обработчика (любого
+ * приемника) не ждет - начатый в другом потоке вызов может еще идти
+ */
+int nmea_ingest_remove(struct nmea_ingest *ingest, int receiver);
+
+/**
+ * Счетчики приемника. Возвращает -1 для неизвестного номера
+ */
+int nmea_ingest_stats(struct nmea_ingest *ingest, int receiver, struct nmea_ingest_stats *stats);
+
+/**
+ * Останавливает потоки, закрывает все источники и освобождает память
+ */
+void nmea_ingest_destroy(struct nmea_ingest *ingest);
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif /* NMEA_INGEST_H */
@@ -0,0 +1,205 @@
+#include "nmea_layout.h"
+
+
+
+//------------------- DEFINES -----------------------------
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define NMEA_LAYOUT_X86
+#include <immintrin.h>
+
+// Выровненное чтение блоками может выйти за '\0', но не за границу страницы
+#if defined(__clang__) || __GNUC__ >= 5
+#define NMEA_LAYOUT_KERNEL(isa)		__attribute__((target(isa), no_sanitize_address))
+#else
+#define NMEA_LAYOUT_KERNEL(isa)		__attribute__((target(isa)))
+#endif
+#endif
+
+
+//------------------- VARIABLES ------------------------
+typedef bool (*nmea_layout_fn)(struct nmea_layout *layout, const char *sentence);
+
+static bool nmea_layout_resolve(struct nmea_layout *layout, const char *sentence);
+
+static nmea_layout_fn nmea_layout_impl = nmea_layout_resolve;
+static const char *nmea_layout_name = "scalar";
+
+
+//------------------- FUNCTIONS ------------------------
+static inline bool nmea_layout_stop(unsigned char c)
+{
+    return c < 0x20 || c > 0x7e || c == '*';
+}
+
+static bool nmea_layout_scalar(struct nmea_layout *layout, const char *sentence)
+{
+    uint8_t checksum = 0x00;
+
+    memset(layout->commas, 0, sizeof(layout->commas));
+    for (size_t i = 0; i < NMEA_LAYOUT_LIMIT; i++) {
+        unsigned char c = sentence[i];
+        if (nmea_layout_stop(c)) {
+            layout->end = i;
+            layout->checksum = checksum;
+            return true;
+        }
+        if (c == ',')
+            layout->commas[i >> 6] |= (uint64_t) 1 << (i & 63);
+        checksum ^= c;
+    }
+
+    return false;
+}
+
+#ifdef NMEA_LAYOUT_X86
+// Окно для маски байт [lo, hi): loadu(window + 32 - lo) & loadu(window + 64 - hi)
+static const uint8_t nmea_layout_window[96] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+};
+
+// Добавляет маску запятых блока, начинающегося в позиции pos (может быть < 0)
+static inline void nmea_layout_commas(struct nmea_layout *layout, ptrdiff_t pos, uint64_t bits)
+{
+    if (pos < 0) {
+        bits >>= -pos;
+        pos = 0;
+    }
+    if (!bits)
+        return;
+
+    size_t word = (size_t) pos >> 6;
+    unsigned shift = (unsigned) pos & 63;
+    layout->commas[word] |= bits << shift;
+    if (shift && word + 1 < NMEA_LAYOUT_WORDS)
+        layout->commas[word + 1] |= bits >> (64 - shift);
+}
+
+NMEA_LAYOUT_KERNEL("sse2")
+static bool nmea_layout_sse2(struct nmea_layout *layout, const char *sentence)
+{
+    ptrdiff_t pos = -(ptrdiff_t) ((uintptr_t) sentence & 15);
+    const __m128i *block = (const __m128i *) (sentence + pos);
+    const __m128i low = _mm_set1_epi8(0x20);
+    const __m128i high = _mm_set1_epi8(0x7e);
+    const __m128i star = _mm_set1_epi8('*');
+    const __m128i comma = _mm_set1_epi8(',');
+    __m128i acc = _mm_setzero_si128();
+
+    memset(layout->commas, 0, sizeof(layout->commas));
+    for (; pos < NMEA_LAYOUT_LIMIT; pos += 16, block++) {
+        __m128i v = _mm_load_si128(block);
+        __m128i s = _mm_or_si128(_mm_or_si128(_mm_cmplt_epi8(v, low), _mm_cmpgt_epi8(v, high)),
+                                 _mm_cmpeq_epi8(v, star));
+        int lo = pos < 0 ? (int) -pos : 0;
+        uint64_t stop = (uint64_t) _mm_movemask_epi8(s) >> lo << lo;
+        int hi = stop ? nmea_ctz64(stop) : 16;
+        uint64_t commas = (uint64_t) _mm_movemask_epi8(_mm_cmpeq_epi8(v, comma));
+        __m128i keep = _mm_and_si128(_mm_loadu_si128((const __m128i *) (nmea_layout_window + 32 - lo)),
+                                     _mm_loadu_si128((const __m128i *) (nmea_layout_window + 64 - hi)));
+
+        acc = _mm_xor_si128(acc, _mm_and_si128(v, keep));
+        nmea_layout_commas(layout, pos, commas & (((uint64_t) 1 << hi) - 1) >> lo << lo);
+
+        if (stop) {
+            acc = _mm_xor_si128(acc, _mm_srli_si128(acc, 8));
+            acc = _mm_xor_si128(acc, _mm_srli_si128(acc, 4));
+            acc = _mm_xor_si128(acc, _mm_srli_si128(acc, 2));
+            acc = _mm_xor_si128(acc, _mm_srli_si128(acc, 1));
+            layout->checksum = (uint8_t) _mm_cvtsi128_si32(acc);
+            layout->end = (size_t) (pos + hi);
+            return layout->end < NMEA_LAYOUT_LIMIT;
+        }
+    }
+
+    return false;
+}
+
+NMEA_LAYOUT_KERNEL("avx2")
+static bool nmea_layout_avx2(struct nmea_layout *layout, const char *sentence)
+{
+    ptrdiff_t pos = -(ptrdiff_t) ((uintptr_t) sentence & 31);
+    const __m256i *block = (const __m256i *) (sentence + pos);
+    const __m256i low = _mm256_set1_epi8(0x20);
+    const __m256i high = _mm256_set1_epi8(0x7e);
+    const __m256i star = _mm256_set1_epi8('*');
+    const __m256i comma = _mm256_set1_epi8(',');
+    __m256i acc = _mm256_setzero_si256();
+
+    memset(layout->commas, 0, sizeof(layout->commas));
+    for (; pos < NMEA_LAYOUT_LIMIT; pos += 32, block++) {
+        __m256i v = _mm256_load_si256(block);
+        __m256i s = _mm256_or_si256(_mm256_or_si256(_mm256_cmpgt_epi8(low, v), _mm256_cmpgt_epi8(v, high)),
+                                    _mm256_cmpeq_epi8(v, star));
+        int lo = pos < 0 ? (int) -pos : 0;
+        uint64_t stop = (uint64_t) (uint32_t) _mm256_movemask_epi8(s) >> lo << lo;
+        int hi = stop ? nmea_ctz64(stop) : 32;
+        uint64_t commas = (uint32_t) _mm256_movemask_epi8(_mm256_cmpeq_epi8(v, comma));
+        __m256i keep = _mm256_and_si256(_mm256_loadu_si256((const __m256i *) (nmea_layout_window + 32 - lo)),
+                                        _mm256_loadu_si256((const __m256i *) (nmea_layout_window + 64 - hi)));
+
+        acc = _mm256_xor_si256(acc, _mm256_and_si256(v, keep));
+        nmea_layout_commas(layout, pos, commas & (((uint64_t) 1 << hi) - 1) >> lo << lo);
+
+        if (stop) {
+            __m128i x = _mm_xor_si128(_mm256_castsi256_si128(acc), _mm256_extracti128_si256(acc, 1));
+            x = _mm_xor_si128(x, _mm_srli_si128(x, 8));
+            x = _mm_xor_si128(x, _mm_srli_si128(x, 4));
+            x = _mm_xor_si128(x, _mm_srli_si128(x, 2));
+            x = _mm_xor_si128(x, _mm_srli_si128(x, 1));
+            layout->checksum = (uint8_t) _mm_cvtsi128_si32(x);
+            layout->end = (size_t) (pos + hi);
+            return layout->end < NMEA_LAYOUT_LIMIT;
+        }
+    }
+
+    return false;
+}
+#endif
+
+// Выбор реализации. Переменная окружения NMEA_KERNEL=scalar|sse2|avx2
+// ограничивает выбор (для тестов и замеров).
+static void nmea_layout_select(void)
+{
+    nmea_layout_fn impl = nmea_layout_scalar;
+    const char *name = "scalar";
+
+#ifdef NMEA_LAYOUT_X86
+    const char *force = getenv("NMEA_KERNEL");
+
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2") && (!force || !strcmp(force, "avx2"))) {
+        impl = nmea_layout_avx2;
+        name = "avx2";
+    } else if (__builtin_cpu_supports("sse2") && (!force || strcmp(force, "scalar"))) {
+        impl = nmea_layout_sse2;
+        name = "sse2";
+    }
+#endif
+
+    // Имя публикуется до указателя: увидевший указатель видит и имя
+    nmea_atomic_store(&nmea_layout_name, name);
+    nmea_atomic_store(&nmea_layout_impl, impl);
+}
+
+static bool nmea_layout_resolve(struct nmea_layout *layout, const char *sentence)
+{
+    nmea_layout_select();
+    return nmea_atomic_load(&nmea_layout_impl)(layout, sentence);
+}
+
+bool nmea_layout(struct nmea_layout *layout, const char *sentence)
+{
+    return nmea_atomic_load(&nmea_layout_impl)(layout, sentence);
+}
+
+const char *nmea_layout_kernel(void)
+{
+    if (nmea_atomic_load(&nmea_layout_impl) == nmea_layout_resolve)
+        nmea_layout_select();
+    return nmea_atomic_load(&nmea_layout_name);
+}
@@ -0,0 +1,61 @@
+#ifndef NMEA_LAYOUT_H
+#define NMEA_LAYOUT_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+//------------------- DEFINES -----------------------------
+#include "nmea.h"
+
+#define NMEA_LAYOUT_WORDS			((NMEA_MAX_LENGTH + 63) / 64 + 1)
+#define NMEA_LAYOUT_LIMIT			(NMEA_LAYOUT_WORDS * 64)
+
+
+//------------------- VARIABLES ---------------------------
+/**
+ * Разметка предложения: контрольная сумма, конец данных и позиции запятых.
+ * Конец данных - первый '*', непечатный символ или '\0'
+ */
+struct nmea_layout {
+	uint64_t commas[NMEA_LAYOUT_WORDS];	// бит N - запятая в позиции N
+	size_t end;				// смещение конца данных
+	uint8_t checksum;			// XOR байт [0, end), включая '$'
+};
+
+//------------------- FUNCTIONS ---------------------------
+/**
+ * Разметка за один проход (AVX2/SSE2/скалярная версия, выбирается при первом вызове).
+ * Возвращает false если конец данных не найден в первых NMEA_LAYOUT_LIMIT байтах
+ */
+bool nmea_layout(struct nmea_layout *layout, const char *sentence);
+
+/**
+ * Название выбранной реализации: "avx2", "sse2" или "scalar"
+ */
+const char *nmea_layout_kernel(void);
+
+/**
+ * Номер младшего установленного бита (bits != 0)
+ */
+static inline int nmea_ctz64(uint64_t bits)
+{
+#if defined(__GNUC__)
+	return __builtin_ctzll(bits);
+#else
+	int n = 0;
+	while (!(bits & 1)) {
+		bits >>= 1;
+		n++;
+	}
+	return n;
+#endif
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif /* NMEA_LAYOUT_H */
@@ -0,0 +1,391 @@
+#include "nmea_log.h"
+#include <stddef.h>
+
+
+
+//------------------- DEFINES -----------------------------
+#define NMEA_LOG_VERSION			1
+#define NMEA_LOG_HEADER				16
+#define NMEA_LOG_RECORD_MAX			88	// байт колонок на запись в худшем случае
+#define NMEA_LOG_EXP_MAX			19	// scale до 1e18
+
+// Колонки блока
+enum {
+	NMEA_LOG_TIME = 0,
+	NMEA_LOG_FLOAT = 1,			// NMEA_LOG_FLOATS колонок
+	NMEA_LOG_STATUS = NMEA_LOG_FLOAT + NMEA_LOG_FLOATS,
+	NMEA_LOG_SATS,
+	NMEA_LOG_EXP,
+};
+
+
+//------------------- VARIABLES ------------------------
+struct nmea_log_writer {
+	FILE *file;
+	size_t count;
+	struct nmea_log_record records[NMEA_LOG_BLOCK];
+	uint8_t exponents[NMEA_LOG_BLOCK][NMEA_LOG_FLOATS];
+	uint8_t data[NMEA_LOG_BLOCK * NMEA_LOG_RECORD_MAX];
+};
+
+static const size_t nmea_log_floats[NMEA_LOG_FLOATS] = {
+	offsetof(struct nmea_log_record, latitude),
+	offsetof(struct nmea_log_record, longitude),
+	offsetof(struct nmea_log_record, altitude),
+	offsetof(struct nmea_log_record, speed),
+	offsetof(struct nmea_log_record, course),
+	offsetof(struct nmea_log_record, hdop),
+};
+
+static const int64_t nmea_log_scales[NMEA_LOG_EXP_MAX + 1] = {
+	0, 1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000,
+	10000000000, 100000000000, 1000000000000, 10000000000000, 100000000000000,
+	1000000000000000, 10000000000000000, 100000000000000000, 1000000000000000000,
+};
+
+
+//------------------- FUNCTIONS ------------------------
+static inline uint64_t nmea_log_zigzag(uint64_t v)
+{
+    return (v << 1) ^ (uint64_t) -(int64_t) (v >> 63);
+}
+
+static inline uint64_t nmea_log_unzigzag(uint64_t v)
+{
+    return (v >> 1) ^ (uint64_t) -(int64_t) (v & 1);
+}
+
+static inline uint8_t *nmea_log_varint(uint8_t *p, uint64_t v)
+{
+    while (v >= 0x80) {
+        *p++ = (uint8_t) (v | 0x80);
+        v >>= 7;
+    }
+    *p++ = (uint8_t) v;
+    return p;
+}
+
+static inline const uint8_t *nmea_log_uvarint(const uint8_t *p, const uint8_t *end, uint64_t *v)
+{
+    uint64_t result = 0;
+
+    for (int shift = 0; p < end && shift < 64; shift += 7) {
+        uint8_t b = *p++;
+        result |= (uint64_t) (b & 0x7F) << shift;
+        if (!(b & 0x80)) {
+            *v = result;
+            return p;
+        }
+    }
+    return NULL;
+}
+
+static inline struct nmea_float *nmea_log_float(struct nmea_log_record *record, int column)
+{
+    return (struct nmea_float *) ((char *) record + nmea_log_floats[column]);
+}
+
+// Код показателя масштаба: 0 - нет значения, -1 - не степень 10
+static int nmea_log_exponent(int64_t scale)
+{
+    for (int e = 0; e <= NMEA_LOG_EXP_MAX; e++)
+        if (nmea_log_scales[e] == scale)
+            return e;
+    return -1;
+}
+
+// Сырые координаты ддмм.мммм в градусы * 1e7
+static int32_t nmea_log_degrees(const struct nmea_float *f)
+{
+    struct nmea_float c = *f;
+    int64_t v = nmea_rescale(&c, 10000000);
+    return (int32_t) (v / 1000000000 * 10000000 + v % 1000000000 / 60);
+}
+
+bool nmea_log_record_fix(struct nmea_log_record *record, const struct nmea_fix *fix)
+{
+    struct timespec ts;
+
+    if (nmea_gettime(&ts, &fix->date, &fix->time))
+        return false;
+
+    record->time = (int64_t) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+    record->latitude = fix->latitude;
+    record->longitude = fix->longitude;
+    record->altitude = fix->altitude;
+    record->speed = fix->speed;
+    record->course = fix->course;
+    record->hdop = fix->hdop;
+    record->fix_quality = fix->fix_quality;
+    record->satellites = fix->satellites_tracked;
+    record->valid = fix->valid;
+    return true;
+}
+
+struct nmea_log_writer *nmea_log_writer_create(FILE *file)
+{
+    uint8_t header[NMEA_LOG_HEADER] = {0};
+    struct nmea_log_writer *writer;
+
+    memcpy(header, NMEA_LOG_MAGIC, 8);
+    header[8] = NMEA_LOG_VERSION;
+    if (fwrite(header, sizeof(header), 1, file) != 1)
+        return NULL;
+
+    writer = malloc(sizeof(*writer));
+    if (!writer)
+        return NULL;
+    writer->file = file;
+    writer->count = 0;
+    return writer;
+}
+
+static int nmea_log_write_block(struct nmea_log_writer *writer)
+{
+    struct nmea_log_block block;
+    struct nmea_log_record *records = writer->records;
+    size_t count = writer->count;
+    uint8_t *p = writer->data;
+    uint8_t *start = p;
+    uint64_t prev = 0, prev_delta = 0;
+
+    memset(&block, 0, sizeof(block));
+    block.magic = NMEA_LOG_BLOCK_MAGIC;
+    block.count = (uint32_t) count;
+    block.time_min = INT64_MAX;
+    block.time_max = INT64_MIN;
+    block.latitude_min = block.longitude_min = INT32_MAX;
+    block.latitude_max = block.longitude_max = INT32_MIN;
+
+    // Время - дельта дельт: при постоянном темпе 1 байт
+    for (size_t i = 0; i < count; i++) {
+        uint64_t delta = (uint64_t) records[i].time - prev;
+        p = nmea_log_varint(p, nmea_log_zigzag(delta - prev_delta));
+        prev = (uint64_t) records[i].time;
+        prev_delta = delta;
+        if (records[i].time < block.time_min)
+            block.time_min = records[i].time;
+        if (records[i].time > block.time_max)
+            block.time_max = records[i].time;
+    }
+    block.columns[NMEA_LOG_TIME] = (uint32_t) (p - start);
+
+    for (int c = 0; c < NMEA_LOG_FLOATS; c++) {
+        start = p;
+        prev = 0;
+        block.exponents[c] = writer->exponents[0][c];
+        for (size_t i = 0; i < count; i++) {
+            const struct nmea_float *f = nmea_log_float(&records[i], c);
+            p = nmea_log_varint(p, nmea_log_zigzag((uint64_t) f->value - prev));
+            prev = (uint64_t) f->value;
+            if (writer->exponents[i][c] != block.exponents[c])
+                block.exponents[c] = NMEA_LOG_EXP_VARIES;
+        }
+        block.columns[NMEA_LOG_FLOAT + c] = (uint32_t) (p - start);
+    }
+
+    start = p;
+    for (size_t i = 0; i < count; i++) {
+        int quality = records[i].fix_quality + 1;
+        quality = quality < 0 ? 0 : quality > 15 ? 15 : quality;
+        *p++ = (uint8_t) (records[i].valid | quality << 1);
+    }
+    block.columns[NMEA_LOG_STATUS] = (uint32_t) (p - start);
+
+    start = p;
+    prev = 0;
+    for (size_t i = 0; i < count; i++) {
+        p = nmea_log_varint(p, nmea_log_zigzag((uint64_t) (int64_t) records[i].satellites - prev));
+        prev = (uint64_t) (int64_t) records[i].satellites;
+    }
+    block.columns[NMEA_LOG_SATS] = (uint32_t) (p - start);
+
+    // Показатели только для колонок с разным масштабом
+    start = p;
+    for (size_t i = 0; i < count; i++)
+        for (int c = 0; c < NMEA_LOG_FLOATS; c++)
+            if (block.exponents[c] == NMEA_LOG_EXP_VARIES)
+                *p++ = writer->exponents[i][c];
+    block.columns[NMEA_LOG_EXP] = (uint32_t) (p - start);
+
+    for (size_t i = 0; i < count; i++) {
+        if (records[i].latitude.scale && records[i].longitude.scale) {
+            int32_t latitude = nmea_log_degrees(&records[i].latitude);
+            int32_t longitude = nmea_log_degrees(&records[i].longitude);
+            if (latitude < block.latitude_min)
+                block.latitude_min = latitude;
+            if (latitude > block.latitude_max)
+                block.latitude_max = latitude;
+            if (longitude < block.longitude_min)
+                block.longitude_min = longitude;
+            if (longitude > block.longitude_max)
+                block.longitude_max = longitude;
+        }
+    }
+
+    while ((p - writer->data) & 7)
+        *p++ = 0;
+    block.size = (uint32_t) (p - writer->data);
+
+    writer->count = 0;
+    if (fwrite(&block, sizeof(block), 1, writer->file) != 1 ||
+        fwrite(writer->data, block.size, 1, writer->file) != 1)
+        return -1;
+    return 0;
+}
+
+int nmea_log_append(struct nmea_log_writer *writer, const struct nmea_log_record *record)
+{
+    uint8_t *exponents = writer->exponents[writer->count];
+
+    for (int c = 0; c < NMEA_LOG_FLOATS; c++) {
+        int e = nmea_log_exponent(nmea_log_float((struct nmea_log_record *) record, c)->scale);
+        if (e < 0) {
+            errno = EINVAL;
+            return -1;
+        }
+        exponents[c] = (uint8_t) e;
+    }
+
+    writer->records[writer->count++] = *record;
+    if (writer->count == NMEA_LOG_BLOCK)
+        return nmea_log_write_block(writer);
+    return 0;
+}
+
+int nmea_log_flush(struct nmea_log_writer *writer)
+{
+    if (writer->count && nmea_log_write_block(writer))
+        return -1;
+    return fflush(writer->file) ? -1 : 0;
+}
+
+int nmea_log_writer_close(struct nmea_log_writer *writer)
+{
+    int result = nmea_log_flush(writer);
+
+    free(writer);
+    return result;
+}
+
+int nmea_log_reader_init(struct nmea_log_reader *reader, const void *data, size_t size)
+{
+    const uint8_t *header = data;
+    uint32_t magic;
+
+    if (size < NMEA_LOG_HEADER || memcmp(header, NMEA_LOG_MAGIC, 8) || header[8] != NMEA_LOG_VERSION) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    // Заголовки блоков в порядке байт платформы записи: журнал другой
+    // платформы отличается переставленной сигнатурой первого блока
+    if (size >= NMEA_LOG_HEADER + sizeof(magic)) {
+        memcpy(&magic, header + NMEA_LOG_HEADER, sizeof(magic));
+        if (magic != NMEA_LOG_BLOCK_MAGIC) {
+            errno = EINVAL;
+            return -1;
+        }
+    }
+
+    reader->data = data;
+    reader->size = size;
+    reader->pos = NMEA_LOG_HEADER;
+    return 0;
+}
+
+const struct nmea_log_block *nmea_log_next(struct nmea_log_reader *reader)
+{
+    const struct nmea_log_block *block;
+    uint64_t columns = 0;
+
+    if (reader->size - reader->pos < sizeof(*block))
+        return NULL;
+
+    block = (const struct nmea_log_block *) (reader->data + reader->pos);
+    for (int c = 0; c < NMEA_LOG_COLUMNS; c++)
+        columns += block->columns[c];
+    if (block->magic != NMEA_LOG_BLOCK_MAGIC || block->count > NMEA_LOG_BLOCK || block->size & 7 ||
+        block->size > reader->size - reader->pos - sizeof(*block) || columns > block->size)
+        return NULL;
+
+    reader->pos += sizeof(*block) + block->size;
+    return block;
+}
+
+int nmea_log_decode(const struct nmea_log_block *block, struct nmea_log_record records[NMEA_LOG_BLOCK])
+{
+    const uint8_t *column[NMEA_LOG_COLUMNS + 1];
+    const uint8_t *p = (const uint8_t *) (block + 1);
+    size_t count = block->count;
+    uint64_t prev = 0, prev_delta = 0, v;
+    int varies = 0;
+
+    column[0] = p;
+    for (int c = 0; c < NMEA_LOG_COLUMNS; c++)
+        column[c + 1] = column[c] + block->columns[c];
+    for (int c = 0; c < NMEA_LOG_FLOATS; c++) {
+        if (block->exponents[c] == NMEA_LOG_EXP_VARIES)
+            varies++;
+        else if (block->exponents[c] > NMEA_LOG_EXP_MAX)
+            goto corrupted;
+    }
+    if (count > NMEA_LOG_BLOCK || column[NMEA_LOG_COLUMNS] > p + block->size ||
+        block->columns[NMEA_LOG_STATUS] != count || block->columns[NMEA_LOG_EXP] != count * varies)
+        goto corrupted;
+
+    p = column[NMEA_LOG_TIME];
+    for (size_t i = 0; i < count; i++) {
+        if (!(p = nmea_log_uvarint(p, column[NMEA_LOG_TIME + 1], &v)))
+            goto corrupted;
+        prev_delta += nmea_log_unzigzag(v);
+        prev += prev_delta;
+        records[i].time = (int64_t) prev;
+    }
+
+    for (int c = 0, vary = 0; c < NMEA_LOG_FLOATS; c++) {
+        const uint8_t *exponents = column[NMEA_LOG_EXP] + vary;
+        uint8_t exponent = block->exponents[c];
+
+        p = column[NMEA_LOG_FLOAT + c];
+        prev = 0;
+        for (size_t i = 0; i < count; i++) {
+            struct nmea_float *f = nmea_log_float(&records[i], c);
+            if (!(p = nmea_log_uvarint(p, column[NMEA_LOG_FLOAT + c + 1], &v)))
+                goto corrupted;
+            prev += nmea_log_unzigzag(v);
+            if (exponent == NMEA_LOG_EXP_VARIES) {
+                uint8_t e = exponents[i * (size_t) varies];
+                if (e > NMEA_LOG_EXP_MAX)
+                    goto corrupted;
+                f->scale = nmea_log_scales[e];
+            } else {
+                f->scale = nmea_log_scales[exponent];
+            }
+            f->value = (int64_t) prev;
+        }
+        if (exponent == NMEA_LOG_EXP_VARIES)
+            vary++;
+    }
+
+    p = column[NMEA_LOG_STATUS];
+    for (size_t i = 0; i < count; i++) {
+        records[i].valid = p[i] & 1;
+        records[i].fix_quality = (p[i] >> 1) - 1;
+    }
+
+    p = column[NMEA_LOG_SATS];
+    prev = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (!(p = nmea_log_uvarint(p, column[NMEA_LOG_SATS + 1], &v)))
+            goto corrupted;
+        prev += nmea_log_unzigzag(v);
+        records[i].satellites = (int) (int64_t) prev;
+    }
+
+    return (int) count;
+
+corrupted:
+    errno = EINVAL;
+    return -1;
+}
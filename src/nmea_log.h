@@ -0,0 +1,130 @@
+#ifndef NMEA_LOG_H
+#define NMEA_LOG_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+//------------------- DEFINES -----------------------------
+#include "nmea.h"
+#include "nmea_epoch.h"
+
+#define NMEA_LOG_MAGIC				"NMEALOG1"
+#define NMEA_LOG_BLOCK_MAGIC		0x4B4C424Eu	// "NBLK"
+#define NMEA_LOG_BLOCK				1024	// записей в блоке
+#define NMEA_LOG_FLOATS				6	// колонок nmea_float
+#define NMEA_LOG_COLUMNS			10
+#define NMEA_LOG_EXP_VARIES			0xFF	// масштаб колонки меняется по записям
+
+
+//------------------- VARIABLES ---------------------------
+/**
+ * Запись журнала: решение одной эпохи
+ */
+struct nmea_log_record {
+	int64_t time;			// UNIX время, мкс
+	struct nmea_float latitude;	// ддмм.мммм со знаком, как в RMC/GGA
+	struct nmea_float longitude;
+	struct nmea_float altitude;
+	struct nmea_float speed;	// узлы
+	struct nmea_float course;
+	struct nmea_float hdop;
+	int fix_quality;		// -1 - нет
+	int satellites;			// -1 - нет
+	bool valid;
+};
+
+/**
+ * Файл: 16 байт заголовка (NMEA_LOG_MAGIC, версия), затем блоки.
+ * Блок - заголовок и колонки подряд: время (дельта дельт), nmea_float
+ * (дельта значения), статус, спутники (дельта), показатели масштаба.
+ * Целые - zig-zag varint. Заголовки блоков в порядке байт платформы
+ * записи, блоки выровнены на 8 байт - файл читается через mmap без
+ * копирования. Журнал другого порядка байт не читается (EINVAL).
+ */
+struct nmea_log_block {
+	uint32_t magic;			// NMEA_LOG_BLOCK_MAGIC
+	uint32_t count;			// записей
+	uint32_t size;			// байт колонок после заголовка, кратно 8
+	uint32_t reserved;
+	int64_t time_min;		// мкс
+	int64_t time_max;
+	int32_t latitude_min;		// градусы * 1e7, min > max - координат нет
+	int32_t latitude_max;
+	int32_t longitude_min;
+	int32_t longitude_max;
+	uint8_t exponents[NMEA_LOG_FLOATS];	// scale = 10^(e-1), 0 - нет значения,
+	uint8_t reserved2[2];			// NMEA_LOG_EXP_VARIES - в колонке показателей
+	uint32_t columns[NMEA_LOG_COLUMNS];	// размеры колонок
+};
+
+struct nmea_log_writer;
+
+/**
+ * Чтение журнала в памяти (mmap, буфер)
+ */
+struct nmea_log_reader {
+	const uint8_t *data;
+	size_t size;
+	size_t pos;
+};
+
+//------------------- FUNCTIONS ---------------------------
+/**
+ * Запись из эпохи nmea_epoch. Возвращает false без даты или времени
+ */
+bool nmea_log_record_fix(struct nmea_log_record *record, const struct nmea_fix *fix);
+
+/**
+ * Потоковая запись в file (заголовок пишется сразу). Записи копятся
+ * в блок по NMEA_LOG_BLOCK. Возвращает NULL при ошибке (errno)
+ */
+struct nmea_log_writer *nmea_log_writer_create(FILE *file);
+
+/**
+ * Добавляет запись. scale полей - степени 10 или 0.
+ * Возвращает 0, -1 при ошибке (errno)
+ */
+int nmea_log_append(struct nmea_log_writer *writer, const struct nmea_log_record *record);
+
+/**
+ * Записывает неполный блок и fflush(). Возвращает 0, -1 при ошибке
+ */
+int nmea_log_flush(struct nmea_log_writer *writer);
+
+/**
+ * nmea_log_flush() и освобождение, file не закрывается
+ */
+int nmea_log_writer_close(struct nmea_log_writer *writer);
+
+/**
+ * Начало чтения. Возвращает 0, -1 если это не журнал или он записан
+ * с другим порядком байт (EINVAL)
+ */
+int nmea_log_reader_init(struct nmea_log_reader *reader, const void *data, size_t size);
+
+/**
+ * Следующий блок без декодирования, NULL в конце или при повреждении
+ */
+const struct nmea_log_block *nmea_log_next(struct nmea_log_reader *reader);
+
+/**
+ * Пересечение блока с интервалом времени [from, to], мкс
+ */
+static inline bool nmea_log_overlaps(const struct nmea_log_block *block, int64_t from, int64_t to)
+{
+    return block->time_min <= to && block->time_max >= from;
+}
+
+/**
+ * Декодирует блок. Возвращает количество записей, -1 при повреждении (EINVAL)
+ */
+int nmea_log_decode(const struct nmea_log_block *block, struct nmea_log_record records[NMEA_LOG_BLOCK]);
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif /* NMEA_LOG_H */
@@ -0,0 +1,285 @@
+#include "nmea_number.h"
+#include "nmea_layout.h"
+
+
+
+//------------------- DEFINES -----------------------------
+#include <limits.h>
+
+// Чтение 8 байт может выйти за '\0', но не за границу страницы
+#if defined(__clang__) || (defined(__GNUC__) && __GNUC__ >= 5)
+#define NMEA_NUMBER_LOAD			__attribute__((no_sanitize_address))
+#else
+#define NMEA_NUMBER_LOAD
+#endif
+
+#if defined(__GNUC__) && defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#define NMEA_NUMBER_SWAR_LOAD
+typedef uint64_t __attribute__((may_alias, aligned(1))) nmea_unaligned64;
+#endif
+
+#define NMEA_NUMBER_PAGE			4096
+
+
+//------------------- VARIABLES ------------------------
+static const int64_t nmea_pow10[NMEA_NUMBER_DIGITS + 1] = {
+    1LL, 10LL, 100LL, 1000LL, 10000LL, 100000LL, 1000000LL, 10000000LL, 100000000LL,
+    1000000000LL, 10000000000LL, 100000000000LL, 1000000000000LL, 10000000000000LL,
+    100000000000000LL, 1000000000000000LL, 10000000000000000LL, 100000000000000000LL,
+    1000000000000000000LL,
+};
+
+
+//------------------- FUNCTIONS ------------------------
+// 8 символов начиная с p, первый символ в младшем байте.
+// Байты после первой не цифры не используются
+NMEA_NUMBER_LOAD
+static inline uint64_t nmea_number_load(const char *p)
+{
+    uint64_t chunk = 0;
+
+#ifdef NMEA_NUMBER_SWAR_LOAD
+    if (((uintptr_t) p & (NMEA_NUMBER_PAGE - 1)) <= NMEA_NUMBER_PAGE - 8)
+        return *(const nmea_unaligned64 *) p;
+#endif
+    // У границы страницы - побайтно до первой не цифры
+    for (int i = 0; i < 8; i++) {
+        unsigned char c = (unsigned char) p[i];
+        chunk |= (uint64_t) c << (8 * i);
+        if (c < '0' || c > '9')
+            break;
+    }
+    return chunk;
+}
+
+// Количество цифр в начале блока (0..8).
+// Цифра: старшая тетрада 3 и старшая тетрада (c + 6) тоже 3
+static inline int nmea_number_digits(uint64_t chunk)
+{
+    uint64_t t = ((chunk & 0xF0F0F0F0F0F0F0F0ULL) |
+                  (((chunk + 0x0606060606060606ULL) & 0xF0F0F0F0F0F0F0F0ULL) >> 4)) ^ 0x3333333333333333ULL;
+
+    return t ? nmea_ctz64(t) >> 3 : 8;
+}
+
+// Значение первых n (1..8) цифр блока: пары, четверки, восьмерки
+static inline uint32_t nmea_number_value(uint64_t chunk, int n)
+{
+    chunk = (chunk & 0x0F0F0F0F0F0F0F0FULL) << (8 * (8 - n));
+    chunk = (chunk * 10 + (chunk >> 8)) & 0x00FF00FF00FF00FFULL;
+    chunk = (chunk * 100 + (chunk >> 16)) & 0x0000FFFF0000FFFFULL;
+    chunk = (chunk * 10000 + (chunk >> 32)) & 0xFFFFFFFFULL;
+    return (uint32_t) chunk;
+}
+
+// Две цифры с позиции i блока, уже проверенного на цифры
+static inline int nmea_number_pair(uint64_t chunk, int i)
+{
+    return (int) ((chunk >> (8 * i)) & 0x0F) * 10 + (int) ((chunk >> (8 * i + 8)) & 0x0F);
+}
+
+// Общий цикл разбора "[+-]ddd[.ddd]": модуль значения без точки, не более
+// decimals знаков дроби (decimals < 0 - без ограничения).
+// Возвращает конец числа, NULL при переполнении целой части
+struct nmea_number_parts {
+    int64_t v;
+    int64_t whole;          // целая часть
+    int fraction;           // сохранено знаков дроби, -1 - без точки
+    int significant;
+    int sign;               // 0 - без знака
+    bool digits;
+};
+
+static inline const char *nmea_number_parse(const char *s, int decimals, struct nmea_number_parts *p)
+{
+    int64_t v = 0;
+    int64_t whole = 0;
+    int sign = 0;
+    int significant = 0;
+    int fraction = -1;
+    bool digits = false;
+
+    if (*s == '+' || *s == '-')
+        sign = (*s++ == '-') ? -1 : 1;
+
+    for (;;) {
+        uint64_t chunk = nmea_number_load(s);
+        int n = nmea_number_digits(chunk);
+
+        if (n) {
+            int take = n;
+
+            digits = true;
+            if (significant + take > NMEA_NUMBER_DIGITS) {
+                // Целая часть не помещается
+                if (fraction < 0)
+                    return NULL;
+                take = NMEA_NUMBER_DIGITS - significant;
+            }
+            if (fraction >= 0 && decimals >= 0 && fraction + take > decimals)
+                take = decimals - fraction;
+
+            if (take > 0) {
+                v = v * nmea_pow10[take] + nmea_number_value(chunk, take);
+                significant += take;
+                if (fraction >= 0)
+                    fraction += take;
+            }
+            s += n;
+            if (n == 8)
+                continue;
+        }
+
+        if (*s == '.' && fraction < 0) {
+            fraction = 0;
+            whole = v;
+            s++;
+            continue;
+        }
+        break;
+    }
+
+    p->v = v;
+    p->whole = fraction < 0 ? v : whole;
+    p->fraction = fraction;
+    p->significant = significant;
+    p->sign = sign;
+    p->digits = digits;
+    return s;
+}
+
+const char *nmea_number_decimal(const char *s, int decimals, int64_t *value, int64_t *scale)
+{
+    struct nmea_number_parts p;
+
+    s = nmea_number_parse(s, decimals, &p);
+    if (!s)
+        return NULL;
+
+    if (!p.digits) {
+        if (p.sign || p.fraction >= 0)
+            return NULL;
+        *value = 0;
+        *scale = 0;
+        return s;
+    }
+
+    *value = p.sign < 0 ? -p.v : p.v;
+    *scale = nmea_pow10[p.fraction > 0 ? p.fraction : 0];
+    return s;
+}
+
+const char *nmea_number_fixed(const char *s, int decimals, int64_t *value)
+{
+    struct nmea_number_parts p;
+
+    if (decimals < 0 || decimals > NMEA_NUMBER_DIGITS)
+        return NULL;
+    s = nmea_number_parse(s, decimals, &p);
+    if (!s || !p.digits)
+        return NULL;
+
+    // Дополнение до decimals знаков умножением, без деления на scale
+    int pad = decimals - (p.fraction > 0 ? p.fraction : 0);
+    if (p.significant + pad > NMEA_NUMBER_DIGITS)
+        return NULL;
+
+    int64_t v = p.v * nmea_pow10[pad];
+    *value = p.sign < 0 ? -v : v;
+    return s;
+}
+
+const char *nmea_number_coord(const char *s, int decimals, int64_t *value)
+{
+    struct nmea_number_parts p;
+
+    if (decimals < 0 || decimals > NMEA_NUMBER_COORD_DECIMALS)
+        return NULL;
+    s = nmea_number_parse(s, decimals, &p);
+    if (!s || !p.digits || p.whole >= 100000)
+        return NULL;
+
+    // Минуты в 10^-decimals: целые из ddmm, дробь дополняется до decimals
+    int fraction = p.fraction > 0 ? p.fraction : 0;
+    int64_t unit = nmea_pow10[decimals];
+    int64_t minutes = (p.whole % 100) * unit + (p.v - p.whole * nmea_pow10[fraction]) * nmea_pow10[decimals - fraction];
+    int64_t v = p.whole / 100 * unit + (minutes + 30) / 60;
+
+    *value = p.sign < 0 ? -v : v;
+    return s;
+}
+
+const char *nmea_number_int(const char *s, int *value)
+{
+    int64_t v = 0;
+    int sign = 1;
+    bool digits = false;
+
+    if (*s == '+' || *s == '-')
+        sign = (*s++ == '-') ? -1 : 1;
+
+    for (;;) {
+        uint64_t chunk = nmea_number_load(s);
+        int n = nmea_number_digits(chunk);
+        if (!n)
+            break;
+
+        digits = true;
+        if (v <= INT_MAX)
+            v = v * nmea_pow10[n] + nmea_number_value(chunk, n);
+        s += n;
+        if (n < 8)
+            break;
+    }
+
+    if (!digits)
+        return NULL;
+
+    if (v > INT_MAX)
+        v = INT_MAX;
+    *value = (int) (sign * v);
+    return s;
+}
+
+const char *nmea_number_time(const char *s, struct nmea_time *time_)
+{
+    uint64_t chunk = nmea_number_load(s);
+    int microseconds = 0;
+
+    if (nmea_number_digits(chunk) < 6)
+        return NULL;
+
+    time_->hours = nmea_number_pair(chunk, 0);
+    time_->minutes = nmea_number_pair(chunk, 2);
+    time_->seconds = nmea_number_pair(chunk, 4);
+    s += 6;
+
+    // Дробная часть секунд, до микросекунд
+    if (*s == '.') {
+        s++;
+        chunk = nmea_number_load(s);
+        int n = nmea_number_digits(chunk);
+        if (n > 6)
+            n = 6;
+        if (n) {
+            microseconds = (int) (nmea_number_value(chunk, n) * nmea_pow10[6 - n]);
+            s += n;
+        }
+    }
+
+    time_->microseconds = microseconds;
+    return s;
+}
+
+const char *nmea_number_date(const char *s, struct nmea_date *date)
+{
+    uint64_t chunk = nmea_number_load(s);
+
+    if (nmea_number_digits(chunk) < 6)
+        return NULL;
+
+    date->day = nmea_number_pair(chunk, 0);
+    date->month = nmea_number_pair(chunk, 2);
+    date->year = nmea_number_pair(chunk, 4);
+    return s + 6;
+}
@@ -0,0 +1,65 @@
+#ifndef NMEA_NUMBER_H
+#define NMEA_NUMBER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+//------------------- DEFINES -----------------------------
+#include "nmea.h"
+
+#define NMEA_NUMBER_DIGITS			18	// значащих цифр в int64_t без переполнения
+#define NMEA_NUMBER_COORD_DECIMALS	9	// знаков дроби градуса в nmea_number_coord
+
+
+//------------------- FUNCTIONS ---------------------------
+/**
+ * Десятичное число "[+-]ddd[.ddd]" в фиксированную точку: value / scale.
+ * Цифры разбираются блоками по 8 (SWAR). Сохраняется не более
+ * NMEA_NUMBER_DIGITS значащих цифр и не более decimals знаков после
+ * точки (decimals < 0 - без ограничения), лишние дробные цифры отбрасываются.
+ * Нет ни одной цифры, знака или точки - *scale = 0.
+ * Возвращает конец числа, NULL при переполнении целой части или
+ * знаке/точке без цифр
+ */
+const char *nmea_number_decimal(const char *s, int decimals, int64_t *value, int64_t *scale);
+
+/**
+ * Десятичное число сразу в целое value * 10^decimals (0..NMEA_NUMBER_DIGITS):
+ * дробь дополняется умножением, лишние знаки отбрасываются.
+ * Возвращает конец числа, NULL если нет цифр или при переполнении
+ */
+const char *nmea_number_fixed(const char *s, int decimals, int64_t *value);
+
+/**
+ * Координата "[+-]dddmm.mmmm" сразу в 10^-decimals градуса
+ * (0..NMEA_NUMBER_COORD_DECIMALS) с округлением минут к ближайшему.
+ * Возвращает конец числа, NULL если нет цифр или градусов больше 999
+ */
+const char *nmea_number_coord(const char *s, int decimals, int64_t *value);
+
+/**
+ * Целое "[+-]ddd". Значение ограничивается диапазоном int.
+ * Возвращает конец числа, NULL если нет цифр
+ */
+const char *nmea_number_int(const char *s, int *value);
+
+/**
+ * Время "ччммсс[.ffffff]" без проверки диапазонов, дробь до микросекунд.
+ * Возвращает конец разобранной части, NULL если нет 6 цифр
+ */
+const char *nmea_number_time(const char *s, struct nmea_time *time_);
+
+/**
+ * Дата "ддммгг" без проверки диапазонов.
+ * Возвращает конец даты, NULL если нет 6 цифр
+ */
+const char *nmea_number_date(const char *s, struct nmea_date *date);
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif /* NMEA_NUMBER_H */
@@ -0,0 +1,295 @@
+#include "nmea_replay.h"
+
+
+
+//------------------- DEFINES -----------------------------
+#include <pthread.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define NMEA_REPLAY_WINDOW			2	// блоков в работе на поток
+
+
+//------------------- VARIABLES ------------------------
+struct nmea_replay_slot {
+	struct nmea_sentence *frames;
+	uint64_t *offsets;
+	size_t count;
+	size_t capacity;
+	uint64_t invalid;
+	bool ready;
+	bool failed;
+};
+
+struct nmea_replay {
+	const char *buf;
+	size_t len;
+	bool strict;
+
+	size_t *bounds;			// границы блоков, nchunks + 1
+	size_t nchunks;
+	struct nmea_replay_slot *slots;	// блок k -> slots[k % window]
+	size_t window;
+
+	size_t next;			// следующий блок для разбора
+	size_t delivered;		// блоков отдано вызывающему
+	bool stop;
+
+	pthread_mutex_t lock;
+	pthread_cond_t ready;
+	pthread_cond_t space;
+};
+
+
+//------------------- FUNCTIONS ------------------------
+static bool nmea_replay_reserve(struct nmea_replay_slot *slot)
+{
+    if (slot->count < slot->capacity)
+        return true;
+
+    size_t capacity = slot->capacity ? slot->capacity * 2 : 4096;
+    struct nmea_sentence *frames = realloc(slot->frames, capacity * sizeof(*frames));
+    if (!frames)
+        return false;
+    slot->frames = frames;
+    uint64_t *offsets = realloc(slot->offsets, capacity * sizeof(*offsets));
+    if (!offsets)
+        return false;
+    slot->offsets = offsets;
+    slot->capacity = capacity;
+    return true;
+}
+
+static bool nmea_replay_parse(struct nmea_replay *replay, struct nmea_replay_slot *slot, size_t begin, size_t end)
+{
+    const char *buf = replay->buf;
+    size_t pos = begin;
+
+    slot->count = 0;
+    slot->invalid = 0;
+    while (pos < end) {
+        const char *line = buf + pos;
+        const char *eol = memchr(line, '\n', end - pos);
+        size_t line_end = eol ? (size_t) (eol - buf) + 1 : end;
+        const char *start = memchr(line, '$', line_end - pos);
+
+        if (start) {
+            if (!nmea_replay_reserve(slot))
+                return false;
+
+            struct nmea_sentence *frame = &slot->frames[slot->count];
+            const char *next;
+            bool ok;
+
+            if (eol) {
+                ok = nmea_parse_line(frame, start, replay->strict, &next) != NMEA_INVALID
+                  && next == buf + line_end;
+            } else {
+                // Последняя строка без '\n' - за ней может не быть '\0'
+                char tmp[NMEA_MAX_LENGTH + 4];
+                size_t n = (size_t) (buf + line_end - start);
+                ok = n < sizeof(tmp);
+                if (ok) {
+                    memcpy(tmp, start, n);
+                    tmp[n] = '\0';
+                    ok = nmea_parse_any(frame, tmp, replay->strict) != NMEA_INVALID;
+                }
+            }
+
+            if (ok)
+                slot->offsets[slot->count++] = (uint64_t) (start - buf);
+            else
+                slot->invalid++;
+        }
+        pos = line_end;
+    }
+
+    return true;
+}
+
+static void *nmea_replay_worker(void *arg)
+{
+    struct nmea_replay *replay = arg;
+
+    pthread_mutex_lock(&replay->lock);
+    for (;;) {
+        while (!replay->stop && replay->next < replay->nchunks &&
+               replay->next >= replay->delivered + replay->window)
+            pthread_cond_wait(&replay->space, &replay->lock);
+        if (replay->stop || replay->next >= replay->nchunks)
+            break;
+
+        size_t k = replay->next++;
+        struct nmea_replay_slot *slot = &replay->slots[k % replay->window];
+        pthread_mutex_unlock(&replay->lock);
+
+        bool ok = nmea_replay_parse(replay, slot, replay->bounds[k], replay->bounds[k + 1]);
+
+        pthread_mutex_lock(&replay->lock);
+        slot->failed = !ok;
+        slot->ready = true;
+        pthread_cond_broadcast(&replay->ready);
+    }
+    pthread_mutex_unlock(&replay->lock);
+
+    return NULL;
+}
+
+// Границы блоков: номинальный размер, продленный до конца строки
+static size_t nmea_replay_bounds(const char *buf, size_t len, size_t chunk, size_t *bounds)
+{
+    size_t n = 0;
+
+    bounds[0] = 0;
+    while (bounds[n] < len) {
+        size_t target = bounds[n] + chunk;
+        if (target >= len) {
+            bounds[++n] = len;
+            break;
+        }
+        const char *eol = memchr(buf + target, '\n', len - target);
+        bounds[++n] = eol ? (size_t) (eol - buf) + 1 : len;
+    }
+
+    return n;
+}
+
+static double nmea_replay_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+int nmea_replay_buffer(const char *buf, size_t len, const struct nmea_replay_options *options,
+                       nmea_replay_cb cb, void *ctx, struct nmea_replay_stats *stats)
+{
+    struct nmea_replay replay;
+    struct nmea_replay_stats total = {0, 0, 0, 0.0};
+    size_t chunk = options && options->chunk_size ? options->chunk_size : NMEA_REPLAY_CHUNK;
+    long threads = options && options->threads > 0 ? options->threads : sysconf(_SC_NPROCESSORS_ONLN);
+    double start = nmea_replay_now();
+    int result = 0;
+
+    if (threads < 1)
+        threads = 1;
+
+    memset(&replay, 0, sizeof(replay));
+    replay.buf = buf;
+    replay.len = len;
+    replay.strict = options && options->strict;
+    replay.bounds = malloc((len / chunk + 2) * sizeof(*replay.bounds));
+    if (!replay.bounds)
+        return -1;
+    replay.nchunks = nmea_replay_bounds(buf, len, chunk, replay.bounds);
+    if ((size_t) threads > replay.nchunks)
+        threads = replay.nchunks ? (long) replay.nchunks : 1;
+    replay.window = (size_t) threads * NMEA_REPLAY_WINDOW;
+    replay.slots = calloc(replay.window, sizeof(*replay.slots));
+    pthread_t *workers = calloc((size_t) threads, sizeof(*workers));
+    if (!replay.slots || !workers) {
+        free(replay.bounds);
+        free(replay.slots);
+        free(workers);
+        return -1;
+    }
+
+    pthread_mutex_init(&replay.lock, NULL);
+    pthread_cond_init(&replay.ready, NULL);
+    pthread_cond_init(&replay.space, NULL);
+
+    long started = 0;
+    for (; started < threads; started++)
+        if (pthread_create(&workers[started], NULL, nmea_replay_worker, &replay))
+            break;
+    if (!started) {
+        result = -1;
+        replay.stop = true;
+    }
+
+    // Выдача результатов строго по порядку блоков
+    for (size_t k = 0; k < replay.nchunks && !replay.stop; k++) {
+        struct nmea_replay_slot *slot = &replay.slots[k % replay.window];
+
+        pthread_mutex_lock(&replay.lock);
+        while (!slot->ready)
+            pthread_cond_wait(&replay.ready, &replay.lock);
+        pthread_mutex_unlock(&replay.lock);
+
+        if (slot->failed) {
+            errno = ENOMEM;
+            result = -1;
+            break;
+        }
+
+        total.bytes += replay.bounds[k + 1] - replay.bounds[k];
+        total.sentences += slot->count;
+        total.invalid += slot->invalid;
+        bool more = !cb || !slot->count || cb(ctx, slot->frames, slot->offsets, slot->count);
+
+        pthread_mutex_lock(&replay.lock);
+        slot->ready = false;
+        replay.delivered++;
+        if (!more)
+            replay.stop = true;
+        pthread_cond_broadcast(&replay.space);
+        pthread_mutex_unlock(&replay.lock);
+    }
+
+    pthread_mutex_lock(&replay.lock);
+    replay.stop = true;
+    pthread_cond_broadcast(&replay.space);
+    pthread_mutex_unlock(&replay.lock);
+    for (long i = 0; i < started; i++)
+        pthread_join(workers[i], NULL);
+
+    pthread_cond_destroy(&replay.space);
+    pthread_cond_destroy(&replay.ready);
+    pthread_mutex_destroy(&replay.lock);
+    for (size_t i = 0; i < replay.window; i++) {
+        free(replay.slots[i].frames);
+        free(replay.slots[i].offsets);
+    }
+    free(replay.slots);
+    free(replay.bounds);
+    free(workers);
+
+    total.seconds = nmea_replay_now() - start;
+    if (stats)
+        *stats = total;
+    return result;
+}
+
+int nmea_replay_file(const char *path, const struct nmea_replay_options *options,
+                     nmea_replay_cb cb, void *ctx, struct nmea_replay_stats *stats)
+{
+    struct stat st;
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return -1;
+    if (fstat(fd, &st) < 0) {
+        close(fd);
+        return -1;
+    }
+
+    size_t len = (size_t) st.st_size;
+    if (!len) {
+        close(fd);
+        return nmea_replay_buffer("", 0, options, cb, ctx, stats);
+    }
+
+    void *map = mmap(NULL, len, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED)
+        return -1;
+    madvise(map, len, MADV_WILLNEED);
+
+    int result = nmea_replay_buffer(map, len, options, cb, ctx, stats);
+
+    int saved = errno;
+    munmap(map, len);
+    errno = saved;
+    return result;
+}
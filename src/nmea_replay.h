@@ -0,0 +1,57 @@
+#ifndef NMEA_REPLAY_H
+#define NMEA_REPLAY_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+//------------------- DEFINES -----------------------------
+#include "nmea.h"
+
+#define NMEA_REPLAY_CHUNK			(4 << 20)	// размер блока по умолчанию
+
+
+//------------------- VARIABLES ---------------------------
+struct nmea_replay_options {
+	int threads;			// 0 - по количеству процессоров
+	size_t chunk_size;		// 0 - NMEA_REPLAY_CHUNK
+	bool strict;			// контрольная сумма обязательна
+};
+
+struct nmea_replay_stats {
+	uint64_t bytes;			// обработано байт
+	uint64_t sentences;		// разобрано предложений (включая NMEA_UNKNOWN)
+	uint64_t invalid;		// строк с ошибками
+	double seconds;			// время разбора
+};
+
+/**
+ * Результаты одного блока в порядке файла. offsets[i] - смещение
+ * предложения frames[i] от начала данных.
+ * Возвращает false для остановки разбора
+ */
+typedef bool (*nmea_replay_cb)(void *ctx, const struct nmea_sentence *frames, const uint64_t *offsets, size_t count);
+
+//------------------- FUNCTIONS ---------------------------
+/**
+ * Параллельный разбор буфера. Буфер делится на блоки по границам строк,
+ * блоки разбираются пулом потоков, cb вызывается в потоке вызывающего
+ * строго в порядке блоков.
+ * Возвращает 0 при успехе, -1 при ошибке (errno)
+ */
+int nmea_replay_buffer(const char *buf, size_t len, const struct nmea_replay_options *options,
+                       nmea_replay_cb cb, void *ctx, struct nmea_replay_stats *stats);
+
+/**
+ * То же для файла, отображенного в память (mmap)
+ */
+int nmea_replay_file(const char *path, const struct nmea_replay_options *options,
+                     nmea_replay_cb cb, void *ctx, struct nmea_replay_stats *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif /* NMEA_REPLAY_H */
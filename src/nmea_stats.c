@@ -0,0 +1,151 @@
+#include "nmea_stats.h"
+
+
+
+//------------------- DEFINES -----------------------------
+#if NMEA_STATS
+#include <pthread.h>
+#endif
+
+
+//------------------- VARIABLES ------------------------
+static const char *const nmea_reject_names[NMEA_REJECTS] = {
+    "format", "length", "checksum", "type", "fields", "direction",
+    "float", "int", "time", "date", "range", "decoder",
+};
+
+#if NMEA_STATS
+NMEA_THREAD_LOCAL struct nmea_stats_thread *nmea_stats_self;
+
+// Все выделенные блоки, только добавление в начало. Блок завершенного
+// потока обнуляется и попадает в nmea_stats_free для следующего потока
+static struct nmea_stats_thread *nmea_stats_threads;
+static struct nmea_stats_thread *nmea_stats_free;
+static unsigned nmea_stats_live;
+
+// Счетчики завершенных потоков
+static struct nmea_stats_thread nmea_stats_retired;
+
+// Общий блок, если память для потока не выделилась: атомарное сложение
+static struct nmea_stats_thread nmea_stats_shared = {.shared = true};
+
+static pthread_mutex_t nmea_stats_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t nmea_stats_once = PTHREAD_ONCE_INIT;
+static pthread_key_t nmea_stats_key;
+static bool nmea_stats_keyed;
+#endif
+
+
+//------------------- FUNCTIONS ------------------------
+const char *nmea_reject_name(enum nmea_reject reason)
+{
+    if ((unsigned) reason >= NMEA_REJECTS)
+        return "unknown";
+    return nmea_reject_names[reason];
+}
+
+#if NMEA_STATS
+uint64_t nmea_stats_now(void)
+{
+    struct timespec ts;
+
+#ifdef _WIN32
+    timespec_get(&ts, TIME_UTC);
+#else
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+#endif
+    return (uint64_t) ts.tv_sec * 1000000000u + (uint64_t) ts.tv_nsec;
+}
+
+static void nmea_stats_move(uint64_t *dst, uint64_t *src, size_t n)
+{
+    for (size_t i = 0; i < n; i++) {
+        __atomic_fetch_add(&dst[i], src[i], __ATOMIC_RELAXED);
+        __atomic_store_n(&src[i], 0, __ATOMIC_RELAXED);
+    }
+}
+
+// Завершение потока: счетчики в nmea_stats_retired, блок в nmea_stats_free
+static void nmea_stats_detach(void *arg)
+{
+    struct nmea_stats_thread *t = arg;
+
+    pthread_mutex_lock(&nmea_stats_lock);
+    nmea_stats_move(nmea_stats_retired.sentences, t->sentences, NMEA_STATS_TYPES);
+    nmea_stats_move(nmea_stats_retired.bytes, t->bytes, NMEA_STATS_TYPES);
+    nmea_stats_move(nmea_stats_retired.rejects, t->rejects, NMEA_REJECTS);
+    nmea_stats_move(&nmea_stats_retired.latency[0][0], &t->latency[0][0], NMEA_STATS_TYPES * NMEA_STATS_BUCKETS);
+    t->tick = 0;
+    t->reuse = nmea_stats_free;
+    nmea_stats_free = t;
+    __atomic_store_n(&nmea_stats_live, nmea_stats_live - 1, __ATOMIC_RELAXED);
+    pthread_mutex_unlock(&nmea_stats_lock);
+
+    // Разбор из деструкторов других ключей получит новый блок
+    nmea_stats_self = NULL;
+}
+
+static void nmea_stats_key_create(void)
+{
+    nmea_stats_keyed = pthread_key_create(&nmea_stats_key, nmea_stats_detach) == 0;
+}
+
+struct nmea_stats_thread *nmea_stats_attach(void)
+{
+    struct nmea_stats_thread *t;
+
+    pthread_once(&nmea_stats_once, nmea_stats_key_create);
+    if (!nmea_stats_keyed) {
+        nmea_stats_self = &nmea_stats_shared;
+        return nmea_stats_self;
+    }
+
+    pthread_mutex_lock(&nmea_stats_lock);
+    t = nmea_stats_free;
+    if (t)
+        nmea_stats_free = t->reuse;
+    else if ((t = calloc(1, sizeof(*t))) != NULL) {
+        t->next = nmea_stats_threads;
+        __atomic_store_n(&nmea_stats_threads, t, __ATOMIC_RELEASE);
+    }
+    if (t && pthread_setspecific(nmea_stats_key, t)) {
+        t->reuse = nmea_stats_free;
+        nmea_stats_free = t;
+        t = NULL;
+    }
+    if (t)
+        __atomic_store_n(&nmea_stats_live, nmea_stats_live + 1, __ATOMIC_RELAXED);
+    pthread_mutex_unlock(&nmea_stats_lock);
+
+    nmea_stats_self = t ? t : &nmea_stats_shared;
+    return nmea_stats_self;
+}
+
+static void nmea_stats_load(uint64_t *dst, const uint64_t *src, size_t n)
+{
+    for (size_t i = 0; i < n; i++)
+        dst[i] += __atomic_load_n(&src[i], __ATOMIC_RELAXED);
+}
+
+static void nmea_stats_sum(struct nmea_stats *stats, const struct nmea_stats_thread *t)
+{
+    nmea_stats_load(stats->sentences, t->sentences, NMEA_STATS_TYPES);
+    nmea_stats_load(stats->bytes, t->bytes, NMEA_STATS_TYPES);
+    nmea_stats_load(stats->rejects, t->rejects, NMEA_REJECTS);
+    nmea_stats_load(&stats->latency[0][0], &t->latency[0][0], NMEA_STATS_TYPES * NMEA_STATS_BUCKETS);
+}
+#endif
+
+void nmea_stats_snapshot(struct nmea_stats *stats)
+{
+    memset(stats, 0, sizeof(*stats));
+
+#if NMEA_STATS
+    stats->enabled = true;
+    stats->threads = __atomic_load_n(&nmea_stats_live, __ATOMIC_RELAXED);
+    for (const struct nmea_stats_thread *t = __atomic_load_n(&nmea_stats_threads, __ATOMIC_ACQUIRE); t; t = t->next)
+        nmea_stats_sum(stats, t);
+    nmea_stats_sum(stats, &nmea_stats_retired);
+    nmea_stats_sum(stats, &nmea_stats_shared);
+#endif
+}
@@ -0,0 +1,156 @@
+#ifndef NMEA_STATS_H
+#define NMEA_STATS_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+//------------------- DEFINES -----------------------------
+#include "nmea.h"
+
+// Счетчики в горячем пути разбора. По умолчанию выключены и не дают
+// ни одной инструкции: -DNMEA_STATS=1 (cmake -DNMEA_ENABLE_STATS=ON)
+#ifndef NMEA_STATS
+#define NMEA_STATS					0
+#endif
+
+#define NMEA_STATS_TYPES			(NMEA_SENTENCE_USER + NMEA_REGISTRY_MAX + 1)	// индекс id + 1
+#define NMEA_STATS_BUCKETS			24	// гистограмма: интервал k - [2^k, 2^(k+1)) нс
+#define NMEA_STATS_SAMPLE			64	// время измеряется у каждого N-го разбора, степень двойки
+
+#if NMEA_STATS && !defined(__GNUC__)
+#error "NMEA_STATS requires GCC/Clang atomics and __thread"
+#endif
+
+
+//------------------- VARIABLES ---------------------------
+/**
+ * Причина отказа в разборе или проверке
+ */
+enum nmea_reject {
+	NMEA_REJECT_FORMAT = 0,		// нет '$', мусор после конца строки
+	NMEA_REJECT_LENGTH,		// длиннее NMEA_MAX_LENGTH
+	NMEA_REJECT_CHECKSUM,		// не совпала, неверная или отсутствует при strict
+	NMEA_REJECT_TYPE,		// неверный адрес или другой тип для nmea_parse_<тип>
+	NMEA_REJECT_FIELDS,		// не хватает полей
+	NMEA_REJECT_DIRECTION,		// 'd': не N/S/E/W
+	NMEA_REJECT_FLOAT,		// 'f': не число или переполнение
+	NMEA_REJECT_INT,		// 'i': не число или переполнение
+	NMEA_REJECT_TIME,		// 'T'
+	NMEA_REJECT_DATE,		// 'D'
+	NMEA_REJECT_RANGE,		// единицы или значение вне диапазона
+	NMEA_REJECT_DECODER,		// отказ зарегистрированного декодера
+	NMEA_REJECTS
+};
+
+/**
+ * Сумма счетчиков всех потоков. Строки sentences/bytes/latency - по типу
+ * результата, индекс id + 1 (0 - NMEA_INVALID). Около 20 КБ
+ */
+struct nmea_stats {
+	bool enabled;			// библиотека собрана с NMEA_STATS
+	unsigned threads;		// работающих потоков, вызывавших разбор
+	uint64_t sentences[NMEA_STATS_TYPES];	// вызовов nmea_parse_*
+	uint64_t bytes[NMEA_STATS_TYPES];	// со "*hh" и концом строки (nmea_parse_<тип> - без конца)
+	uint64_t rejects[NMEA_REJECTS];		// по первой ошибке, в том числе nmea_check/nmea_scan
+	uint64_t latency[NMEA_STATS_TYPES][NMEA_STATS_BUCKETS];	// выборка каждого NMEA_STATS_SAMPLE-го
+};
+
+/**
+ * Счетчики одного потока: пишет только владелец, без атомарных
+ * операций чтения-записи. После завершения потока счетчики переносятся
+ * в общую сумму, блок достается следующему потоку
+ */
+struct nmea_stats_thread {
+	struct nmea_stats_thread *next;		// все блоки
+	struct nmea_stats_thread *reuse;	// свободные блоки
+	bool shared;			// общий блок нескольких потоков
+	uint32_t tick;
+	uint64_t sentences[NMEA_STATS_TYPES];
+	uint64_t bytes[NMEA_STATS_TYPES];
+	uint64_t rejects[NMEA_REJECTS];
+	uint64_t latency[NMEA_STATS_TYPES][NMEA_STATS_BUCKETS];
+};
+
+//------------------- FUNCTIONS ---------------------------
+/**
+ * Снимок счетчиков всех потоков. Без блокировок: значения каждого
+ * счетчика целые, но снимок не атомарен как целое
+ */
+void nmea_stats_snapshot(struct nmea_stats *stats);
+
+/**
+ * Имя причины для экспорта ("checksum", "direction", ...)
+ */
+const char *nmea_reject_name(enum nmea_reject reason);
+
+#if NMEA_STATS
+// Служебное: вызывается из библиотеки
+
+extern NMEA_THREAD_LOCAL struct nmea_stats_thread *nmea_stats_self;
+
+struct nmea_stats_thread *nmea_stats_attach(void);
+uint64_t nmea_stats_now(void);
+
+// Пишет только поток-владелец: обычное сложение, атомарна лишь запись.
+// В общий блок пишут несколько потоков - атомарное сложение
+#define nmea_stats_add(t, p, v) \
+	((t)->shared ? (void) __atomic_fetch_add((p), (v), __ATOMIC_RELAXED) \
+	             : __atomic_store_n((p), *(p) + (v), __ATOMIC_RELAXED))
+
+static inline struct nmea_stats_thread *nmea_stats_thread(void)
+{
+	struct nmea_stats_thread *t = nmea_stats_self;
+	return t ? t : nmea_stats_attach();
+}
+
+static inline uint64_t nmea_stats_begin(void)
+{
+	struct nmea_stats_thread *t = nmea_stats_thread();
+	return (++t->tick & (NMEA_STATS_SAMPLE - 1)) ? 0 : nmea_stats_now();
+}
+
+static inline void nmea_stats_end(uint64_t start, enum nmea_sentence_id id, size_t len)
+{
+	struct nmea_stats_thread *t = nmea_stats_self;
+	int row = (int) id + 1;
+
+	nmea_stats_add(t, &t->sentences[row], 1);
+	nmea_stats_add(t, &t->bytes[row], len);
+	if (start) {
+		uint64_t ns = nmea_stats_now() - start;
+		int bucket = 0;
+		while (ns >>= 1)
+			bucket++;
+		if (bucket >= NMEA_STATS_BUCKETS)
+			bucket = NMEA_STATS_BUCKETS - 1;
+		nmea_stats_add(t, &t->latency[row][bucket], 1);
+	}
+}
+
+// Отказ по причине reason, всегда false
+static inline bool nmea_reject(enum nmea_reject reason)
+{
+	struct nmea_stats_thread *t = nmea_stats_thread();
+
+	nmea_stats_add(t, &t->rejects[reason], 1);
+	return false;
+}
+
+#define NMEA_STATS_REJECT(reason)	((void) nmea_reject(reason))
+#define NMEA_STATS_BEGIN(t)			uint64_t t = nmea_stats_begin()
+#define NMEA_STATS_END(t, id, len)	nmea_stats_end((t), (id), (len))
+#else
+#define nmea_reject(reason)			false
+#define NMEA_STATS_REJECT(reason)	((void) 0)
+#define NMEA_STATS_BEGIN(t)
+#define NMEA_STATS_END(t, id, len)	((void) 0)
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif /* NMEA_STATS_H */
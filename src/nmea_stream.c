@@ -0,0 +1,133 @@
+#include "nmea_stream.h"
+
+
+
+//------------------- FUNCTIONS ------------------------
+void nmea_stream_init(struct nmea_stream *stream)
+{
+    stream->head = 0;
+    stream->tail = 0;
+    stream->scan = 0;
+    stream->in_sentence = false;
+    stream->sentences = 0;
+    stream->dropped = 0;
+}
+
+char *nmea_stream_wbuf(struct nmea_stream *stream, size_t *len)
+{
+    size_t index = stream->head & NMEA_STREAM_MASK;
+    size_t space = nmea_stream_space(stream);
+
+    if (space > NMEA_STREAM_SIZE - index)
+        space = NMEA_STREAM_SIZE - index;
+
+    *len = space;
+    return stream->buf + index;
+}
+
+void nmea_stream_commit(struct nmea_stream *stream, size_t len)
+{
+    size_t index = stream->head & NMEA_STREAM_MASK;
+
+    // Зеркало начала кольца в хвосте буфера
+    if (index < NMEA_STREAM_MIRROR) {
+        size_t n = NMEA_STREAM_MIRROR - index;
+        if (n > len)
+            n = len;
+        memcpy(stream->buf + NMEA_STREAM_SIZE + index, stream->buf + index, n);
+    }
+
+    stream->head += len;
+}
+
+size_t nmea_stream_push(struct nmea_stream *stream, const void *data, size_t len)
+{
+    const char *src = data;
+    size_t total = 0;
+
+    while (total < len) {
+        size_t space;
+        char *dst = nmea_stream_wbuf(stream, &space);
+        if (!space)
+            break;
+        if (space > len - total)
+            space = len - total;
+        memcpy(dst, src + total, space);
+        nmea_stream_commit(stream, space);
+        total += space;
+    }
+
+    return total;
+}
+
+static inline void nmea_stream_drop(struct nmea_stream *stream, size_t pos)
+{
+    stream->dropped++;
+    stream->in_sentence = false;
+    stream->scan = pos;
+    stream->tail = pos;
+}
+
+bool nmea_stream_next(struct nmea_stream *stream, struct nmea_span *sentence)
+{
+    while (stream->scan < stream->head) {
+        size_t index = stream->scan & NMEA_STREAM_MASK;
+        size_t n = stream->head - stream->scan;
+        if (n > NMEA_STREAM_SIZE - index)
+            n = NMEA_STREAM_SIZE - index;
+        const char *p = stream->buf + index;
+
+        // Поиск начала предложения, все до '$' пропускается
+        if (!stream->in_sentence) {
+            const char *start = memchr(p, '$', n);
+            if (!start) {
+                stream->scan += n;
+                stream->tail = stream->scan;
+                continue;
+            }
+            stream->tail = stream->scan + (size_t) (start - p);
+            stream->scan = stream->tail + 1;
+            stream->in_sentence = true;
+            continue;
+        }
+
+        // Поиск конца строки
+        size_t i;
+        for (i = 0; i < n; i++) {
+            unsigned char c = p[i];
+            size_t pos = stream->scan + i;
+
+            if (c == '\r' || c == '\n') {
+                size_t len = pos - stream->tail;
+                char *data = stream->buf + (stream->tail & NMEA_STREAM_MASK);
+
+                // Конец строки уже обработан, на его место ставится '\0'
+                data[len] = '\0';
+                sentence->data = data;
+                sentence->len = len;
+
+                stream->in_sentence = false;
+                stream->scan = pos + 1;
+                stream->tail = stream->scan;
+                stream->sentences++;
+                return true;
+            }
+            if (c == '$') {
+                // Начало нового предложения до конца текущего
+                stream->dropped++;
+                stream->tail = pos;
+                stream->scan = pos + 1;
+                break;
+            }
+            // Граница длины как в nmea_check(): NMEA_MAX_LENGTH и "*hh"
+            if (c < 0x20 || c > 0x7e || pos - stream->tail >= NMEA_MAX_LENGTH + 3) {
+                nmea_stream_drop(stream, pos + 1);
+                break;
+            }
+        }
+        if (i == n)
+            stream->scan += n;
+    }
+
+    return false;
+}
@@ -0,0 +1,77 @@
+#ifndef NMEA_STREAM_H
+#define NMEA_STREAM_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+//------------------- DEFINES -----------------------------
+#include "nmea.h"
+
+#define NMEA_STREAM_SIZE			4096	// степень двойки
+#define NMEA_STREAM_MASK			(NMEA_STREAM_SIZE - 1)
+#define NMEA_STREAM_MIRROR			(NMEA_MAX_LENGTH + 4)
+
+
+//------------------- VARIABLES ---------------------------
+/**
+ * Кольцевой буфер для потока байт (serial/socket).
+ * Начало кольца зеркалируется в хвост buf, поэтому любое предложение
+ * доступно как непрерывный участок памяти без копирования.
+ * Позиции - монотонные счетчики, индекс в буфере: pos & NMEA_STREAM_MASK.
+ */
+struct nmea_stream {
+	char buf[NMEA_STREAM_SIZE + NMEA_STREAM_MIRROR];
+	size_t head;			// позиция записи
+	size_t tail;			// начало не обработанных данных
+	size_t scan;			// позиция сканирования
+	bool in_sentence;		// найден '$', ожидается конец строки
+	unsigned long sentences;	// выдано предложений
+	unsigned long dropped;		// отброшено (лишний '$', длинная строка, мусор)
+};
+
+//------------------- FUNCTIONS ---------------------------
+/**
+ * Инициализация (сброс) потока
+ */
+void nmea_stream_init(struct nmea_stream *stream);
+
+/**
+ * Свободное место в буфере
+ */
+static inline size_t nmea_stream_space(const struct nmea_stream *stream)
+{
+	return NMEA_STREAM_SIZE - (stream->head - stream->tail);
+}
+
+/**
+ * Непрерывный участок буфера для записи (например read() прямо в буфер).
+ * После записи необходимо вызвать nmea_stream_commit()
+ */
+char *nmea_stream_wbuf(struct nmea_stream *stream, size_t *len);
+
+/**
+ * Подтверждает запись len байт в участок, полученный от nmea_stream_wbuf()
+ */
+void nmea_stream_commit(struct nmea_stream *stream, size_t len);
+
+/**
+ * Копирует данные в буфер. Возвращает количество принятых байт,
+ * меньше len если буфер заполнен (нужно выбрать предложения nmea_stream_next())
+ */
+size_t nmea_stream_push(struct nmea_stream *stream, const void *data, size_t len);
+
+/**
+ * Выдает следующее полное предложение "$....*hh" без конца строки.
+ * Данные завершаются '\0' и остаются в буфере до следующей записи.
+ * Возвращает false если полных предложений больше нет
+ */
+bool nmea_stream_next(struct nmea_stream *stream, struct nmea_span *sentence);
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif /* NMEA_STREAM_H */
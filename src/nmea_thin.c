@@ -0,0 +1,269 @@
+#include "nmea_thin.h"
+#include "nmea_number.h"
+#include "nmea_coord.h"
+#include "nmea_geo.h"
+
+
+
+//------------------- DEFINES -----------------------------
+#include <math.h>
+
+#define NMEA_THIN_METERS			(NMEA_GEO_A * 3.14159265358979323846 / 180.0)	// м на градус дуги
+
+
+//------------------- FUNCTIONS ------------------------
+void nmea_thin_init(struct nmea_thin *thin, const struct nmea_thin_options *options)
+{
+    static const struct nmea_thin_options none;
+
+    memset(thin, 0, sizeof(*thin));
+    thin->options = options ? *options : none;
+    if (thin->options.window < 2 || thin->options.window > NMEA_THIN_WINDOW)
+        thin->options.window = NMEA_THIN_WINDOW;
+    thin->last = -1;
+}
+
+static inline int64_t nmea_thin_ms(const struct nmea_time *time_)
+{
+    return ((int64_t) time_->hours * 3600 + time_->minutes * 60 + time_->seconds) * 1000 + time_->microseconds / 1000;
+}
+
+// Время суток в монотонное: ближайшее к last в обе стороны, как в
+// nmea_index_time(). Запоздавшее до полуночи получается раньше last
+static inline int64_t nmea_thin_unwrap(int64_t last, int64_t ms)
+{
+    if (last < 0)
+        return ms;
+
+    int64_t t = last - last % NMEA_THIN_DAY + ms;
+    if (t < last - NMEA_THIN_DAY / 2)
+        t += NMEA_THIN_DAY;
+    else if (t > last + NMEA_THIN_DAY / 2)
+        t -= NMEA_THIN_DAY;
+    return t;
+}
+
+// Повтор времени или тот же шаг сетки, что у last
+static inline bool nmea_thin_decimated(const struct nmea_thin *thin, int64_t t)
+{
+    if (thin->last < 0)
+        return false;
+    if (t <= thin->last)
+        return true;
+    return thin->options.interval && t / thin->options.interval == thin->last / thin->options.interval;
+}
+
+bool nmea_thin_wanted(const struct nmea_thin *thin, const char *sentence)
+{
+    enum nmea_sentence_id id = nmea_sentence_type(sentence);
+    struct nmea_time time_;
+
+    if (id != NMEA_SENTENCE_RMC && id != NMEA_SENTENCE_GGA)
+        return true;
+    // Время - первое поле у обоих типов
+    const char *field = strchr(sentence, ',');
+    if (!field || !nmea_number_time(field + 1, &time_))
+        return true;
+    return !nmea_thin_decimated(thin, nmea_thin_unwrap(thin->last, nmea_thin_ms(&time_)));
+}
+
+static inline double nmea_thin_float(const struct nmea_float *f)
+{
+    return f->scale ? (double) f->value / (double) f->scale : NAN;
+}
+
+// Точка из RMC/GGA с решением и координатами
+static bool nmea_thin_point(struct nmea_thin_point *p, const struct nmea_sentence *frame)
+{
+    struct nmea_float coord[2];
+    double deg[2];
+    const struct nmea_time *time_;
+
+    switch (frame->id) {
+        case NMEA_SENTENCE_RMC:
+            if (!frame->data.rmc.valid)
+                return false;
+            time_ = &frame->data.rmc.time;
+            coord[0] = frame->data.rmc.latitude;
+            coord[1] = frame->data.rmc.longitude;
+            p->speed = nmea_thin_float(&frame->data.rmc.speed);
+            p->course = nmea_thin_float(&frame->data.rmc.course);
+            break;
+        case NMEA_SENTENCE_GGA:
+            if (frame->data.gga.fix_quality <= 0)
+                return false;
+            time_ = &frame->data.gga.time;
+            coord[0] = frame->data.gga.latitude;
+            coord[1] = frame->data.gga.longitude;
+            p->speed = NAN;
+            p->course = NAN;
+            break;
+        default:
+            return false;
+    }
+
+    if (time_->hours < 0)
+        return false;
+    nmea_coord_degrees(deg, coord, 2);
+    if (isnan(deg[0]) || isnan(deg[1]))
+        return false;
+    p->time = nmea_thin_ms(time_);
+    p->latitude = deg[0];
+    p->longitude = deg[1];
+    p->source = frame->id;
+    return true;
+}
+
+// Смещение b относительно a в метрах, локальная равнопромежуточная проекция
+static inline void nmea_thin_offset(const struct nmea_thin_point *a, const struct nmea_thin_point *b,
+                                    double cos_lat, double *x, double *y)
+{
+    double dlon = b->longitude - a->longitude;
+
+    if (dlon > 180.0)
+        dlon -= 360.0;
+    else if (dlon < -180.0)
+        dlon += 360.0;
+    *x = dlon * cos_lat * NMEA_THIN_METERS;
+    *y = (b->latitude - a->latitude) * NMEA_THIN_METERS;
+}
+
+static inline double nmea_thin_cos(double latitude)
+{
+    double s, c;
+
+    nmea_geo_sincos(latitude, &s, &c);
+    return c;
+}
+
+// Порог смещения: далеко от prev, поворот или истек keepalive
+static bool nmea_thin_moved(const struct nmea_thin *thin, const struct nmea_thin_point *p)
+{
+    const struct nmea_thin_options *o = &thin->options;
+    double x, y;
+
+    if (o->distance <= 0.0 || !thin->passed)
+        return true;
+    if (o->keepalive && p->time - thin->prev.time >= o->keepalive)
+        return true;
+    if (o->heading > 0.0 && !isnan(p->course) && !isnan(thin->prev.course)) {
+        double turn = fabs(fmod(p->course - thin->prev.course + 540.0, 360.0) - 180.0);
+        if (turn >= o->heading)
+            return true;
+    }
+
+    nmea_thin_offset(&thin->prev, p, nmea_thin_cos(thin->prev.latitude), &x, &y);
+    return x * x + y * y >= o->distance * o->distance;
+}
+
+// Квадрат расстояния от (px, py) до отрезка (ax, ay)-(bx, by)
+static inline double nmea_thin_segment(double px, double py, double ax, double ay, double bx, double by)
+{
+    double dx = bx - ax, dy = by - ay;
+    double len = dx * dx + dy * dy;
+    double k = len > 0.0 ? ((px - ax) * dx + (py - ay) * dy) / len : 0.0;
+
+    if (k < 0.0)
+        k = 0.0;
+    else if (k > 1.0)
+        k = 1.0;
+    dx = ax + k * dx - px;
+    dy = ay + k * dy - py;
+    return dx * dx + dy * dy;
+}
+
+// Дуглас-Пекер по окну без рекурсии. window[0] уже выдана,
+// последняя точка становится опорной следующего окна
+static int nmea_thin_simplify(struct nmea_thin *thin, struct nmea_thin_point *out)
+{
+    const struct nmea_thin_point *w = thin->window;
+    double x[NMEA_THIN_WINDOW], y[NMEA_THIN_WINDOW];
+    bool keep[NMEA_THIN_WINDOW] = {false};
+    int stack[2 * NMEA_THIN_WINDOW];
+    int n = thin->count, top = 0, emitted = 0;
+    double limit = thin->options.tolerance * thin->options.tolerance;
+    double cos_lat = nmea_thin_cos(w[0].latitude);
+
+    for (int i = 0; i < n; i++)
+        nmea_thin_offset(&w[0], &w[i], cos_lat, &x[i], &y[i]);
+
+    keep[n - 1] = true;
+    stack[top++] = 0;
+    stack[top++] = n - 1;
+    while (top) {
+        int last = stack[--top];
+        int first = stack[--top];
+        int far = 0;
+        double max = limit;
+
+        for (int i = first + 1; i < last; i++) {
+            double d = nmea_thin_segment(x[i], y[i], x[first], y[first], x[last], y[last]);
+            if (d > max) {
+                max = d;
+                far = i;
+            }
+        }
+        if (!far)
+            continue;
+        keep[far] = true;
+        stack[top++] = first;
+        stack[top++] = far;
+        stack[top++] = far;
+        stack[top++] = last;
+    }
+
+    for (int i = 1; i < n; i++)
+        if (keep[i])
+            out[emitted++] = w[i];
+    thin->simplified += (unsigned long) (n - 1 - emitted);
+    thin->emitted += (unsigned long) emitted;
+    thin->window[0] = thin->window[n - 1];
+    thin->count = 1;
+    return emitted;
+}
+
+int nmea_thin_push(struct nmea_thin *thin, const struct nmea_sentence *frame, struct nmea_thin_point *out)
+{
+    struct nmea_thin_point p;
+
+    if (!nmea_thin_point(&p, frame)) {
+        if (frame->id == NMEA_SENTENCE_RMC || frame->id == NMEA_SENTENCE_GGA)
+            thin->invalid++;
+        return 0;
+    }
+
+    p.time = nmea_thin_unwrap(thin->last, p.time);
+    if (nmea_thin_decimated(thin, p.time)) {
+        thin->decimated++;
+        return 0;
+    }
+    thin->last = p.time;
+
+    if (!nmea_thin_moved(thin, &p)) {
+        thin->stationary++;
+        return 0;
+    }
+    thin->prev = p;
+    thin->passed = true;
+
+    // Без упрощения и первая опорная точка выдаются сразу
+    if (thin->options.tolerance <= 0.0 || !thin->count) {
+        thin->window[0] = p;
+        thin->count = 1;
+        thin->emitted++;
+        out[0] = p;
+        return 1;
+    }
+
+    thin->window[thin->count++] = p;
+    if (thin->count < thin->options.window)
+        return 0;
+    return nmea_thin_simplify(thin, out);
+}
+
+int nmea_thin_flush(struct nmea_thin *thin, struct nmea_thin_point *out)
+{
+    if (thin->count < 2)
+        return 0;
+    return nmea_thin_simplify(thin, out);
+}
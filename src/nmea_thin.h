@@ -0,0 +1,90 @@
+#ifndef NMEA_THIN_H
+#define NMEA_THIN_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+//------------------- DEFINES -----------------------------
+#include "nmea.h"
+
+#define NMEA_THIN_WINDOW			64			// точек в окне упрощения, размер out
+#define NMEA_THIN_DAY				86400000	// мс в сутках
+
+
+//------------------- VARIABLES ---------------------------
+/**
+ * Ступени прореживания по порядку: сетка времени, порог смещения,
+ * упрощение Дугласа-Пекера в окне. Нулевое значение отключает ступень
+ */
+struct nmea_thin_options {
+	uint32_t interval;		// мс: не более одной точки на шаг сетки времени
+	double distance;		// м от последней прошедшей точки
+	double heading;			// градусы изменения курса RMC: точка проходит независимо от distance
+	uint32_t keepalive;		// мс: при стоянке точка проходит не реже (при distance)
+	double tolerance;		// м: допуск упрощения
+	int window;				// 2..NMEA_THIN_WINDOW точек в окне, 0 - NMEA_THIN_WINDOW
+};
+
+struct nmea_thin_point {
+	int64_t time;			// мс от полуночи первых суток, с переходом через полночь
+	double latitude;		// градусы
+	double longitude;
+	double speed;			// RMC, узлы; NaN для GGA
+	double course;			// RMC; NaN для GGA
+	enum nmea_sentence_id source;
+};
+
+/**
+ * Прореживание траектории одного приемника. Память фиксирована,
+ * задержка выдачи - не более одного окна
+ */
+struct nmea_thin {
+	struct nmea_thin_options options;
+	int64_t last;			// время последней точки после сетки, -1
+	bool passed;			// prev заполнена
+	struct nmea_thin_point prev;	// последняя точка после порога смещения
+	int count;				// точек в окне, window[0] - уже выданная опорная
+	struct nmea_thin_point window[NMEA_THIN_WINDOW];
+
+	unsigned long invalid;		// без решения или координат
+	unsigned long decimated;	// отброшено сеткой времени (и повторы времени)
+	unsigned long stationary;	// отброшено порогом смещения
+	unsigned long simplified;	// отброшено упрощением
+	unsigned long emitted;		// выдано точек
+};
+
+//------------------- FUNCTIONS ---------------------------
+/**
+ * Инициализация (сброс). options = NULL - все ступени отключены
+ */
+void nmea_thin_init(struct nmea_thin *thin, const struct nmea_thin_options *options);
+
+/**
+ * Нужно ли разбирать предложение: по типу и полю времени, без разбора
+ * остальных полей. false - RMC/GGA будет отброшено сеткой времени;
+ * остальные типы и предложения без времени - true.
+ * Для фильтра кадрового буфера (nmea_ingest_options.filter)
+ */
+bool nmea_thin_wanted(const struct nmea_thin *thin, const char *sentence);
+
+/**
+ * Добавляет разобранное предложение (nmea_parse_any()), используются
+ * RMC со статусом 'A' и GGA с fix_quality > 0. В out (NMEA_THIN_WINDOW
+ * точек) записываются выданные точки по порядку времени.
+ * Возвращает количество выданных точек
+ */
+int nmea_thin_push(struct nmea_thin *thin, const struct nmea_sentence *frame, struct nmea_thin_point *out);
+
+/**
+ * Выдает точки окна (конец данных)
+ */
+int nmea_thin_flush(struct nmea_thin *thin, struct nmea_thin_point *out);
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif /* NMEA_THIN_H */
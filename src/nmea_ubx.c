@@ -0,0 +1,496 @@
+#include "nmea_ubx.h"
+
+
+
+//------------------- DEFINES -----------------------------
+#define NMEA_UBX_SAT_BLOCK			12	// байт на спутник в NAV-SAT
+#define NMEA_UBX_SAT_USED			0x08	// flags.svUsed
+#define NMEA_UBX_DAY				86400000000LL	// мкс в сутках
+
+#define NMEA_UBX_PVT_TYPES			(NMEA_EPOCH_TYPE(NMEA_SENTENCE_RMC) | NMEA_EPOCH_TYPE(NMEA_SENTENCE_GGA) | \
+									 NMEA_EPOCH_TYPE(NMEA_SENTENCE_GSA))
+
+
+//------------------- FUNCTIONS ------------------------
+static inline uint16_t nmea_ubx_u2(const uint8_t *p)
+{
+    return (uint16_t) (p[0] | p[1] << 8);
+}
+
+static inline uint32_t nmea_ubx_u4(const uint8_t *p)
+{
+    return (uint32_t) p[0] | (uint32_t) p[1] << 8 | (uint32_t) p[2] << 16 | (uint32_t) p[3] << 24;
+}
+
+static inline int32_t nmea_ubx_i4(const uint8_t *p)
+{
+    return (int32_t) nmea_ubx_u4(p);
+}
+
+uint16_t nmea_ubx_checksum(const uint8_t *data, size_t len)
+{
+    uint8_t a = 0, b = 0;
+
+    for (size_t i = 0; i < len; i++) {
+        a += data[i];
+        b += a;
+    }
+    return (uint16_t) (a | b << 8);
+}
+
+static inline void nmea_ubx_put_u2(uint8_t *p, uint32_t v)
+{
+    p[0] = (uint8_t) v;
+    p[1] = (uint8_t) (v >> 8);
+}
+
+static inline void nmea_ubx_put_u4(uint8_t *p, uint32_t v)
+{
+    nmea_ubx_put_u2(p, v);
+    nmea_ubx_put_u2(p + 2, v >> 16);
+}
+
+size_t nmea_ubx_write(uint8_t *buf, uint8_t class_, uint8_t id, const void *payload, uint16_t len)
+{
+    uint8_t *p = buf + NMEA_UBX_HEADER;
+
+    if (len && payload != p)
+        memmove(p, payload, len);
+    buf[0] = NMEA_UBX_SYNC1;
+    buf[1] = NMEA_UBX_SYNC2;
+    buf[2] = class_;
+    buf[3] = id;
+    nmea_ubx_put_u2(buf + 4, len);
+    nmea_ubx_put_u2(p + len, nmea_ubx_checksum(buf + 2, len + 4u));
+    return len + NMEA_UBX_OVERHEAD;
+}
+
+size_t nmea_ubx_cfg_msg(uint8_t *buf, uint8_t msg_class, uint8_t msg_id, const uint8_t rates[NMEA_UBX_PORTS])
+{
+    uint8_t *p = buf + NMEA_UBX_HEADER;
+
+    p[0] = msg_class;
+    p[1] = msg_id;
+    memcpy(p + 2, rates, NMEA_UBX_PORTS);
+    return nmea_ubx_write(buf, NMEA_UBX_CLASS_CFG, NMEA_UBX_CFG_MSG, p, 2 + NMEA_UBX_PORTS);
+}
+
+size_t nmea_ubx_cfg_nmea(uint8_t *buf, enum nmea_sentence_id id, const uint8_t rates[NMEA_UBX_PORTS])
+{
+    uint8_t msg_id;
+
+    switch (id) {
+        case NMEA_SENTENCE_GGA: msg_id = NMEA_UBX_NMEA_GGA; break;
+        case NMEA_SENTENCE_GLL: msg_id = NMEA_UBX_NMEA_GLL; break;
+        case NMEA_SENTENCE_GSA: msg_id = NMEA_UBX_NMEA_GSA; break;
+        case NMEA_SENTENCE_GSV: msg_id = NMEA_UBX_NMEA_GSV; break;
+        case NMEA_SENTENCE_RMC: msg_id = NMEA_UBX_NMEA_RMC; break;
+        case NMEA_SENTENCE_VTG: msg_id = NMEA_UBX_NMEA_VTG; break;
+        case NMEA_SENTENCE_GST: msg_id = NMEA_UBX_NMEA_GST; break;
+        case NMEA_SENTENCE_ZDA: msg_id = NMEA_UBX_NMEA_ZDA; break;
+        default: return 0;
+    }
+    return nmea_ubx_cfg_msg(buf, NMEA_UBX_CLASS_NMEA, msg_id, rates);
+}
+
+size_t nmea_ubx_cfg_rate(uint8_t *buf, uint16_t meas_ms, uint16_t nav_rate, uint16_t time_ref)
+{
+    uint8_t *p = buf + NMEA_UBX_HEADER;
+
+    nmea_ubx_put_u2(p, meas_ms);
+    nmea_ubx_put_u2(p + 2, nav_rate);
+    nmea_ubx_put_u2(p + 4, time_ref);
+    return nmea_ubx_write(buf, NMEA_UBX_CLASS_CFG, NMEA_UBX_CFG_RATE, p, 6);
+}
+
+size_t nmea_ubx_cfg_prt(uint8_t *buf, uint8_t port, uint32_t baud, uint16_t in_proto, uint16_t out_proto)
+{
+    uint8_t *p = buf + NMEA_UBX_HEADER;
+
+    memset(p, 0, 20);
+    p[0] = port;
+    nmea_ubx_put_u4(p + 4, NMEA_UBX_PRT_8N1);
+    nmea_ubx_put_u4(p + 8, baud);
+    nmea_ubx_put_u2(p + 12, in_proto);
+    nmea_ubx_put_u2(p + 14, out_proto);
+    return nmea_ubx_write(buf, NMEA_UBX_CLASS_CFG, NMEA_UBX_CFG_PRT, p, 20);
+}
+
+void nmea_ubx_init(struct nmea_ubx_stream *stream)
+{
+    stream->head = 0;
+    stream->tail = 0;
+    stream->scan = 0;
+    stream->packets = 0;
+    stream->sentences = 0;
+    stream->errors = 0;
+    stream->dropped = 0;
+}
+
+uint8_t *nmea_ubx_wbuf(struct nmea_ubx_stream *stream, size_t *len)
+{
+    // Остаток - не больше одного незавершенного кадра
+    if (stream->tail) {
+        memmove(stream->buf, stream->buf + stream->tail, stream->head - stream->tail);
+        stream->head -= stream->tail;
+        stream->scan -= stream->tail;
+        stream->tail = 0;
+    }
+
+    *len = NMEA_UBX_STREAM_SIZE - stream->head;
+    return stream->buf + stream->head;
+}
+
+size_t nmea_ubx_push(struct nmea_ubx_stream *stream, const void *data, size_t len)
+{
+    size_t space;
+    uint8_t *dst = nmea_ubx_wbuf(stream, &space);
+
+    if (len > space)
+        len = space;
+    memcpy(dst, data, len);
+    nmea_ubx_commit(stream, len);
+    return len;
+}
+
+static inline void nmea_ubx_skip(struct nmea_ubx_stream *stream, size_t pos)
+{
+    stream->tail = pos;
+    stream->scan = pos;
+}
+
+// Кадр UBX в начале необработанных данных.
+// Возвращает 1 - кадр выдан, 0 - байт пропущен, -1 - нужны еще данные
+static int nmea_ubx_take(struct nmea_ubx_stream *stream, struct nmea_ubx_item *item)
+{
+    const uint8_t *p = stream->buf + stream->tail;
+    size_t n = stream->head - stream->tail;
+
+    if (n < 2)
+        return -1;
+    if (p[1] != NMEA_UBX_SYNC2) {
+        nmea_ubx_skip(stream, stream->tail + 1);
+        return 0;
+    }
+    if (n < NMEA_UBX_HEADER)
+        return -1;
+
+    size_t len = nmea_ubx_u2(p + 4);
+    if (len > NMEA_UBX_MAX_PAYLOAD) {
+        stream->errors++;
+        nmea_ubx_skip(stream, stream->tail + 1);
+        return 0;
+    }
+    if (n < len + NMEA_UBX_OVERHEAD)
+        return -1;
+
+    // Неверная сумма - синхронизация со следующего байта
+    uint16_t ck = nmea_ubx_checksum(p + 2, len + 4);
+    if (p[len + 6] != (uint8_t) ck || p[len + 7] != (uint8_t) (ck >> 8)) {
+        stream->errors++;
+        nmea_ubx_skip(stream, stream->tail + 1);
+        return 0;
+    }
+
+    item->kind = NMEA_UBX_PACKET;
+    item->data.packet.class_ = p[2];
+    item->data.packet.id = p[3];
+    item->data.packet.len = (uint16_t) len;
+    item->data.packet.payload = p + NMEA_UBX_HEADER;
+    nmea_ubx_skip(stream, stream->tail + len + NMEA_UBX_OVERHEAD);
+    stream->packets++;
+    return 1;
+}
+
+enum nmea_ubx_kind nmea_ubx_next(struct nmea_ubx_stream *stream, struct nmea_ubx_item *item)
+{
+    while (stream->tail < stream->head) {
+        uint8_t *p = stream->buf + stream->tail;
+
+        if (p[0] == NMEA_UBX_SYNC1) {
+            int ret = nmea_ubx_take(stream, item);
+            if (ret < 0)
+                return NMEA_UBX_NONE;
+            if (ret > 0)
+                return NMEA_UBX_PACKET;
+            continue;
+        }
+
+        if (p[0] != '$') {
+            // Мусор до начала строки или кадра
+            size_t i = stream->tail + 1;
+            while (i < stream->head && stream->buf[i] != '$' && stream->buf[i] != NMEA_UBX_SYNC1)
+                i++;
+            nmea_ubx_skip(stream, i);
+            continue;
+        }
+
+        // Поиск конца строки, продолжается с места прошлой остановки
+        size_t i = stream->scan > stream->tail ? stream->scan : stream->tail + 1;
+        for (; i < stream->head; i++) {
+            uint8_t c = stream->buf[i];
+
+            if (c == '\r' || c == '\n') {
+                stream->buf[i] = '\0';
+                item->kind = NMEA_UBX_NMEA;
+                item->data.sentence.data = (const char *) p;
+                item->data.sentence.len = i - stream->tail;
+                nmea_ubx_skip(stream, i + 1);
+                stream->sentences++;
+                return NMEA_UBX_NMEA;
+            }
+            // Начало кадра или новой строки до конца текущей
+            if (c == '$' || c == NMEA_UBX_SYNC1) {
+                stream->dropped++;
+                nmea_ubx_skip(stream, i);
+                break;
+            }
+            if (c < 0x20 || c > 0x7e || i - stream->tail >= NMEA_MAX_LENGTH) {
+                stream->dropped++;
+                nmea_ubx_skip(stream, i + 1);
+                break;
+            }
+        }
+        if (i == stream->head) {
+            stream->scan = i;
+            return NMEA_UBX_NONE;
+        }
+    }
+
+    return NMEA_UBX_NONE;
+}
+
+void nmea_ubx_fix_init(struct nmea_fix *fix)
+{
+    memset(fix, 0, sizeof(*fix));
+    fix->date.day = fix->date.month = fix->date.year = -1;
+    fix->time.hours = fix->time.minutes = fix->time.seconds = fix->time.microseconds = -1;
+    fix->fix_quality = fix->satellites_tracked = fix->fix_type = fix->sats_in_view = -1;
+}
+
+static void nmea_ubx_date(struct nmea_date *date, const uint8_t *p)
+{
+    date->year = nmea_ubx_u2(p);
+    date->month = p[2];
+    date->day = p[3];
+}
+
+// Поля часов UBX округлены, nano - поправка со знаком (-1e9..1e9).
+// Возвращает перенос на соседние сутки: -1, 0, 1
+static int nmea_ubx_time(struct nmea_time *time_, const uint8_t *p, int32_t nano)
+{
+    int64_t us = ((int64_t) (p[0] * 60 + p[1]) * 60 + p[2]) * 1000000 + nano / 1000;
+    int carry = 0;
+
+    if (us < 0) {
+        us += NMEA_UBX_DAY;
+        carry = -1;
+    } else if (us >= NMEA_UBX_DAY) {
+        us -= NMEA_UBX_DAY;
+        carry = 1;
+    }
+    time_->microseconds = (int) (us % 1000000);
+    us /= 1000000;
+    time_->seconds = (int) (us % 60);
+    time_->minutes = (int) (us / 60 % 60);
+    time_->hours = (int) (us / 3600);
+    return carry;
+}
+
+static int nmea_ubx_month_days(int year, int month)
+{
+    static const uint8_t days[12] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+    bool leap = year % 4 == 0 && (year % 100 != 0 || year % 400 == 0);
+
+    return days[month - 1] + (month == 2 && leap);
+}
+
+// Перенос даты на соседние сутки
+static void nmea_ubx_shift(struct nmea_date *date, int carry)
+{
+    if (date->month < 1 || date->month > 12)
+        return;
+
+    if (carry < 0 && --date->day < 1) {
+        if (--date->month < 1) {
+            date->month = 12;
+            date->year--;
+        }
+        date->day = nmea_ubx_month_days(date->year, date->month);
+    } else if (carry > 0 && ++date->day > nmea_ubx_month_days(date->year, date->month)) {
+        date->day = 1;
+        if (++date->month > 12) {
+            date->month = 1;
+            date->year++;
+        }
+    }
+}
+
+// 1e-7 градуса в ddmm.mmmmmm: минуты = frac * 60 / 1e7 = frac * 6 / 1e6
+static void nmea_ubx_coord(struct nmea_float *f, int32_t raw)
+{
+    int64_t v = raw < 0 ? -(int64_t) raw : raw;
+
+    f->value = v / 10000000 * 100000000 + v % 10000000 * 6;
+    if (raw < 0)
+        f->value = -f->value;
+    f->scale = 1000000;
+}
+
+// Качество GGA по fixType и flags
+static int nmea_ubx_quality(uint8_t fix_type, uint8_t flags)
+{
+    if (!(flags & 0x01))
+        return fix_type == 1 ? 6 : 0;
+    // carrSoln: 2 - RTK fixed, 1 - RTK float
+    switch (flags >> 6) {
+        case 2: return 4;
+        case 1: return 5;
+        default: break;
+    }
+    if (flags & 0x02)
+        return 2;
+    return fix_type == 1 ? 6 : 1;
+}
+
+bool nmea_ubx_nav_pvt(struct nmea_fix *fix, const struct nmea_ubx_packet *packet)
+{
+    const uint8_t *p = packet->payload;
+
+    if (packet->class_ != NMEA_UBX_CLASS_NAV || packet->id != NMEA_UBX_NAV_PVT ||
+        packet->len < NMEA_UBX_NAV_PVT_LEN)
+        return false;
+
+    uint8_t valid = p[11];
+    uint8_t fix_type = p[20];
+    uint8_t flags = p[21];
+    int32_t height = nmea_ubx_i4(p + 32);
+    int32_t msl = nmea_ubx_i4(p + 36);
+    int32_t speed = nmea_ubx_i4(p + 60);
+
+    // validDate, validTime
+    if (valid & 0x02) {
+        int carry = nmea_ubx_time(&fix->time, p + 8, nmea_ubx_i4(p + 16));
+        if (valid & 0x01) {
+            nmea_ubx_date(&fix->date, p + 4);
+            nmea_ubx_shift(&fix->date, carry);
+        }
+    } else if (valid & 0x01) {
+        nmea_ubx_date(&fix->date, p + 4);
+    }
+
+    fix->valid = (flags & 0x01) && fix_type >= 1 && fix_type <= 4;
+    nmea_ubx_coord(&fix->latitude, nmea_ubx_i4(p + 28));
+    nmea_ubx_coord(&fix->longitude, nmea_ubx_i4(p + 24));
+    // мм/с в узлы * 1000
+    fix->speed.value = ((int64_t) (speed < 0 ? 0 : speed) * 3600 + 926) / 1852;
+    fix->speed.scale = 1000;
+    fix->course.value = nmea_ubx_i4(p + 64);
+    fix->course.scale = 100000;
+    fix->fix_quality = nmea_ubx_quality(fix_type, flags);
+    fix->satellites_tracked = p[23];
+    fix->altitude.value = msl;
+    fix->altitude.scale = 1000;
+    fix->height.value = (int64_t) height - msl;
+    fix->height.scale = 1000;
+    fix->mode = 'A';
+    fix->fix_type = fix_type == 2 ? 2 : fix_type == 3 || fix_type == 4 ? 3 : 1;
+    fix->pdop.value = nmea_ubx_u2(p + 76);
+    fix->pdop.scale = 100;
+
+    fix->types |= NMEA_UBX_PVT_TYPES;
+    return true;
+}
+
+// Номер спутника NMEA (расширенная нумерация u-blox) по gnssId/svId
+static int nmea_ubx_sv(uint8_t gnss, uint8_t sv)
+{
+    switch (gnss) {
+        case 2: return 210 + sv;	// Galileo
+        case 3: return 400 + sv;	// BeiDou
+        case 5: return 192 + sv;	// QZSS
+        case 6: return sv == 255 ? 0 : 64 + sv;	// GLONASS
+        default: return sv;		// GPS, SBAS
+    }
+}
+
+static int nmea_ubx_sat_count(const struct nmea_ubx_packet *packet)
+{
+    if (packet->class_ != NMEA_UBX_CLASS_NAV || packet->id != NMEA_UBX_NAV_SAT || packet->len < 8)
+        return -1;
+
+    int count = packet->payload[5];
+    if (packet->len < 8 + count * NMEA_UBX_SAT_BLOCK)
+        return -1;
+    return count;
+}
+
+bool nmea_ubx_nav_sat(struct nmea_fix *fix, const struct nmea_ubx_packet *packet)
+{
+    int count = nmea_ubx_sat_count(packet);
+    int n = 0;
+
+    if (count < 0)
+        return false;
+
+    memset(fix->sats, 0, sizeof(fix->sats));
+    for (int i = 0; i < count && n < 12; i++) {
+        const uint8_t *sat = packet->payload + 8 + i * NMEA_UBX_SAT_BLOCK;
+        if (nmea_ubx_u4(sat + 8) & NMEA_UBX_SAT_USED)
+            fix->sats[n++] = nmea_ubx_sv(sat[0], sat[1]);
+    }
+    fix->sats_in_view = count;
+
+    fix->types |= NMEA_EPOCH_TYPE(NMEA_SENTENCE_GSV);
+    return true;
+}
+
+int nmea_ubx_sats(const struct nmea_ubx_packet *packet, struct nmea_sat_info *sats, int max)
+{
+    int count = nmea_ubx_sat_count(packet);
+
+    if (count < 0)
+        return -1;
+    if (count > max)
+        count = max;
+
+    for (int i = 0; i < count; i++) {
+        const uint8_t *sat = packet->payload + 8 + i * NMEA_UBX_SAT_BLOCK;
+        sats[i].nr = nmea_ubx_sv(sat[0], sat[1]);
+        sats[i].snr = sat[2];
+        sats[i].elevation = (int8_t) sat[3];
+        sats[i].azimuth = (int16_t) nmea_ubx_u2(sat + 4);
+    }
+    return count;
+}
+
+bool nmea_ubx_nav_timeutc(struct nmea_fix *fix, const struct nmea_ubx_packet *packet)
+{
+    const uint8_t *p = packet->payload;
+
+    if (packet->class_ != NMEA_UBX_CLASS_NAV || packet->id != NMEA_UBX_NAV_TIMEUTC ||
+        packet->len < NMEA_UBX_NAV_TIMEUTC_LEN)
+        return false;
+    // validUTC
+    if (!(p[19] & 0x04))
+        return false;
+
+    nmea_ubx_date(&fix->date, p + 12);
+    nmea_ubx_shift(&fix->date, nmea_ubx_time(&fix->time, p + 16, nmea_ubx_i4(p + 8)));
+
+    fix->types |= NMEA_EPOCH_TYPE(NMEA_SENTENCE_ZDA);
+    return true;
+}
+
+bool nmea_ubx_decode(struct nmea_fix *fix, const struct nmea_ubx_packet *packet)
+{
+    if (packet->class_ != NMEA_UBX_CLASS_NAV)
+        return false;
+
+    switch (packet->id) {
+        case NMEA_UBX_NAV_PVT: return nmea_ubx_nav_pvt(fix, packet);
+        case NMEA_UBX_NAV_SAT: return nmea_ubx_nav_sat(fix, packet);
+        case NMEA_UBX_NAV_TIMEUTC: return nmea_ubx_nav_timeutc(fix, packet);
+        default: return false;
+    }
+}
@@ -0,0 +1,260 @@
+#ifndef NMEA_UBX_H
+#define NMEA_UBX_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+//------------------- DEFINES -----------------------------
+#include "nmea.h"
+#include "nmea_epoch.h"
+
+#define NMEA_UBX_SYNC1				0xB5
+#define NMEA_UBX_SYNC2				0x62
+#define NMEA_UBX_HEADER				6	// sync, class, id, длина
+#define NMEA_UBX_OVERHEAD			8	// заголовок + CK_A, CK_B
+#define NMEA_UBX_MAX_PAYLOAD		4096	// NAV-SAT на 255 спутников - 3068 байт
+#define NMEA_UBX_STREAM_SIZE		8192	// не меньше NMEA_UBX_MAX_PAYLOAD + NMEA_UBX_OVERHEAD
+
+#define NMEA_UBX_CLASS_NAV			0x01
+#define NMEA_UBX_NAV_PVT			0x07
+#define NMEA_UBX_NAV_TIMEUTC		0x21
+#define NMEA_UBX_NAV_SAT			0x35
+
+#define NMEA_UBX_NAV_PVT_LEN		92
+#define NMEA_UBX_NAV_TIMEUTC_LEN	20
+
+#define NMEA_UBX_CLASS_CFG			0x06
+#define NMEA_UBX_CFG_PRT			0x00
+#define NMEA_UBX_CFG_MSG			0x01
+#define NMEA_UBX_CFG_RATE			0x08
+
+#define NMEA_UBX_CFG_MSG_LEN		16	// кадр целиком
+#define NMEA_UBX_CFG_RATE_LEN		14
+#define NMEA_UBX_CFG_PRT_LEN		28
+
+// Класс и номера сообщений NMEA для CFG-MSG
+#define NMEA_UBX_CLASS_NMEA			0xF0
+#define NMEA_UBX_NMEA_GGA			0x00
+#define NMEA_UBX_NMEA_GLL			0x01
+#define NMEA_UBX_NMEA_GSA			0x02
+#define NMEA_UBX_NMEA_GSV			0x03
+#define NMEA_UBX_NMEA_RMC			0x04
+#define NMEA_UBX_NMEA_VTG			0x05
+#define NMEA_UBX_NMEA_GST			0x07
+#define NMEA_UBX_NMEA_ZDA			0x08
+
+// Порты (I/O targets) CFG-MSG и CFG-PRT
+#define NMEA_UBX_PORT_DDC			0
+#define NMEA_UBX_PORT_UART1			1
+#define NMEA_UBX_PORT_UART2			2
+#define NMEA_UBX_PORT_USB			3
+#define NMEA_UBX_PORT_SPI			4
+#define NMEA_UBX_PORTS				6
+
+// CFG-PRT: режим UART и маски протоколов
+#define NMEA_UBX_PRT_8N1			0x000008D0
+#define NMEA_UBX_PROTO_UBX			0x01
+#define NMEA_UBX_PROTO_NMEA			0x02
+#define NMEA_UBX_PROTO_RTCM			0x04
+#define NMEA_UBX_PROTO_RTCM3		0x20
+
+/*
+ * Кадры CFG-* с постоянными параметрами - инициализаторы массивов,
+ * контрольная сумма вычисляется при компиляции:
+ *
+ *   static const uint8_t rate_10hz[NMEA_UBX_CFG_RATE_LEN] = NMEA_UBX_CFG_RATE_INIT(100, 1, 1);
+ *
+ * Fletcher-8 линейна: CK_A = сумма байт, CK_B = сумма байт с весами
+ * N, N-1, ..., 1, где N - число байт от class до конца данных
+ */
+#define NMEA_UBX_B(v, n)			(((unsigned long) (v) >> (8 * (n))) & 0xFF)
+#define NMEA_UBX_U2(v)				NMEA_UBX_B(v, 0), NMEA_UBX_B(v, 1)
+#define NMEA_UBX_U4(v)				NMEA_UBX_B(v, 0), NMEA_UBX_B(v, 1), NMEA_UBX_B(v, 2), NMEA_UBX_B(v, 3)
+#define NMEA_UBX_U2_A(v)			(NMEA_UBX_B(v, 0) + NMEA_UBX_B(v, 1))
+#define NMEA_UBX_U2_B(w, v)			((w) * NMEA_UBX_B(v, 0) + ((w) - 1) * NMEA_UBX_B(v, 1))
+#define NMEA_UBX_U4_A(v)			(NMEA_UBX_U2_A(v) + NMEA_UBX_B(v, 2) + NMEA_UBX_B(v, 3))
+#define NMEA_UBX_U4_B(w, v)			(NMEA_UBX_U2_B(w, v) + ((w) - 2) * NMEA_UBX_B(v, 2) + ((w) - 3) * NMEA_UBX_B(v, 3))
+
+// CFG-MSG: сообщение msg_class/msg_id, частота вывода по портам r0..r5 (0 - выключено)
+#define NMEA_UBX_CFG_MSG_INIT(msg_class, msg_id, r0, r1, r2, r3, r4, r5) { \
+	NMEA_UBX_SYNC1, NMEA_UBX_SYNC2, NMEA_UBX_CLASS_CFG, NMEA_UBX_CFG_MSG, NMEA_UBX_U2(8), \
+	(msg_class), (msg_id), (r0), (r1), (r2), (r3), (r4), (r5), \
+	(uint8_t) (NMEA_UBX_CLASS_CFG + NMEA_UBX_CFG_MSG + 8 + (msg_class) + (msg_id) + \
+	           (r0) + (r1) + (r2) + (r3) + (r4) + (r5)), \
+	(uint8_t) (12 * NMEA_UBX_CLASS_CFG + 11 * NMEA_UBX_CFG_MSG + 10 * 8 + 8 * (msg_class) + 7 * (msg_id) + \
+	           6 * (r0) + 5 * (r1) + 4 * (r2) + 3 * (r3) + 2 * (r4) + (r5)) }
+
+// CFG-RATE: период измерений, мс; измерений на решение; опорное время (0 - UTC, 1 - GPS)
+#define NMEA_UBX_CFG_RATE_INIT(meas_ms, nav_rate, time_ref) { \
+	NMEA_UBX_SYNC1, NMEA_UBX_SYNC2, NMEA_UBX_CLASS_CFG, NMEA_UBX_CFG_RATE, NMEA_UBX_U2(6), \
+	NMEA_UBX_U2(meas_ms), NMEA_UBX_U2(nav_rate), NMEA_UBX_U2(time_ref), \
+	(uint8_t) (NMEA_UBX_CLASS_CFG + NMEA_UBX_CFG_RATE + 6 + \
+	           NMEA_UBX_U2_A(meas_ms) + NMEA_UBX_U2_A(nav_rate) + NMEA_UBX_U2_A(time_ref)), \
+	(uint8_t) (10 * NMEA_UBX_CLASS_CFG + 9 * NMEA_UBX_CFG_RATE + 8 * 6 + \
+	           NMEA_UBX_U2_B(6, meas_ms) + NMEA_UBX_U2_B(4, nav_rate) + NMEA_UBX_U2_B(2, time_ref)) }
+
+// CFG-PRT для UART: порт, режим (NMEA_UBX_PRT_8N1), скорость, маски протоколов
+#define NMEA_UBX_CFG_PRT_INIT(port, mode, baud, in_proto, out_proto) { \
+	NMEA_UBX_SYNC1, NMEA_UBX_SYNC2, NMEA_UBX_CLASS_CFG, NMEA_UBX_CFG_PRT, NMEA_UBX_U2(20), \
+	(port), 0, NMEA_UBX_U2(0), NMEA_UBX_U4(mode), NMEA_UBX_U4(baud), \
+	NMEA_UBX_U2(in_proto), NMEA_UBX_U2(out_proto), NMEA_UBX_U2(0), NMEA_UBX_U2(0), \
+	(uint8_t) (NMEA_UBX_CLASS_CFG + NMEA_UBX_CFG_PRT + 20 + (port) + NMEA_UBX_U4_A(mode) + \
+	           NMEA_UBX_U4_A(baud) + NMEA_UBX_U2_A(in_proto) + NMEA_UBX_U2_A(out_proto)), \
+	(uint8_t) (24 * NMEA_UBX_CLASS_CFG + 23 * NMEA_UBX_CFG_PRT + 22 * 20 + 20 * (port) + \
+	           NMEA_UBX_U4_B(16, mode) + NMEA_UBX_U4_B(12, baud) + \
+	           NMEA_UBX_U2_B(8, in_proto) + NMEA_UBX_U2_B(6, out_proto)) }
+
+
+//------------------- VARIABLES ---------------------------
+enum nmea_ubx_kind {
+	NMEA_UBX_NONE = 0,		// нужны еще данные
+	NMEA_UBX_PACKET,		// кадр UBX с верной контрольной суммой
+	NMEA_UBX_NMEA,			// строка NMEA
+};
+
+struct nmea_ubx_packet {
+	uint8_t class_;
+	uint8_t id;
+	uint16_t len;
+	const uint8_t *payload;
+};
+
+/**
+ * Элемент смешанного потока: кадр UBX или строка NMEA "$...*hh" с '\0'
+ * на месте конца строки. Данные действительны до следующей записи в поток
+ */
+struct nmea_ubx_item {
+	enum nmea_ubx_kind kind;
+	union {
+		struct nmea_ubx_packet packet;
+		struct nmea_span sentence;
+	} data;
+};
+
+/**
+ * Разбор потока байт, в котором чередуются кадры UBX и строки NMEA.
+ * Буфер линейный: необработанный остаток сдвигается к началу при записи,
+ * поэтому любой кадр доступен как непрерывный участок памяти.
+ */
+struct nmea_ubx_stream {
+	uint8_t buf[NMEA_UBX_STREAM_SIZE];
+	size_t head;			// конец записанных данных
+	size_t tail;			// начало не обработанных данных
+	size_t scan;			// позиция поиска конца строки NMEA
+	unsigned long packets;		// выдано кадров UBX
+	unsigned long sentences;	// выдано строк NMEA
+	unsigned long errors;		// кадров UBX с неверной длиной/контрольной суммой
+	unsigned long dropped;		// отброшено строк NMEA (мусор, длинная строка)
+};
+
+//------------------- FUNCTIONS ---------------------------
+/**
+ * Контрольная сумма Fletcher-8 по class, id, длине и данным кадра.
+ * Возвращает CK_A в младшем байте, CK_B в старшем
+ */
+uint16_t nmea_ubx_checksum(const uint8_t *data, size_t len);
+
+/**
+ * Кадр UBX в buf: заголовок, len байт payload (может уже лежать в
+ * buf + NMEA_UBX_HEADER) и контрольная сумма. Возвращает длину кадра
+ */
+size_t nmea_ubx_write(uint8_t *buf, uint8_t class_, uint8_t id, const void *payload, uint16_t len);
+
+/**
+ * CFG-MSG: частота вывода сообщения по портам, rates[NMEA_UBX_PORT_*]
+ * (0 - выключено, 1 - каждое решение). Возвращает NMEA_UBX_CFG_MSG_LEN
+ */
+size_t nmea_ubx_cfg_msg(uint8_t *buf, uint8_t msg_class, uint8_t msg_id, const uint8_t rates[NMEA_UBX_PORTS]);
+
+/**
+ * CFG-MSG для предложения NMEA. Возвращает 0 для типа, которого нет в UBX
+ */
+size_t nmea_ubx_cfg_nmea(uint8_t *buf, enum nmea_sentence_id id, const uint8_t rates[NMEA_UBX_PORTS]);
+
+/**
+ * CFG-RATE: период измерений meas_ms (100 - 10 Гц, 40 - 25 Гц), измерений
+ * на решение, опорное время (0 - UTC, 1 - GPS). Возвращает NMEA_UBX_CFG_RATE_LEN
+ */
+size_t nmea_ubx_cfg_rate(uint8_t *buf, uint16_t meas_ms, uint16_t nav_rate, uint16_t time_ref);
+
+/**
+ * CFG-PRT для UART 8N1: скорость и маски протоколов NMEA_UBX_PROTO_*.
+ * Возвращает NMEA_UBX_CFG_PRT_LEN
+ */
+size_t nmea_ubx_cfg_prt(uint8_t *buf, uint8_t port, uint32_t baud, uint16_t in_proto, uint16_t out_proto);
+
+/**
+ * Инициализация (сброс) потока
+ */
+void nmea_ubx_init(struct nmea_ubx_stream *stream);
+
+/**
+ * Непрерывный участок буфера для записи (например read() прямо в буфер).
+ * Сдвигает необработанный остаток, ранее выданные элементы становятся
+ * недействительны. После записи необходимо вызвать nmea_ubx_commit()
+ */
+uint8_t *nmea_ubx_wbuf(struct nmea_ubx_stream *stream, size_t *len);
+
+/**
+ * Подтверждает запись len байт в участок, полученный от nmea_ubx_wbuf()
+ */
+static inline void nmea_ubx_commit(struct nmea_ubx_stream *stream, size_t len)
+{
+	stream->head += len;
+}
+
+/**
+ * Копирует данные в буфер. Возвращает количество принятых байт,
+ * меньше len, если буфер заполнен
+ */
+size_t nmea_ubx_push(struct nmea_ubx_stream *stream, const void *data, size_t len);
+
+/**
+ * Следующий кадр UBX или строка NMEA. Возвращает NMEA_UBX_NONE,
+ * если полного элемента в буфере нет
+ */
+enum nmea_ubx_kind nmea_ubx_next(struct nmea_ubx_stream *stream, struct nmea_ubx_item *item);
+
+/**
+ * Пустое решение: время, дата и счетчики -1, числа без значения
+ */
+void nmea_ubx_fix_init(struct nmea_fix *fix);
+
+/**
+ * NAV-PVT: дата, время, координаты (в формате NMEA ddmm.mmmmmm), высота,
+ * скорость (узлы), курс, PDOP, качество и число спутников.
+ * Дополняет fix, в types отмечаются RMC, GGA и GSA
+ */
+bool nmea_ubx_nav_pvt(struct nmea_fix *fix, const struct nmea_ubx_packet *packet);
+
+/**
+ * NAV-SAT: число видимых спутников и номера использованных в решении
+ * (нумерация NMEA). В types отмечается GSV
+ */
+bool nmea_ubx_nav_sat(struct nmea_fix *fix, const struct nmea_ubx_packet *packet);
+
+/**
+ * Спутники NAV-SAT в формате GSV. Возвращает число записанных, не больше max,
+ * -1 для неверного кадра
+ */
+int nmea_ubx_sats(const struct nmea_ubx_packet *packet, struct nmea_sat_info *sats, int max);
+
+/**
+ * NAV-TIMEUTC: дата и время, если UTC определено. В types отмечается ZDA
+ */
+bool nmea_ubx_nav_timeutc(struct nmea_fix *fix, const struct nmea_ubx_packet *packet);
+
+/**
+ * Разбор кадра одним из декодеров NAV-*. Возвращает false для
+ * неизвестного или неверного кадра
+ */
+bool nmea_ubx_decode(struct nmea_fix *fix, const struct nmea_ubx_packet *packet);
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif /* NMEA_UBX_H */
@@ -0,0 +1,164 @@
+#include "nmea_view.h"
+#include "nmea_number.h"
+
+
+
+//------------------- DEFINES -----------------------------
+#define NMEA_VIEW_TAIL				(NMEA_MAX_LENGTH + 4)
+
+
+//------------------- FUNCTIONS ------------------------
+int nmea_view_split(struct nmea_view *view, const char *data, size_t len, bool strict)
+{
+    const char *fields[NMEA_MAX_FIELDS];
+    size_t end;
+
+    view->data = data;
+    view->len = len;
+    view->count = nmea_split_n(data, len, fields, strict, &end);
+
+    for (int i = 0; i < view->count; i++) {
+        const char *field = fields[i];
+        const char *stop = i + 1 < view->count ? fields[i + 1] - 1 : data + end;
+        // Полей больше NMEA_MAX_FIELDS - последнее до ближайшей запятой
+        if (i + 1 == NMEA_MAX_FIELDS) {
+            const char *comma = memchr(field, ',', (size_t) (stop - field));
+            if (comma)
+                stop = comma;
+        }
+        view->fields[i].offset = (uint16_t) (field - data);
+        view->fields[i].len = (uint16_t) (stop - field);
+    }
+
+    return view->count;
+}
+
+// Поле с разделителем после него: в буфере, либо копия в tail, если
+// поле заканчивается на границе буфера. NULL если поля нет
+static const char *nmea_view_get(const struct nmea_view *view, int n, char tail[NMEA_VIEW_TAIL], size_t *len)
+{
+    const char *field = nmea_view_field(view, n, len);
+
+    if (field && field + *len == view->data + view->len) {
+        memcpy(tail, field, *len);
+        tail[*len] = '\0';
+        return tail;
+    }
+    return field;
+}
+
+enum nmea_sentence_id nmea_view_type(const struct nmea_view *view)
+{
+    char tail[NMEA_VIEW_TAIL];
+    size_t len;
+    const char *field = nmea_view_get(view, 0, tail, &len);
+
+    return field ? nmea_sentence_type(field) : NMEA_INVALID;
+}
+
+char nmea_view_char(const struct nmea_view *view, int n)
+{
+    size_t len;
+    const char *field = nmea_view_field(view, n, &len);
+
+    return field && len ? *field : '\0';
+}
+
+bool nmea_view_direction(const struct nmea_view *view, int n, int *value)
+{
+    switch (nmea_view_char(view, n)) {
+        case '\0': *value = 0; return true;
+        case 'N':
+        case 'E': *value = 1; return true;
+        case 'S':
+        case 'W': *value = -1; return true;
+        default: return false;
+    }
+}
+
+bool nmea_view_float(const struct nmea_view *view, int n, struct nmea_float *f)
+{
+    char tail[NMEA_VIEW_TAIL];
+    int64_t value = 0;
+    int64_t scale = 0;
+    size_t len;
+    const char *field = nmea_view_get(view, n, tail, &len);
+
+    if (field) {
+        const char *end = field + len;
+        // Пробелы допустимы только перед числом
+        while (field < end && *field == ' ')
+            field++;
+        field = nmea_number_decimal(field, -1, &value, &scale);
+        if (field != end)
+            return false;
+    }
+
+    f->value = value;
+    f->scale = scale;
+    return true;
+}
+
+bool nmea_view_int(const struct nmea_view *view, int n, int *value)
+{
+    char tail[NMEA_VIEW_TAIL];
+    int result = 0;
+    size_t len;
+    const char *field = nmea_view_get(view, n, tail, &len);
+
+    if (field && len) {
+        const char *end = field + len;
+        while (field < end && *field == ' ')
+            field++;
+        field = nmea_number_int(field, &result);
+        if (field != end)
+            return false;
+    }
+
+    *value = result;
+    return true;
+}
+
+bool nmea_view_time(const struct nmea_view *view, int n, struct nmea_time *time_)
+{
+    char tail[NMEA_VIEW_TAIL];
+    struct nmea_time t = {-1, -1, -1, -1};
+    size_t len;
+    const char *field = nmea_view_get(view, n, tail, &len);
+
+    if (field && len && !nmea_number_time(field, &t))
+        return false;
+
+    *time_ = t;
+    return true;
+}
+
+bool nmea_view_date(const struct nmea_view *view, int n, struct nmea_date *date)
+{
+    char tail[NMEA_VIEW_TAIL];
+    struct nmea_date d = {-1, -1, -1};
+    size_t len;
+    const char *field = nmea_view_get(view, n, tail, &len);
+
+    if (field && len && !nmea_number_date(field, &d))
+        return false;
+
+    *date = d;
+    return true;
+}
+
+size_t nmea_view_string(const struct nmea_view *view, int n, char *buf, size_t size)
+{
+    size_t len = 0;
+    const char *field = nmea_view_field(view, n, &len);
+
+    if (!field)
+        len = 0;
+    if (size) {
+        size_t copy = len < size ? len : size - 1;
+        if (copy)
+            memcpy(buf, field, copy);
+        buf[copy] = '\0';
+    }
+    return len;
+}
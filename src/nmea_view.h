@@ -0,0 +1,77 @@
+#ifndef NMEA_VIEW_H
+#define NMEA_VIEW_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+//------------------- DEFINES -----------------------------
+#include "nmea.h"
+
+
+//------------------- VARIABLES ---------------------------
+struct nmea_field_view {
+	uint16_t offset;		// от начала предложения
+	uint16_t len;
+};
+
+/**
+ * Поля предложения без копирования: смещения и длины в буфере
+ * вызывающего. Буфер должен жить, пока читаются поля.
+ * Значения декодируются только при обращении к полю.
+ */
+struct nmea_view {
+	const char *data;
+	size_t len;			// длина предложения с "*hh" и концом строки
+	int count;
+	struct nmea_field_view fields[NMEA_MAX_FIELDS];
+};
+
+//------------------- FUNCTIONS ---------------------------
+/**
+ * Проверка и разметка предложения длиной len (nmea_split_n()).
+ * Возвращает количество полей, 0 при ошибке
+ */
+int nmea_view_split(struct nmea_view *view, const char *data, size_t len, bool strict);
+
+/**
+ * Поле n без копирования (не завершено '\0'), NULL если поля нет
+ */
+static inline const char *nmea_view_field(const struct nmea_view *view, int n, size_t *len)
+{
+    if (n < 0 || n >= view->count)
+        return NULL;
+    *len = view->fields[n].len;
+    return view->data + view->fields[n].offset;
+}
+
+/**
+ * Тип предложения по первому полю (nmea_sentence_type())
+ */
+enum nmea_sentence_id nmea_view_type(const struct nmea_view *view);
+
+/**
+ * Типизированное чтение поля n, правила как у nmea_scan().
+ * Отсутствующее или пустое поле - нулевое значение (-1 для даты/времени).
+ * Возвращают false при ошибке формата
+ */
+char nmea_view_char(const struct nmea_view *view, int n);
+bool nmea_view_direction(const struct nmea_view *view, int n, int *value);
+bool nmea_view_float(const struct nmea_view *view, int n, struct nmea_float *f);
+bool nmea_view_int(const struct nmea_view *view, int n, int *value);
+bool nmea_view_time(const struct nmea_view *view, int n, struct nmea_time *time_);
+bool nmea_view_date(const struct nmea_view *view, int n, struct nmea_date *date);
+
+/**
+ * Копия поля n в buf размером size с '\0', лишнее обрезается.
+ * Возвращает полную длину поля
+ */
+size_t nmea_view_string(const struct nmea_view *view, int n, char *buf, size_t size);
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif /* NMEA_VIEW_H */
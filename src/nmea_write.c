@@ -0,0 +1,426 @@
+#include "nmea_write.h"
+
+
+
+//------------------- VARIABLES ------------------------
+static const char nmea_digits[200] = {
+    '0','0','0','1','0','2','0','3','0','4','0','5','0','6','0','7','0','8','0','9',
+    '1','0','1','1','1','2','1','3','1','4','1','5','1','6','1','7','1','8','1','9',
+    '2','0','2','1','2','2','2','3','2','4','2','5','2','6','2','7','2','8','2','9',
+    '3','0','3','1','3','2','3','3','3','4','3','5','3','6','3','7','3','8','3','9',
+    '4','0','4','1','4','2','4','3','4','4','4','5','4','6','4','7','4','8','4','9',
+    '5','0','5','1','5','2','5','3','5','4','5','5','5','6','5','7','5','8','5','9',
+    '6','0','6','1','6','2','6','3','6','4','6','5','6','6','6','7','6','8','6','9',
+    '7','0','7','1','7','2','7','3','7','4','7','5','7','6','7','7','7','8','7','9',
+    '8','0','8','1','8','2','8','3','8','4','8','5','8','6','8','7','8','8','8','9',
+    '9','0','9','1','9','2','9','3','9','4','9','5','9','6','9','7','9','8','9','9',
+};
+
+static const uint64_t nmea_powers[20] = {
+    1ull, 10ull, 100ull, 1000ull, 10000ull, 100000ull, 1000000ull, 10000000ull, 100000000ull,
+    1000000000ull, 10000000000ull, 100000000000ull, 1000000000000ull, 10000000000000ull,
+    100000000000000ull, 1000000000000000ull, 10000000000000000ull, 100000000000000000ull,
+    1000000000000000000ull, 10000000000000000000ull,
+};
+
+static const char nmea_hex[16] = {'0','1','2','3','4','5','6','7','8','9','A','B','C','D','E','F'};
+
+
+//------------------- FUNCTIONS ------------------------
+static inline int nmea_count_digits(uint64_t v)
+{
+#if defined(__GNUC__)
+    // log10 по номеру старшего бита: 1233 / 4096 ~ log10(2)
+    int n = ((64 - __builtin_clzll(v | 1)) * 1233) >> 12;
+    return n + (v >= nmea_powers[n]);
+#else
+    int n = 1;
+    while (n < 20 && v >= nmea_powers[n])
+        n++;
+    return n;
+#endif
+}
+
+// Десятичное без знака, не короче width (ведущие нули)
+static inline char *nmea_put_uint(char *p, uint64_t v, int width)
+{
+    int n = nmea_count_digits(v);
+    if (n < width)
+        n = width;
+
+    char *end = p + n;
+    char *q = end;
+    while (v >= 100) {
+        unsigned d = (unsigned) (v % 100) * 2;
+        v /= 100;
+        *--q = nmea_digits[d + 1];
+        *--q = nmea_digits[d];
+    }
+    if (v >= 10) {
+        *--q = nmea_digits[v * 2 + 1];
+        *--q = nmea_digits[v * 2];
+    } else {
+        *--q = (char) ('0' + v);
+    }
+    while (q > p)
+        *--q = '0';
+    return end;
+}
+
+static inline char *nmea_put_int(char *p, int v, int width)
+{
+    if (v < 0) {
+        *p++ = '-';
+        return nmea_put_uint(p, (uint64_t) -(int64_t) v, width);
+    }
+    return nmea_put_uint(p, (uint64_t) v, width);
+}
+
+// Фиксированная точка: decimals знаков дроби, не меньше width цифр целой части.
+// Цифры пишутся с конца, без деления на масштаб
+static inline char *nmea_put_fixed(char *p, uint64_t v, int decimals, int width)
+{
+    int n = nmea_count_digits(v);
+    if (n < decimals + width)
+        n = decimals + width;
+
+    char *end = p + n + (decimals > 0);
+    char *q = end;
+    int i = decimals;
+    for (; i >= 2; i -= 2) {
+        unsigned d = (unsigned) (v % 100) * 2;
+        v /= 100;
+        *--q = nmea_digits[d + 1];
+        *--q = nmea_digits[d];
+    }
+    if (i) {
+        *--q = (char) ('0' + v % 10);
+        v /= 10;
+    }
+    if (decimals)
+        *--q = '.';
+    while (q - p >= 2) {
+        unsigned d = (unsigned) (v % 100) * 2;
+        v /= 100;
+        *--q = nmea_digits[d + 1];
+        *--q = nmea_digits[d];
+    }
+    if (q > p)
+        *--q = (char) ('0' + v % 10);
+    return end;
+}
+
+// value / scale; width - минимум цифр целой части (ддмм, дддмм),
+// absolute - без знака (направление в отдельном поле). scale = 0 - пусто
+static char *nmea_put_float(char *p, const struct nmea_float *f, int width, bool absolute)
+{
+    struct nmea_float v = *f;
+
+    if (v.scale <= 0)
+        return p;
+    int decimals = nmea_count_digits((uint64_t) v.scale) - 1;
+    // Масштаб не степень 10 - к ближайшей большей
+    if (nmea_powers[decimals] != (uint64_t) v.scale) {
+        if (decimals < 18)
+            decimals++;
+        v.value = nmea_rescale(&v, (int_least64_t) nmea_powers[decimals]);
+    }
+
+    uint64_t magnitude = v.value < 0 ? 0 - (uint64_t) v.value : (uint64_t) v.value;
+    if (v.value < 0 && !absolute)
+        *p++ = '-';
+    return nmea_put_fixed(p, magnitude, decimals, width);
+}
+
+static inline char *nmea_put_char(char *p, char c)
+{
+    if (c)
+        *p++ = c;
+    return p;
+}
+
+// Направление по знаку, пусто без значения
+static inline char *nmea_put_direction(char *p, const struct nmea_float *f, char positive, char negative)
+{
+    if (f->scale)
+        *p++ = f->value < 0 ? negative : positive;
+    return p;
+}
+
+// ччммсс.сс, дробь до микросекунд по числу значащих знаков
+static char *nmea_put_time(char *p, const struct nmea_time *time_)
+{
+    if (time_->hours < 0)
+        return p;
+
+    p = nmea_put_uint(p, (uint64_t) time_->hours, 2);
+    p = nmea_put_uint(p, (uint64_t) time_->minutes, 2);
+    p = nmea_put_uint(p, (uint64_t) time_->seconds, 2);
+    *p++ = '.';
+    int us = time_->microseconds < 0 ? 0 : time_->microseconds;
+    if (us % 10000 == 0)
+        return nmea_put_uint(p, (uint64_t) us / 10000, 2);
+    if (us % 1000 == 0)
+        return nmea_put_uint(p, (uint64_t) us / 1000, 3);
+    return nmea_put_uint(p, (uint64_t) us, 6);
+}
+
+static char *nmea_put_date(char *p, const struct nmea_date *date)
+{
+    if (date->year < 0)
+        return p;
+
+    p = nmea_put_uint(p, (uint64_t) date->day, 2);
+    p = nmea_put_uint(p, (uint64_t) date->month, 2);
+    return nmea_put_uint(p, (uint64_t) date->year % 100, 2);
+}
+
+static inline char *nmea_put_coord(char *p, const struct nmea_float *latitude, const struct nmea_float *longitude)
+{
+    p = nmea_put_float(p, latitude, 4, true);
+    *p++ = ',';
+    p = nmea_put_direction(p, latitude, 'N', 'S');
+    *p++ = ',';
+    p = nmea_put_float(p, longitude, 5, true);
+    *p++ = ',';
+    return nmea_put_direction(p, longitude, 'E', 'W');
+}
+
+static inline char *nmea_put_start(char *p, const char *talker, const char type[3])
+{
+    p[0] = '$';
+    p[1] = talker[0];
+    p[2] = talker[1];
+    p[3] = type[0];
+    p[4] = type[1];
+    p[5] = type[2];
+    p[6] = ',';
+    return p + 7;
+}
+
+// Контрольная сумма по 8 байт, "*hh\r\n\0"
+static size_t nmea_put_end(char *buf, char *p)
+{
+    const char *s = buf + 1;
+    uint64_t acc = 0;
+
+    while (p - s >= 8) {
+        uint64_t word;
+        memcpy(&word, s, sizeof(word));
+        acc ^= word;
+        s += 8;
+    }
+    acc ^= acc >> 32;
+    acc ^= acc >> 16;
+    acc ^= acc >> 8;
+
+    uint8_t sum = (uint8_t) acc;
+    while (s < p)
+        sum ^= (uint8_t) *s++;
+
+    p[0] = '*';
+    p[1] = nmea_hex[sum >> 4];
+    p[2] = nmea_hex[sum & 0x0F];
+    p[3] = '\r';
+    p[4] = '\n';
+    p[5] = '\0';
+    return (size_t) (p + 5 - buf);
+}
+
+size_t nmea_write_float(char *buf, const struct nmea_float *f)
+{
+    return (size_t) (nmea_put_float(buf, f, 1, false) - buf);
+}
+
+size_t nmea_write_rmc(char *buf, const char *talker, const struct nmea_sentence_rmc *frame)
+{
+    char *p = nmea_put_start(buf, talker, "RMC");
+
+    p = nmea_put_time(p, &frame->time);
+    *p++ = ',';
+    *p++ = frame->valid ? 'A' : 'V';
+    *p++ = ',';
+    p = nmea_put_coord(p, &frame->latitude, &frame->longitude);
+    *p++ = ',';
+    p = nmea_put_float(p, &frame->speed, 1, false);
+    *p++ = ',';
+    p = nmea_put_float(p, &frame->course, 1, false);
+    *p++ = ',';
+    p = nmea_put_date(p, &frame->date);
+    *p++ = ',';
+    p = nmea_put_float(p, &frame->variation, 1, true);
+    *p++ = ',';
+    p = nmea_put_direction(p, &frame->variation, 'E', 'W');
+    return nmea_put_end(buf, p);
+}
+
+size_t nmea_write_gga(char *buf, const char *talker, const struct nmea_sentence_gga *frame)
+{
+    char *p = nmea_put_start(buf, talker, "GGA");
+
+    p = nmea_put_time(p, &frame->time);
+    *p++ = ',';
+    p = nmea_put_coord(p, &frame->latitude, &frame->longitude);
+    *p++ = ',';
+    p = nmea_put_int(p, frame->fix_quality, 1);
+    *p++ = ',';
+    p = nmea_put_int(p, frame->satellites_tracked, 2);
+    *p++ = ',';
+    p = nmea_put_float(p, &frame->hdop, 1, false);
+    *p++ = ',';
+    p = nmea_put_float(p, &frame->altitude, 1, false);
+    *p++ = ',';
+    p = nmea_put_char(p, frame->altitude_units);
+    *p++ = ',';
+    p = nmea_put_float(p, &frame->height, 1, false);
+    *p++ = ',';
+    p = nmea_put_char(p, frame->height_units);
+    *p++ = ',';
+    p = nmea_put_float(p, &frame->dgps_age, 1, false);
+    // Номер станции DGPS не разбирается
+    *p++ = ',';
+    return nmea_put_end(buf, p);
+}
+
+size_t nmea_write_gsa(char *buf, const char *talker, const struct nmea_sentence_gsa *frame)
+{
+    char *p = nmea_put_start(buf, talker, "GSA");
+
+    p = nmea_put_char(p, frame->mode);
+    *p++ = ',';
+    p = nmea_put_int(p, frame->fix_type, 1);
+    for (int i = 0; i < 12; i++) {
+        *p++ = ',';
+        if (frame->sats[i])
+            p = nmea_put_int(p, frame->sats[i], 2);
+    }
+    *p++ = ',';
+    p = nmea_put_float(p, &frame->pdop, 1, false);
+    *p++ = ',';
+    p = nmea_put_float(p, &frame->hdop, 1, false);
+    *p++ = ',';
+    p = nmea_put_float(p, &frame->vdop, 1, false);
+    return nmea_put_end(buf, p);
+}
+
+size_t nmea_write_gll(char *buf, const char *talker, const struct nmea_sentence_gll *frame)
+{
+    char *p = nmea_put_start(buf, talker, "GLL");
+
+    p = nmea_put_coord(p, &frame->latitude, &frame->longitude);
+    *p++ = ',';
+    p = nmea_put_time(p, &frame->time);
+    *p++ = ',';
+    p = nmea_put_char(p, frame->status);
+    if (frame->mode) {
+        *p++ = ',';
+        *p++ = frame->mode;
+    }
+    return nmea_put_end(buf, p);
+}
+
+size_t nmea_write_gst(char *buf, const char *talker, const struct nmea_sentence_gst *frame)
+{
+    const struct nmea_float *values[7] = {
+        &frame->rms_deviation, &frame->semi_major_deviation, &frame->semi_minor_deviation,
+        &frame->semi_major_orientation, &frame->latitude_error_deviation,
+        &frame->longitude_error_deviation, &frame->altitude_error_deviation,
+    };
+    char *p = nmea_put_start(buf, talker, "GST");
+
+    p = nmea_put_time(p, &frame->time);
+    for (int i = 0; i < 7; i++) {
+        *p++ = ',';
+        p = nmea_put_float(p, values[i], 1, false);
+    }
+    return nmea_put_end(buf, p);
+}
+
+size_t nmea_write_gsv(char *buf, const char *talker, const struct nmea_sentence_gsv *frame)
+{
+    char *p = nmea_put_start(buf, talker, "GSV");
+    int count = 4;
+
+    // Пустые спутники в конце не выводятся
+    while (count > 0 && !frame->sats[count - 1].nr)
+        count--;
+
+    p = nmea_put_int(p, frame->total_msgs, 1);
+    *p++ = ',';
+    p = nmea_put_int(p, frame->msg_nr, 1);
+    *p++ = ',';
+    p = nmea_put_int(p, frame->total_sats, 2);
+    for (int i = 0; i < count; i++) {
+        const struct nmea_sat_info *sat = &frame->sats[i];
+        *p++ = ',';
+        if (sat->nr) {
+            p = nmea_put_int(p, sat->nr, 2);
+            *p++ = ',';
+            p = nmea_put_int(p, sat->elevation, 2);
+            *p++ = ',';
+            p = nmea_put_int(p, sat->azimuth, 3);
+            *p++ = ',';
+            // SNR 0 - спутник не отслеживается
+            if (sat->snr)
+                p = nmea_put_int(p, sat->snr, 2);
+        } else {
+            *p++ = ',';
+            *p++ = ',';
+            *p++ = ',';
+        }
+    }
+    return nmea_put_end(buf, p);
+}
+
+size_t nmea_write_vtg(char *buf, const char *talker, const struct nmea_sentence_vtg *frame)
+{
+    char *p = nmea_put_start(buf, talker, "VTG");
+
+    p = nmea_put_float(p, &frame->true_track_degrees, 1, false);
+    memcpy(p, ",T,", 3);
+    p = nmea_put_float(p + 3, &frame->magnetic_track_degrees, 1, false);
+    memcpy(p, ",M,", 3);
+    p = nmea_put_float(p + 3, &frame->speed_knots, 1, false);
+    memcpy(p, ",N,", 3);
+    p = nmea_put_float(p + 3, &frame->speed_kph, 1, false);
+    memcpy(p, ",K", 2);
+    p += 2;
+    if (frame->faa_mode) {
+        *p++ = ',';
+        *p++ = (char) frame->faa_mode;
+    }
+    return nmea_put_end(buf, p);
+}
+
+size_t nmea_write_zda(char *buf, const char *talker, const struct nmea_sentence_zda *frame)
+{
+    char *p = nmea_put_start(buf, talker, "ZDA");
+
+    p = nmea_put_time(p, &frame->time);
+    *p++ = ',';
+    p = nmea_put_int(p, frame->date.day, 2);
+    *p++ = ',';
+    p = nmea_put_int(p, frame->date.month, 2);
+    *p++ = ',';
+    p = nmea_put_int(p, frame->date.year, 4);
+    *p++ = ',';
+    p = nmea_put_int(p, frame->hour_offset, 2);
+    *p++ = ',';
+    p = nmea_put_int(p, frame->minute_offset, 2);
+    return nmea_put_end(buf, p);
+}
+
+size_t nmea_write_sentence(char *buf, const struct nmea_sentence *frame)
+{
+    switch (frame->id) {
+        case NMEA_SENTENCE_RMC: return nmea_write_rmc(buf, frame->talker, &frame->data.rmc);
+        case NMEA_SENTENCE_GGA: return nmea_write_gga(buf, frame->talker, &frame->data.gga);
+        case NMEA_SENTENCE_GSA: return nmea_write_gsa(buf, frame->talker, &frame->data.gsa);
+        case NMEA_SENTENCE_GLL: return nmea_write_gll(buf, frame->talker, &frame->data.gll);
+        case NMEA_SENTENCE_GST: return nmea_write_gst(buf, frame->talker, &frame->data.gst);
+        case NMEA_SENTENCE_GSV: return nmea_write_gsv(buf, frame->talker, &frame->data.gsv);
+        case NMEA_SENTENCE_VTG: return nmea_write_vtg(buf, frame->talker, &frame->data.vtg);
+        case NMEA_SENTENCE_ZDA: return nmea_write_zda(buf, frame->talker, &frame->data.zda);
+        default: return 0;
+    }
+}
@@ -0,0 +1,43 @@
+#ifndef NMEA_WRITE_H
+#define NMEA_WRITE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+//------------------- DEFINES -----------------------------
+#include "nmea.h"
+
+#define NMEA_WRITE_MAX				320	// размер буфера для любого предложения
+
+
+//------------------- FUNCTIONS ---------------------------
+/*
+ * Формирование предложений из структур разбора: "$ttXXX,...*hh\r\n\0".
+ * talker - 2 символа источника ("GP", "GN", ...), buf - не менее
+ * NMEA_WRITE_MAX байт. Числа выводятся из фиксированной точки без printf,
+ * nmea_parse_*() результата дает исходную структуру.
+ * Возвращают длину без '\0'
+ */
+size_t nmea_write_rmc(char *buf, const char *talker, const struct nmea_sentence_rmc *frame);
+size_t nmea_write_gga(char *buf, const char *talker, const struct nmea_sentence_gga *frame);
+size_t nmea_write_gsa(char *buf, const char *talker, const struct nmea_sentence_gsa *frame);
+size_t nmea_write_gll(char *buf, const char *talker, const struct nmea_sentence_gll *frame);
+size_t nmea_write_gst(char *buf, const char *talker, const struct nmea_sentence_gst *frame);
+size_t nmea_write_gsv(char *buf, const char *talker, const struct nmea_sentence_gsv *frame);
+size_t nmea_write_vtg(char *buf, const char *talker, const struct nmea_sentence_vtg *frame);
+size_t nmea_write_zda(char *buf, const char *talker, const struct nmea_sentence_zda *frame);
+
+/**
+ * Предложение по frame->id и frame->talker. Возвращает 0 для типов
+ * без формирователя (NMEA_UNKNOWN, зарегистрированные)
+ */
+size_t nmea_write_sentence(char *buf, const struct nmea_sentence *frame);
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif /* NMEA_WRITE_H */
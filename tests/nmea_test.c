@@ -0,0 +1,1344 @@
+#ifdef __linux__
+#define _GNU_SOURCE
+#endif
+#include "nmea.h"
+#include "nmea_stream.h"
+#include "nmea_batch.h"
+#include "nmea_epoch.h"
+#include "nmea_gsv.h"
+#include "nmea_view.h"
+#include "nmea_log.h"
+#include "nmea_index.h"
+#include "nmea_write.h"
+#include "nmea_ubx.h"
+#include "nmea_stats.h"
+#include "nmea_coord.h"
+#include "nmea_geo.h"
+#include "nmea_fixed.h"
+#include "nmea_number.h"
+#include "nmea_thin.h"
+#include "nmea_layout.h"
+#ifndef _WIN32
+#include "nmea_replay.h"
+#include <pthread.h>
+#endif
+#ifdef __linux__
+#include "nmea_ingest.h"
+#include <unistd.h>
+#include <fcntl.h>
+#include <termios.h>
+#include <sys/socket.h>
+#endif
+
+
+
+//------------------- DEFINES -----------------------------
+#define CHECK(cond) \
+	do { \
+		checks++; \
+		if (!(cond)) { \
+			failures++; \
+			printf("%s:%d: %s\n", __FILE__, __LINE__, #cond); \
+		} \
+	} while (0)
+
+
+//------------------- VARIABLES ---------------------------
+static int checks;
+static int failures;
+
+
+//------------------- FUNCTIONS ---------------------------
+// Эталон nmea_layout(): побайтно, независимо от реализации в библиотеке
+static bool layout_reference(struct nmea_layout *layout, const char *sentence)
+{
+	memset(layout, 0, sizeof(*layout));
+	for (size_t i = 0; i < NMEA_LAYOUT_LIMIT; i++) {
+		unsigned char c = (unsigned char) sentence[i];
+		if (c < 0x20 || c > 0x7e || c == '*') {
+			layout->end = i;
+			return true;
+		}
+		if (c == ',')
+			layout->commas[i / 64] |= (uint64_t) 1 << (i % 64);
+		layout->checksum ^= c;
+	}
+	return false;
+}
+
+// Выбранная реализация (NMEA_KERNEL в ctest) против эталона: все
+// выравнивания начала, конец в любой позиции блока, длинные строки
+static void test_layout(void)
+{
+	static const char alphabet[] = "GPRMC,,0123456789.,NSEW,,";
+	static char buf[NMEA_LAYOUT_LIMIT + 128] __attribute__((aligned(64)));
+	const char *force = getenv("NMEA_KERNEL");
+	const char *kernel = nmea_layout_kernel();
+	uint32_t seed = 777;
+	int bad = 0;
+
+	if (force && !strcmp(force, "scalar"))
+		CHECK(!strcmp(kernel, "scalar"));
+	if (force && !strcmp(force, "sse2"))
+		CHECK(strcmp(kernel, "avx2") != 0);
+
+	for (int n = 0; n < 4000; n++) {
+		size_t offset = (size_t) n % 64;
+		size_t len = n < 2000 ? (size_t) n % 200 : (size_t) n % (NMEA_LAYOUT_LIMIT + 16);
+		char *s = buf + offset;
+		struct nmea_layout expected, layout;
+
+		for (size_t i = 0; i < sizeof(buf); i++) {
+			seed = seed * 1103515245u + 12345u;
+			buf[i] = alphabet[(seed >> 16) % (sizeof(alphabet) - 1)];
+		}
+		s[0] = '$';
+		// Конец: '*', '\0', '\r' или байт вне ASCII
+		seed = seed * 1103515245u + 12345u;
+		s[len] = "*\0\r\x80"[(seed >> 16) % 4];
+
+		bool ok = layout_reference(&expected, s);
+		memset(&layout, 0xA5, sizeof(layout));
+		if (nmea_layout(&layout, s) != ok)
+			bad++;
+		else if (ok && (layout.end != expected.end || layout.checksum != expected.checksum ||
+		                memcmp(layout.commas, expected.commas, sizeof(layout.commas))))
+			bad++;
+	}
+	CHECK(bad == 0);
+}
+
+static void test_check(void)
+{
+	CHECK(nmea_checksum("$GPGGA,123519,4807.038,N,01131.000,E,1,08,0.9,545.4,M,46.9,M,,*47") == 0x47);
+	CHECK(nmea_check("$GPGGA,123519,4807.038,N,01131.000,E,1,08,0.9,545.4,M,46.9,M,,*47", true));
+	CHECK(nmea_check("$GPGGA,123519,4807.038,N,01131.000,E,1,08,0.9,545.4,M,46.9,M,,*47\r\n", true));
+	CHECK(!nmea_check("$GPGGA,123519,4807.038,N,01131.000,E,1,08,0.9,545.4,M,46.9,M,,*48", false));
+	CHECK(!nmea_check("$GPGGA,123519,4807.038,N,01131.000,E,1,08,0.9,545.4,M,46.9,M,,", true));
+	CHECK(nmea_check("$GPGGA,123519,4807.038,N,01131.000,E,1,08,0.9,545.4,M,46.9,M,,", false));
+	CHECK(!nmea_check("GPGGA,123519*47", false));
+	CHECK(!nmea_check("$GPGGA,12\x01" "3519", false));
+	CHECK(!nmea_check("$GPGGA,123519,4807.038,N,01131.000,E,1,08,0.9,545.4,M,46.9,M,,*47\r\nx", true));
+
+	CHECK(nmea_sentence_id("$GPRMC,081836,A,3751.65,S,14507.36,E,000.0,360.0,130998,011.3,E*62", true) == NMEA_SENTENCE_RMC);
+	CHECK(nmea_sentence_id("$GPXYZ,1,2,3", false) == NMEA_UNKNOWN);
+	CHECK(nmea_sentence_id("$GPRMC,081836*00", false) == NMEA_INVALID);
+}
+
+static void test_parse(void)
+{
+	struct nmea_sentence_rmc rmc;
+	CHECK(nmea_parse_rmc(&rmc, "$GPRMC,081836,A,3751.65,S,14507.36,E,000.0,360.0,130998,011.3,E*62"));
+	CHECK(rmc.time.hours == 8 && rmc.time.minutes == 18 && rmc.time.seconds == 36);
+	CHECK(rmc.valid);
+	CHECK(rmc.latitude.value == -375165 && rmc.latitude.scale == 100);
+	CHECK(rmc.longitude.value == 1450736 && rmc.longitude.scale == 100);
+	CHECK(rmc.date.day == 13 && rmc.date.month == 9 && rmc.date.year == 98);
+	CHECK(rmc.variation.value == 113 && rmc.variation.scale == 10);
+
+	struct nmea_sentence_gga gga;
+	CHECK(nmea_parse_gga(&gga, "$GPGGA,123519,4807.038,N,01131.000,E,1,08,0.9,545.4,M,46.9,M,,*47"));
+	CHECK(gga.fix_quality == 1 && gga.satellites_tracked == 8);
+	CHECK(gga.altitude.value == 5454 && gga.altitude.scale == 10 && gga.altitude_units == 'M');
+	CHECK(gga.dgps_age.scale == 0);
+	CHECK(nmea_parse_gga(&gga, "$GPGGA,123519.125,4807.0381234,N,01131.0001234,E,4,12,0.50,545.4123,M,46.9,M,1.2,0031*72"));
+	CHECK(gga.latitude.value == 48070381234LL && gga.latitude.scale == 10000000);
+	CHECK(gga.longitude.value == 11310001234LL && gga.time.microseconds == 125000);
+	CHECK(gga.altitude.value == 5454123 && gga.altitude.scale == 10000);
+
+	struct nmea_sentence_gsa gsa;
+	CHECK(nmea_parse_gsa(&gsa, "$GPGSA,A,3,04,05,,09,12,,,24,,,,,2.5,1.3,2.1*39"));
+	CHECK(gsa.mode == 'A' && gsa.fix_type == 3 && gsa.sats[0] == 4 && gsa.sats[2] == 0 && gsa.sats[7] == 24);
+	CHECK(gsa.vdop.value == 21 && gsa.vdop.scale == 10);
+
+	struct nmea_sentence_gll gll;
+	CHECK(nmea_parse_gll(&gll, "$GPGLL,3723.2475,N,12158.3416,W,161229.487,A,A*41"));
+	CHECK(gll.longitude.value == -121583416 && gll.time.microseconds == 487000);
+	CHECK(gll.status == 'A' && gll.mode == 'A');
+
+	struct nmea_sentence_gst gst;
+	CHECK(nmea_parse_gst(&gst, "$GPGST,024603.00,3.2,6.6,4.7,47.3,5.8,5.6,22.0*58"));
+	CHECK(gst.semi_major_orientation.value == 473 && gst.altitude_error_deviation.value == 220);
+
+	struct nmea_sentence_gsv gsv;
+	CHECK(nmea_parse_gsv(&gsv, "$GPGSV,3,3,11,22,42,067,42,24,14,311,43,27,05,244,00,,,,*4D"));
+	CHECK(gsv.total_msgs == 3 && gsv.msg_nr == 3 && gsv.total_sats == 11);
+	CHECK(gsv.sats[1].nr == 24 && gsv.sats[1].azimuth == 311 && gsv.sats[3].nr == 0);
+	CHECK(nmea_parse_gsv(&gsv, "$GPGSV,4,4,13*7B"));
+
+	struct nmea_sentence_vtg vtg;
+	CHECK(nmea_parse_vtg(&vtg, "$GPVTG,096.5,T,083.5,M,0.0,N,0.0,K,D*22"));
+	CHECK(vtg.true_track_degrees.value == 965 && vtg.faa_mode == NMEA_FAA_MODE_DIFFERENTIAL);
+	CHECK(!nmea_parse_vtg(&vtg, "$GPVTG,096.5,X,083.5,M,0.0,N,0.0,K,D*22"));
+
+	struct nmea_sentence_zda zda;
+	CHECK(nmea_parse_zda(&zda, "$GPZDA,201530.00,04,07,2002,00,00*60"));
+	CHECK(zda.date.day == 4 && zda.date.month == 7 && zda.date.year == 2002);
+
+	struct timespec ts;
+	CHECK(!nmea_parse_zda(&zda, "$GPZDA,2015,04,07,2002,00,00"));
+	CHECK(nmea_parse_zda(&zda, "$GPZDA,201530.00,04,07,2002,00,00*60"));
+	CHECK(nmea_gettime(&ts, &zda.date, &zda.time) == 0 && ts.tv_sec == 1025813730);
+
+	struct nmea_date new_year = {1, 1, 17};
+	struct nmea_time midnight = {0, 0, 0, 0};
+	CHECK(nmea_gettime_scale(&ts, &new_year, &midnight, NMEA_TIMESCALE_GPS) == 0 && ts.tv_sec == 1167264018);
+	CHECK(nmea_gettime_scale(&ts, &new_year, &midnight, NMEA_TIMESCALE_TAI) == 0 && ts.tv_sec == 1483228800 + 37);
+	CHECK(nmea_days_from_civil(2000, 3, 1) == 11017 && nmea_days_from_civil(1969, 12, 31) == -1);
+
+	CHECK(!nmea_parse_gga(&gga, "$GPRMC,081836,A,3751.65,S,14507.36,E,000.0,360.0,130998,011.3,E*62"));
+	CHECK(!nmea_parse_rmc(&rmc, "$GPRMC,081836,A,3751.65,X,14507.36,E,000.0,360.0,130998,011.3,E*62"));
+}
+
+static void test_parse_fields(void)
+{
+	struct nmea_sentence_gga gga;
+	struct nmea_sentence_rmc rmc;
+	struct nmea_sentence frame;
+
+	CHECK(nmea_parse_gga_fields(&gga, "$GPGGA,123519,4807.038,N,01131.000,E,1,08,0.9,545.4,M,46.9,M,,*47", NMEA_FIELD_POSITION));
+	CHECK(gga.latitude.value == 4807038 && gga.longitude.value == 1131000);
+	CHECK(gga.time.hours == -1 && gga.satellites_tracked == 0 && gga.hdop.scale == 0 && gga.altitude_units == '\0');
+	// Поля вне mask не проверяются
+	CHECK(nmea_parse_gga_fields(&gga, "$GPGGA,123519,4807.038,S,01131.000,E,1,08,x,y,M,46.9,M,,", NMEA_FIELD_POSITION));
+	CHECK(gga.latitude.value == -4807038);
+	CHECK(!nmea_parse_gga(&gga, "$GPGGA,123519,4807.038,S,01131.000,E,1,08,x,y,M,46.9,M,,"));
+
+	CHECK(nmea_parse_rmc_fields(&rmc, "$GPRMC,081836,A,3751.65,S,14507.36,E,000.0,360.0,130998,011.3,E*62", NMEA_FIELD_TIME));
+	CHECK(rmc.time.minutes == 18 && rmc.date.year == 98 && rmc.latitude.scale == 0 && !rmc.valid);
+
+	CHECK(nmea_parse_fields(&frame, "$GPRMC,081836,A,3751.65,S,14507.36,E,000.0,360.0,130998,011.3,E*62\r\n", true,
+	                        NMEA_FIELD_STATUS | NMEA_FIELD_POSITION) == NMEA_SENTENCE_RMC);
+	CHECK(frame.data.rmc.valid && frame.data.rmc.latitude.value == -375165 && frame.data.rmc.speed.scale == 0);
+}
+
+static void test_parse_any(void)
+{
+	struct nmea_sentence frame;
+	struct nmea_sentence_gga gga;
+	const char *sentence = "$GNGGA,123519,4807.038,N,01131.000,E,1,08,0.9,545.4,M,46.9,M,,*59";
+
+	CHECK(nmea_parse_any(&frame, sentence, true) == NMEA_SENTENCE_GGA);
+	CHECK(nmea_parse_gga(&gga, sentence));
+	CHECK(!memcmp(&frame.data.gga.latitude, &gga.latitude, sizeof(gga.latitude)));
+	CHECK(!strcmp(frame.talker, "GN"));
+	CHECK(nmea_parse_any(&frame, "$GNGGA,123519,4807.038,N,01131.000,E,1,08,0.9,545.4,M,46.9,M,,*58", true) == NMEA_INVALID);
+}
+
+static bool test_decoder(void *ctx, struct nmea_sentence *frame, const char *sentence,
+                         const char *fields[], int count)
+{
+	(void) ctx;
+	(void) sentence;
+	frame->data.user[0] = (uint64_t) count;
+	frame->data.user[1] = (uint64_t) atoi(fields[1]);
+	return true;
+}
+
+static void test_register(void)
+{
+	struct nmea_sentence frame;
+	enum nmea_sentence_id id = nmea_register("PTST", test_decoder, NULL);
+
+	CHECK(id >= NMEA_SENTENCE_USER);
+	CHECK(nmea_register("RMC", NULL, NULL) == NMEA_INVALID);
+	CHECK(nmea_register("PTST", test_decoder, NULL) == id);
+	CHECK(nmea_parse_any(&frame, "$PTST,42,x*7D", true) == id);
+	CHECK(frame.data.user[0] == 3 && frame.data.user[1] == 42);
+	CHECK(nmea_sentence_type("$PTSX,42") == NMEA_INVALID);
+
+	// Собственное предложение с совпадающим с RMC окончанием адреса
+	enum nmea_sentence_id garmin = nmea_register("PGRMC", test_decoder, NULL);
+	CHECK(garmin >= NMEA_SENTENCE_USER && garmin != id);
+	CHECK(nmea_sentence_type("$PGRMC,1") == garmin);
+	CHECK(nmea_sentence_type("$GPRMC,1") == NMEA_SENTENCE_RMC);
+	CHECK(nmea_register("GPRMC", test_decoder, NULL) == NMEA_INVALID);
+}
+
+static void test_stream(void)
+{
+	static struct nmea_stream stream;
+	const char *input = "noise$GPGGA,1*00\r\n$GPR$GPZDA,2\n\x01$GP\x02ZDA\r\n";
+	struct nmea_span span;
+	int count = 0, bad = 0;
+
+	nmea_stream_init(&stream);
+	for (int round = 0; round < 500; round++) {
+		for (const char *p = input; *p; p++) {
+			bad += nmea_stream_push(&stream, p, 1) != 1;
+			while (nmea_stream_next(&stream, &span)) {
+				bad += span.data[0] != '$' || strlen(span.data) != span.len;
+				count++;
+			}
+		}
+	}
+	CHECK(!bad && count == 1000);
+	CHECK(stream.dropped == 1000);
+
+	// Самая длинная допустимая строка (NMEA_MAX_LENGTH + "*hh") выдается,
+	// на байт длиннее - отбрасывается, как в nmea_check()
+	char line[NMEA_MAX_LENGTH + 8];
+	for (int extra = 0; extra < 2; extra++) {
+		size_t len = NMEA_MAX_LENGTH + 3 + (size_t) extra;
+		memset(line, 'A', len);
+		memcpy(line, "$GPTXT,", 7);
+		line[len - 3] = '*';
+		line[len] = '\0';
+		snprintf(line + len - 2, 3, "%02X", nmea_checksum(line));
+		CHECK(nmea_check(line, true) == !extra);
+		line[len] = '\n';
+
+		nmea_stream_init(&stream);
+		CHECK(nmea_stream_push(&stream, line, len + 1) == len + 1);
+		bool got = nmea_stream_next(&stream, &span);
+		CHECK(got == !extra && stream.dropped == (unsigned long) extra);
+		CHECK(!got || (span.len == len && nmea_check(span.data, true)));
+	}
+}
+
+static void test_batch(void)
+{
+	const char *input =
+		"$GPRMC,081836,A,3751.65,S,14507.36,E,000.0,360.0,130998,011.3,E*62\r\n"
+		"$GPGGA,123519,4807.038,N,01131.000,E,1,08,0.9,545.4,M,46.9,M,,*47\n"
+		"$GPGGA,123519,4807.038,N*00\n"
+		"$GPGSV,4,4,13*7B\n"
+		"$GPGGA,1235";
+	int8_t type[4];
+	uint8_t valid[1];
+	int32_t time[4], latitude[4], longitude[4], altitude[4];
+	int16_t hdop[4];
+	int8_t satellites[4];
+	struct nmea_batch batch = {4, 0, NMEA_BATCH_TYPE(NMEA_SENTENCE_RMC) | NMEA_BATCH_TYPE(NMEA_SENTENCE_GGA), false, 0,
+	                           type, valid, time, latitude, longitude, altitude, hdop, satellites};
+
+	size_t used = nmea_parse_batch(&batch, input, strlen(input));
+	CHECK(used == strlen(input) - strlen("$GPGGA,1235"));
+	CHECK(batch.count == 2 && batch.rejected == 1);
+	CHECK(type[0] == NMEA_SENTENCE_RMC && time[0] == 29916000 && latitude[0] == -378608333);
+	CHECK(type[1] == NMEA_SENTENCE_GGA && altitude[1] == 545400 && hdop[1] == 90 && satellites[1] == 8);
+	CHECK(longitude[1] == 115166667 && (valid[0] & 3) == 3);
+
+	// Усеченное предложение, широта больше 90, время с мусором - отказ;
+	// высота вне int32_t в мм - нет значения
+	input =
+		"$GPGGA,123519,4807.038,N,01131.000,E,1,08\n"
+		"$GPGGA,123519,9959.000,N,01131.000,E,1,08,0.9,545.4,M,46.9,M,,\n"
+		"$GPGGA,123519x,4807.038,N,01131.000,E,1,08,0.9,545.4,M,46.9,M,,\n"
+		"$GPGGA,123519,4807.038,N,01131.000,E,1,08,0.9,5454444.4,M,46.9,M,,\n";
+	batch.count = 0;
+	batch.rejected = 0;
+	CHECK(nmea_parse_batch(&batch, input, strlen(input)) == strlen(input));
+	CHECK(batch.count == 1 && batch.rejected == 3);
+	CHECK(altitude[0] == NMEA_BATCH_NONE && latitude[0] == 481173000);
+}
+
+static void test_epoch(void)
+{
+	static struct nmea_epoch epoch;
+	struct nmea_sentence rmc, gga, gsa;
+	struct nmea_fix fix;
+
+	nmea_parse_any(&rmc, "$GPRMC,081836,A,3751.65,S,14507.36,E,000.0,360.0,130998,011.3,E*62", true);
+	nmea_parse_any(&gga, "$GPGGA,081836,4807.038,N,01131.000,E,1,08,0.9,545.4,M,46.9,M,,*4E", true);
+	nmea_parse_any(&gsa, "$GPGSA,A,3,04,05,,09,12,,,24,,,,,2.5,1.3,2.1*39", true);
+
+	nmea_epoch_init(&epoch, 0, 500);
+	CHECK(nmea_epoch_push(&epoch, &gga, 0) && nmea_epoch_push(&epoch, &gsa, 5));
+	CHECK(!nmea_epoch_pop(&epoch, &fix));
+	CHECK(nmea_epoch_push(&epoch, &rmc, 10));
+	CHECK(nmea_epoch_pop(&epoch, &fix) && fix.complete && fix.valid);
+	CHECK(fix.latitude.value == 4807038 && fix.date.year == 98 && fix.sats[2] == 9 && fix.speed.scale == 10);
+
+	// Следующая эпоха без RMC - по таймауту, опоздавшее RMC отбрасывается
+	gga.data.gga.time.seconds = 37;
+	CHECK(nmea_epoch_push(&epoch, &gga, 1000));
+	nmea_epoch_poll(&epoch, 1400);
+	CHECK(!nmea_epoch_pop(&epoch, &fix));
+	nmea_epoch_poll(&epoch, 1500);
+	CHECK(nmea_epoch_pop(&epoch, &fix) && !fix.complete && fix.time.seconds == 37 && fix.date.day == 13);
+	CHECK(!nmea_epoch_push(&epoch, &rmc, 1510) && epoch.late == 1);
+	CHECK(!nmea_epoch_push(&epoch, &gsa, 1520) && epoch.late == 2);
+	CHECK(epoch.emitted == 2 && epoch.timeouts == 1 && epoch.overflow == 0);
+}
+
+static void test_gsv(void)
+{
+	static struct nmea_gsv gsv;
+	const struct nmea_gsv_table *table;
+
+	nmea_gsv_init(&gsv);
+	CHECK(!nmea_gsv_parse(&gsv, "$GPGSV,3,1,11,03,03,111,00,04,15,270,00,06,01,010,00,13,06,292,00*74"));
+	CHECK(!nmea_gsv_parse(&gsv, "$GPGSV,3,2,11,14,25,170,00,16,57,208,39,18,67,296,40,19,40,246,00*74"));
+	CHECK(nmea_gsv_parse(&gsv, "$GLGSV,1,1,01,65,10,100,30*5B") != NULL);
+	table = nmea_gsv_parse(&gsv, "$GPGSV,3,3,11,22,42,067,42,24,14,311,43,27,05,244,00,,,,*4D");
+	CHECK(table && table->count == 11 && table->total_sats == 11 && table->cycle == 1);
+	CHECK(table->sats[5].nr == 16 && table->sats[5].snr == 39 && table->sats[10].nr == 27);
+	CHECK(nmea_gsv_table(&gsv, "GP") == table && !strcmp(table->talker, "GP"));
+	CHECK(nmea_gsv_table(&gsv, "GL") && nmea_gsv_table(&gsv, "GL")->sats[0].nr == 65);
+
+	// Пропущенная часть - цикл отбрасывается, опубликованная таблица не меняется
+	CHECK(!nmea_gsv_parse(&gsv, "$GPGSV,3,1,11,03,03,111,00,04,15,270,00,06,01,010,00,13,06,292,00*74"));
+	CHECK(!nmea_gsv_parse(&gsv, "$GPGSV,3,3,11,22,42,067,42,24,14,311,43,27,05,244,00,,,,*4D"));
+	CHECK(gsv.dropped == 1 && nmea_gsv_table(&gsv, "GP") == table && table->count == 11);
+}
+
+static void test_view(void)
+{
+	// Буфер приема: предложения подряд, без '\0'
+	const char rx[] = "$GPGGA,123519,4807.038,N,01131.000,E,1,08,0.9,545.4,M,46.9,M,,*47\r\n$GPZDA,201530.00,04,07,2002,00,00*60\r\n";
+	size_t first = strchr(rx, '\n') + 1 - rx;
+	struct nmea_sentence frame;
+	struct nmea_view view;
+	struct nmea_float f;
+	struct nmea_time t;
+	char buf[4];
+	int value;
+
+	CHECK(nmea_check_n(rx, first, true));
+	CHECK(!nmea_check_n(rx, first - 1, true));
+	CHECK(!nmea_check_n(rx, first + 1, true));
+	CHECK(nmea_parse_any_n(&frame, rx, first, true) == NMEA_SENTENCE_GGA);
+	CHECK(frame.data.gga.satellites_tracked == 8);
+	CHECK(nmea_parse_any_n(&frame, rx + first, sizeof(rx) - 1 - first, true) == NMEA_SENTENCE_ZDA);
+	CHECK(frame.data.zda.date.year == 2002);
+
+	CHECK(nmea_view_split(&view, rx, first, true) == 15);
+	CHECK(nmea_view_type(&view) == NMEA_SENTENCE_GGA);
+	CHECK(nmea_view_float(&view, 2, &f) && f.value == 4807038 && f.scale == 1000);
+	CHECK(nmea_view_direction(&view, 3, &value) && value == 1);
+	CHECK(nmea_view_int(&view, 7, &value) && value == 8);
+	CHECK(nmea_view_time(&view, 1, &t) && t.hours == 12 && t.seconds == 19);
+	CHECK(nmea_view_char(&view, 10) == 'M' && nmea_view_char(&view, 13) == '\0');
+	CHECK(nmea_view_string(&view, 4, buf, sizeof(buf)) == 9 && !strcmp(buf, "011"));
+	CHECK(nmea_view_float(&view, 20, &f) && f.scale == 0);
+
+	// Без "*hh" и конца строки последнее поле заканчивается границей буфера
+	CHECK(nmea_view_split(&view, "$GPZDA,201530.00,04,07,2002,00,0012", 33, false) == 7);
+	CHECK(nmea_view_int(&view, 6, &value) && value == 0);
+	CHECK(nmea_parse_any_n(&frame, "$GPZDA,201530.00,04,07,2002,00,0012", 33, false) == NMEA_SENTENCE_ZDA);
+	CHECK(!nmea_view_split(&view, "$GPZDA,201530.00,04,07,2002,00,00", 33, true));
+}
+
+static void test_log(void)
+{
+	static struct nmea_log_record records[NMEA_LOG_BLOCK];
+	struct nmea_log_record r;
+	struct nmea_log_reader reader;
+	const struct nmea_log_block *block;
+	FILE *file = tmpfile();
+	struct nmea_log_writer *writer = file ? nmea_log_writer_create(file) : NULL;
+	int n = 1500, bad = 0;
+
+	CHECK(writer != NULL);
+	if (!writer)
+		return;
+
+	memset(&r, 0, sizeof(r));
+	for (int i = 0; i < n; i++) {
+		r.time = 1700000000000000 + (int64_t) i * 1000000;
+		r.latitude = (struct nmea_float) {48070380 + i, 10000};
+		r.longitude = (struct nmea_float) {-11310000 - 3 * i, 10000};
+		// Масштаб высоты меняется, скорости нет
+		r.altitude = i % 7 ? (struct nmea_float) {5454, 10} : (struct nmea_float) {54540, 100};
+		r.speed = (struct nmea_float) {0, 0};
+		r.hdop = (struct nmea_float) {9, 10};
+		r.fix_quality = i % 3 - 1;
+		r.satellites = 8 + i % 2;
+		r.valid = i % 5 != 0;
+		bad += nmea_log_append(writer, &r) != 0;
+	}
+	r.latitude.scale = 3;
+	CHECK(nmea_log_append(writer, &r) == -1 && errno == EINVAL);
+	CHECK(!bad && nmea_log_writer_close(writer) == 0);
+
+	long size = ftell(file);
+	uint64_t *data = malloc((size_t) size + 8);
+	rewind(file);
+	CHECK(data && fread(data, 1, (size_t) size, file) == (size_t) size);
+	fclose(file);
+	if (!data)
+		return;
+	// Не менее 10 раз меньше текста RMC+GGA (~140 байт на эпоху)
+	CHECK(size < n * 14);
+
+	CHECK(nmea_log_reader_init(&reader, data, (size_t) size) == 0);
+	int total = 0, blocks = 0;
+	while ((block = nmea_log_next(&reader))) {
+		int count = nmea_log_decode(block, records);
+		blocks++;
+		for (int i = 0; i < count; i++, total++) {
+			const struct nmea_log_record *d = &records[i];
+			int k = total;
+			if (d->time != 1700000000000000 + (int64_t) k * 1000000 ||
+			    d->latitude.value != 48070380 + k || d->latitude.scale != 10000 ||
+			    d->longitude.value != -11310000 - 3 * k ||
+			    d->altitude.value != (k % 7 ? 5454 : 54540) || d->altitude.scale != (k % 7 ? 10 : 100) ||
+			    d->speed.scale != 0 || d->hdop.value != 9 || d->fix_quality != k % 3 - 1 ||
+			    d->satellites != 8 + k % 2 || d->valid != (k % 5 != 0))
+				bad++;
+		}
+	}
+	CHECK(blocks == 2 && total == n && !bad);
+
+	// Пропуск блока по времени без декодирования
+	nmea_log_reader_init(&reader, data, (size_t) size);
+	block = nmea_log_next(&reader);
+	CHECK(block && !nmea_log_overlaps(block, 1700000000000000 + 1100 * 1000000LL, INT64_MAX));
+	CHECK(block && block->latitude_min == 481173000 && block->longitude_max == -115166666);
+
+	CHECK(nmea_log_reader_init(&reader, data, (size_t) size - 8) == 0);
+	nmea_log_next(&reader);
+	CHECK(!nmea_log_next(&reader));
+
+	// Журнал с другим порядком байт (переставленная сигнатура блока)
+	uint8_t *magic = (uint8_t *) data + 16, swap;
+	swap = magic[0], magic[0] = magic[3], magic[3] = swap;
+	swap = magic[1], magic[1] = magic[2], magic[2] = swap;
+	errno = 0;
+	CHECK(nmea_log_reader_init(&reader, data, (size_t) size) == -1 && errno == EINVAL);
+	free(data);
+}
+
+static void test_index(void)
+{
+	// 2024-06-14 23:59:45 UTC, 30 эпох через полночь: GGA, RMC, GSA
+	const int64_t start = 1718409585;
+	static char capture[30 * 3 * 96];
+	struct nmea_index index, loaded;
+	size_t len = 0;
+	FILE *file;
+
+	for (int i = 0; i < 30; i++) {
+		int t = (int) ((start + i) % 86400);
+		len += (size_t) sprintf(capture + len, "$GPGGA,%02d%02d%02d.00,4807.038,N,01131.000,E,1,08,0.9,545.4,M,46.9,M,,\r\n",
+		                        t / 3600, t / 60 % 60, t % 60);
+		len += (size_t) sprintf(capture + len, "$GPRMC,%02d%02d%02d.00,A,4807.038,N,01131.000,E,0.0,0.0,%s,,\r\n",
+		                        t / 3600, t / 60 % 60, t % 60, i < 15 ? "140624" : "150624");
+		len += (size_t) sprintf(capture + len, "$GPGSA,A,3,04,05,,09,12,,,24,,,,,2.5,1.3,2.1\r\n");
+	}
+
+	// Захват дописывается: разбор продолжается с index.scanned
+	nmea_index_init(&index, 5);
+	CHECK(nmea_index_update(&index, capture, len / 2 + 7) > 0 && index.scanned < len / 2 + 7);
+	CHECK(nmea_index_update(&index, capture + index.scanned, len - index.scanned) > 0 && index.scanned == len);
+	CHECK(index.count == 6 && index.entries[3].time == start + 15 && index.clock.last == start + 29);
+	CHECK(!strncmp(capture + index.entries[3].offset, "$GPRMC,000000.00", 16));
+	CHECK(nmea_index_seek(&index, start + 15) == index.entries[2].offset);
+	CHECK(nmea_index_seek(&index, start) == 0);
+
+	// GGA после полуночи до первого RMC новых суток
+	struct nmea_index_clock clock = {-1, -1};
+	struct nmea_sentence frame;
+	int64_t t = 0;
+	nmea_parse_any(&frame, "$GPRMC,235959.00,A,4807.038,N,01131.000,E,0.0,0.0,140624,,", false);
+	CHECK(nmea_index_time(&clock, &frame, &t) && t == start + 14);
+	nmea_parse_any(&frame, "$GPGGA,000000.00,4807.038,N,01131.000,E,1,08,0.9,545.4,M,46.9,M,,", false);
+	CHECK(nmea_index_time(&clock, &frame, &t) && t == start + 15);
+
+	file = tmpfile();
+	CHECK(file && !nmea_index_save(&index, file));
+	if (file) {
+		rewind(file);
+		CHECK(!nmea_index_load(&loaded, file) && loaded.count == index.count && loaded.scanned == index.scanned &&
+		      !memcmp(loaded.entries, index.entries, index.count * sizeof(*index.entries)));
+		nmea_index_free(&loaded);
+		fclose(file);
+	}
+	nmea_index_free(&index);
+}
+
+static void test_write(void)
+{
+	static const char *lines[] = {
+		"$GPRMC,081836,A,3751.65,S,14507.36,E,000.0,360.0,130998,011.3,E*62",
+		"$GPGGA,123519,4807.038,N,01131.000,E,1,08,0.9,545.4,M,46.9,M,,*47",
+		"$GPGSA,A,3,04,05,,09,12,,,24,,,,,2.5,1.3,2.1*39",
+		"$GPGLL,3723.2475,N,12158.3416,W,161229.487,A,A*41",
+		"$GPGST,024603.00,3.2,6.6,4.7,47.3,5.8,5.6,22.0*58",
+		"$GPGSV,3,3,11,22,42,067,42,24,14,311,43,27,05,244,00,,,,*4D",
+		"$GPVTG,096.5,T,083.5,M,0.0,N,0.0,K,D*22",
+		"$GPZDA,201530.00,04,07,2002,-05,00*48",
+	};
+	struct nmea_sentence frame, again;
+	char buf[NMEA_WRITE_MAX];
+	int bad = 0;
+
+	// Разбор -> запись -> разбор дает ту же структуру
+	for (size_t i = 0; i < sizeof(lines) / sizeof(lines[0]); i++) {
+		memset(&frame, 0, sizeof(frame));
+		memset(&again, 0, sizeof(again));
+		if (nmea_parse_any(&frame, lines[i], false) <= NMEA_UNKNOWN) {
+			bad++;
+			continue;
+		}
+		size_t len = nmea_write_sentence(buf, &frame);
+		if (len != strlen(buf) || !nmea_check(buf, true) || nmea_parse_any(&again, buf, true) != frame.id ||
+		    memcmp(&frame, &again, sizeof(frame))) {
+			printf("%s -> %s", lines[i], buf);
+			bad++;
+		}
+	}
+	CHECK(!bad);
+
+	nmea_parse_any(&frame, lines[1], false);
+	nmea_write_sentence(buf, &frame);
+	CHECK(!strcmp(buf, "$GPGGA,123519.00,4807.038,N,01131.000,E,1,08,0.9,545.4,M,46.9,M,,*69\r\n"));
+
+	struct nmea_float f = {-5, 1000};
+	nmea_ftoa(&f, buf);
+	CHECK(!strcmp(buf, "-0.005"));
+}
+
+static void put_le(uint8_t *p, uint32_t v, int n)
+{
+	for (int i = 0; i < n; i++)
+		p[i] = (uint8_t) (v >> (8 * i));
+}
+
+static size_t ubx_frame(uint8_t *frame, uint8_t id, const uint8_t *payload, size_t len)
+{
+	frame[0] = NMEA_UBX_SYNC1;
+	frame[1] = NMEA_UBX_SYNC2;
+	frame[2] = NMEA_UBX_CLASS_NAV;
+	frame[3] = id;
+	put_le(frame + 4, (uint32_t) len, 2);
+	memcpy(frame + NMEA_UBX_HEADER, payload, len);
+	put_le(frame + NMEA_UBX_HEADER + len, nmea_ubx_checksum(frame + 2, len + 4), 2);
+	return len + NMEA_UBX_OVERHEAD;
+}
+
+static void test_ubx(void)
+{
+	static const char rmc[] = "$GPRMC,081836,A,3751.65,S,14507.36,E,000.0,360.0,130998,011.3,E*62\r\n";
+	uint8_t pvt[NMEA_UBX_NAV_PVT_LEN] = {0}, sat[8 + 2 * 12] = {0}, utc[NMEA_UBX_NAV_TIMEUTC_LEN] = {0};
+	uint8_t data[512];
+	size_t len = 0;
+
+	// CFG-RATE из nmea.c: CK_A 0x7A, CK_B 0x12
+	CHECK(nmea_ubx_checksum(updateFreq + 2, FREQ_LEN - 4) == 0x127A);
+
+	// 2024-01-01 00:00:00 - 0.25 с: сутки назад
+	put_le(pvt + 4, 2024, 2);
+	pvt[6] = 1, pvt[7] = 1;
+	pvt[11] = 0x07;
+	put_le(pvt + 16, (uint32_t) -250000000, 4);
+	pvt[20] = 3, pvt[21] = 0x83, pvt[23] = 12;
+	put_le(pvt + 24, 1451226000, 4);
+	put_le(pvt + 28, (uint32_t) -378608333, 4);
+	put_le(pvt + 32, 40000, 4);
+	put_le(pvt + 36, 15200, 4);
+	put_le(pvt + 60, 1852, 4);
+	put_le(pvt + 64, 9050000, 4);
+	put_le(pvt + 76, 180, 2);
+
+	sat[5] = 2;
+	sat[8] = 6, sat[9] = 3, sat[10] = 40, sat[11] = 35, put_le(sat + 12, 211, 2), sat[16] = 0x08;
+	sat[20] = 0, sat[21] = 7, sat[22] = 30, sat[23] = (uint8_t) -2, put_le(sat + 24, 45, 2);
+
+	put_le(utc + 8, 500000000, 4);
+	put_le(utc + 12, 2023, 2);
+	utc[14] = 12, utc[15] = 31, utc[16] = 23, utc[17] = 59, utc[18] = 59, utc[19] = 0x07;
+
+	// Мусор, NMEA, NAV-PVT, испорченный кадр, NAV-SAT, NMEA без "\r\n" до кадра, NAV-TIMEUTC
+	memcpy(data, "\x01\xB5junk", 6);
+	len = 6;
+	memcpy(data + len, rmc, sizeof(rmc) - 1);
+	len += sizeof(rmc) - 1;
+	len += ubx_frame(data + len, NMEA_UBX_NAV_PVT, pvt, sizeof(pvt));
+	size_t bad = len;
+	len += ubx_frame(data + len, NMEA_UBX_NAV_SAT, sat, sizeof(sat));
+	data[bad + 10] ^= 1;
+	len += ubx_frame(data + len, NMEA_UBX_NAV_SAT, sat, sizeof(sat));
+	memcpy(data + len, "$GPGGA,1", 8);
+	len += 8;
+	len += ubx_frame(data + len, NMEA_UBX_NAV_TIMEUTC, utc, sizeof(utc));
+
+	struct nmea_ubx_stream *stream = malloc(sizeof(*stream));
+	struct nmea_ubx_item item;
+	struct nmea_fix fix, clock;
+	struct nmea_sat_info sats[4];
+	int packets = 0, lines = 0;
+
+	nmea_ubx_init(stream);
+	nmea_ubx_fix_init(&fix);
+	nmea_ubx_fix_init(&clock);
+	// Поток по 7 байт: кадры и строки на границах записей
+	for (size_t i = 0; i < len; i += 7) {
+		nmea_ubx_push(stream, data + i, len - i < 7 ? len - i : 7);
+		while (nmea_ubx_next(stream, &item)) {
+			if (item.kind == NMEA_UBX_NMEA) {
+				lines++;
+				CHECK(!strcmp(item.data.sentence.data, "$GPRMC,081836,A,3751.65,S,14507.36,E,000.0,360.0,130998,011.3,E*62"));
+				continue;
+			}
+			packets++;
+			if (item.data.packet.id == NMEA_UBX_NAV_SAT)
+				CHECK(nmea_ubx_sats(&item.data.packet, sats, 4) == 2 && sats[0].nr == 67 && sats[0].azimuth == 211 &&
+				      sats[1].nr == 7 && sats[1].elevation == -2 && sats[1].snr == 30);
+			CHECK(nmea_ubx_decode(item.data.packet.id == NMEA_UBX_NAV_TIMEUTC ? &clock : &fix, &item.data.packet));
+		}
+	}
+	CHECK(lines == 1 && packets == 3);
+	CHECK(stream->errors == 1 && stream->dropped == 1);
+
+	CHECK(fix.date.year == 2023 && fix.date.month == 12 && fix.date.day == 31);
+	CHECK(fix.time.hours == 23 && fix.time.minutes == 59 && fix.time.seconds == 59 && fix.time.microseconds == 750000);
+	CHECK(fix.valid && fix.fix_quality == 4 && fix.fix_type == 3 && fix.satellites_tracked == 12);
+	CHECK(fix.latitude.value == -3751649998 && fix.latitude.scale == 1000000);
+	CHECK(fix.longitude.value == 14507356000 && fix.longitude.scale == 1000000);
+	CHECK(fabsf(nmea_tocoord(&fix.latitude) + 37.8608333f) < 1e-5f);
+	CHECK(fix.altitude.value == 15200 && fix.height.value == 24800 && fix.speed.value == 3600);
+	CHECK(nmea_tofloat(&fix.course) == 90.5f && nmea_tofloat(&fix.pdop) == 1.8f);
+	CHECK(fix.sats_in_view == 2 && fix.sats[0] == 67 && fix.sats[1] == 0);
+	CHECK(fix.types == (NMEA_EPOCH_TYPE(NMEA_SENTENCE_RMC) | NMEA_EPOCH_TYPE(NMEA_SENTENCE_GGA) |
+	                    NMEA_EPOCH_TYPE(NMEA_SENTENCE_GSA) | NMEA_EPOCH_TYPE(NMEA_SENTENCE_GSV)));
+
+	// 23:59:59 + 0.5 с остается в тех же сутках
+	CHECK(clock.date.year == 2023 && clock.date.day == 31 && clock.time.seconds == 59 &&
+	      clock.time.microseconds == 500000 && clock.types == NMEA_EPOCH_TYPE(NMEA_SENTENCE_ZDA));
+
+	free(stream);
+}
+
+static void test_ubx_cfg(void)
+{
+	static const uint8_t gga_off[] = {0xB5, 0x62, 0x06, 0x01, 0x08, 0x00, 0xF0, 0x00,
+	                                  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xFF, 0x23};
+	static const uint8_t vtg_on[] = {0xB5, 0x62, 0x06, 0x01, 0x08, 0x00, 0xF0, 0x05,
+	                                 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x0A, 0x5B};
+	static const uint8_t rate[] = {0xB5, 0x62, 0x06, 0x08, 0x06, 0x00, 0x64, 0x00, 0x01, 0x00, 0x01, 0x00, 0x7A, 0x12};
+	static const uint8_t baud[] = {0xB5, 0x62, 0x06, 0x00, 0x14, 0x00, 0x01, 0x00, 0x00, 0x00, 0xD0, 0x08, 0x00, 0x00,
+	                               0x00, 0xC2, 0x01, 0x00, 0x07, 0x00, 0x03, 0x00, 0x00, 0x00, 0x00, 0x00, 0xC0, 0x7E};
+	static const uint8_t rate_25hz[NMEA_UBX_CFG_RATE_LEN] = NMEA_UBX_CFG_RATE_INIT(40, 1, 0);
+	static const uint8_t prt_921600[NMEA_UBX_CFG_PRT_LEN] =
+		NMEA_UBX_CFG_PRT_INIT(NMEA_UBX_PORT_UART2, NMEA_UBX_PRT_8N1, 921600, NMEA_UBX_PROTO_UBX, NMEA_UBX_PROTO_UBX);
+	static const uint8_t gsv_uart1[NMEA_UBX_CFG_MSG_LEN] =
+		NMEA_UBX_CFG_MSG_INIT(NMEA_UBX_CLASS_NMEA, NMEA_UBX_NMEA_GSV, 0, 5, 0, 0, 0, 0);
+	const uint8_t ports[NMEA_UBX_PORTS] = {0, 5, 0, 0, 0, 0};
+	uint8_t buf[64];
+
+	// Таблицы прежнего API побайтно совпадают с записанными вручную
+	CHECK(!memcmp(turn_Off_GPGGA, gga_off, sizeof(gga_off)) && !memcmp(turn_On_GPVTG, vtg_on, sizeof(vtg_on)));
+	CHECK(!memcmp(updateFreq, rate, sizeof(rate)) && !memcmp(changeBaud, baud, sizeof(baud)));
+
+	// Кадры времени компиляции и построенные при выполнении
+	CHECK(nmea_ubx_cfg_rate(buf, 40, 1, 0) == NMEA_UBX_CFG_RATE_LEN && !memcmp(buf, rate_25hz, sizeof(rate_25hz)));
+	CHECK(nmea_ubx_cfg_prt(buf, NMEA_UBX_PORT_UART2, 921600, NMEA_UBX_PROTO_UBX, NMEA_UBX_PROTO_UBX) == NMEA_UBX_CFG_PRT_LEN &&
+	      !memcmp(buf, prt_921600, sizeof(prt_921600)));
+	CHECK(nmea_ubx_cfg_nmea(buf, NMEA_SENTENCE_GSV, ports) == NMEA_UBX_CFG_MSG_LEN && !memcmp(buf, gsv_uart1, sizeof(gsv_uart1)));
+	CHECK(nmea_ubx_cfg_nmea(buf, NMEA_UNKNOWN, ports) == 0);
+
+	// Кадр проходит разбор потока
+	struct nmea_ubx_stream *stream = malloc(sizeof(*stream));
+	struct nmea_ubx_item item;
+	nmea_ubx_init(stream);
+	nmea_ubx_push(stream, prt_921600, sizeof(prt_921600));
+	CHECK(nmea_ubx_next(stream, &item) == NMEA_UBX_PACKET && item.data.packet.class_ == NMEA_UBX_CLASS_CFG &&
+	      item.data.packet.len == 20 && item.data.packet.payload[10] == 0x0E);
+	free(stream);
+}
+
+#ifndef _WIN32
+static void *stats_thread(void *arg)
+{
+	struct nmea_sentence frame;
+
+	(void) arg;
+	nmea_parse_any(&frame, "$GPRMC,081836,A,3751.65,S,14507.36,E,000.0,360.0,130998,011.3,E*62", false);
+	return NULL;
+}
+#endif
+
+static void test_stats(void)
+{
+	static struct nmea_stats before, after;
+	struct nmea_sentence frame;
+	int direction;
+	char line[NMEA_MAX_LENGTH + 16];
+
+	nmea_stats_snapshot(&before);
+	nmea_parse_any(&frame, "$GPRMC,081836,A,3751.65,S,14507.36,E,000.0,360.0,130998,011.3,E*62", false);
+	nmea_parse_any(&frame, "$GPRMC,081836,A,3751.65,S,14507.36,E,000.0,360.0,130998,011.3,E*63", false);
+	nmea_parse_any(&frame, "$GPGLL,3723.2475,X,12158.3416,W,161229.487,A,A", false);
+	nmea_scan("$GPXXX,Q", "t;d", line, &direction);
+	memset(line, 'A', sizeof(line) - 1);
+	line[0] = '$';
+	line[sizeof(line) - 1] = '\0';
+	CHECK(!nmea_check(line, false));
+	nmea_stats_snapshot(&after);
+
+	CHECK(!strcmp(nmea_reject_name(NMEA_REJECT_CHECKSUM), "checksum"));
+	if (!after.enabled) {
+		CHECK(after.threads == 0 && after.sentences[NMEA_SENTENCE_RMC + 1] == 0);
+		return;
+	}
+
+	// Время измерено не более чем у каждого NMEA_STATS_SAMPLE-го разбора
+	uint64_t samples = 0, sentences = 0;
+	for (int t = 0; t < NMEA_STATS_TYPES; t++) {
+		sentences += after.sentences[t];
+		for (int b = 0; b < NMEA_STATS_BUCKETS; b++)
+			samples += after.latency[t][b];
+	}
+	CHECK(after.threads >= 1 && samples <= sentences / NMEA_STATS_SAMPLE + 1);
+	CHECK(after.sentences[NMEA_SENTENCE_RMC + 1] - before.sentences[NMEA_SENTENCE_RMC + 1] == 1);
+	CHECK(after.bytes[NMEA_SENTENCE_RMC + 1] - before.bytes[NMEA_SENTENCE_RMC + 1] == 66);
+	CHECK(after.sentences[0] - before.sentences[0] == 2);
+	CHECK(after.rejects[NMEA_REJECT_CHECKSUM] - before.rejects[NMEA_REJECT_CHECKSUM] == 1);
+	CHECK(after.rejects[NMEA_REJECT_DIRECTION] - before.rejects[NMEA_REJECT_DIRECTION] == 2);
+	CHECK(after.rejects[NMEA_REJECT_LENGTH] - before.rejects[NMEA_REJECT_LENGTH] == 1);
+
+#ifndef _WIN32
+	// Завершенные потоки: счетчики сохраняются, блоки используются повторно
+	for (int i = 0; i < 8; i++) {
+		pthread_t thread;
+		CHECK(pthread_create(&thread, NULL, stats_thread, NULL) == 0 && pthread_join(thread, NULL) == 0);
+	}
+	nmea_stats_snapshot(&before);
+	CHECK(before.threads == after.threads);
+	CHECK(before.sentences[NMEA_SENTENCE_RMC + 1] - after.sentences[NMEA_SENTENCE_RMC + 1] == 8);
+#endif
+}
+
+static void test_coord(void)
+{
+	static const int_least64_t scales[] = {1, 10, 100, 1000, 10000, 100000};
+	enum { N = 1003 };
+	static struct nmea_float in[N];
+	static double deg[N];
+	static int32_t e7[N];
+	uint32_t seed = 12345;
+	int bad_deg = 0, bad_e7 = 0;
+
+	// Серии одинакового scale со сменой, пустые значения, хвост не кратный 4
+	for (int i = 0; i < N; i++) {
+		seed = seed * 1103515245u + 12345u;
+		int_least64_t scale = scales[(i / 37) % 6];
+		int_least64_t minutes = (int_least64_t) (seed >> 8) % (60 * scale);
+		int_least64_t degrees = (int_least64_t) (seed >> 3) % 180;
+		in[i].scale = (i % 101 == 7) ? 0 : scale;
+		in[i].value = (degrees * 100 * scale + minutes) * ((seed & 1) ? -1 : 1);
+	}
+	nmea_coord_degrees(deg, in, N);
+	nmea_coord_e7(e7, in, N);
+
+	for (int i = 0; i < N; i++) {
+		if (!in[i].scale) {
+			bad_deg += deg[i] == deg[i];
+			bad_e7 += e7[i] != NMEA_COORD_NONE;
+			continue;
+		}
+		int_least64_t div = in[i].scale * 100;
+		int_least64_t mag = in[i].value < 0 ? -in[i].value : in[i].value;
+		int_least64_t rem = mag % div;
+		int_least64_t fixed = mag / div * 10000000 + (rem * 20000000 + 60 * in[i].scale) / (120 * in[i].scale);
+		double exact = (double) (mag / div) + (double) rem / (60.0 * (double) in[i].scale);
+		if (in[i].value < 0) {
+			fixed = -fixed;
+			exact = -exact;
+		}
+		bad_deg += fabs(deg[i] - exact) > 1e-12;
+		bad_e7 += e7[i] != fixed;
+	}
+	CHECK(bad_deg == 0);
+	CHECK(bad_e7 == 0);
+
+	// Как nmea_tocoord, но в double; за пределами int32 - NMEA_COORD_NONE
+	struct nmea_float one[5] = {{375165, 100}, {-1450736, 100}, {0, 1}, {21500000, 1000}, {0, 0}};
+	nmea_coord_degrees(deg, one, 5);
+	nmea_coord_e7(e7, one, 5);
+	CHECK(fabs(deg[0] - 37.8608333333333) < 1e-12 && fabs(deg[1] - nmea_tocoord(&one[1])) < 1e-5);
+	CHECK(e7[0] == 378608333 && e7[1] == -1451226667 && e7[2] == 0);
+	CHECK(e7[3] == NMEA_COORD_NONE && e7[4] == NMEA_COORD_NONE && isnan(deg[4]));
+	CHECK(!strcmp(nmea_coord_kernel(), "avx2") || !strcmp(nmea_coord_kernel(), "scalar"));
+}
+
+static void test_geo(void)
+{
+	static const double angles[] = {0.0, 30.0, 45.0, -45.0, 90.0, 135.5, -180.0, 359.9, 1e-9};
+	double lat[7] = {48.1173, -37.8608333333333, 60.0, 0.0, 85.0, 0.0, 90.0};
+	double lon[7] = {11.5167, 145.1226666666667, 5.0, 3.0, 10.0, 0.0, 0.0};
+	double h[7] = {592.3, 15.2, 0.0, 0.0, 0.0, 0.0, 0.0};
+	double x[7], y[7], z[7], one[3], e[7], n[7];
+	int8_t zone[7];
+	struct nmea_geo_origin origin;
+	struct nmea_sentence_gga gga;
+	bool same = true;
+
+	for (size_t i = 0; i < sizeof(angles) / sizeof(angles[0]); i++) {
+		double s, c;
+		nmea_geo_sincos(angles[i], &s, &c);
+		CHECK(fabs(s - sin(angles[i] * M_PI / 180)) < 3e-16 && fabs(c - cos(angles[i] * M_PI / 180)) < 3e-16);
+	}
+
+	// Блок AVX2 и хвост совпадают побитно со скалярным расчетом по одной точке
+	nmea_geo_ecef(x, y, z, lat, lon, h, 7);
+	for (int i = 0; i < 7; i++) {
+		nmea_geo_ecef(&one[0], &one[1], &one[2], &lat[i], &lon[i], &h[i], 1);
+		same &= !memcmp(&one[0], &x[i], sizeof(double)) && !memcmp(&one[2], &z[i], sizeof(double));
+	}
+	CHECK(same);
+	CHECK(fabs(x[5] - NMEA_GEO_A) < 1e-9 && fabs(y[5]) < 1e-9 && fabs(z[5]) < 1e-9);
+	CHECK(fabs(x[6]) < 1e-9 && fabs(z[6] - 6356752.314245) < 1e-6);
+
+	// ENU: начало в нуле, 1e-5 градуса к северу - около 1.11 м
+	nmea_geo_origin(&origin, lat[0], lon[0], h[0]);
+	lat[5] = lat[0] + 1e-5, lon[5] = lon[0], h[5] = h[0];
+	nmea_geo_enu(&origin, x, y, z, lat, lon, h, 7);
+	CHECK(fabs(x[0]) < 1e-8 && fabs(y[0]) < 1e-8 && fabs(z[0]) < 1e-8);
+	CHECK(fabs(x[5]) < 1e-6 && fabs(y[5] - 1.1122) < 1e-3 && fabs(z[5]) < 1e-6);
+
+	// UTM против ряда Крюгера; Норвегия - зона 32, выше 84 - нет зоны
+	lat[5] = 0.0, lon[5] = 0.0;
+	nmea_geo_utm(e, n, zone, lat, lon, 7, 0);
+	CHECK(zone[0] == 32 && fabs(e[0] - 687302.0557) < 1e-3 && fabs(n[0] - 5332401.3267) < 1e-3);
+	CHECK(zone[1] == -55 && fabs(e[1] - 334856.7953) < 1e-3 && fabs(n[1] - 5807964.7950) < 1e-3);
+	CHECK(zone[2] == 32 && fabs(e[2] - 276979.9264) < 1e-3 && fabs(n[2] - 6658157.2024) < 1e-3);
+	CHECK(zone[3] == 31 && fabs(e[3] - 500000.0) < 1e-6 && fabs(n[3]) < 1e-6);
+	CHECK(zone[4] == 0 && isnan(e[4]) && isnan(n[4]));
+	nmea_geo_utm(e, n, zone, lat, lon, 1, 33);
+	CHECK(zone[0] == 33 && e[0] < 500000.0);
+
+	CHECK(nmea_parse_gga(&gga, "$GPGGA,123519,4807.038,N,01131.000,E,1,08,0.9,545.4,M,46.9,M,,*47"));
+	CHECK(nmea_geo_from_gga(lat, lon, h, &gga, 1) == 1);
+	CHECK(fabs(lat[0] - 48.1173) < 1e-12 && fabs(lon[0] - 11.5166666666667) < 1e-12 && fabs(h[0] - 592.3) < 1e-9);
+	CHECK(!strcmp(nmea_geo_kernel(), nmea_coord_kernel()));
+}
+
+static void test_fixed(void)
+{
+	static const struct nmea_fixed_units units = NMEA_FIXED_UNITS_INIT;
+	struct nmea_fixed_units fine = NMEA_FIXED_UNITS_INIT;
+	struct nmea_fixed frame;
+	int64_t value;
+
+	CHECK(nmea_number_fixed("12.345", 2, &value) && value == 1234);
+	CHECK(nmea_number_fixed("-0.5", 3, &value) && value == -500);
+	CHECK(nmea_number_fixed("7", 0, &value) && value == 7);
+	CHECK(!nmea_number_fixed(",", 2, &value));
+	CHECK(nmea_number_coord("3751.65", 7, &value) && value == 378608333);
+	CHECK(nmea_number_coord("14507.36", 7, &value) && value == 1451226667);
+	CHECK(!nmea_number_coord("100000.0", 7, &value));
+
+	CHECK(nmea_parse_fixed(&frame, "$GPRMC,081836,A,3751.65,S,14507.36,E,000.0,360.0,130998,011.3,E*62", false, &units) == NMEA_SENTENCE_RMC);
+	CHECK(frame.data.rmc.valid);
+	CHECK(frame.data.rmc.latitude == -378608333);
+	CHECK(frame.data.rmc.longitude == 1451226667);
+	CHECK(frame.data.rmc.speed == 0);
+	CHECK(frame.data.rmc.course == 36000);
+	CHECK(frame.data.rmc.variation == 1130);
+	CHECK(frame.data.rmc.date.year == 98 && frame.data.rmc.time.hours == 8);
+
+	CHECK(nmea_parse_fixed(&frame, "$GPGGA,123519,4807.038,N,01131.000,E,1,08,0.9,545.4,M,46.9,M,,*47", false, &units) == NMEA_SENTENCE_GGA);
+	CHECK(frame.data.gga.latitude == 481173000);
+	CHECK(frame.data.gga.longitude == 115166667);
+	CHECK(frame.data.gga.hdop == 90);
+	CHECK(frame.data.gga.altitude == 545400);
+	CHECK(frame.data.gga.height == 46900);
+	CHECK(frame.data.gga.dgps_age == NMEA_FIXED_NONE);
+	CHECK(frame.data.gga.satellites_tracked == 8);
+
+	CHECK(nmea_parse_fixed(&frame, "$GPGSA,A,3,04,05,,09,12,,,24,,,,,2.5,1.3,2.1*39", false, &units) == NMEA_SENTENCE_GSA);
+	CHECK(frame.data.gsa.pdop == 250 && frame.data.gsa.hdop == 130 && frame.data.gsa.vdop == 210);
+	CHECK(frame.data.gsa.sats[0] == 4 && frame.data.gsa.sats[2] == 0);
+
+	// Узлы и км/ч в мм/с
+	CHECK(nmea_parse_fixed(&frame, "$GPVTG,054.7,T,034.4,M,005.5,N,010.2,K*48", false, &units) == NMEA_SENTENCE_VTG);
+	CHECK(frame.data.vtg.true_track_degrees == 5470 && frame.data.vtg.magnetic_track_degrees == 3440);
+	CHECK(frame.data.vtg.speed == 2829);
+	CHECK(nmea_parse_fixed(&frame, "$GPVTG,054.7,T,034.4,M,,N,010.2,K", false, &units) == NMEA_SENTENCE_VTG);
+	CHECK(frame.data.vtg.speed == 2833);
+
+	// Пустые поля и координата без направления
+	CHECK(nmea_parse_fixed(&frame, "$GPRMC,,V,3751.65,,,,,,,,", false, &units) == NMEA_SENTENCE_RMC);
+	CHECK(frame.data.rmc.latitude == NMEA_FIXED_NONE && frame.data.rmc.longitude == NMEA_FIXED_NONE);
+	CHECK(frame.data.rmc.speed == NMEA_FIXED_NONE && frame.data.rmc.time.hours == -1);
+
+	fine.coord = 9;
+	CHECK(nmea_parse_fixed(&frame, "$GPGLL,3751.65,S,14507.36,E,081836,A", false, &fine) == NMEA_SENTENCE_GLL);
+	CHECK(frame.data.gll.latitude == -37860833333);
+	fine.coord = 10;
+	CHECK(nmea_parse_fixed(&frame, "$GPGLL,3751.65,S,14507.36,E,081836,A", false, &fine) == NMEA_INVALID);
+	CHECK(nmea_parse_fixed(&frame, "$GPGLL,3751.65,X,14507.36,E,081836,A", false, &units) == NMEA_INVALID);
+	CHECK(nmea_parse_fixed(&frame, "$GPGSV,1,1,00", false, &units) == NMEA_UNKNOWN);
+}
+
+// RMC без контрольной суммы: cs - сотые секунды, координаты в 1e-4 минуты
+static const char *thin_rmc(char *line, long cs, long latitude, long longitude, int course)
+{
+	cs %= 8640000;
+	sprintf(line, "$GPRMC,%02ld%02ld%02ld.%02ld,A,%04ld.%04ld,N,%05ld.%04ld,E,10.0,%03d.0,150624,,",
+	        cs / 360000, cs / 6000 % 60, cs / 100 % 60, cs % 100, latitude / 10000, latitude % 10000,
+	        longitude / 10000, longitude % 10000, course);
+	return line;
+}
+
+static void test_thin(void)
+{
+	struct nmea_thin_options options = {0};
+	struct nmea_thin thin;
+	struct nmea_thin_point out[NMEA_THIN_WINDOW];
+	struct nmea_sentence frame;
+	char line[NMEA_MAX_LENGTH + 1];
+	int emitted = 0, unwanted = 0;
+
+	// 20 Гц в 1 Гц: nmea_thin_wanted() совпадает с решением сетки
+	options.interval = 1000;
+	nmea_thin_init(&thin, &options);
+	for (long i = 0; i < 200; i++) {
+		thin_rmc(line, 4500000 + i * 5, 48070380, 11310000 + i * 10, 90);
+		unwanted += !nmea_thin_wanted(&thin, line);
+		CHECK(nmea_parse_any(&frame, line, false) == NMEA_SENTENCE_RMC);
+		emitted += nmea_thin_push(&thin, &frame, out);
+	}
+	CHECK(emitted == 10 && thin.emitted == 10);
+	CHECK(thin.decimated == 190 && unwanted == 190);
+	CHECK(nmea_thin_wanted(&thin, "$GPGSV,1,1,00"));
+
+	// Переход через полночь
+	nmea_thin_init(&thin, &options);
+	CHECK(nmea_parse_any(&frame, thin_rmc(line, 8639950, 48070380, 11310000, 90), false) == NMEA_SENTENCE_RMC);
+	CHECK(nmea_thin_push(&thin, &frame, out) == 1 && out[0].time == 86399500);
+	CHECK(nmea_parse_any(&frame, thin_rmc(line, 8640000, 48070380, 11310000, 90), false) == NMEA_SENTENCE_RMC);
+	CHECK(nmea_thin_push(&thin, &frame, out) == 1 && out[0].time == 86400000);
+
+	// Запоздавшее предложение до полуночи - повтор, смещения на сутки нет
+	options.interval = 0;
+	nmea_thin_init(&thin, &options);
+	CHECK(nmea_parse_any(&frame, thin_rmc(line, 100, 48070380, 11310000, 90), false) == NMEA_SENTENCE_RMC);
+	CHECK(nmea_thin_push(&thin, &frame, out) == 1 && out[0].time == 1000);
+	CHECK(!nmea_thin_wanted(&thin, thin_rmc(line, 8639900, 48070380, 11310000, 90)));
+	CHECK(nmea_parse_any(&frame, line, false) == NMEA_SENTENCE_RMC);
+	CHECK(nmea_thin_push(&thin, &frame, out) == 0 && thin.decimated == 1 && thin.last == 1000);
+	CHECK(nmea_parse_any(&frame, thin_rmc(line, 200, 48070380, 11310000, 90), false) == NMEA_SENTENCE_RMC);
+	CHECK(nmea_thin_push(&thin, &frame, out) == 1 && out[0].time == 2000);
+	options.interval = 1000;
+
+	// Стоянка с шумом около 0.2 м: первая точка и keepalive, затем смещение 10 м
+	options.distance = 5.0;
+	options.keepalive = 30000;
+	nmea_thin_init(&thin, &options);
+	emitted = 0;
+	for (long i = 0; i < 60; i++) {
+		thin_rmc(line, 4500000 + i * 100, 48070380 + (i & 1), 11310000 - (i & 2), 90);
+		CHECK(nmea_parse_any(&frame, line, false) == NMEA_SENTENCE_RMC);
+		emitted += nmea_thin_push(&thin, &frame, out);
+	}
+	CHECK(emitted == 2 && thin.stationary == 58);
+	CHECK(nmea_parse_any(&frame, thin_rmc(line, 4506000, 48070380 + 54, 11310000, 90), false) == NMEA_SENTENCE_RMC);
+	CHECK(nmea_thin_push(&thin, &frame, out) == 1);
+
+	// Упрощение: 20 точек на восток и 20 на север - начало, поворот и конец
+	memset(&options, 0, sizeof(options));
+	options.tolerance = 1.0;
+	nmea_thin_init(&thin, &options);
+	emitted = 0;
+	for (long i = 0; i < 40; i++) {
+		long east = i < 20 ? i : 19, north = i < 20 ? 0 : i - 19;
+		thin_rmc(line, 4500000 + i * 100, 48070380 + north * 100, 11310000 + east * 100, i < 20 ? 90 : 0);
+		CHECK(nmea_parse_any(&frame, line, false) == NMEA_SENTENCE_RMC);
+		emitted += nmea_thin_push(&thin, &frame, out);
+	}
+	CHECK(emitted == 1);
+	CHECK(nmea_thin_flush(&thin, out) == 2);
+	CHECK(out[0].time == 45019000 && out[1].time == 45039000);
+	CHECK(fabs(out[1].latitude - (48.0 + 7.238 / 60.0)) < 1e-9);
+	CHECK(thin.simplified == 37 && thin.emitted == 3);
+}
+
+#ifndef _WIN32
+struct replay_check {
+	const uint64_t *offsets;	// ожидаемые смещения строк
+	size_t next;				// номер следующего ожидаемого предложения
+	int calls;
+	int stop;					// остановка после stop вызовов, 0 - нет
+	int bad;
+};
+
+static bool replay_cb(void *ctx, const struct nmea_sentence *frames, const uint64_t *offsets, size_t count)
+{
+	struct replay_check *check = ctx;
+
+	for (size_t i = 0; i < count; i++, check->next++) {
+		const struct nmea_time *t = &frames[i].data.gga.time;
+		if (frames[i].id != NMEA_SENTENCE_GGA || offsets[i] != check->offsets[check->next] ||
+		    (size_t) (t->hours * 3600 + t->minutes * 60 + t->seconds) != check->next)
+			check->bad++;
+	}
+	return !check->stop || ++check->calls < check->stop;
+}
+
+static void test_replay(void)
+{
+	enum { N = 500 };
+	static char buf[N * 80];
+	static uint64_t offsets[N];
+	struct nmea_replay_options options = {.threads = 4, .chunk_size = 256, .strict = false};
+	struct nmea_replay_stats stats;
+	struct replay_check check = {offsets, 0, 0, 0, 0};
+	size_t len = 0;
+
+	// Блоки по 256 байт на 4 потока, последняя строка без '\n'
+	for (int i = 0; i < N; i++) {
+		offsets[i] = len;
+		len += (size_t) sprintf(buf + len, "$GPGGA,%02d%02d%02d,4807.038,N,01131.000,E,1,08,0.9,545.4,M,46.9,M,,%s",
+		                        i / 3600, i / 60 % 60, i % 60, i + 1 < N ? "\r\n" : "");
+	}
+
+	CHECK(nmea_replay_buffer(buf, len, &options, replay_cb, &check, &stats) == 0);
+	CHECK(check.next == N && check.bad == 0);
+	CHECK(stats.sentences == N && stats.bytes == len && stats.invalid == 0);
+
+	// Остановка из обработчика: дальше блоки не выдаются
+	memset(&check, 0, sizeof(check));
+	check.offsets = offsets;
+	check.stop = 3;
+	CHECK(nmea_replay_buffer(buf, len, &options, replay_cb, &check, &stats) == 0);
+	CHECK(check.calls == 3 && check.next > 0 && check.next < N && check.bad == 0);
+	CHECK(stats.sentences == check.next);
+}
+#endif
+
+#ifdef __linux__
+struct ingest_counter {
+	int sentences;
+	int closed;
+	int bad;
+};
+
+static void ingest_cb(void *ctx, int receiver, const struct nmea_sentence *frames, size_t count)
+{
+	struct ingest_counter *counter = ctx;
+
+	(void) receiver;
+	if (!frames) {
+		__atomic_add_fetch(&counter->closed, 1, __ATOMIC_RELAXED);
+		return;
+	}
+	for (size_t i = 0; i < count; i++)
+		if (frames[i].id != NMEA_SENTENCE_GGA || frames[i].data.gga.satellites_tracked != 8)
+			__atomic_add_fetch(&counter->bad, 1, __ATOMIC_RELAXED);
+	__atomic_add_fetch(&counter->sentences, (int) count, __ATOMIC_RELAXED);
+}
+
+static bool ingest_wait(struct ingest_counter *counter, int sentences, int closed)
+{
+	for (int i = 0; i < 2000; i++) {
+		if (__atomic_load_n(&counter->sentences, __ATOMIC_RELAXED) >= sentences &&
+		    __atomic_load_n(&counter->closed, __ATOMIC_RELAXED) >= closed)
+			return true;
+		usleep(1000);
+	}
+	return false;
+}
+
+// Обработчик, который читает счетчики и удаляет свой приемник
+struct ingest_self {
+	struct nmea_ingest *ingest;
+	int calls;
+	int closed;
+	int bad;
+};
+
+static void ingest_self_cb(void *ctx, int receiver, const struct nmea_sentence *frames, size_t count)
+{
+	struct ingest_self *self = ctx;
+	struct nmea_ingest_stats stats;
+
+	(void) count;
+	if (!frames) {
+		__atomic_add_fetch(&self->closed, 1, __ATOMIC_RELAXED);
+		return;
+	}
+	if (nmea_ingest_stats(self->ingest, receiver, &stats) || !stats.open || nmea_ingest_remove(self->ingest, receiver))
+		__atomic_add_fetch(&self->bad, 1, __ATOMIC_RELAXED);
+	__atomic_add_fetch(&self->calls, 1, __ATOMIC_RELAXED);
+}
+
+static void test_ingest_self(const char *line)
+{
+	struct ingest_self self = {NULL, 0, 0, 0};
+	struct nmea_ingest_stats stats;
+	int pair[2];
+
+	self.ingest = nmea_ingest_create(NULL, ingest_self_cb);
+	CHECK(self.ingest != NULL && socketpair(AF_UNIX, SOCK_STREAM, 0, pair) == 0);
+	if (!self.ingest)
+		return;
+	int id = nmea_ingest_add(self.ingest, pair[0], &self);
+	CHECK(id >= 0);
+	CHECK(write(pair[1], line, strlen(line)) == (ssize_t) strlen(line));
+	for (int i = 0; i < 2000 && !__atomic_load_n(&self.calls, __ATOMIC_RELAXED); i++)
+		usleep(1000);
+
+	// После удаления из обработчика данные приемника больше не выдаются
+	// (дескриптор закрыт, запись получает EPIPE)
+	CHECK(send(pair[1], line, strlen(line), MSG_NOSIGNAL) < 0);
+	usleep(20000);
+	CHECK(__atomic_load_n(&self.calls, __ATOMIC_RELAXED) == 1 && __atomic_load_n(&self.closed, __ATOMIC_RELAXED) == 0 &&
+	      __atomic_load_n(&self.bad, __ATOMIC_RELAXED) == 0);
+	CHECK(nmea_ingest_stats(self.ingest, id, &stats) == 0 && !stats.open && stats.sentences == 1);
+	close(pair[1]);
+	nmea_ingest_destroy(self.ingest);
+}
+
+// Обработчики двух потоков одновременно удаляют приемники друг друга
+struct ingest_cross {
+	struct nmea_ingest *ingest;
+	int ids[2];
+	int entered;
+	int calls;
+	int bad;
+};
+
+static void ingest_cross_cb(void *ctx, int receiver, const struct nmea_sentence *frames, size_t count)
+{
+	struct ingest_cross *cross = ctx;
+
+	(void) count;
+	if (!frames)
+		return;
+	// Оба обработчика внутри, затем удаление чужого приемника
+	__atomic_add_fetch(&cross->entered, 1, __ATOMIC_SEQ_CST);
+	for (int i = 0; i < 2000 && __atomic_load_n(&cross->entered, __ATOMIC_SEQ_CST) < 2; i++)
+		usleep(1000);
+	if (nmea_ingest_remove(cross->ingest, cross->ids[receiver == cross->ids[0]]))
+		__atomic_add_fetch(&cross->bad, 1, __ATOMIC_RELAXED);
+	__atomic_add_fetch(&cross->calls, 1, __ATOMIC_RELAXED);
+}
+
+static void test_ingest_cross(const char *line)
+{
+	struct nmea_ingest_options options = {.threads = 2};
+	struct ingest_cross cross = {NULL, {-1, -1}, 0, 0, 0};
+	struct nmea_ingest_stats stats;
+	int pair[2][2];
+
+	cross.ingest = nmea_ingest_create(&options, ingest_cross_cb);
+	CHECK(cross.ingest != NULL);
+	if (!cross.ingest)
+		return;
+	// Приемники распределяются по потокам по кругу
+	for (int i = 0; i < 2; i++) {
+		CHECK(socketpair(AF_UNIX, SOCK_STREAM, 0, pair[i]) == 0);
+		cross.ids[i] = nmea_ingest_add(cross.ingest, pair[i][0], &cross);
+		CHECK(cross.ids[i] >= 0);
+	}
+	for (int i = 0; i < 2; i++)
+		CHECK(write(pair[i][1], line, strlen(line)) == (ssize_t) strlen(line));
+	for (int i = 0; i < 4000 && __atomic_load_n(&cross.calls, __ATOMIC_RELAXED) < 2; i++)
+		usleep(1000);
+
+	CHECK(__atomic_load_n(&cross.calls, __ATOMIC_RELAXED) == 2 && __atomic_load_n(&cross.bad, __ATOMIC_RELAXED) == 0);
+	for (int i = 0; i < 2; i++) {
+		CHECK(nmea_ingest_stats(cross.ingest, cross.ids[i], &stats) == 0 && !stats.open);
+		close(pair[i][1]);
+	}
+	nmea_ingest_destroy(cross.ingest);
+
+	// Ошибка добавления (epoll не принимает обычный файл): дескриптор закрыт
+	struct nmea_ingest *ingest = nmea_ingest_create(NULL, ingest_cb);
+	FILE *file = tmpfile();
+	int fd = file ? dup(fileno(file)) : -1;
+	CHECK(ingest != NULL && file != NULL && fd >= 0);
+	if (ingest && file) {
+		CHECK(nmea_ingest_add(ingest, fd, NULL) < 0);
+		CHECK(fcntl(fd, F_GETFD) < 0 && errno == EBADF);
+	}
+	if (file)
+		fclose(file);
+	nmea_ingest_destroy(ingest);
+}
+
+static void test_ingest(void)
+{
+	const char *line = "$GPGGA,123519,4807.038,N,01131.000,E,1,08,0.9,545.4,M,46.9,M,,*47\r\n";
+	struct nmea_ingest_options options = {.threads = 2, .strict = true};
+	struct ingest_counter sock = {0, 0, 0}, pty = {0, 0, 0};
+	struct nmea_ingest_stats stats;
+	struct termios tio;
+	int pair[2];
+
+	struct nmea_ingest *ingest = nmea_ingest_create(&options, ingest_cb);
+	CHECK(ingest != NULL);
+	if (!ingest)
+		return;
+
+	// Сокет: строки приходят частями и с мусором
+	CHECK(socketpair(AF_UNIX, SOCK_STREAM, 0, pair) == 0);
+	int sid = nmea_ingest_add(ingest, pair[0], &sock);
+	CHECK(sid >= 0);
+	size_t written = 0;
+	for (int i = 0; i < 300; i++) {
+		written += (size_t) write(pair[1], line, 20);
+		written += (size_t) write(pair[1], line + 20, strlen(line) - 20);
+		if (i % 100 == 0)
+			written += (size_t) write(pair[1], "junk\n", 5);
+	}
+	CHECK(written == 300 * strlen(line) + 15);
+
+	// pty: приемник - подчиненная сторона, данные пишутся в главную
+	int master = posix_openpt(O_RDWR | O_NOCTTY);
+	CHECK(master >= 0 && grantpt(master) == 0 && unlockpt(master) == 0);
+	int slave = open(ptsname(master), O_RDWR | O_NOCTTY);
+	CHECK(slave >= 0 && tcgetattr(slave, &tio) == 0);
+	cfmakeraw(&tio);
+	CHECK(tcsetattr(slave, TCSANOW, &tio) == 0);
+	int pid = nmea_ingest_add(ingest, slave, &pty);
+	CHECK(pid >= 0 && pid != sid);
+	written = 0;
+	for (int i = 0; i < 100; i++)
+		written += (size_t) write(master, line, strlen(line));
+	CHECK(written == 100 * strlen(line));
+
+	CHECK(ingest_wait(&sock, 300, 0) && ingest_wait(&pty, 100, 0));
+	close(pair[1]);
+	CHECK(ingest_wait(&sock, 300, 1));
+	CHECK(nmea_ingest_stats(ingest, sid, &stats) == 0 && !stats.open && stats.sentences == 300);
+	CHECK(stats.bytes == 300 * strlen(line) + 15);
+
+	CHECK(nmea_ingest_remove(ingest, pid) == 0);
+	CHECK(nmea_ingest_stats(ingest, pid, &stats) == 0 && !stats.open && stats.sentences == 100);
+	CHECK(sock.sentences == 300 && pty.sentences == 100 && !sock.bad && !pty.bad && pty.closed == 0);
+	close(master);
+	nmea_ingest_destroy(ingest);
+
+	test_ingest_self(line);
+	test_ingest_cross(line);
+}
+#endif
+
+int main(void)
+{
+	test_check();
+	test_layout();
+	test_parse();
+	test_parse_fields();
+	test_parse_any();
+	test_register();
+	test_stream();
+	test_batch();
+	test_epoch();
+	test_gsv();
+	test_view();
+	test_log();
+	test_index();
+	test_write();
+	test_ubx();
+	test_ubx_cfg();
+	test_stats();
+	test_coord();
+	test_geo();
+	test_fixed();
+	test_thin();
+#ifndef _WIN32
+	test_replay();
+#endif
+#ifdef __linux__
+	test_ingest();
+#endif
+
+	printf("%d checks, %d failures\n", checks, failures);
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,171 @@
+/*
+ * Индекс времени файла захвата NMEA (файл рядом с захватом) и выборка
+ * строк за интервал без разбора файла с начала.
+ *
+ * nmea_index build CAPTURE [INDEX]
+ * nmea_index query CAPTURE FROM TO [INDEX]
+ *
+ * FROM, TO - секунды UNIX или ГГГГ-ММ-ДДTчч:мм:сс (UTC), INDEX по
+ * умолчанию CAPTURE.idx. Индекс дополняется, если захват вырос.
+ */
+#define _FILE_OFFSET_BITS			64	// захваты больше 2 ГБ при 32-битном long
+#include "nmea.h"
+#include "nmea_index.h"
+
+
+
+//------------------- DEFINES -----------------------------
+#include <sys/types.h>
+
+#define INDEX_CHUNK					(1 << 20)
+
+#ifdef _WIN32
+#define fseeko						_fseeki64
+#define ftello						_ftelli64
+typedef __int64 index_off;
+#else
+typedef off_t index_off;
+#endif
+
+
+//------------------- FUNCTIONS ---------------------------
+static int64_t parse_time(const char *s)
+{
+	int year, month, day, hours, minutes, seconds;
+	char *end;
+
+	if (sscanf(s, "%d-%d-%dT%d:%d:%d", &year, &month, &day, &hours, &minutes, &seconds) == 6)
+		return nmea_days_from_civil(year, month, day) * 86400 + hours * 3600 + minutes * 60 + seconds;
+
+	long long t = strtoll(s, &end, 10);
+	if (end == s || *end) {
+		fprintf(stderr, "bad time: %s\n", s);
+		exit(2);
+	}
+	return t;
+}
+
+// Загрузка индекса и дочитывание захвата с index->scanned
+static int index_update(struct nmea_index *index, const char *capture, const char *path)
+{
+	FILE *file = fopen(path, "rb");
+	char *buf;
+	size_t have = 0;
+
+	if (!file || nmea_index_load(index, file))
+		nmea_index_init(index, 0);
+	if (file)
+		fclose(file);
+
+	file = fopen(capture, "rb");
+	if (!file) {
+		perror(capture);
+		return -1;
+	}
+	index_off size = fseeko(file, 0, SEEK_END) ? -1 : ftello(file);
+	if (size < 0) {
+		perror(capture);
+		fclose(file);
+		return -1;
+	}
+	// Захват перезаписан (короче разобранного) - индекс строится заново
+	if ((uint64_t) size < index->scanned) {
+		nmea_index_free(index);
+		nmea_index_init(index, 0);
+	}
+	buf = malloc(INDEX_CHUNK);
+	if (!buf || fseeko(file, (index_off) index->scanned, SEEK_SET)) {
+		free(buf);
+		fclose(file);
+		return -1;
+	}
+
+	for (;;) {
+		size_t got = fread(buf + have, 1, INDEX_CHUNK - have, file);
+		if (!got)
+			break;
+		have += got;
+		ptrdiff_t used = nmea_index_update(index, buf, have);
+		if (used < 0)
+			break;
+		have -= (size_t) used;
+		memmove(buf, buf + used, have);
+	}
+	free(buf);
+	fclose(file);
+
+	file = fopen(path, "wb");
+	if (!file || nmea_index_save(index, file)) {
+		perror(path);
+		if (file)
+			fclose(file);
+		return -1;
+	}
+	fclose(file);
+	return 0;
+}
+
+static int query(const struct nmea_index *index, const char *capture, int64_t from, int64_t to)
+{
+	struct nmea_index_clock clock = {-1, -1};
+	char line[NMEA_MAX_LENGTH * 4];
+	long printed = 0;
+	FILE *file = fopen(capture, "rb");
+
+	if (!file || fseeko(file, (index_off) nmea_index_seek(index, from), SEEK_SET)) {
+		perror(capture);
+		if (file)
+			fclose(file);
+		return -1;
+	}
+
+	// Строки без времени (GSA, GSV, ...) относятся к последнему времени
+	int64_t t = -1;
+	while (fgets(line, sizeof(line), file)) {
+		struct nmea_sentence frame;
+		if (nmea_parse_any(&frame, line, false) > NMEA_UNKNOWN)
+			nmea_index_time(&clock, &frame, &t);
+		if (t > to)
+			break;
+		if (t >= 0 && t >= from) {
+			fputs(line, stdout);
+			printed++;
+		}
+	}
+
+	fclose(file);
+	fprintf(stderr, "%ld lines\n", printed);
+	return 0;
+}
+
+int main(int argc, char *argv[])
+{
+	struct nmea_index index;
+	char path[4096];
+	const char *capture = argc > 2 ? argv[2] : NULL;
+	int result;
+
+	if (argc >= 3 && argc <= 4 && !strcmp(argv[1], "build")) {
+		snprintf(path, sizeof(path), "%s", argc == 4 ? argv[3] : "");
+	} else if (argc >= 5 && argc <= 6 && !strcmp(argv[1], "query")) {
+		snprintf(path, sizeof(path), "%s", argc == 6 ? argv[5] : "");
+	} else {
+		fprintf(stderr, "usage: %s build CAPTURE [INDEX]\n"
+		                "       %s query CAPTURE FROM TO [INDEX]\n", argv[0], argv[0]);
+		return 2;
+	}
+	if (!path[0])
+		snprintf(path, sizeof(path), "%s.idx", capture);
+
+	if (index_update(&index, capture, path))
+		return 1;
+	if (!strcmp(argv[1], "build")) {
+		fprintf(stderr, "%zu entries, %llu bytes indexed\n", index.count, (unsigned long long) index.scanned);
+		result = 0;
+	} else {
+		result = query(&index, capture, parse_time(argv[3]), parse_time(argv[4]));
+	}
+
+	nmea_index_free(&index);
+	return result ? 1 : 0;
+}